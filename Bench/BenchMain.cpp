@@ -0,0 +1,2545 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <math.h>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "SyntheticMatch.h"
+#include "Game.h"
+#include "ValueEngine.h"
+#include "VEEventStore.h"
+#include "RTPassage.h"
+#include "RTReplayLog.h"
+#include "RTEventList.h"
+#include "Timeline.h"
+#include "ParallelReplay.h"
+#include "Environment.h"
+#include "Match.h"
+#include "Record.h"
+#include "CVMarker.h"
+#include "RTProcessBuffer.h"
+#include "RTStats.h"
+#include "RTBus.h"
+#include "qthreads.h"
+
+/*
+	StormBench [options]
+
+	Benchmark suite on a synthetic match (SyntheticMatch.h). Every benchmark writes one
+	JSON object per line, so the results of two versions can be compared by a script:
+
+		{"suite":...}               settings of the run
+		{"bench":"generate",...}    the synthetic match written as a replay log
+		{"bench":"parse",...}       RTReplayLogNext over the log
+		{"bench":"process",...}     RTCoreProcess end to end: parse module, Value Engine
+		                            commit, latency from RTCoreProcess until the data is
+		                            destroyed (the log is fed at full rate, so it includes
+		                            the queueing in the Process Buffer), heap allocations
+		                            per record, peak RSS
+		{"bench":"live",...}        the log fed at BENCH_LIVE_SPEED times its game time into an
+		                            instance that spends BENCH_LIVE_WORK_USEC on every entry,
+		                            without and with live mode: latency until the commit,
+		                            entries dropped, time at each level, values deferred
+		{"bench":"event_list",...}  RTEventList insert, pop expired and refresh
+		{"bench":"process_buffer",...}  one producer thread, the consumer pops batches
+		{"bench":"logger",...}      LogFormat from the calling thread, and until written
+		{"bench":"dispatch",...}    actions into the Value Engine by instruction name
+		                            (ActionDetected) and as RTBus messages
+		{"bench":"entity_index",...}  unit id to player lookups for a match of units, in the
+		                            EntityIndex of GameClass and in a DuList with a comparator,
+		                            and summons coming and going in the index
+		{"bench":"threads",...}     the Q-Threads library linked in: mutex P/V with 1 to 8
+		                            threads on one mutex, semaphore round trip between two
+		                            threads, how late a 1 ms timedwait returns
+		{"bench":"timeline",...}    Timeline over the log: build cost and snapshot memory,
+		                            random seeks against replaying from the start, stepping
+		                            back from the end, the states compared with a straight run
+		{"bench":"event_store",...}  VEEventStore of the match: appends, player totals over a
+		                            time window against a scan of the rows and of the log,
+		                            top abilities, the same queries over mapped segments
+		{"bench":"segmented",...}   ParallelReplay of the log: time segments starting at
+		                            deaths and objectives analysed on a pool against the
+		                            straight run, outputs diffed byte for byte
+		{"bench":"matches",...}     BENCH_MATCHES matches in one process on one shared
+		                            environment, each fed the log by a thread of its own:
+		                            memory and heap per additional match, throughput, the
+		                            values of every match against a match run alone
+		{"bench":"markers",...}     CVMarkerDecode over synthetic minimap frames, per kernel
+		                            with a full search every frame and with tracking:
+		                            markers decoded, correct, false and missed, decode time
+		                            per frame, the kernels compared with the scalar one
+
+	--out path          results file, default stdout
+	--log path          where the synthetic log is written, default storm_bench.log
+	--only name         runs one benchmark (generate always runs, the others read its log)
+	--seed n            match settings, see SyntheticMatchSettings
+	--seconds s
+	--density e         records per second outside team fights
+	--fights n          team fights per minute
+	--fight-seconds s
+	--burst x           rate multiplier in a team fight
+	--ops n             operations of the micro-benchmarks
+*/
+
+#define BENCH_RESULTS_FORMAT        1
+#define BENCH_DEFAULT_LOG           "storm_bench.log"
+#define BENCH_DEFAULT_OPS           2000000
+/* events kept in the Event List by the event_list benchmark */
+#define BENCH_EVENT_LIST_SIZE       1024
+/* units of the match in the entity_index benchmark, by kind */
+#define BENCH_NOF_SUMMONS           200
+#define BENCH_NOF_CAMPS             40
+#define BENCH_NOF_STRUCTURES        40
+/* ids looked up, one in BENCH_MISS_RATIO is of no unit */
+#define BENCH_NOF_QUERIES           4096
+#define BENCH_MISS_RATIO            10
+/* most threads on one mutex in the threads benchmark */
+#define BENCH_MAX_LOCK_THREADS      8
+#define BENCH_TIMEDWAITS            50
+/* seeks of the timeline benchmark, and the snapshot budget of its bounded run */
+#define BENCH_TIMELINE_SEEKS        500
+#define BENCH_TIMELINE_MAX_BYTES    (64 << 10)
+/* queries of the event_store benchmark over a window of BENCH_STORE_WINDOW seconds, the
+   log scans are slow and only done for the first few; matches of its season */
+#define BENCH_STORE_QUERIES         1000
+#define BENCH_STORE_LOG_QUERIES     10
+#define BENCH_STORE_WINDOW          120.0
+#define BENCH_STORE_SEGMENTS        8
+/* workers of the segmented runs, besides one per core */
+#define BENCH_SEGMENT_WORKERS       4
+
+#define BENCH_LIVE_SPEED            300.0   /* game seconds fed per wall second, the team fights overload the budget */
+#define BENCH_LIVE_WORK_USEC        20      /* analysis of an entry on the TIME_TICK thread */
+#define BENCH_LIVE_TARGET           0.002
+#define BENCH_LIVE_SHARE            0.5
+#define BENCH_LIVE_WINDOW           0.1
+
+#define BENCH_MATCHES               32
+#define BENCH_MATCH_ICON_SIZE       24      /* pixels per side of a recognition template */
+
+/* minimap frames of the markers benchmark, when the odd slots die and how long they are dead */
+#define BENCH_MARKER_FRAMES         600
+#define BENCH_MARKER_MODULE         CV_MARKER_DEFAULT_MODULE
+#define BENCH_MARKER_BLOBS          150
+#define BENCH_MARKER_FIRST_DEATH    60
+#define BENCH_MARKER_DEATH_STEP     40
+#define BENCH_MARKER_DEAD_FRAMES    90
+
+
+using namespace std;
+
+
+static FILE *glOut;
+
+
+/*
+	Heap allocations of the process, every operator new counts. The C allocations of the
+	ds/du libraries are not seen; the data pool reports its own (pool_mallocs).
+*/
+static std::atomic<unsigned long long> glNofAllocs(0);
+static std::atomic<unsigned long long> glAllocBytes(0);
+
+void* operator new(size_t size)
+{
+	void *p;
+
+	glNofAllocs.fetch_add(1, std::memory_order_relaxed);
+	glAllocBytes.fetch_add(size, std::memory_order_relaxed);
+	p = malloc(size != 0 ? size : 1);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	glNofAllocs.fetch_add(1, std::memory_order_relaxed);
+	glAllocBytes.fetch_add(size, std::memory_order_relaxed);
+	return malloc(size != 0 ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+
+static int64_t NowNsec()
+{
+	return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+static unsigned long PeakRssKb()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return (unsigned long)(counters.PeakWorkingSetSize / 1024);
+#else
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	return (unsigned long)usage.ru_maxrss;
+#endif
+}
+
+
+static unsigned long CurrentRssKb()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return (unsigned long)(counters.WorkingSetSize / 1024);
+#else
+	unsigned long size, resident;
+	FILE *f;
+
+	f = fopen("/proc/self/statm", "r");
+	if (f == NULL)
+		return 0;
+	if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+		resident = 0;
+	fclose(f);
+	return (unsigned long)(resident * (sysconf(_SC_PAGESIZE) / 1024));
+#endif
+}
+
+
+/* One line of results: "bench":name and the fields of format */
+static void WriteResult(const char* name, const char* format, ...)
+{
+	va_list args;
+
+	fprintf(glOut, "{\"bench\":\"%s\",", name);
+	va_start(args, format);
+	vfprintf(glOut, format, args);
+	va_end(args);
+	fprintf(glOut, "}\n");
+	fflush(glOut);
+}
+
+
+/* value of sorted at fraction p (0 - 1) */
+static int64_t Percentile(const std::vector<int64_t>& sorted, double p)
+{
+	size_t i;
+
+	if (sorted.empty())
+		return 0;
+	i = (size_t)(p * (double)(sorted.size() - 1) + 0.5);
+	return sorted[i];
+}
+
+
+
+static int BenchGenerate(const SyntheticMatchSettings* settings, const char* path, unsigned long* nofRecords)
+{
+	SyntheticMatchClass match;
+	unsigned long long nofBytes;
+	int64_t start;
+	double seconds;
+	int ret;
+
+	ret = match.Start(settings);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	start = NowNsec();
+	ret = match.WriteLog(path, nofRecords, &nofBytes);
+	seconds = (NowNsec() - start) * 1e-9;
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	WriteResult("generate", "\"records\":%lu,\"bytes\":%llu,\"seconds\":%.6f,\"records_per_s\":%.0f",
+	            *nofRecords, nofBytes, seconds, (seconds > 0.0) ? *nofRecords / seconds : 0.0);
+	return RT_RETURN_OK;
+}
+
+
+static int BenchParse(const char* path)
+{
+	RTReplayLogStats stats;
+	RTReplayLog log;
+	RTPassage passage;
+	double time;
+	int64_t start;
+	double seconds;
+	int ret;
+
+	ret = RTReplayLogOpen(path, 0, RT_REPLAY_LOG_FLAG_NO_CACHE, &log);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	start = NowNsec();
+	while ((ret = RTReplayLogNext(log, &passage, &time)) == RT_RETURN_OK)
+		;
+	seconds = (NowNsec() - start) * 1e-9;
+	RTReplayLogGetStats(log, &stats);
+	RTReplayLogClose(log);
+	if (ret != RT_RETURN_END_OF_LOG)
+		return ret;
+
+	WriteResult("parse", "\"records\":%lu,\"bytes\":%llu,\"seconds\":%.6f,\"records_per_s\":%.0f,\"mb_per_s\":%.1f",
+	            stats.nofRecords, stats.nofBytes, seconds, (seconds > 0.0) ? stats.nofRecords / seconds : 0.0,
+	            (seconds > 0.0) ? stats.nofBytes / seconds / 1e6 : 0.0);
+	return RT_RETURN_OK;
+}
+
+
+
+/*
+	process: the records go through RTCoreProcess into two modules, "register" parses a
+	record into a VEEvent and "value" commits it to the GameClass and the Value Engine
+	of the match. The entry of a record holds its event and times it, from RTCoreProcess
+	until the TIME_TICK thread destroys its data.
+*/
+typedef struct _BenchEntry
+{
+	int64_t         pushed;
+	int64_t         latency;
+	VEEvent         event;
+} BenchEntry;
+
+typedef struct _BenchMatch
+{
+	GameClass                   *game;
+	ValueEngine                 *engine;
+	std::atomic<unsigned long>  nofReleased;
+	unsigned long               nofCommitted;
+} BenchMatch;
+
+static BenchMatch glMatch;
+
+
+static int RegisterProcess(RTDataStruct* data, int moduleIndex, void* context)
+{
+	BenchEntry *entry = (BenchEntry*)data->pUserData;
+	const RTPassageStruct *passage;
+
+	(void)moduleIndex;
+	(void)context;
+	if (entry == NULL || data->nofpassages < 1)
+		return RT_RETURN_ILLEGAL_DATA;
+	passage = (const RTPassageStruct*)data->passages[0];
+	return RecordClass::Parse(passage->data, passage->size, &entry->event);
+}
+
+
+static int ValueProcess(RTDataStruct* data, int moduleIndex, void* context)
+{
+	(void)data;
+	(void)moduleIndex;
+	(void)context;
+	return RT_RETURN_OK;
+}
+
+
+/* The event changes the game, then the values */
+static void ApplyEvent(GameClass* game, ValueEngine* engine, const VEEvent* event)
+{
+	RecordClass::ApplyGame(game, event);
+	engine->HandleEvent(event);
+	engine->Tick(event->time);
+}
+
+
+/* TIME_TICK thread */
+static void ValueCommit(RTDataStruct* data, int moduleIndex, void* context)
+{
+	BenchMatch *match = (BenchMatch*)context;
+	BenchEntry *entry = (BenchEntry*)data->pUserData;
+
+	if (data->haserror || data->moduleReturnValue[moduleIndex] != RT_RETURN_OK)
+		return;
+	entry->event.time = data->timeStamp;
+	ApplyEvent(match->game, match->engine, &entry->event);
+	match->nofCommitted++;
+}
+
+
+static void ReleaseEntry(void* userdata)
+{
+	BenchEntry *entry = (BenchEntry*)userdata;
+
+	entry->latency = NowNsec() - entry->pushed;
+	glMatch.nofReleased.fetch_add(1, std::memory_order_release);
+}
+
+
+static int BenchProcess(const char* path, unsigned long nofRecords)
+{
+	RTModuleSettings modules[2];
+	RTDataAllocStats poolBefore, poolAfter;
+	std::vector<BenchEntry> entries(nofRecords);
+	std::vector<int64_t> latencies;
+	unsigned long long allocsBefore, allocs;
+	unsigned long n = 0, nofDropped = 0;
+	RTDataStruct *data;
+	RTReplayLog log;
+	GameClass game;
+	ValueEngine engine;
+	int64_t start;
+	double seconds;
+	GameEntity entity;
+	int team, i, ret;
+
+	for (team = 0; team < GAME_NOF_TEAMS; team++)
+		for (i = 0; i < GAME_PLAYERS_PER_TEAM; i++)
+			game.AddPlayer(team, team * GAME_PLAYERS_PER_TEAM + i, &entity);
+	engine.Bind(&game);
+	glMatch.game = &game;
+	glMatch.engine = &engine;
+	glMatch.nofReleased.store(0);
+	glMatch.nofCommitted = 0;
+
+	memset(modules, 0, sizeof(modules));
+	modules[0].name = "register";
+	modules[0].inputs = RT_PRODUCT_BIT(RT_PRODUCT_PASSAGES);
+	modules[0].outputs = RT_PRODUCT_BIT(RT_PRODUCT_REGISTER);
+	modules[0].process = RegisterProcess;
+	modules[1].name = "value";
+	modules[1].inputs = RT_PRODUCT_BIT(RT_PRODUCT_REGISTER);
+	modules[1].outputs = RT_PRODUCT_BIT(RT_PRODUCT_MACRO_VALUE);
+	modules[1].process = ValueProcess;
+	modules[1].commit = ValueCommit;
+	modules[1].context = &glMatch;
+	RTCoreAddModule(&modules[0], NULL);
+	RTCoreAddModule(&modules[1], NULL);
+
+	ret = RTCoreInit("BENCH", NULL, NULL);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	ret = RTReplayLogOpen(path, 0, RT_REPLAY_LOG_FLAG_NO_CACHE, &log);
+	if (ret != RT_RETURN_OK)
+	{
+		RTCoreFinalize();
+		return ret;
+	}
+
+	RTStatsReset();
+	RTCoreGetDataAllocStats(&poolBefore);
+	allocsBefore = glNofAllocs.load();
+	start = NowNsec();
+	while (n < nofRecords && (ret = RTReplayLogReadData(log, NULL, &data)) == RT_RETURN_OK)
+	{
+		BenchEntry *entry = &entries[n++];
+
+		entry->pushed = NowNsec();
+		RTCoreDataSetUserData(data, entry, ReleaseEntry);
+		ret = RTCoreProcess(data);
+		if (ret == RT_RETURN_PASSAGE_DROPPED || ret == RT_RETURN_BUFFER_OVERFLOW)
+			nofDropped++;
+		else if (ret != RT_RETURN_OK)
+			break;
+	}
+	if (ret == RT_RETURN_END_OF_LOG || n == nofRecords)
+		ret = RT_RETURN_OK;
+
+	/* every record pushed is destroyed once, handled or dropped */
+	while (glMatch.nofReleased.load(std::memory_order_acquire) < n)
+		QThread_sleep(1);
+	seconds = (NowNsec() - start) * 1e-9;
+	allocs = glNofAllocs.load() - allocsBefore;
+	RTCoreGetDataAllocStats(&poolAfter);
+
+	RTCoreFinalize();
+	RTReplayLogClose(log);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	latencies.reserve(n);
+	for (i = 0; i < (int)n; i++)
+		latencies.push_back(entries[i].latency);
+	std::sort(latencies.begin(), latencies.end());
+
+	WriteResult("process", "\"records\":%lu,\"committed\":%lu,\"dropped\":%lu,\"seconds\":%.6f,\"records_per_s\":%.0f,"
+	            "\"latency_p50_us\":%.2f,\"latency_p99_us\":%.2f,\"latency_max_us\":%.2f,"
+	            "\"heap_allocs_per_record\":%.4f,\"pool_allocs_per_record\":%.4f,\"pool_mallocs\":%lu,\"peak_rss_kb\":%lu",
+	            n, glMatch.nofCommitted, nofDropped, seconds, (seconds > 0.0) ? n / seconds : 0.0,
+	            Percentile(latencies, 0.5) / 1000.0, Percentile(latencies, 0.99) / 1000.0, Percentile(latencies, 1.0) / 1000.0,
+	            (n != 0) ? (double)allocs / n : 0.0,
+	            (n != 0) ? (double)(poolAfter.nofAllocs - poolBefore.nofAllocs) / n : 0.0,
+	            poolAfter.nofMallocs - poolBefore.nofMallocs, PeakRssKb());
+	return RT_RETURN_OK;
+}
+
+
+
+typedef struct _BenchLiveRun
+{
+	unsigned long   nofFed;
+	unsigned long   nofDropped;
+	double          seconds;
+	double          latency50;          /* us, of the entries committed */
+	double          latency99;
+	double          latencyMax;
+	VEStats         engine;
+	RTLiveStats     live;               /* zero without live mode */
+} BenchLiveRun;
+
+
+/* stands for the recognition and scoring of a live entry */
+static int LiveAnalyseProcess(RTDataStruct* data, int moduleIndex, void* context)
+{
+	int64_t end = NowNsec() + BENCH_LIVE_WORK_USEC * 1000;
+
+	(void)data;
+	(void)moduleIndex;
+	(void)context;
+	while (NowNsec() < end)
+		;
+	return RT_RETURN_OK;
+}
+
+
+/* One pass of the log at BENCH_LIVE_SPEED, live == NULL: live mode off */
+static int LiveRun(const char* path, unsigned long nofRecords, const RTLiveSettings* live, BenchLiveRun* run)
+{
+	RTInstanceSettings settings;
+	RTModuleSettings modules[2];
+	std::vector<BenchEntry> entries(nofRecords);
+	std::vector<char> dropped(nofRecords, 0);
+	std::vector<int64_t> latencies;
+	RTEngineInstance instance;
+	RTDataStruct *data;
+	RTReplayLog log;
+	RTBus bus;
+	GameClass game;
+	ValueEngine engine;
+	double firstTime = -1.0;
+	int64_t start, due;
+	unsigned long n = 0;
+	GameEntity entity;
+	int team, i, ret;
+
+	memset(run, 0, sizeof(BenchLiveRun));
+	for (team = 0; team < GAME_NOF_TEAMS; team++)
+		for (i = 0; i < GAME_PLAYERS_PER_TEAM; i++)
+			game.AddPlayer(team, team * GAME_PLAYERS_PER_TEAM + i, &entity);
+	engine.Bind(&game);
+	glMatch.game = &game;
+	glMatch.engine = &engine;
+	glMatch.nofReleased.store(0);
+	glMatch.nofCommitted = 0;
+
+	/* the engine hears the level changes on the bus of the instance */
+	ret = RTBusCreate(&bus);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	if (engine.Subscribe(bus) != DU_RETURN_OK)
+	{
+		RTBusDestroy(bus);
+		return RT_RETURN_INTERNAL_ERROR;
+	}
+
+	memset(modules, 0, sizeof(modules));
+	modules[0].name = "register";
+	modules[0].inputs = RT_PRODUCT_BIT(RT_PRODUCT_PASSAGES);
+	modules[0].outputs = RT_PRODUCT_BIT(RT_PRODUCT_REGISTER);
+	modules[0].process = RegisterProcess;
+	modules[1].name = "value";
+	modules[1].inputs = RT_PRODUCT_BIT(RT_PRODUCT_REGISTER);
+	modules[1].outputs = RT_PRODUCT_BIT(RT_PRODUCT_MACRO_VALUE);
+	modules[1].process = LiveAnalyseProcess;
+	modules[1].commit = ValueCommit;
+	modules[1].context = &glMatch;
+
+	memset(&settings, 0, sizeof(settings));
+	settings.modules = modules;
+	settings.nofModules = 2;
+	settings.bus = bus;
+	if (live != NULL)
+		settings.live = *live;
+	ret = RTInstanceCreate("LIVE", &settings, &instance);
+	if (ret != RT_RETURN_OK)
+	{
+		engine.Subscribe(NULL);
+		RTBusDestroy(bus);
+		return ret;
+	}
+	ret = RTReplayLogOpen(path, 0, RT_REPLAY_LOG_FLAG_NO_CACHE, &log);
+	if (ret != RT_RETURN_OK)
+	{
+		RTInstanceDestroy(instance);
+		engine.Subscribe(NULL);
+		RTBusDestroy(bus);
+		return ret;
+	}
+
+	start = NowNsec();
+	while (n < nofRecords && (ret = RTReplayLogReadData(log, instance, &data)) == RT_RETURN_OK)
+	{
+		BenchEntry *entry = &entries[n];
+
+		/* a record comes in at its game time, sped up */
+		if (firstTime < 0.0)
+			firstTime = data->timeStamp;
+		due = start + (int64_t)((data->timeStamp - firstTime) / BENCH_LIVE_SPEED * 1e9);
+		while (NowNsec() < due)
+			QThread_sleep(1);
+
+		entry->pushed = NowNsec();
+		RTInstanceDataSetUserData(instance, data, entry, ReleaseEntry);
+		ret = RTInstanceProcess(instance, data);
+		if (ret == RT_RETURN_PASSAGE_DROPPED || ret == RT_RETURN_BUFFER_OVERFLOW)
+		{
+			dropped[n] = 1;
+			run->nofDropped++;
+		}
+		else if (ret != RT_RETURN_OK)
+		{
+			break;
+		}
+		n++;
+	}
+	if (ret == RT_RETURN_END_OF_LOG || n == nofRecords)
+		ret = RT_RETURN_OK;
+
+	while (glMatch.nofReleased.load(std::memory_order_acquire) < n)
+		QThread_sleep(1);
+	run->seconds = (NowNsec() - start) * 1e-9;
+	run->nofFed = n;
+	engine.GetStats(&run->engine);
+	if (live != NULL)
+		RTInstanceGetLiveStats(instance, &run->live);
+
+	RTInstanceDestroy(instance);
+	RTReplayLogClose(log);
+	engine.Subscribe(NULL);
+	RTBusDestroy(bus);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	latencies.reserve(n);
+	for (i = 0; i < (int)n; i++)
+	{
+		if (!dropped[i])
+			latencies.push_back(entries[i].latency);
+	}
+	std::sort(latencies.begin(), latencies.end());
+	run->latency50 = Percentile(latencies, 0.5) / 1000.0;
+	run->latency99 = Percentile(latencies, 0.99) / 1000.0;
+	run->latencyMax = Percentile(latencies, 1.0) / 1000.0;
+	return RT_RETURN_OK;
+}
+
+
+static int BenchLive(const char* path, unsigned long nofRecords)
+{
+	RTLiveSettings live;
+	BenchLiveRun off, on;
+	int ret;
+
+	ret = LiveRun(path, nofRecords, NULL, &off);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	memset(&live, 0, sizeof(live));
+	live.targetLatency = BENCH_LIVE_TARGET;
+	live.cpuShare = BENCH_LIVE_SHARE;
+	live.window = BENCH_LIVE_WINDOW;
+	ret = LiveRun(path, nofRecords, &live, &on);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	WriteResult("live", "\"records\":%lu,\"speed\":%.0f,\"work_us\":%d,\"target_us\":%.0f,\"share\":%.2f,"
+	            "\"off_seconds\":%.3f,\"off_latency_p50_us\":%.2f,\"off_latency_p99_us\":%.2f,\"off_latency_max_us\":%.2f,"
+	            "\"seconds\":%.3f,\"latency_p50_us\":%.2f,\"latency_p99_us\":%.2f,\"latency_max_us\":%.2f,"
+	            "\"late\":%lu,\"dropped\":%lu,\"level_changes\":%lu,\"share_used\":%.3f,\"throttled_s\":%.3f,"
+	            "\"full_s\":%.3f,\"coarse_cv_s\":%.3f,\"defer_values_s\":%.3f,\"drop_passages_s\":%.3f,"
+	            "\"values_deferred\":%lu,\"values_recomputed\":%lu,\"off_values_recomputed\":%lu",
+	            on.nofFed, BENCH_LIVE_SPEED, BENCH_LIVE_WORK_USEC, BENCH_LIVE_TARGET * 1e6, BENCH_LIVE_SHARE,
+	            off.seconds, off.latency50, off.latency99, off.latencyMax,
+	            on.seconds, on.latency50, on.latency99, on.latencyMax,
+	            on.live.nofLate, on.nofDropped, on.live.nofLevelChanges,
+	            (on.seconds > 0.0) ? on.live.busySeconds / on.seconds : 0.0, on.live.throttledSeconds,
+	            on.live.levelSeconds[RT_LIVE_LEVEL_FULL], on.live.levelSeconds[RT_LIVE_LEVEL_COARSE_CV],
+	            on.live.levelSeconds[RT_LIVE_LEVEL_DEFER_VALUES], on.live.levelSeconds[RT_LIVE_LEVEL_DROP_PASSAGES],
+	            on.engine.nofDeferred, on.engine.nofRecomputed, off.engine.nofRecomputed);
+	return RT_RETURN_OK;
+}
+
+
+
+static int BenchEventList(unsigned long nofOps)
+{
+	RTEventHandle handles[BENCH_EVENT_LIST_SIZE];
+	RTEventInfo info;
+	RTEventList list;
+	double time = 0.0, endTime;
+	uint32_t rng = 12345;
+	unsigned long op, nofRefreshed = 0;
+	int64_t start;
+	double seconds;
+	int i, ret;
+
+	ret = RTEventListCreate(RT_EVENT_LIST_DEFAULT_CAPACITY, &list);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	memset(&info, 0, sizeof(info));
+
+	/* a steady list: every op adds an event, pops what expired and refreshes one */
+	for (i = 0; i < BENCH_EVENT_LIST_SIZE; i++)
+	{
+		rng = rng * 1664525u + 1013904223u;
+		RTEventListInsert(list, (rng >> 8) * (30.0 / 16777216.0), &info, &handles[i]);
+	}
+
+	start = NowNsec();
+	for (op = 0; op < nofOps; op++)
+	{
+		time += 30.0 / BENCH_EVENT_LIST_SIZE;
+		while (RTEventListPopExpired(list, time, &info, &endTime) == RT_RETURN_OK)
+			;
+		rng = rng * 1664525u + 1013904223u;
+		i = (int)(op % BENCH_EVENT_LIST_SIZE);
+		RTEventListInsert(list, time + (rng >> 8) * (30.0 / 16777216.0), &info, &handles[i]);
+		if (RTEventListRefresh(list, handles[(i * 7) % BENCH_EVENT_LIST_SIZE], time + 15.0) == RT_RETURN_OK)
+			nofRefreshed++;
+	}
+	seconds = (NowNsec() - start) * 1e-9;
+
+	WriteResult("event_list", "\"ops\":%lu,\"refreshed\":%lu,\"size\":%d,\"seconds\":%.6f,\"ns_per_op\":%.1f",
+	            nofOps, nofRefreshed, RTEventListGetSize(list), seconds, (nofOps != 0) ? seconds * 1e9 / nofOps : 0.0);
+	RTEventListDestroy(list);
+	return RT_RETURN_OK;
+}
+
+
+
+typedef struct _BenchProducer
+{
+	RTProcessBuffer     buffer;
+	unsigned long       nofEntries;
+} BenchProducer;
+
+static RTDataStruct glBenchData;
+
+
+static void* ProducerThread(void* threadData)
+{
+	BenchProducer *producer = (BenchProducer*)threadData;
+	RTDataStruct *dropped;
+	unsigned long i;
+
+	/* the buffer only passes the pointers on */
+	for (i = 0; i < producer->nofEntries; i++)
+		RTProcessBufferPush(producer->buffer, &glBenchData, &dropped);
+	return NULL;
+}
+
+
+static int BenchProcessBuffer(unsigned long nofEntries)
+{
+	RTDataStruct *batch[RT_PROCESS_BUFFER_MAX_BATCH];
+	RTProcessBufferStats stats;
+	BenchProducer producer;
+	QThread thread;
+	unsigned long popped = 0;
+	int64_t start;
+	double seconds;
+	int count, ret;
+
+	ret = RTProcessBufferCreate(RT_PROCESS_BUFFER_DEFAULT_CAPACITY, RT_PROCESS_BUFFER_SINGLE_PRODUCER,
+	                            RT_BUFFER_OVERFLOW_BLOCK, &producer.buffer);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	producer.nofEntries = nofEntries;
+
+	start = NowNsec();
+	if (QThread_create(&thread, "BENCH_PRODUCER", ProducerThread, &producer) != QTHREAD_RETURN_OK)
+	{
+		RTProcessBufferDestroy(producer.buffer);
+		return RT_RETURN_INTERNAL_ERROR;
+	}
+	while (popped < nofEntries)
+	{
+		RTProcessBufferPopBatch(producer.buffer, batch, RT_PROCESS_BUFFER_MAX_BATCH, &count, 100);
+		popped += count;
+	}
+	seconds = (NowNsec() - start) * 1e-9;
+	QThread_join(thread, NULL);
+
+	RTProcessBufferGetStats(producer.buffer, &stats);
+	RTProcessBufferDestroy(producer.buffer);
+
+	WriteResult("process_buffer", "\"entries\":%lu,\"seconds\":%.6f,\"entries_per_s\":%.0f,\"blocked\":%lu,\"wakeups\":%lu",
+	            popped, seconds, (seconds > 0.0) ? popped / seconds : 0.0, stats.nofBlocked, stats.nofWakeups);
+	return RT_RETURN_OK;
+}
+
+
+
+static int BenchLogger(unsigned long nofMessages)
+{
+	LogStats stats;
+	unsigned long i;
+	int64_t start, logged;
+	double callerSeconds, seconds;
+
+	if (!InitLog("bench", MessageLog))
+		return RT_RETURN_CANNOT_OPEN_FILE;
+
+	start = NowNsec();
+	for (i = 0; i < nofMessages; i++)
+		LogFormat(MessageLog, "bench message %lu at %.3f", i, i * 0.05);
+	logged = NowNsec();
+	FlushLogs();
+	callerSeconds = (logged - start) * 1e-9;
+	seconds = (NowNsec() - start) * 1e-9;
+	GetLogStats(&stats);
+	CloseLogFiles();
+
+	WriteResult("logger", "\"messages\":%lu,\"caller_ns_per_message\":%.1f,\"seconds\":%.6f,\"messages_per_s\":%.0f,"
+	            "\"dropped\":%lu,\"blocked\":%lu",
+	            nofMessages, (nofMessages != 0) ? callerSeconds * 1e9 / nofMessages : 0.0, seconds,
+	            (seconds > 0.0) ? nofMessages / seconds : 0.0, stats.nofDropped, stats.nofBlocked);
+	return RT_RETURN_OK;
+}
+
+
+
+/* The same actions into the Value Engine by name and through the bus */
+static int BenchDispatch(unsigned long nofMessages)
+{
+	SyntheticMatchClass match;
+	std::vector<VEEvent> events;
+	RTBusMessage message;
+	GameClass game;
+	ValueEngine engine;
+	RTBus bus;
+	char record[SYNTHETIC_MAX_RECORD_SIZE];
+	const char *payload;
+	unsigned long long allocsBefore, byNameAllocs, busAllocs;
+	unsigned long i;
+	int64_t start;
+	double byNameSeconds, busSeconds, t;
+	GameEntity entity;
+	VEEvent *event;
+	int team, p, ret;
+
+	/* one minute of the match, over and over */
+	events.reserve(4096);
+	while (events.size() < 4096 && match.Next(record, &t) == RT_RETURN_OK)
+	{
+		VEEvent parsed;
+
+		payload = strchr(record, '\t') + 1;
+		if (RecordClass::Parse(payload, (unsigned int)strlen(payload), &parsed) == RT_RETURN_OK)
+		{
+			parsed.time = t;
+			events.push_back(parsed);
+		}
+	}
+	if (events.empty())
+		return RT_RETURN_NO_DATA_YET;
+
+	for (team = 0; team < GAME_NOF_TEAMS; team++)
+		for (p = 0; p < GAME_PLAYERS_PER_TEAM; p++)
+			game.AddPlayer(team, team * GAME_PLAYERS_PER_TEAM + p, &entity);
+	engine.Bind(&game);
+	ret = RTBusCreate(&bus);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	engine.Subscribe(bus);
+
+	allocsBefore = glNofAllocs.load();
+	start = NowNsec();
+	for (i = 0; i < nofMessages; i++)
+	{
+		event = &events[i % events.size()];
+		engine.ActionDetected(ValueEngine::GetEventName(event->type), event, event->time);
+	}
+	byNameSeconds = (NowNsec() - start) * 1e-9;
+	byNameAllocs = glNofAllocs.load() - allocsBefore;
+
+	engine.Reset();
+	message.opcode = RT_BUS_ACTION;
+	allocsBefore = glNofAllocs.load();
+	start = NowNsec();
+	for (i = 0; i < nofMessages; i++)
+	{
+		event = &events[i % events.size()];
+		message.time = event->time;
+		message.action.type = event->type;
+		message.action.entity = event->entity;
+		message.action.target = event->target;
+		message.action.team = event->team;
+		message.action.amount = event->amount;
+		RTBusPublish(bus, &message);
+	}
+	busSeconds = (NowNsec() - start) * 1e-9;
+	busAllocs = glNofAllocs.load() - allocsBefore;
+
+	engine.Subscribe(NULL);
+	RTBusDestroy(bus);
+
+	WriteResult("dispatch", "\"messages\":%lu,\"by_name_ns_per_message\":%.1f,\"bus_ns_per_message\":%.1f,"
+	            "\"by_name_allocs_per_message\":%.4f,\"bus_allocs_per_message\":%.4f",
+	            nofMessages, (nofMessages != 0) ? byNameSeconds * 1e9 / nofMessages : 0.0,
+	            (nofMessages != 0) ? busSeconds * 1e9 / nofMessages : 0.0,
+	            (nofMessages != 0) ? (double)byNameAllocs / nofMessages : 0.0,
+	            (nofMessages != 0) ? (double)busAllocs / nofMessages : 0.0);
+	return RT_RETURN_OK;
+}
+
+
+
+/* A unit in the DuList of the entity_index benchmark */
+typedef struct _BenchUnit
+{
+	unsigned int        id;
+	GameEntity          owner;
+} BenchUnit;
+
+
+static int CompareUnits(void* data1, void* data2)
+{
+	unsigned int id1 = ((BenchUnit*)data1)->id;
+	unsigned int id2 = ((BenchUnit*)data2)->id;
+
+	return (id1 < id2) ? -1 : (id1 > id2) ? 1 : 0;
+}
+
+
+/* xorshift32, unit ids spread like the ones of a replay */
+static unsigned int NextUnitId(unsigned int* seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return *seed;
+}
+
+
+/*
+	The damage of every summon, published with unit ids as RT_BUS_UNIT_ACTION, must count
+	for its summoner exactly like the same damage dealt by the summoner's slot. Returns the
+	players whose impact differs, -1 if the bus could not be set up.
+*/
+static int BenchSummonCredit(const GameClass* game, const std::vector<BenchUnit>& units)
+{
+	GameClass slots;
+	ValueEngine byUnit, bySlot;
+	RTBusMessage message;
+	VEEvent event;
+	RTBus bus;
+	GameEntity entity;
+	size_t i;
+	int team, p, e;
+	int mismatches = 0;
+
+	for (team = 0; team < GAME_NOF_TEAMS; team++)
+		for (p = 0; p < GAME_PLAYERS_PER_TEAM; p++)
+			slots.AddPlayer(team, team * GAME_PLAYERS_PER_TEAM + p, &entity);
+	byUnit.Bind(game);
+	bySlot.Bind(&slots);
+	if (RTBusCreate(&bus) != RT_RETURN_OK)
+		return -1;
+	if (byUnit.Subscribe(bus) != DU_RETURN_OK)
+	{
+		RTBusDestroy(bus);
+		return -1;
+	}
+
+	/* units[0 .. GAME_NOF_SLOTS - 1] are the heroes of the slots, the summons follow */
+	memset(&message, 0, sizeof(message));
+	message.opcode = RT_BUS_UNIT_ACTION;
+	for (i = GAME_NOF_SLOTS; i < GAME_NOF_SLOTS + BENCH_NOF_SUMMONS && i < units.size(); i++)
+	{
+		const BenchUnit *summon = &units[i];
+		GameEntity victim = (summon->owner + GAME_PLAYERS_PER_TEAM) % GAME_NOF_SLOTS;
+
+		message.time = (double)i;
+		message.action.type = VEEventDamage;
+		message.action.entity = (int)summon->id;
+		message.action.target = (int)units[victim].id;
+		message.action.team = GameClass::TeamOf(summon->owner);
+		message.action.amount = 10.0f + (float)(i % 7);
+		RTBusPublish(bus, &message);
+
+		event.type = VEEventDamage;
+		event.entity = summon->owner;
+		event.target = victim;
+		event.team = message.action.team;
+		event.amount = message.action.amount;
+		event.time = message.time;
+		bySlot.HandleEvent(&event);
+	}
+	byUnit.Subscribe(NULL);
+	RTBusDestroy(bus);
+
+	for (e = 0; e < GAME_NOF_SLOTS; e++)
+	{
+		if (byUnit.GetPlayerImpact(e) != bySlot.GetPlayerImpact(e))
+			mismatches++;
+	}
+	return mismatches;
+}
+
+
+static int BenchEntityIndex(unsigned long nofOps)
+{
+	static const int nofUnits[GAME_NOF_UNIT_KINDS] = { 0, GAME_NOF_SLOTS, BENCH_NOF_SUMMONS, BENCH_NOF_CAMPS, BENCH_NOF_STRUCTURES };
+	std::vector<BenchUnit> units;
+	std::vector<unsigned int> queries;
+	GameClass game;
+	GameEntity entity;
+	GameUnit unit;
+	DuList list;
+	BenchUnit key;
+	void *found;
+	unsigned int seed = 2463534242u;
+	unsigned long long allocsBefore, indexAllocs;
+	unsigned long i, nofListOps, nofChurns;
+	long checksum = 0;
+	int64_t start;
+	double indexSeconds, listSeconds, churnSeconds;
+	int kind, k, team, p, ret;
+	int creditMismatches;
+
+	for (team = 0; team < GAME_NOF_TEAMS; team++)
+		for (p = 0; p < GAME_PLAYERS_PER_TEAM; p++)
+			game.AddPlayer(team, team * GAME_PLAYERS_PER_TEAM + p, &entity);
+
+	ret = DuListCreate(&list);
+	if (ret != DU_RETURN_OK)
+		return RT_RETURN_OUT_OF_MEMORY;
+	DuListSetComparator(list, CompareUnits);
+
+	/* the heroes, then summons of every player, camps and structures of nobody */
+	units.reserve(GAME_NOF_SLOTS + BENCH_NOF_SUMMONS + BENCH_NOF_CAMPS + BENCH_NOF_STRUCTURES);
+	for (kind = GameUnitHero; kind < GAME_NOF_UNIT_KINDS; kind++)
+	{
+		for (k = 0; k < nofUnits[kind]; k++)
+		{
+			BenchUnit u;
+
+			u.id = NextUnitId(&seed);
+			u.owner = (kind == GameUnitHero || kind == GameUnitSummon) ? k % GAME_NOF_SLOTS : GAME_ENTITY_NONE;
+			if (game.AddUnit(u.id, kind, u.owner, &unit) != DU_RETURN_OK)
+				continue;
+			units.push_back(u);
+		}
+	}
+	for (i = 0; i < units.size(); i++)
+	{
+		if (DuListAppendElement(list, &units[i]) != DU_RETURN_OK)
+		{
+			DuListDestroy(list);
+			return RT_RETURN_OUT_OF_MEMORY;
+		}
+	}
+
+	queries.reserve(BENCH_NOF_QUERIES);
+	for (i = 0; i < BENCH_NOF_QUERIES; i++)
+		queries.push_back((i % BENCH_MISS_RATIO == 0) ? NextUnitId(&seed) : units[NextUnitId(&seed) % units.size()].id);
+
+	allocsBefore = glNofAllocs.load();
+	start = NowNsec();
+	for (i = 0; i < nofOps; i++)
+		checksum += game.ResolveUnit(queries[i % BENCH_NOF_QUERIES]);
+	indexSeconds = (NowNsec() - start) * 1e-9;
+	indexAllocs = glNofAllocs.load() - allocsBefore;
+
+	/* a walk of the list per lookup, fewer of them */
+	nofListOps = nofOps / 20;
+	start = NowNsec();
+	for (i = 0; i < nofListOps; i++)
+	{
+		key.id = queries[i % BENCH_NOF_QUERIES];
+		DuListRetrieveElement(list, &key, &found);
+	}
+	listSeconds = (NowNsec() - start) * 1e-9;
+	DuListDestroy(list);
+
+	/* summons die and new ones are summoned, the index keeps its size */
+	nofChurns = nofOps / 4;
+	start = NowNsec();
+	for (i = 0; i < nofChurns; i++)
+	{
+		BenchUnit *summon = &units[GAME_NOF_SLOTS + i % BENCH_NOF_SUMMONS];
+
+		game.RemoveUnit(summon->id);
+		summon->id = NextUnitId(&seed);
+		game.AddUnit(summon->id, GameUnitSummon, summon->owner, &unit);
+	}
+	churnSeconds = (NowNsec() - start) * 1e-9;
+
+	creditMismatches = BenchSummonCredit(&game, units);
+
+	WriteResult("entity_index", "\"units\":%d,\"lookups\":%lu,\"index_ns_per_lookup\":%.1f,\"list_ns_per_lookup\":%.1f,"
+	            "\"index_allocs_per_lookup\":%.4f,\"churn_ns_per_summon\":%.1f,\"max_probes\":%d,\"checksum\":%ld,"
+	            "\"credit_mismatches\":%d",
+	            game.GetUnits()->GetNofUnits(), nofOps, (nofOps != 0) ? indexSeconds * 1e9 / nofOps : 0.0,
+	            (nofListOps != 0) ? listSeconds * 1e9 / nofListOps : 0.0,
+	            (nofOps != 0) ? (double)indexAllocs / nofOps : 0.0,
+	            (nofChurns != 0) ? churnSeconds * 1e9 / nofChurns : 0.0, game.GetUnits()->GetMaxProbes(),
+	            checksum, creditMismatches);
+	return RT_RETURN_OK;
+}
+
+
+
+typedef struct _BenchLocker
+{
+	QThread_Mutex       mutex;
+	unsigned long       nofLocks;
+	volatile unsigned long *counter;
+} BenchLocker;
+
+typedef struct _BenchPingPong
+{
+	QThread_Semaphore   ping;
+	QThread_Semaphore   pong;
+	unsigned long       nofRounds;
+} BenchPingPong;
+
+
+static void* LockerThread(void* threadData)
+{
+	BenchLocker *locker = (BenchLocker*)threadData;
+	unsigned long i;
+
+	for (i = 0; i < locker->nofLocks; i++)
+	{
+		QThread_Mutex_P(locker->mutex);
+		(*locker->counter)++;
+		QThread_Mutex_V(locker->mutex);
+	}
+	return NULL;
+}
+
+
+static void* PongThread(void* threadData)
+{
+	BenchPingPong *pingPong = (BenchPingPong*)threadData;
+	unsigned long i;
+
+	for (i = 0; i < pingPong->nofRounds; i++)
+	{
+		QThread_Semaphore_wait(pingPong->ping);
+		QThread_Semaphore_post(pingPong->pong);
+	}
+	return NULL;
+}
+
+
+/* ns per P/V pair with nofThreads threads taking turns on one mutex, < 0 on error */
+static double MutexContention(int nofThreads, unsigned long nofLocks)
+{
+	BenchLocker lockers[BENCH_MAX_LOCK_THREADS];
+	QThread threads[BENCH_MAX_LOCK_THREADS];
+	QThread_Mutex mutex;
+	volatile unsigned long counter = 0;
+	int64_t start;
+	double seconds;
+	int i, nofStarted = 0;
+
+	if (QThread_Mutex_create(&mutex) != QTHREAD_RETURN_OK)
+		return -1.0;
+
+	start = NowNsec();
+	for (i = 0; i < nofThreads; i++)
+	{
+		lockers[i].mutex = mutex;
+		lockers[i].nofLocks = nofLocks / nofThreads;
+		lockers[i].counter = &counter;
+		if (QThread_create(&threads[i], "BENCH_LOCKER", LockerThread, &lockers[i]) != QTHREAD_RETURN_OK)
+			break;
+		nofStarted++;
+	}
+	for (i = 0; i < nofStarted; i++)
+		QThread_join(threads[i], NULL);
+	seconds = (NowNsec() - start) * 1e-9;
+	QThread_Mutex_destroy(&mutex);
+
+	/* a lost increment is a broken mutex */
+	if (nofStarted != nofThreads || counter != (nofLocks / nofThreads) * nofThreads)
+		return -1.0;
+	return seconds * 1e9 / counter;
+}
+
+
+static int BenchThreads(unsigned long nofOps)
+{
+	static const int nofLockThreads[] = { 1, 2, 4, BENCH_MAX_LOCK_THREADS };
+	double lockNs[sizeof(nofLockThreads) / sizeof(nofLockThreads[0])];
+	const char *major, *minor, *maintenance, *description;
+	BenchPingPong pingPong;
+	QThread_Semaphore idle;
+	QThread thread;
+	unsigned long i;
+	int64_t start, late, maxLate = 0, sumLate = 0;
+	double roundTripNs;
+	int n, ret = RT_RETURN_OK;
+
+	QThread_getVersion(&major, &minor, &maintenance, &description);
+
+	for (n = 0; n < (int)(sizeof(nofLockThreads) / sizeof(nofLockThreads[0])); n++)
+	{
+		lockNs[n] = MutexContention(nofLockThreads[n], nofOps);
+		if (lockNs[n] < 0.0)
+			return RT_RETURN_INTERNAL_ERROR;
+	}
+
+	/* every round trip puts one thread to sleep and wakes it */
+	pingPong.nofRounds = nofOps / 20;
+	if (QThread_Semaphore_create(&pingPong.ping, 0) != QTHREAD_RETURN_OK)
+		return RT_RETURN_OUT_OF_MEMORY;
+	if (QThread_Semaphore_create(&pingPong.pong, 0) != QTHREAD_RETURN_OK)
+	{
+		QThread_Semaphore_destroy(&pingPong.ping);
+		return RT_RETURN_OUT_OF_MEMORY;
+	}
+	start = NowNsec();
+	if (QThread_create(&thread, "BENCH_PONG", PongThread, &pingPong) != QTHREAD_RETURN_OK)
+		ret = RT_RETURN_INTERNAL_ERROR;
+	else
+	{
+		for (i = 0; i < pingPong.nofRounds; i++)
+		{
+			QThread_Semaphore_post(pingPong.ping);
+			QThread_Semaphore_wait(pingPong.pong);
+		}
+		QThread_join(thread, NULL);
+	}
+	roundTripNs = (pingPong.nofRounds != 0) ? (NowNsec() - start) / (double)pingPong.nofRounds : 0.0;
+	QThread_Semaphore_destroy(&pingPong.ping);
+	QThread_Semaphore_destroy(&pingPong.pong);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	/* nobody posts, every wait runs into its timeout */
+	if (QThread_Semaphore_create(&idle, 0) != QTHREAD_RETURN_OK)
+		return RT_RETURN_OUT_OF_MEMORY;
+	for (i = 0; i < BENCH_TIMEDWAITS; i++)
+	{
+		start = NowNsec();
+		QThread_Semaphore_timedwait(idle, 1);
+		late = NowNsec() - start - 1000000;
+		sumLate += late;
+		if (late > maxLate)
+			maxLate = late;
+	}
+	QThread_Semaphore_destroy(&idle);
+
+	WriteResult("threads", "\"library\":\"%s.%s.%s %s\",\"locks\":%lu,\"lock_ns_1\":%.1f,\"lock_ns_2\":%.1f,"
+	            "\"lock_ns_4\":%.1f,\"lock_ns_8\":%.1f,\"round_trip_ns\":%.0f,\"timedwait_late_us\":%.1f,"
+	            "\"timedwait_max_late_us\":%.1f",
+	            major, minor, maintenance, description, nofOps, lockNs[0], lockNs[1], lockNs[2], lockNs[3],
+	            roundTripNs, sumLate / (BENCH_TIMEDWAITS * 1000.0), maxLate / 1000.0);
+	return RT_RETURN_OK;
+}
+
+
+
+/*
+	timeline: the match of the process benchmark plus an Event List with the respawn
+	timers (a death adds one, the respawn cancels it), applied by TimelineApply both in a
+	straight run, which keeps a digest of the state after every record, and through the
+	Timeline. Every state a seek or step lands in is compared with the digest.
+*/
+typedef struct _BenchTimelineMatch
+{
+	GameClass       game;
+	ValueEngine     engine;
+	RTEventList     events;
+} BenchTimelineMatch;
+
+
+/* A parsed record with its respawn timer, the values recomputed only with tick */
+static int ApplyRecord(BenchTimelineMatch* match, const VEEvent* event, int tick)
+{
+	double time = event->time;
+	RTEventInfo info;
+	int ret;
+
+	while (RTEventListPopExpired(match->events, time, &info, NULL) == RT_RETURN_OK)
+		;
+	if (event->type == VEEventDeath)
+	{
+		memset(&info, 0, sizeof(info));
+		info.type = VEEventRespawn;
+		info.sourceId = event->entity;
+		info.targetId = event->entity;
+		info.stacks = 1;
+		info.startTime = time;
+		ret = RTEventListInsert(match->events, time + 10.0 + 2.0 * match->game.GetState()->level[event->entity], &info, NULL);
+		if (ret != RT_RETURN_OK)
+			return ret;
+	}
+	else if (event->type == VEEventRespawn)
+		RTEventListCancelTarget(match->events, event->entity, NULL);
+
+	RecordClass::ApplyGame(&match->game, event);
+	match->engine.HandleEvent(event);
+	if (tick)
+		match->engine.Tick(time);
+	return RT_RETURN_OK;
+}
+
+
+static int TimelineApply(const char* payload, unsigned int size, double time, void* context)
+{
+	VEEvent event;
+	int ret;
+
+	ret = RecordClass::Parse(payload, size, &event);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	event.time = time;
+	return ApplyRecord((BenchTimelineMatch*)context, &event, 1);
+}
+
+
+/* FNV-1a over what a record changes: the game state, the values, the Event List */
+static uint64_t TimelineDigest(BenchTimelineMatch* match)
+{
+	const GameState *state = match->game.GetState();
+	uint64_t hash = 14695981039346656037ull;
+	unsigned char bytes[sizeof(float) * VE_NOF_NODES + sizeof(double) + sizeof(int)];
+	double next = -1.0;
+	float values[VE_NOF_NODES];
+	int n, size;
+	size_t i;
+
+	for (n = 0; n < VE_NOF_NODES; n++)
+		values[n] = match->engine.GetValue(n);
+	RTEventListPeekNext(match->events, &next);
+	size = RTEventListGetSize(match->events);
+	memcpy(bytes, values, sizeof(values));
+	memcpy(bytes + sizeof(values), &next, sizeof(next));
+	memcpy(bytes + sizeof(values) + sizeof(next), &size, sizeof(size));
+
+	for (i = 0; i < sizeof(bytes); i++)
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	for (i = 0; i < GAME_NOF_SLOTS; i++)
+	{
+		hash = (hash ^ (uint64_t)(state->hp[i] * 1000.0f)) * 1099511628211ull;
+		hash = (hash ^ (uint64_t)state->level[i]) * 1099511628211ull;
+		hash = (hash ^ state->alive[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+
+static int TimelineMatchCreate(BenchTimelineMatch* match)
+{
+	GameEntity entity;
+	int team, i;
+
+	for (team = 0; team < GAME_NOF_TEAMS; team++)
+		for (i = 0; i < GAME_PLAYERS_PER_TEAM; i++)
+			match->game.AddPlayer(team, team * GAME_PLAYERS_PER_TEAM + i, &entity);
+	match->engine.Bind(&match->game);
+	return RTEventListCreate(RT_EVENT_LIST_DEFAULT_CAPACITY, &match->events);
+}
+
+
+static int BenchTimeline(const char* path)
+{
+	std::vector<uint64_t> digests;
+	BenchTimelineMatch straight, match, bounded;
+	TimelineSettings settings;
+	TimelineStats stats, boundedStats;
+	TimelineClass timeline, boundedTimeline;
+	RTReplayLog log;
+	RTPassage passage;
+	unsigned long nofRecords, nofTargeted = 0, nofMismatches = 0, nofSteps = 0;
+	uint32_t rng = 4711;
+	int64_t start;
+	double time, endTime, straightSeconds, openSeconds, seekSeconds, reverseSeconds, boundedSeconds;
+	int i, ret;
+
+	if ((ret = TimelineMatchCreate(&straight)) != RT_RETURN_OK ||
+		(ret = TimelineMatchCreate(&match)) != RT_RETURN_OK ||
+		(ret = TimelineMatchCreate(&bounded)) != RT_RETURN_OK)
+		return ret;
+
+	/* straight run, digests[n] is the state after n records */
+	ret = RTReplayLogOpen(path, 0, RT_REPLAY_LOG_FLAG_NO_CACHE, &log);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	digests.push_back(TimelineDigest(&straight));
+	start = NowNsec();
+	while ((ret = RTReplayLogNext(log, &passage, &time)) == RT_RETURN_OK)
+	{
+		ret = TimelineApply(passage->data, passage->size, time, &straight);
+		if (ret != RT_RETURN_OK)
+			break;
+		digests.push_back(TimelineDigest(&straight));
+	}
+	straightSeconds = (NowNsec() - start) * 1e-9;
+	RTReplayLogClose(log);
+	if (ret != RT_RETURN_END_OF_LOG)
+		return ret;
+	nofRecords = (unsigned long)digests.size() - 1;
+
+	TimelineClass::DefaultSettings(&settings);
+	settings.logFlags = RT_REPLAY_LOG_FLAG_NO_CACHE;
+	start = NowNsec();
+	ret = timeline.Open(path, &settings, &match.game, &match.engine, match.events, TimelineApply, &match);
+	openSeconds = (NowNsec() - start) * 1e-9;
+	if (ret != RT_RETURN_OK)
+		return ret;
+	if (timeline.GetNofRecords() != nofRecords || TimelineDigest(&match) != digests[nofRecords])
+		nofMismatches++;
+	endTime = timeline.GetTime();
+
+	/* random seeks; replaying from the start instead would apply nofTargeted records */
+	start = NowNsec();
+	for (i = 0; i < BENCH_TIMELINE_SEEKS && ret == RT_RETURN_OK; i++)
+	{
+		rng = rng * 1664525u + 1013904223u;
+		ret = timeline.Seek((rng >> 8) * (endTime / 16777216.0));
+		nofTargeted += timeline.GetPosition();
+	}
+	seekSeconds = (NowNsec() - start) * 1e-9;
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	/* the same seeks again, checked */
+	rng = 4711;
+	for (i = 0; i < BENCH_TIMELINE_SEEKS && ret == RT_RETURN_OK; i++)
+	{
+		rng = rng * 1664525u + 1013904223u;
+		ret = timeline.Seek((rng >> 8) * (endTime / 16777216.0));
+		if (TimelineDigest(&match) != digests[timeline.GetPosition()])
+			nofMismatches++;
+	}
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	/* reverse from the end, every step checked after the timing */
+	ret = timeline.SeekRecord(nofRecords);
+	start = NowNsec();
+	while (ret == RT_RETURN_OK && (ret = timeline.Previous()) == RT_RETURN_OK)
+		nofSteps++;
+	reverseSeconds = (NowNsec() - start) * 1e-9;
+	if (ret != RT_RETURN_END_OF_LOG)
+		return ret;
+	ret = timeline.SeekRecord(nofRecords);
+	while (ret == RT_RETURN_OK && (ret = timeline.Previous()) == RT_RETURN_OK)
+	{
+		if (TimelineDigest(&match) != digests[timeline.GetPosition()])
+			nofMismatches++;
+	}
+	if (ret != RT_RETURN_END_OF_LOG)
+		return ret;
+	timeline.GetStats(&stats);
+
+	/* a snapshot budget the match does not fit in: fewer snapshots, longer seeks */
+	settings.maxBytes = BENCH_TIMELINE_MAX_BYTES;
+	ret = boundedTimeline.Open(path, &settings, &bounded.game, &bounded.engine, bounded.events, TimelineApply, &bounded);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	rng = 4711;
+	start = NowNsec();
+	for (i = 0; i < BENCH_TIMELINE_SEEKS && ret == RT_RETURN_OK; i++)
+	{
+		rng = rng * 1664525u + 1013904223u;
+		ret = boundedTimeline.Seek((rng >> 8) * (endTime / 16777216.0));
+	}
+	boundedSeconds = (NowNsec() - start) * 1e-9;
+	if (ret != RT_RETURN_OK || TimelineDigest(&bounded) != digests[boundedTimeline.GetPosition()])
+		nofMismatches++;
+	boundedTimeline.GetStats(&boundedStats);
+
+	boundedTimeline.Close();
+	timeline.Close();
+	RTEventListDestroy(bounded.events);
+	RTEventListDestroy(match.events);
+	RTEventListDestroy(straight.events);
+
+	WriteResult("timeline", "\"records\":%lu,\"straight_seconds\":%.6f,\"open_seconds\":%.6f,\"snapshots\":%d,\"snapshot_bytes\":%lu,"
+	            "\"interval\":%.1f,\"seek_us\":%.2f,\"replay_from_start_us\":%.2f,\"reverse_ns_per_step\":%.1f,"
+	            "\"scratch_bytes\":%lu,\"bounded_max_bytes\":%d,\"bounded_snapshots\":%d,\"bounded_snapshot_bytes\":%lu,"
+	            "\"bounded_interval\":%.1f,\"bounded_seek_us\":%.2f,\"mismatches\":%lu",
+	            nofRecords, straightSeconds, openSeconds, stats.nofSnapshots, (unsigned long)stats.snapshotBytes,
+	            stats.interval, seekSeconds * 1e6 / BENCH_TIMELINE_SEEKS,
+	            (nofRecords != 0) ? straightSeconds * 1e6 * nofTargeted / nofRecords / BENCH_TIMELINE_SEEKS : 0.0,
+	            (nofSteps != 0) ? reverseSeconds * 1e9 / nofSteps : 0.0,
+	            (unsigned long)stats.scratchBytes, BENCH_TIMELINE_MAX_BYTES, boundedStats.nofSnapshots,
+	            (unsigned long)boundedStats.snapshotBytes, boundedStats.interval, boundedSeconds * 1e6 / BENCH_TIMELINE_SEEKS,
+	            nofMismatches);
+	return (nofMismatches == 0) ? RT_RETURN_OK : RT_RETURN_INTERNAL_ERROR;
+}
+
+
+
+/*
+	event_store: the match of the process benchmark, every event stored with its score
+	before it is applied. The player of a query is one of the match; the segments of the
+	season are the same match with the players in other slots.
+*/
+static void StoreQuery(uint32_t* rng, double endTime, int playerId, VEStoreQuery* query)
+{
+	VEEventStore::InitQuery(query);
+	*rng = *rng * 1664525u + 1013904223u;
+	query->from = (*rng >> 8) * ((endTime - BENCH_STORE_WINDOW) / 16777216.0);
+	query->to = query->from + BENCH_STORE_WINDOW;
+	query->source = playerId;
+	query->type = (*rng & 1) ? VEEventHeal : VEEventDamage;
+}
+
+
+static int RowMatches(const VEStoredEvent* row, const VEStoreQuery* query, const int* playerIds)
+{
+	return row->time >= query->from && row->time < query->to && row->type == query->type &&
+	       row->source != GAME_ENTITY_NONE && playerIds[row->source] == query->source;
+}
+
+
+/* The query the way it is answered without a store: parse the replay log and score it again */
+static int LogQuery(const char* path, const VEStoreQuery* query, VEStoreTotals* totals)
+{
+	static const int slots[GAME_NOF_SLOTS] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+	BenchTimelineMatch match;
+	VEStoredEvent row;
+	RTReplayLog log;
+	RTPassage passage;
+	VEEvent event;
+	double time;
+	int ret;
+
+	if ((ret = TimelineMatchCreate(&match)) != RT_RETURN_OK)
+		return ret;
+	ret = RTReplayLogOpen(path, 0, RT_REPLAY_LOG_FLAG_NO_CACHE, &log);
+	if (ret != RT_RETURN_OK)
+	{
+		RTEventListDestroy(match.events);
+		return ret;
+	}
+	while ((ret = RTReplayLogNext(log, &passage, &time)) == RT_RETURN_OK)
+	{
+		if (RecordClass::Parse(passage->data, passage->size, &event) != RT_RETURN_OK)
+			continue;
+		event.time = time;
+		row.time = time;
+		row.type = event.type;
+		row.source = event.entity;
+		if (RowMatches(&row, query, slots))
+		{
+			totals->count++;
+			totals->amount += event.amount;
+			totals->value += match.engine.ScoreEvent(&event);
+		}
+		ApplyEvent(&match.game, &match.engine, &event);
+	}
+	RTReplayLogClose(log);
+	RTEventListDestroy(match.events);
+	return (ret == RT_RETURN_END_OF_LOG) ? RT_RETURN_OK : ret;
+}
+
+
+static int SameTotals(const VEStoreTotals* a, const VEStoreTotals* b)
+{
+	return a->count == b->count && fabs(a->amount - b->amount) <= 1e-6 * (1.0 + fabs(a->amount)) &&
+	       fabs(a->value - b->value) <= 1e-6 * (1.0 + fabs(a->value));
+}
+
+
+static int BenchEventStore(const char* path)
+{
+	static const int slots[GAME_NOF_SLOTS] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+	std::vector<VEStoredEvent> rows;
+	std::vector<VEStoreGroup> groups;
+	VEEventStore store;
+	VEEventStore season[BENCH_STORE_SEGMENTS];
+	BenchTimelineMatch match;
+	VEStoreQuery query;
+	VEStoreTotals totals, scanned, logged, seasonTotals;
+	VEStoredEvent row;
+	RTReplayLog log;
+	RTPassage passage;
+	VEEvent event;
+	char segmentPath[64];
+	int playerIds[GAME_NOF_SLOTS];
+	unsigned long nofMismatches = 0, nofMatched = 0;
+	uint32_t rng;
+	int64_t start;
+	double time, endTime = 0.0, appendSeconds, querySeconds, scanSeconds, logSeconds, topSeconds, openSeconds, seasonSeconds;
+	size_t i;
+	int q, m, slot, ret;
+
+	if ((ret = TimelineMatchCreate(&match)) != RT_RETURN_OK)
+		return ret;
+	ret = RTReplayLogOpen(path, 0, RT_REPLAY_LOG_FLAG_NO_CACHE, &log);
+	if (ret != RT_RETURN_OK)
+	{
+		RTEventListDestroy(match.events);
+		return ret;
+	}
+	while ((ret = RTReplayLogNext(log, &passage, &time)) == RT_RETURN_OK)
+	{
+		if (RecordClass::Parse(passage->data, passage->size, &event) != RT_RETURN_OK)
+			continue;
+		event.time = time;
+		row.time = time;
+		row.type = event.type;
+		row.source = event.entity;
+		row.target = event.target;
+		row.ability = (event.type == VEEventAbility) ? (int)event.amount : VE_ABILITY_NONE;
+		row.amount = event.amount;
+		row.value = match.engine.ScoreEvent(&event);
+		rows.push_back(row);
+		ApplyEvent(&match.game, &match.engine, &event);
+		endTime = time;
+	}
+	RTReplayLogClose(log);
+	RTEventListDestroy(match.events);
+	if (ret != RT_RETURN_END_OF_LOG)
+		return ret;
+
+	start = NowNsec();
+	for (i = 0; i < rows.size(); i++)
+	{
+		ret = store.Append(&rows[i]);
+		if (ret != DU_RETURN_OK)
+			return RT_RETURN_INTERNAL_ERROR;
+	}
+	appendSeconds = (NowNsec() - start) * 1e-9;
+
+	/* healing or damage of a player in a window */
+	rng = 99;
+	memset(&totals, 0, sizeof(totals));
+	start = NowNsec();
+	for (q = 0; q < BENCH_STORE_QUERIES; q++)
+	{
+		StoreQuery(&rng, endTime, q % GAME_NOF_SLOTS, &query);
+		store.Aggregate(&query, &totals);
+	}
+	querySeconds = (NowNsec() - start) * 1e-9;
+
+	rng = 99;
+	memset(&scanned, 0, sizeof(scanned));
+	start = NowNsec();
+	for (q = 0; q < BENCH_STORE_QUERIES; q++)
+	{
+		StoreQuery(&rng, endTime, q % GAME_NOF_SLOTS, &query);
+		for (i = 0; i < rows.size(); i++)
+		{
+			if (RowMatches(&rows[i], &query, slots))
+			{
+				scanned.count++;
+				scanned.amount += rows[i].amount;
+				scanned.value += rows[i].value;
+			}
+		}
+	}
+	scanSeconds = (NowNsec() - start) * 1e-9;
+	if (!SameTotals(&totals, &scanned))
+		nofMismatches++;
+
+	/* the first queries again, one by one against the log */
+	rng = 99;
+	logSeconds = 0.0;
+	for (q = 0; q < BENCH_STORE_LOG_QUERIES; q++)
+	{
+		StoreQuery(&rng, endTime, q % GAME_NOF_SLOTS, &query);
+		memset(&totals, 0, sizeof(totals));
+		memset(&logged, 0, sizeof(logged));
+		store.Aggregate(&query, &totals);
+		start = NowNsec();
+		ret = LogQuery(path, &query, &logged);
+		logSeconds += (NowNsec() - start) * 1e-9;
+		if (ret != RT_RETURN_OK)
+			return ret;
+		if (!SameTotals(&totals, &logged))
+			nofMismatches++;
+		nofMatched += logged.count;
+	}
+
+	/* the three abilities of every player worth the most over the match */
+	start = NowNsec();
+	for (q = 0; q < BENCH_STORE_QUERIES; q++)
+	{
+		VEEventStore::InitQuery(&query);
+		query.source = q % GAME_NOF_SLOTS;
+		query.type = VEEventAbility;
+		groups.clear();
+		store.Group(&query, VEStoreByAbility, &groups);
+		VEEventStore::TopK(&groups, 3, 0);
+	}
+	topSeconds = (NowNsec() - start) * 1e-9;
+
+	/* the season: segment m has the player of slot s as player (s + m) % GAME_NOF_SLOTS */
+	for (m = 0; m < BENCH_STORE_SEGMENTS; m++)
+	{
+		for (slot = 0; slot < GAME_NOF_SLOTS; slot++)
+			playerIds[slot] = (slot + m) % GAME_NOF_SLOTS;
+		store.SetPlayers(playerIds);
+		sprintf(segmentPath, "storm_bench_%d.vss", m);
+		ret = store.WriteSegment(segmentPath);
+		if (ret != DU_RETURN_OK)
+			return RT_RETURN_CANNOT_OPEN_FILE;
+	}
+	store.SetPlayers(slots);
+
+	start = NowNsec();
+	for (m = 0; m < BENCH_STORE_SEGMENTS; m++)
+	{
+		sprintf(segmentPath, "storm_bench_%d.vss", m);
+		ret = season[m].OpenSegment(segmentPath);
+		if (ret != DU_RETURN_OK)
+			return RT_RETURN_ILLEGAL_DATA;
+	}
+	openSeconds = (NowNsec() - start) * 1e-9;
+
+	/* a player over the season is every player of the match once, summed up */
+	rng = 99;
+	seasonSeconds = 0.0;
+	for (q = 0; q < BENCH_STORE_QUERIES; q++)
+	{
+		StoreQuery(&rng, endTime, q % GAME_NOF_SLOTS, &query);
+		memset(&seasonTotals, 0, sizeof(seasonTotals));
+		start = NowNsec();
+		for (m = 0; m < BENCH_STORE_SEGMENTS; m++)
+			season[m].Aggregate(&query, &seasonTotals);
+		seasonSeconds += (NowNsec() - start) * 1e-9;
+
+		memset(&totals, 0, sizeof(totals));
+		for (m = 0; m < BENCH_STORE_SEGMENTS; m++)
+		{
+			query.source = ((q % GAME_NOF_SLOTS) - m + GAME_NOF_SLOTS) % GAME_NOF_SLOTS;
+			store.Aggregate(&query, &totals);
+		}
+		if (!SameTotals(&totals, &seasonTotals))
+			nofMismatches++;
+	}
+
+	WriteResult("event_store", "\"rows\":%lu,\"bytes\":%lu,\"append_ns_per_row\":%.1f,\"query_us\":%.2f,\"row_scan_us\":%.2f,"
+	            "\"log_scan_us\":%.0f,\"log_rows_matched\":%lu,\"top_abilities_us\":%.2f,\"segments\":%d,\"segment_bytes\":%lu,"
+	            "\"segment_open_us\":%.2f,\"season_query_us\":%.2f,\"mismatches\":%lu",
+	            store.GetNofRows(), (unsigned long)store.GetSize(),
+	            rows.empty() ? 0.0 : appendSeconds * 1e9 / rows.size(),
+	            querySeconds * 1e6 / BENCH_STORE_QUERIES, scanSeconds * 1e6 / BENCH_STORE_QUERIES,
+	            logSeconds * 1e6 / BENCH_STORE_LOG_QUERIES, nofMatched, topSeconds * 1e6 / BENCH_STORE_QUERIES,
+	            BENCH_STORE_SEGMENTS, (unsigned long)season[0].GetSize(), openSeconds * 1e6 / BENCH_STORE_SEGMENTS,
+	            seasonSeconds * 1e6 / BENCH_STORE_QUERIES, nofMismatches);
+
+	for (m = 0; m < BENCH_STORE_SEGMENTS; m++)
+	{
+		season[m].Reset();
+		sprintf(segmentPath, "storm_bench_%d.vss", m);
+		remove(segmentPath);
+	}
+	return (nofMismatches == 0) ? RT_RETURN_OK : RT_RETURN_INTERNAL_ERROR;
+}
+
+
+
+/*
+	segmented: the timeline match analysed in segments. The output of a record is its score
+	before it is applied and every value after; the state pass leaves the values dirty.
+*/
+typedef struct _BenchSegmentRow
+{
+	double          time;
+	int             type;
+	int             entity;
+	float           score;
+	float           values[VE_NOF_NODES];
+} BenchSegmentRow;
+
+
+static int SegmentAnalyse(const char* payload, unsigned int size, double time, void* analysis, std::vector<char>* output)
+{
+	BenchTimelineMatch *match = (BenchTimelineMatch*)analysis;
+	BenchSegmentRow row;
+	VEEvent event;
+	int n, ret;
+
+	ret = RecordClass::Parse(payload, size, &event);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	event.time = time;
+	if (output == NULL)
+		return ApplyRecord(match, &event, 0);
+
+	memset(&row, 0, sizeof(row));
+	row.score = match->engine.ScoreEvent(&event);
+	ret = ApplyRecord(match, &event, 1);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	row.time = time;
+	row.type = event.type;
+	row.entity = event.entity;
+	for (n = 0; n < VE_NOF_NODES; n++)
+		row.values[n] = match->engine.GetValue(n);
+	output->insert(output->end(), (const char*)&row, (const char*)(&row + 1));
+	return RT_RETURN_OK;
+}
+
+
+static int SegmentIsSync(const char* payload, unsigned int size, double time, void* context)
+{
+	VEEvent event;
+
+	(void)time;
+	(void)context;
+	if (RecordClass::Parse(payload, size, &event) != RT_RETURN_OK)
+		return 0;
+	return event.type == VEEventDeath || event.type == VEEventObjective;
+}
+
+
+static int SegmentMatchCreate(ParallelReplayMatch* match, void* context)
+{
+	BenchTimelineMatch *m;
+	int ret;
+
+	(void)context;
+	m = new (std::nothrow) BenchTimelineMatch;
+	if (m == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	ret = TimelineMatchCreate(m);
+	if (ret != RT_RETURN_OK)
+	{
+		delete m;
+		return ret;
+	}
+	match->game = &m->game;
+	match->engine = &m->engine;
+	match->events = m->events;
+	match->analysis = m;
+	return RT_RETURN_OK;
+}
+
+
+static void SegmentMatchDestroy(ParallelReplayMatch* match, void* context)
+{
+	BenchTimelineMatch *m = (BenchTimelineMatch*)match->analysis;
+
+	(void)context;
+	if (m == NULL)
+		return;
+	RTEventListDestroy(m->events);
+	delete m;
+}
+
+
+static int BenchSegmented(const char* path)
+{
+	ParallelReplayCallbacks callbacks;
+	ParallelReplaySettings settings;
+	ParallelReplayStats stats, fixedStats;
+	ParallelReplayClass replay;
+	unsigned long nofMismatches = 0;
+	int ret;
+
+	memset(&callbacks, 0, sizeof(callbacks));
+	callbacks.create = SegmentMatchCreate;
+	callbacks.destroy = SegmentMatchDestroy;
+	callbacks.analyse = SegmentAnalyse;
+	callbacks.isSync = SegmentIsSync;
+
+	ParallelReplayClass::DefaultSettings(&settings);
+	settings.verify = 1;
+	settings.logFlags = RT_REPLAY_LOG_FLAG_NO_CACHE;
+	ret = replay.Run(path, &settings, &callbacks, &stats);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	if (stats.verified != ParallelReplayIdentical)
+		nofMismatches++;
+
+	settings.nofWorkers = BENCH_SEGMENT_WORKERS;
+	ret = replay.Run(path, &settings, &callbacks, &fixedStats);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	if (fixedStats.verified != ParallelReplayIdentical)
+		nofMismatches++;
+
+	WriteResult("segmented", "\"records\":%lu,\"output_bytes\":%lu,\"straight_seconds\":%.6f,\"read_seconds\":%.6f,"
+	            "\"workers\":%d,\"segments\":%d,\"state_seconds\":%.6f,\"segmented_seconds\":%.6f,\"speedup\":%.2f,\"steals\":%lu,"
+	            "\"workers_%d_segments\":%d,\"workers_%d_seconds\":%.6f,\"workers_%d_speedup\":%.2f,\"rerun\":%d,\"mismatches\":%lu",
+	            stats.nofRecords, (unsigned long)stats.outputBytes, stats.straightSeconds, stats.readSeconds,
+	            stats.nofWorkers, stats.nofSegments, stats.stateSeconds, stats.segmentSeconds,
+	            (stats.segmentSeconds > 0.0) ? stats.straightSeconds / stats.segmentSeconds : 0.0, stats.nofSteals,
+	            BENCH_SEGMENT_WORKERS, fixedStats.nofSegments, BENCH_SEGMENT_WORKERS, fixedStats.segmentSeconds,
+	            BENCH_SEGMENT_WORKERS, (fixedStats.segmentSeconds > 0.0) ? fixedStats.straightSeconds / fixedStats.segmentSeconds : 0.0,
+	            stats.nofRerun + fixedStats.nofRerun, nofMismatches);
+	return (nofMismatches == 0 && stats.nofRerun + fixedStats.nofRerun == 0) ? RT_RETURN_OK : RT_RETURN_INTERNAL_ERROR;
+}
+
+
+
+/*
+	matches: BENCH_MATCHES matches on one environment. They share the module table, a module
+	finds its match in its context and the feed of the match in the user data of the match.
+*/
+typedef struct _BenchMatchFeed BenchMatchFeed;
+
+typedef struct _BenchMatchEntry
+{
+	VEEvent             event;
+	BenchMatchFeed     *feed;
+} BenchMatchEntry;
+
+struct _BenchMatchFeed
+{
+	MatchClass                      match;
+	const char                     *path;
+	unsigned long                   nofRecords;
+	std::vector<BenchMatchEntry>    entries;
+	std::atomic<unsigned long>      nofReleased;
+	unsigned long                   nofFed;
+	unsigned long                   nofCommitted;   /* TIME_TICK thread of the match */
+	int                             ret;
+};
+
+typedef struct _BenchMatchesRun
+{
+	unsigned long       nofCommitted;       /* of all matches */
+	double              seconds;            /* from the first feed started until the last match is done */
+	unsigned long       rssKb;              /* resident memory the open matches added */
+	unsigned long long  heapBytes;          /* operator new while the matches opened */
+	unsigned long       peakRssKb;
+} BenchMatchesRun;
+
+
+static int MatchRegisterProcess(RTDataStruct* data, int moduleIndex, void* context)
+{
+	BenchMatchEntry *entry = (BenchMatchEntry*)data->pUserData;
+	const RTPassageStruct *passage;
+
+	(void)moduleIndex;
+	(void)context;
+	if (entry == NULL || data->nofpassages < 1)
+		return RT_RETURN_ILLEGAL_DATA;
+	passage = (const RTPassageStruct*)data->passages[0];
+	return RecordClass::Parse(passage->data, passage->size, &entry->event);
+}
+
+
+/* TIME_TICK thread of the match */
+static void MatchValueCommit(RTDataStruct* data, int moduleIndex, void* context)
+{
+	MatchClass *match = (MatchClass*)context;
+	BenchMatchEntry *entry = (BenchMatchEntry*)data->pUserData;
+
+	if (data->haserror || data->moduleReturnValue[moduleIndex] != RT_RETURN_OK)
+		return;
+	entry->event.time = data->timeStamp;
+	ApplyEvent(match->GetGame(), match->GetEngine(), &entry->event);
+	((BenchMatchFeed*)match->GetUserData())->nofCommitted++;
+}
+
+
+static void ReleaseMatchEntry(void* userdata)
+{
+	BenchMatchEntry *entry = (BenchMatchEntry*)userdata;
+
+	entry->feed->nofReleased.fetch_add(1, std::memory_order_release);
+}
+
+
+/* Feeds the log to one match as fast as its Process Buffer takes it */
+static void* MatchFeedThread(void* threadData)
+{
+	BenchMatchFeed *feed = (BenchMatchFeed*)threadData;
+	RTEngineInstance instance = feed->match.GetInstance();
+	RTDataStruct *data;
+	RTReplayLog log;
+	int ret;
+
+	ret = RTReplayLogOpen(feed->path, 0, RT_REPLAY_LOG_FLAG_NO_CACHE, &log);
+	if (ret != RT_RETURN_OK)
+	{
+		feed->ret = ret;
+		return NULL;
+	}
+	while (feed->nofFed < feed->nofRecords && (ret = RTReplayLogReadData(log, instance, &data)) == RT_RETURN_OK)
+	{
+		BenchMatchEntry *entry = &feed->entries[feed->nofFed];
+
+		entry->feed = feed;
+		RTInstanceDataSetUserData(instance, data, entry, ReleaseMatchEntry);
+		ret = RTInstanceProcess(instance, data);
+		if (ret != RT_RETURN_OK)
+			break;
+		feed->nofFed++;
+	}
+	feed->ret = (ret == RT_RETURN_END_OF_LOG || feed->nofFed == feed->nofRecords) ? RT_RETURN_OK : ret;
+
+	/* the passages point into the log */
+	while (feed->nofReleased.load(std::memory_order_acquire) < feed->nofFed)
+		QThread_sleep(1);
+	RTReplayLogClose(log);
+	return NULL;
+}
+
+
+/* nofMatches matches fed at once, values receives the VE_NOF_NODES values of every match at the end */
+static int MatchesRun(const char* path, unsigned long nofRecords, const EnvironmentClass* environment, int nofMatches,
+                      float* values, BenchMatchesRun* run)
+{
+	MatchSettings settings;
+	RTModuleSettings modules[2];
+	BenchMatchFeed *feeds;
+	std::vector<QThread> threads(nofMatches, (QThread)NULL);
+	unsigned long rssBefore, rssOpen;
+	unsigned long long bytesBefore;
+	GameEntity entity;
+	int64_t start;
+	int m, n, team, i, ret = RT_RETURN_OK;
+
+	memset(run, 0, sizeof(BenchMatchesRun));
+	memset(modules, 0, sizeof(modules));
+	modules[0].name = "register";
+	modules[0].inputs = RT_PRODUCT_BIT(RT_PRODUCT_PASSAGES);
+	modules[0].outputs = RT_PRODUCT_BIT(RT_PRODUCT_REGISTER);
+	modules[0].process = MatchRegisterProcess;
+	modules[1].name = "value";
+	modules[1].inputs = RT_PRODUCT_BIT(RT_PRODUCT_REGISTER);
+	modules[1].outputs = RT_PRODUCT_BIT(RT_PRODUCT_MACRO_VALUE);
+	modules[1].process = ValueProcess;
+	modules[1].commit = MatchValueCommit;
+	MatchClass::DefaultSettings(&settings);
+	settings.modules = modules;
+	settings.nofModules = 2;
+
+	feeds = new (std::nothrow) BenchMatchFeed[nofMatches];
+	if (feeds == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+
+	/* what one more match costs: the matches opened, players in, nothing fed yet */
+	rssBefore = CurrentRssKb();
+	bytesBefore = glAllocBytes.load();
+	for (m = 0; m < nofMatches && ret == RT_RETURN_OK; m++)
+	{
+		feeds[m].path = path;
+		feeds[m].nofRecords = nofRecords;
+		feeds[m].nofReleased.store(0);
+		feeds[m].nofFed = 0;
+		feeds[m].nofCommitted = 0;
+		feeds[m].ret = RT_RETURN_OK;
+		settings.userData = &feeds[m];
+		ret = feeds[m].match.Open("MATCH", environment, &settings);
+		for (team = 0; team < GAME_NOF_TEAMS && ret == RT_RETURN_OK; team++)
+			for (i = 0; i < GAME_PLAYERS_PER_TEAM; i++)
+				feeds[m].match.GetGame()->AddPlayer(team, team * GAME_PLAYERS_PER_TEAM + i, &entity);
+	}
+	rssOpen = CurrentRssKb();
+	run->heapBytes = glAllocBytes.load() - bytesBefore;
+	run->rssKb = (rssOpen > rssBefore) ? rssOpen - rssBefore : 0;
+	if (ret != RT_RETURN_OK)
+	{
+		delete[] feeds;
+		return ret;
+	}
+	for (m = 0; m < nofMatches; m++)
+		feeds[m].entries.resize(nofRecords);
+
+	start = NowNsec();
+	for (m = 0; m < nofMatches; m++)
+	{
+		if (QThread_create(&threads[m], "BENCH_FEED", MatchFeedThread, &feeds[m]) != QTHREAD_RETURN_OK)
+		{
+			threads[m] = NULL;
+			ret = RT_RETURN_INTERNAL_ERROR;
+			break;
+		}
+	}
+	for (m = 0; m < nofMatches; m++)
+	{
+		if (threads[m] != NULL)
+			QThread_join(threads[m], NULL);
+	}
+	run->seconds = (NowNsec() - start) * 1e-9;
+	run->peakRssKb = PeakRssKb();
+
+	/* every feed waited for its entries, the TIME_TICK threads are idle */
+	for (m = 0; m < nofMatches; m++)
+	{
+		if (ret == RT_RETURN_OK)
+			ret = feeds[m].ret;
+		run->nofCommitted += feeds[m].nofCommitted;
+		for (n = 0; n < VE_NOF_NODES; n++)
+			values[m * VE_NOF_NODES + n] = feeds[m].match.GetEngine()->GetValue(n);
+	}
+	delete[] feeds;
+	return ret;
+}
+
+
+static int BenchMatches(const char* path, unsigned long nofRecords)
+{
+	EnvironmentClass environment;
+	BenchMatchesRun single, many;
+	std::vector<unsigned char> pixels(BENCH_MATCH_ICON_SIZE * BENCH_MATCH_ICON_SIZE * 3);
+	std::vector<float> alone(VE_NOF_NODES), values(BENCH_MATCHES * VE_NOF_NODES);
+	CVImage image;
+	uint32_t rng = 1;
+	size_t p;
+	int nofMismatches = 0;
+	int hero, m, ret;
+
+	/* the environment every match reads: the patch and a template per hero */
+	ret = environment.Load(NULL);
+	image.pixels = pixels.data();
+	image.width = BENCH_MATCH_ICON_SIZE;
+	image.height = BENCH_MATCH_ICON_SIZE;
+	image.stride = BENCH_MATCH_ICON_SIZE * 3;
+	for (hero = 0; hero < ENV_NOF_HEROES && ret == RT_RETURN_OK; hero++)
+	{
+		for (p = 0; p < pixels.size(); p++)
+		{
+			rng = rng * 1664525u + 1013904223u;
+			pixels[p] = (unsigned char)(rng >> 24);
+		}
+		ret = environment.AddTemplate(hero, 0, &image);
+	}
+	if (ret == RT_RETURN_OK)
+		ret = environment.Seal();
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	ret = MatchesRun(path, nofRecords, &environment, 1, alone.data(), &single);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	ret = MatchesRun(path, nofRecords, &environment, BENCH_MATCHES, values.data(), &many);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	/* nothing of one match leaks into another: each ends where the match run alone did */
+	for (m = 0; m < BENCH_MATCHES; m++)
+	{
+		if (memcmp(&values[m * VE_NOF_NODES], alone.data(), VE_NOF_NODES * sizeof(float)) != 0)
+			nofMismatches++;
+	}
+	if (many.nofCommitted != single.nofCommitted * BENCH_MATCHES)
+		nofMismatches++;
+
+	WriteResult("matches", "\"matches\":%d,\"records\":%lu,\"templates\":%d,\"model_kb\":%.1f,"
+	            "\"single_seconds\":%.6f,\"seconds\":%.6f,\"records_per_s\":%.0f,\"single_records_per_s\":%.0f,"
+	            "\"single_rss_kb\":%lu,\"single_heap_bytes\":%llu,\"rss_kb_per_match\":%.1f,\"heap_bytes_per_match\":%.0f,"
+	            "\"peak_rss_kb\":%lu,\"mismatches\":%d",
+	            BENCH_MATCHES, single.nofCommitted, CVIndexGetNofTemplates(environment.GetRecognitionIndex()),
+	            environment.GetModelBytes() / 1024.0,
+	            single.seconds, many.seconds, (many.seconds > 0.0) ? many.nofCommitted / many.seconds : 0.0,
+	            (single.seconds > 0.0) ? single.nofCommitted / single.seconds : 0.0,
+	            single.rssKb, single.heapBytes, (double)many.rssKb / BENCH_MATCHES, (double)many.heapBytes / BENCH_MATCHES,
+	            many.peakRssKb, nofMismatches);
+	return (nofMismatches == 0) ? RT_RETURN_OK : RT_RETURN_INTERNAL_ERROR;
+}
+
+
+/*
+	markers: the minimap crop of ENV_CV_MINIMAP with the marker of every slot moving in a
+	band of its own, over terrain with dark patches (some as large as a marker) and pixel
+	noise. The odd slots die once and are off the minimap for BENCH_MARKER_DEAD_FRAMES.
+	Every kernel decodes every frame, with a full search each frame and with tracking.
+*/
+
+typedef struct _BenchMarkerRun
+{
+	CVMarkerTracker         tracker;
+	cvKernel                kernel;
+	int                     tracking;
+	CVMarkerFrame           frame;
+	std::vector<int64_t>    nsec;
+	unsigned long           nofVisible;
+	unsigned long           nofCorrect;
+	unsigned long           nofFalse;
+	unsigned long           nofMissed;
+	unsigned long           nofMismatches;      /* frames decoded otherwise than by the scalar kernel */
+} BenchMarkerRun;
+
+
+static int MarkerVisible(int slot, int frame)
+{
+	int death = BENCH_MARKER_FIRST_DEATH + slot * BENCH_MARKER_DEATH_STEP;
+
+	return (slot % 2) == 0 || frame < death || frame >= death + BENCH_MARKER_DEAD_FRAMES;
+}
+
+
+/* left top corner of the marker with its quiet zone */
+static void MarkerPosition(int slot, int frame, int width, int height, int* x, int* y)
+{
+	int side = CV_MARKER_QUIET_CELLS * BENCH_MARKER_MODULE;
+	int band = height / CV_MARKER_NOF_CODES;
+	double t = frame * (0.02 + 0.004 * slot) + slot;
+
+	*x = (int)((width - side) * (0.5 + 0.5 * sin(t)));
+	*y = slot * band + (int)((band - side) * (0.5 + 0.5 * sin(1.7 * t)));
+}
+
+
+static int SameFrame(const CVMarkerFrame* a, const CVMarkerFrame* b)
+{
+	int i;
+
+	if (a->nofMarkers != b->nofMarkers)
+		return 0;
+	for (i = 0; i < a->nofMarkers; i++)
+	{
+		if (a->markers[i].slot != b->markers[i].slot || a->markers[i].x != b->markers[i].x ||
+			a->markers[i].y != b->markers[i].y || a->markers[i].rotation != b->markers[i].rotation ||
+			a->markers[i].errors != b->markers[i].errors)
+			return 0;
+	}
+	return 1;
+}
+
+
+static int BenchMarkers(void)
+{
+	static const cvKernel kernels[] = { CVKernelScalar, CVKernelSSE, CVKernelAVX2 };
+	const ENV_CVRegionStruct *region = &ENV_CVRegions[ENV_CV_MINIMAP];
+	int width = region->width, height = region->height;
+	int side = CV_MARKER_QUIET_CELLS * BENCH_MARKER_MODULE;
+	std::vector<unsigned char> terrain((size_t)width * height * 3), pixels(terrain.size());
+	std::vector<BenchMarkerRun> runs;
+	CVMarkerSettings settings;
+	CVMarkerStats stats;
+	CVImage image;
+	uint32_t rng = 7;
+	size_t p;
+	int blob, frame, slot, x, y, bx, by, bw, bh, k, tracking, i, r;
+	int ret = RT_RETURN_OK;
+
+	/* light ground, dark walls, trees and shadows */
+	for (p = 0; p < terrain.size(); p++)
+	{
+		rng = rng * 1664525u + 1013904223u;
+		terrain[p] = (unsigned char)(140 + (rng >> 26));
+	}
+	for (blob = 0; blob < BENCH_MARKER_BLOBS; blob++)
+	{
+		rng = rng * 1664525u + 1013904223u;
+		bw = 4 + (int)((rng >> 8) % 40);
+		bh = 4 + (int)((rng >> 16) % 40);
+		rng = rng * 1664525u + 1013904223u;
+		bx = (int)((rng >> 8) % (unsigned int)(width - bw));
+		by = (int)((rng >> 16) % (unsigned int)(height - bh));
+		for (y = by; y < by + bh; y++)
+			memset(&terrain[((size_t)y * width + bx) * 3], 20 + (int)(rng >> 26), (size_t)bw * 3);
+	}
+
+	memset(&settings, 0, sizeof(settings));
+	settings.moduleSize = BENCH_MARKER_MODULE;
+	for (tracking = 0; tracking <= 1; tracking++)
+	{
+		for (k = 0; k < (int)(sizeof(kernels) / sizeof(kernels[0])); k++)
+		{
+			BenchMarkerRun run;
+
+			memset(&run.frame, 0, sizeof(run.frame));
+			run.kernel = kernels[k];
+			run.tracking = tracking;
+			run.nofVisible = run.nofCorrect = run.nofFalse = run.nofMissed = run.nofMismatches = 0;
+			settings.noTracking = !tracking;
+			ret = CVMarkerTrackerCreate(&settings, &run.tracker);
+			if (ret != RT_RETURN_OK)
+				break;
+			/* a kernel the processor does not have is left out */
+			if (CVMarkerSetKernel(run.tracker, kernels[k]) != RT_RETURN_OK)
+			{
+				CVMarkerTrackerDestroy(run.tracker);
+				continue;
+			}
+			run.nsec.reserve(BENCH_MARKER_FRAMES);
+			runs.push_back(run);
+		}
+	}
+
+	image.pixels = pixels.data();
+	image.width = width;
+	image.height = height;
+	image.stride = width * 3;
+	for (frame = 0; frame < BENCH_MARKER_FRAMES && ret == RT_RETURN_OK; frame++)
+	{
+		memcpy(pixels.data(), terrain.data(), pixels.size());
+		for (slot = 0; slot < CV_MARKER_NOF_CODES; slot++)
+		{
+			if (!MarkerVisible(slot, frame))
+				continue;
+			MarkerPosition(slot, frame, width, height, &x, &y);
+			CVMarkerDraw(&image, slot, BENCH_MARKER_MODULE, x, y);
+		}
+		/* video noise, markers included */
+		for (p = 0; p < pixels.size(); p++)
+		{
+			rng = rng * 1664525u + 1013904223u;
+			r = (int)pixels[p] + (int)(rng >> 27) - 16;
+			pixels[p] = (unsigned char)((r < 0) ? 0 : (r > 255) ? 255 : r);
+		}
+
+		for (i = 0; i < (int)runs.size() && ret == RT_RETURN_OK; i++)
+		{
+			BenchMarkerRun *run = &runs[i];
+			int64_t start = NowNsec();
+
+			ret = CVMarkerDecode(run->tracker, &image, &run->frame);
+			run->nsec.push_back(NowNsec() - start);
+
+			for (slot = 0, k = 0; slot < CV_MARKER_NOF_CODES; slot++)
+			{
+				const CVMarker *marker = (k < run->frame.nofMarkers && run->frame.markers[k].slot == slot)
+				                         ? &run->frame.markers[k++] : NULL;
+				int visible = MarkerVisible(slot, frame);
+
+				MarkerPosition(slot, frame, width, height, &x, &y);
+				if (visible)
+					run->nofVisible++;
+				if (marker == NULL)
+					run->nofMissed += visible;
+				else if (visible && fabs(marker->x - (x + 0.5 * side)) <= 2.0 && fabs(marker->y - (y + 0.5 * side)) <= 2.0)
+					run->nofCorrect++;
+				else
+					run->nofFalse++;
+			}
+			/* runs[0 .. nofKernels - 1] are the full searches, the scalar one first */
+			for (k = 0; k < i; k++)
+			{
+				if (runs[k].tracking == run->tracking && runs[k].kernel == CVKernelScalar)
+				{
+					if (!SameFrame(&runs[k].frame, &run->frame))
+						run->nofMismatches++;
+					break;
+				}
+			}
+		}
+	}
+
+	for (i = 0; i < (int)runs.size(); i++)
+	{
+		BenchMarkerRun *run = &runs[i];
+		int64_t total = 0;
+
+		if (ret == RT_RETURN_OK)
+		{
+			CVMarkerGetStats(run->tracker, &stats);
+			for (p = 0; p < run->nsec.size(); p++)
+				total += run->nsec[p];
+			std::sort(run->nsec.begin(), run->nsec.end());
+			WriteResult("markers", "\"kernel\":\"%s\",\"tracking\":%d,\"frames\":%lu,\"width\":%d,\"height\":%d,"
+			            "\"decoded_per_frame\":%.2f,\"visible\":%lu,\"correct\":%lu,\"false\":%lu,\"missed\":%lu,"
+			            "\"mean_us\":%.1f,\"p50_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f,\"full_searches\":%lu,"
+			            "\"local_searches\":%lu,\"local_hits\":%lu,\"candidates\":%lu,\"kernel_mismatches\":%lu",
+			            CVMarkerGetKernelName(run->tracker), run->tracking, stats.nofFrames, width, height,
+			            (double)stats.nofDecoded / stats.nofFrames, run->nofVisible, run->nofCorrect, run->nofFalse,
+			            run->nofMissed, total / 1000.0 / run->nsec.size(), Percentile(run->nsec, 0.5) / 1000.0,
+			            Percentile(run->nsec, 0.99) / 1000.0, run->nsec.back() / 1000.0, stats.nofFullSearches,
+			            stats.nofLocalSearches, stats.nofLocalHits, stats.nofCandidates, run->nofMismatches);
+			/* the kernels decode alike, and a full search of every frame misses nothing */
+			if (run->nofMismatches != 0 || run->nofFalse != 0 || (!run->tracking && run->nofMissed != 0))
+				ret = RT_RETURN_INTERNAL_ERROR;
+		}
+		CVMarkerTrackerDestroy(run->tracker);
+	}
+	return ret;
+}
+
+
+static int Selected(const char* only, const char* name)
+{
+	return only == NULL || strcmp(only, name) == 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+	SyntheticMatchSettings settings;
+	const char *outPath = NULL;
+	const char *logPath = BENCH_DEFAULT_LOG;
+	const char *only = NULL;
+	unsigned long nofOps = BENCH_DEFAULT_OPS;
+	unsigned long nofRecords = 0;
+	int failed = 0;
+	int i, ret;
+
+	SyntheticMatchClass::DefaultSettings(&settings);
+	for (i = 1; i < argc; i++)
+	{
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "%s: missing value\n", argv[i]);
+			return 2;
+		}
+		if (strcmp(argv[i], "--out") == 0)
+			outPath = argv[++i];
+		else if (strcmp(argv[i], "--log") == 0)
+			logPath = argv[++i];
+		else if (strcmp(argv[i], "--only") == 0)
+			only = argv[++i];
+		else if (strcmp(argv[i], "--seed") == 0)
+			settings.seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--seconds") == 0)
+			settings.matchSeconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "--density") == 0)
+			settings.eventsPerSecond = atof(argv[++i]);
+		else if (strcmp(argv[i], "--fights") == 0)
+			settings.teamFightsPerMinute = atof(argv[++i]);
+		else if (strcmp(argv[i], "--fight-seconds") == 0)
+			settings.teamFightSeconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "--burst") == 0)
+			settings.teamFightBurst = atof(argv[++i]);
+		else if (strcmp(argv[i], "--ops") == 0)
+			nofOps = strtoul(argv[++i], NULL, 10);
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	glOut = stdout;
+	if (outPath != NULL && (glOut = fopen(outPath, "w")) == NULL)
+	{
+		fprintf(stderr, "cannot write %s\n", outPath);
+		return 1;
+	}
+
+	fprintf(glOut, "{\"suite\":\"StormBench\",\"format\":%d,\"seed\":%u,\"match_seconds\":%.1f,\"events_per_second\":%.2f,"
+	        "\"team_fights_per_minute\":%.2f,\"team_fight_seconds\":%.1f,\"team_fight_burst\":%.2f,\"ops\":%lu,\"stats\":%s}\n",
+	        BENCH_RESULTS_FORMAT, settings.seed, settings.matchSeconds, settings.eventsPerSecond,
+	        settings.teamFightsPerMinute, settings.teamFightSeconds, settings.teamFightBurst, nofOps,
+#ifdef RT_WITH_STATS
+	        "true"
+#else
+	        "false"
+#endif
+	        );
+
+	ret = BenchGenerate(&settings, logPath, &nofRecords);
+	if (ret != RT_RETURN_OK)
+	{
+		fprintf(stderr, "generate: error %d\n", ret);
+		return 1;
+	}
+
+	if (Selected(only, "parse") && (ret = BenchParse(logPath)) != RT_RETURN_OK)
+	{
+		fprintf(stderr, "parse: error %d\n", ret);
+		failed++;
+	}
+	if (Selected(only, "process") && (ret = BenchProcess(logPath, nofRecords)) != RT_RETURN_OK)
+	{
+		fprintf(stderr, "process: error %d\n", ret);
+		failed++;
+	}
+	if (Selected(only, "live") && (ret = BenchLive(logPath, nofRecords)) != RT_RETURN_OK)
+	{
+		fprintf(stderr, "live: error %d\n", ret);
+		failed++;
+	}
+	if (Selected(only, "event_list") && (ret = BenchEventList(nofOps)) != RT_RETURN_OK)
+	{
+		fprintf(stderr, "event_list: error %d\n", ret);
+		failed++;
+	}
+	if (Selected(only, "process_buffer") && (ret = BenchProcessBuffer(nofOps)) != RT_RETURN_OK)
+	{
+		fprintf(stderr, "process_buffer: error %d\n", ret);
+		failed++;
+	}
+	if (Selected(only, "logger") && (ret = BenchLogger(nofOps / 10)) != RT_RETURN_OK)
+	{
+		fprintf(stderr, "logger: error %d\n", ret);
+		failed++;
+	}
+
+	if (Selected(only, "dispatch") && (ret = BenchDispatch(nofOps)) != RT_RETURN_OK)
+	{
+		fprintf(stderr, "dispatch: error %d\n", ret);
+		failed++;
+	}
+	if (Selected(only, "entity_index") && (ret = BenchEntityIndex(nofOps)) != RT_RETURN_OK)
+	{
+		fprintf(stderr, "entity_index: error %d\n", ret);
+		failed++;
+	}
+	if (Selected(only, "threads") && (ret = BenchThreads(nofOps)) != RT_RETURN_OK)
+	{
+		fprintf(stderr, "threads: error %d\n", ret);
+		failed++;
+	}
+	if (Selected(only, "timeline") && (ret = BenchTimeline(logPath)) != RT_RETURN_OK)
+	{
+		fprintf(stderr, "timeline: error %d\n", ret);
+		failed++;
+	}
+	if (Selected(only, "event_store") && (ret = BenchEventStore(logPath)) != RT_RETURN_OK)
+	{
+		fprintf(stderr, "event_store: error %d\n", ret);
+		failed++;
+	}
+	if (Selected(only, "segmented") && (ret = BenchSegmented(logPath)) != RT_RETURN_OK)
+	{
+		fprintf(stderr, "segmented: error %d\n", ret);
+		failed++;
+	}
+	if (Selected(only, "matches") && (ret = BenchMatches(logPath, nofRecords)) != RT_RETURN_OK)
+	{
+		fprintf(stderr, "matches: error %d\n", ret);
+		failed++;
+	}
+	if (Selected(only, "markers") && (ret = BenchMarkers()) != RT_RETURN_OK)
+	{
+		fprintf(stderr, "markers: error %d\n", ret);
+		failed++;
+	}
+
+	if (glOut != stdout)
+		fclose(glOut);
+	return failed != 0;
+}
@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SyntheticMatch.h"
+
+/* hit points of a player of level 1, and what a level adds */
+#define SYNTHETIC_BASE_HP           1500.0f
+#define SYNTHETIC_HP_PER_LEVEL      100.0f
+#define SYNTHETIC_MAX_LEVEL         30
+
+/* weights of the event types of a step, out of and in a team fight */
+static const int syntheticWeights[2][VE_NOF_EVENT_TYPES] =
+{
+	/* damage heal ability takedown death respawn levelUp move objective */
+	{ 20, 5, 20, 0, 0, 0, 0, 55, 0 },
+	{ 50, 15, 25, 0, 0, 0, 0, 10, 0 },
+};
+
+/*
+	SyntheticMatch CLASS
+*/
+
+SyntheticMatchClass::SyntheticMatchClass()
+{
+	DefaultSettings(&settings);
+	Start(&settings);
+}
+
+SyntheticMatchClass::~SyntheticMatchClass()
+{
+}
+
+
+void SyntheticMatchClass::DefaultSettings(SyntheticMatchSettings* settings)
+{
+	if (settings == NULL)
+		return;
+	settings->seed = 1;
+	settings->matchSeconds = 1200.0;
+	settings->eventsPerSecond = 20.0;
+	settings->teamFightsPerMinute = 1.5;
+	settings->teamFightSeconds = 15.0;
+	settings->teamFightBurst = 8.0;
+}
+
+
+int SyntheticMatchClass::Start(const SyntheticMatchSettings* s)
+{
+	int e, team;
+
+	if (s == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (s->matchSeconds <= 0.0 || s->eventsPerSecond <= 0.0 || s->teamFightsPerMinute < 0.0 ||
+		s->teamFightSeconds < 0.0 || s->teamFightBurst < 1.0)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+
+	settings = *s;
+	/* splitmix of the seed, a zero state would stay zero */
+	rng = (uint64_t)settings.seed * 0x9E3779B97F4A7C15ull + 0x632BE59BD9B4E019ull;
+	time = 0.0;
+	fightStart = fightEnd = 0.0;
+	for (team = 0; team < GAME_NOF_TEAMS; team++)
+		nextLevelUp[team] = 30.0 + Uniform() * 30.0;
+	nextObjective = 120.0 + Uniform() * 60.0;
+
+	for (e = 0; e < GAME_NOF_SLOTS; e++)
+	{
+		level[e] = 1;
+		hp[e] = SYNTHETIC_BASE_HP + SYNTHETIC_HP_PER_LEVEL;
+		respawnAt[e] = 0.0;
+	}
+	nofPending = nextPending = 0;
+	return RT_RETURN_OK;
+}
+
+
+/* xorshift64*, the upper half */
+uint32_t SyntheticMatchClass::Random()
+{
+	rng ^= rng >> 12;
+	rng ^= rng << 25;
+	rng ^= rng >> 27;
+	return (uint32_t)((rng * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+
+double SyntheticMatchClass::Uniform()
+{
+	return Random() * (1.0 / 4294967296.0);
+}
+
+
+int SyntheticMatchClass::RandomSlot(int team)
+{
+	return GameClass::TeamBegin(team) + (int)(Random() % GAME_PLAYERS_PER_TEAM);
+}
+
+
+/* GAME_ENTITY_NONE when the whole team is dead */
+int SyntheticMatchClass::RandomAliveSlot(int team)
+{
+	int first = (int)(Random() % GAME_PLAYERS_PER_TEAM);
+	int i, e;
+
+	for (i = 0; i < GAME_PLAYERS_PER_TEAM; i++)
+	{
+		e = GameClass::TeamBegin(team) + (first + i) % GAME_PLAYERS_PER_TEAM;
+		if (respawnAt[e] == 0.0)
+			return e;
+	}
+	return GAME_ENTITY_NONE;
+}
+
+
+void SyntheticMatchClass::Emit(int type, int entity, int target, int team, float amount)
+{
+	VEEvent *event;
+
+	if (nofPending >= (int)(sizeof(pending) / sizeof(pending[0])))
+		return;
+	event = &pending[nofPending++];
+	event->type = type;
+	event->entity = entity;
+	event->target = target;
+	event->team = team;
+	event->amount = amount;
+	event->time = time;
+}
+
+
+/* Advances the game time to the next event and queues its records */
+void SyntheticMatchClass::Step()
+{
+	const int *weights;
+	double rate, gap;
+	int inFight, type, total, pick, team, source, target, e;
+	float amount, maxHp;
+
+	nofPending = nextPending = 0;
+
+	/* the next team fight, the gaps between them average 60 / teamFightsPerMinute */
+	if (time >= fightEnd && settings.teamFightsPerMinute > 0.0)
+	{
+		gap = 60.0 / settings.teamFightsPerMinute;
+		fightStart = time + Uniform() * 2.0 * gap;
+		fightEnd = fightStart + settings.teamFightSeconds;
+	}
+
+	inFight = (time >= fightStart && time < fightEnd);
+	rate = settings.eventsPerSecond * (inFight ? settings.teamFightBurst : 1.0);
+	time += Uniform() * 2.0 / rate;
+	if (time >= settings.matchSeconds)
+		return;
+	inFight = (time >= fightStart && time < fightEnd);
+
+	for (e = 0; e < GAME_NOF_SLOTS; e++)
+	{
+		if (respawnAt[e] != 0.0 && respawnAt[e] <= time)
+		{
+			respawnAt[e] = 0.0;
+			hp[e] = SYNTHETIC_BASE_HP + SYNTHETIC_HP_PER_LEVEL * level[e];
+			Emit(VEEventRespawn, e, GAME_ENTITY_NONE, GameClass::TeamOf(e), 0.0f);
+		}
+	}
+
+	for (team = 0; team < GAME_NOF_TEAMS; team++)
+	{
+		if (time < nextLevelUp[team])
+			continue;
+		nextLevelUp[team] = time + 45.0 + Uniform() * 60.0;
+		e = GameClass::TeamBegin(team);
+		if (level[e] >= SYNTHETIC_MAX_LEVEL)
+			continue;
+		for (; e < GameClass::TeamEnd(team); e++)
+			level[e]++;
+		Emit(VEEventLevelUp, GameClass::TeamBegin(team), GAME_ENTITY_NONE, team, (float)level[GameClass::TeamBegin(team)]);
+	}
+
+	if (time >= nextObjective)
+	{
+		nextObjective = time + 90.0 + Uniform() * 120.0;
+		team = (int)(Random() % GAME_NOF_TEAMS);
+		source = RandomAliveSlot(team);
+		Emit(VEEventObjective, (source != GAME_ENTITY_NONE) ? source : RandomSlot(team), GAME_ENTITY_NONE, team,
+		     (float)(1 + Random() % 3));
+	}
+
+	weights = syntheticWeights[inFight];
+	for (total = 0, type = 0; type < VE_NOF_EVENT_TYPES; type++)
+		total += weights[type];
+	pick = (int)(Random() % (uint32_t)total);
+	for (type = 0; pick >= weights[type]; type++)
+		pick -= weights[type];
+
+	team = (int)(Random() % GAME_NOF_TEAMS);
+	source = RandomAliveSlot(team);
+	if (source == GAME_ENTITY_NONE)
+		return;
+
+	switch (type)
+	{
+	case VEEventDamage:
+		target = RandomAliveSlot(1 - team);
+		if (target == GAME_ENTITY_NONE)
+			return;
+		amount = (float)(50 + Random() % 351);
+		hp[target] -= amount;
+		Emit(VEEventDamage, source, target, team, amount);
+		if (hp[target] <= 0.0f)
+		{
+			hp[target] = 0.0f;
+			respawnAt[target] = time + 10.0 + 2.0 * level[target];
+			Emit(VEEventDeath, target, GAME_ENTITY_NONE, 1 - team, 0.0f);
+			Emit(VEEventTakedown, source, target, team, 1.0f);
+		}
+		break;
+
+	case VEEventHeal:
+		target = RandomAliveSlot(team);
+		maxHp = SYNTHETIC_BASE_HP + SYNTHETIC_HP_PER_LEVEL * level[target];
+		amount = (float)(50 + Random() % 251);
+		hp[target] = (hp[target] + amount < maxHp) ? hp[target] + amount : maxHp;
+		Emit(VEEventHeal, source, target, team, amount);
+		break;
+
+	case VEEventAbility:
+		Emit(VEEventAbility, source, GAME_ENTITY_NONE, team, (float)(Random() % GAME_NOF_ABILITIES));
+		break;
+
+	default:
+		Emit(VEEventMove, source, GAME_ENTITY_NONE, team, 0.0f);
+		break;
+	}
+}
+
+
+int SyntheticMatchClass::Next(char* record, double* t)
+{
+	const VEEvent *event;
+
+	if (record == NULL || t == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	while (nextPending >= nofPending)
+	{
+		if (time >= settings.matchSeconds)
+			return RT_RETURN_END_OF_LOG;
+		Step();
+	}
+
+	event = &pending[nextPending++];
+	*t = event->time;
+	snprintf(record, SYNTHETIC_MAX_RECORD_SIZE, "%.3f\t%s %d %d %d %.1f", event->time,
+	         ValueEngine::GetEventName(event->type), event->entity, event->target, event->team, event->amount);
+	return RT_RETURN_OK;
+}
+
+
+int SyntheticMatchClass::WriteLog(const char* path, unsigned long* nofRecords, unsigned long long* nofBytes)
+{
+	char record[SYNTHETIC_MAX_RECORD_SIZE];
+	unsigned long records = 0;
+	unsigned long long bytes = 0;
+	double t;
+	FILE *f;
+	int ret;
+
+	if (path == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	f = fopen(path, "wb");
+	if (f == NULL)
+		return RT_RETURN_CANNOT_OPEN_FILE;
+
+	ret = Start(&settings);
+	while (ret == RT_RETURN_OK && (ret = Next(record, &t)) == RT_RETURN_OK)
+	{
+		bytes += fprintf(f, "%s\n", record);
+		records++;
+	}
+	if (fclose(f) != 0 && ret == RT_RETURN_END_OF_LOG)
+		ret = RT_RETURN_CANNOT_OPEN_FILE;
+
+	if (nofRecords != NULL)
+		*nofRecords = records;
+	if (nofBytes != NULL)
+		*nofBytes = bytes;
+	return (ret == RT_RETURN_END_OF_LOG) ? RT_RETURN_OK : ret;
+}
+
+
+/*
+	END OF SyntheticMatch CLASS
+*/
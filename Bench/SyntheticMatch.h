@@ -0,0 +1,103 @@
+#ifndef _SyntheticMatch_H_
+#define _SyntheticMatch_H_
+
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "RTEngine.h"
+#include "ValueEngine.h"
+
+/*
+	SyntheticMatchClass generates a 5v5 match as replay log records (RTReplayLog.h), for
+	benchmarks that need a match of a given length and event density without a recording.
+
+	The match is a function of its settings only: the same settings give the same log,
+	byte for byte, on every platform (own random generator, no transcendental math).
+
+	Outside team fights records come at eventsPerSecond, mostly moves and abilities.
+	A team fight of teamFightSeconds starts teamFightsPerMinute times a minute on average
+	and multiplies the rate by teamFightBurst; its records are mostly damage and heals,
+	and a player whose hit points run out dies (a death and a takedown record) and
+	respawns later. Level ups and objectives come at a steady pace.
+
+	A record is one line:
+
+		<time>\t<event> <entity> <target> <team> <amount>
+
+	time in seconds with 3 decimals, event one of the instruction names of
+	ValueEngine::ActionDetected, entity and target slots (-1 for none). The payload after the
+	time is the one of RecordClass (Record.h), RecordClass::Parse turns it back into a VEEvent.
+*/
+
+
+typedef struct _SyntheticMatchSettings
+{
+	unsigned int    seed;
+	double          matchSeconds;           /* game time of the match */
+	double          eventsPerSecond;        /* records per second outside team fights */
+	double          teamFightsPerMinute;
+	double          teamFightSeconds;
+	double          teamFightBurst;         /* rate multiplier in a team fight */
+} SyntheticMatchSettings;
+
+
+/* Longest record, time and payload, without line end */
+#define SYNTHETIC_MAX_RECORD_SIZE       96
+
+
+typedef class SyntheticMatchClass
+{
+public:
+	SyntheticMatchClass();
+	~SyntheticMatchClass();
+
+	/* Settings of a 20 minute match with 20 records/s */
+	static void DefaultSettings(SyntheticMatchSettings* settings);
+
+	/* Starts the match over */
+	int Start(const SyntheticMatchSettings* settings);
+
+	/*
+		The next record, NUL terminated and without line end, in record (at least
+		SYNTHETIC_MAX_RECORD_SIZE bytes). RT_RETURN_END_OF_LOG after the match.
+	*/
+	int Next(char* record, double* time);
+
+	/* Writes the whole match to path, nofRecords and nofBytes (optional) receive what was written */
+	int WriteLog(const char* path, unsigned long* nofRecords, unsigned long long* nofBytes);
+
+private:
+	SyntheticMatchClass(const SyntheticMatchClass&);
+	SyntheticMatchClass& operator=(const SyntheticMatchClass&);
+
+	uint32_t Random();
+	/* uniform in [0, 1) */
+	double Uniform();
+	int RandomSlot(int team);
+	int RandomAliveSlot(int team);
+	void Emit(int type, int entity, int target, int team, float amount);
+	void Step();
+
+	SyntheticMatchSettings settings;
+	uint64_t rng;
+	double time;
+	double fightStart;                  /* the running or the next team fight */
+	double fightEnd;
+	double nextLevelUp[GAME_NOF_TEAMS];
+	double nextObjective;
+
+	float hp[GAME_NOF_SLOTS];
+	int level[GAME_NOF_SLOTS];
+	double respawnAt[GAME_NOF_SLOTS];   /* 0 when alive */
+
+	/* records of one step: respawns, level ups, an objective and up to 3 for the event itself */
+	VEEvent pending[GAME_NOF_SLOTS + GAME_NOF_TEAMS + 4];
+	int nofPending;
+	int nextPending;
+
+}* SyntheticMatch;
+
+
+
+#endif // _SyntheticMatch_H_
@@ -0,0 +1,178 @@
+﻿#ifndef _CVENGINE_H_
+#define _CVENGINE_H_
+
+#include <stdio.h>
+
+#include "RTEngine.h"
+#include "ENV_CV.h"
+
+/*
+	CV Engine: extracts visual information from a replay video (Get_Frame_info).
+
+	Frames go through a pipeline of stages, each on its own thread:
+
+		DECODE   reads the next frame of the video into a free frame buffer
+		CROP     copies the UI regions of ENV_CV.h out of the frame
+		ANALYSE  runs the analysis on the regions and fills an RTDataStruct
+		EMIT     hands the data to the RT Engine, in frame order, and recycles the frame
+
+	The stages pass frames through bounded queues; a fixed set of frame buffers is
+	allocated when the pipeline opens and reused for the whole video.
+
+	In real-time mode the video is read at the rate it was recorded, as it would arrive
+	from a running game. When the analysis falls behind, DECODE skips frames: any frame
+	more than maxLag seconds late, and any frame for which no buffer is free. Offline
+	mode reads every frame as fast as the stages allow.
+
+	Return values are the RT_RETURN_* codes of RTEngine.h.
+*/
+
+
+/** Frame buffers of a pipeline by default */
+#define CV_PIPELINE_DEFAULT_NOF_FRAMES      8
+/** Real-time mode skips frames that are later than this, in seconds */
+#define CV_PIPELINE_DEFAULT_MAX_LAG         0.25
+/** Real-time mode analyses one frame in this many while the instance is at RT_LIVE_LEVEL_COARSE_CV or above */
+#define CV_PIPELINE_COARSE_STRIDE           2
+
+
+/** Stages of the pipeline */
+enum cvStage
+{
+	CVStageDecode, CVStageCrop, CVStageAnalyse, CVStageEmit,
+	CV_NOF_STAGES
+};
+
+
+/** 8 bit BGR image, 3 bytes per pixel */
+typedef struct _CVImage
+{
+	unsigned char  *pixels;
+	int             width;
+	int             height;
+	int             stride;         /**< bytes from one row to the next */
+} CVImage;
+
+
+/** A frame in the pipeline. The buffers belong to the pipeline, they are reused for later frames. */
+typedef struct _CVFrameStruct
+{
+	unsigned long   frameNr;                        /**< in the video, 0 based */
+	double          time;                           /**< video time in seconds */
+	double          gameTime;                       /**< time * replaySpeed */
+	int             sourceId;                       /**< passage source id for the data, from the settings */
+	CVImage         image;                          /**< the whole frame, filled by DECODE */
+	CVImage         regions[ENV_CV_NOF_REGIONS];    /**< the ENV_CV.h regions, filled by CROP */
+	RTDataStruct   *data;                           /**< result of ANALYSE, NULL if there is nothing to emit */
+} CVFrameStruct;
+
+
+/**
+ * Analysis of one frame, called in the ANALYSE thread for every frame that is not skipped.
+ *
+ * To emit a result the function creates a data container with RTInstanceCreateData(instance)
+ * (RTCoreCreateData if instance is NULL) and stores it in frame->data. Passages must not
+ * point into the frame, its buffers are reused once the frame is emitted; keep them in the
+ * userdata of the container.
+ *
+ * @retval RT_RETURN_OK, anything else is counted as an analysis error
+ */
+typedef int (*CVAnalyseFunc)(CVFrameStruct* frame, RTEngineInstance instance, void* context);
+
+
+/** Settings of a pipeline. All zero gives the defaults. */
+typedef struct _CVPipelineSettings
+{
+	int                 nofFrames;          /**< frame buffers, 0: CV_PIPELINE_DEFAULT_NOF_FRAMES */
+	int                 realTime;           /**< 1: read the video at its recorded rate and skip late frames */
+	double              maxLag;             /**< seconds, 0: CV_PIPELINE_DEFAULT_MAX_LAG */
+	double              replaySpeed;        /**< game seconds per video second of the recording, 0: 1 */
+	RTEngineInstance    instance;           /**< receives the data, NULL: the RTCore instance */
+	int                 sourceId;           /**< passage source id of the emitted data */
+	CVAnalyseFunc       analyse;            /**< NULL: CVAnalyseRegionChanges */
+	void               *analyseContext;
+} CVPipelineSettings;
+
+
+/** Counters of one stage */
+typedef struct _CVStageStats
+{
+	const char     *name;
+	unsigned long   nofFrames;          /**< frames handled */
+	double          busySeconds;        /**< time spent on them, waiting excluded */
+	double          fps;                /**< sustained frames per second over the run */
+	double          maxFps;             /**< frames per second the stage manages on its own */
+} CVStageStats;
+
+
+typedef struct _CVPipelineStats
+{
+	unsigned long   nofFrames;          /**< frames in the video read so far */
+	unsigned long   nofSkipped;         /**< frames DECODE skipped because the analysis was behind */
+	unsigned long   nofCoarse;          /**< frames DECODE skipped for the live mode of the instance */
+	unsigned long   nofEmitted;         /**< data containers handed to the RT Engine */
+	unsigned long   nofErrors;          /**< failed analyses and rejected data */
+	double          seconds;            /**< wall time since the pipeline opened */
+	double          videoSeconds;       /**< video time of the last frame read */
+	CVStageStats    stages[CV_NOF_STAGES];
+} CVPipelineStats;
+
+
+typedef struct _CVPipelineStruct *CVPipeline;
+
+
+
+/**
+ * Opens a video and starts the pipeline on it.
+ *
+ * Y4M (YUV4MPEG2) videos are read natively, any recording converts to it with
+ * "ffmpeg -i replay.mp4 -pix_fmt yuv420p replay.y4m". Built with CV_WITH_OPENCV every
+ * format OpenCV reads is accepted as well.
+ *
+ * @param[in]   path        The video file
+ * @param[in]   settings    Settings, NULL for the defaults
+ * @param[out]  pipeline    The running pipeline
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_CANNOT_OPEN_FILE
+ * @retval RT_RETURN_ILLEGAL_DATA - not a video that can be read
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ * @retval RT_RETURN_INTERNAL_ERROR - a stage thread could not be started
+ */
+extern int CVPipelineOpen(const char* path, const CVPipelineSettings* settings, CVPipeline* pipeline);
+
+/** Waits until every frame of the video went through the pipeline */
+extern int CVPipelineWait(CVPipeline pipeline);
+
+/** Stops reading the video, the frames already read still go through the pipeline */
+extern int CVPipelineStop(CVPipeline pipeline);
+
+/** Stops the pipeline if it is still running, waits for it and frees it */
+extern int CVPipelineClose(CVPipeline pipeline);
+
+/** Returns the counters of the pipeline. May be called from any thread while it runs. */
+extern int CVPipelineGetStats(CVPipeline pipeline, CVPipelineStats* stats);
+
+/** Prints the counters of a pipeline, one line per stage */
+extern void CVPipelinePrintStats(FILE* f, const CVPipelineStats* stats);
+
+
+/** State of CVAnalyseRegionChanges, start it zeroed */
+typedef struct _CVRegionChangesStruct
+{
+	int             valid;
+	double          mean[ENV_CV_NOF_REGIONS][3];    /**< B, G, R of the last emitted frame */
+} CVRegionChangesStruct;
+
+/**
+ * Default analysis: emits a data container when the mean colour of a region changes by
+ * more than a few levels since the last emitted frame. The passage (RT_PASSAGE_TYPE_CV_RESULT)
+ * is the text "<region name> <mean B> <mean G> <mean R>" of every changed region.
+ * context is a CVRegionChangesStruct.
+ */
+extern int CVAnalyseRegionChanges(CVFrameStruct* frame, RTEngineInstance instance, void* context);
+
+
+
+#endif //_CVENGINE_H_
@@ -0,0 +1,780 @@
+﻿#include "pch.h"
+#include "CVMarker.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <chrono>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CV_WITH_X86_KERNELS
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+
+/* a run of top edge pixels is a border when its length is this many quarters of the expected one */
+#define CV_MARKER_MIN_RUN_QUARTERS  3
+#define CV_MARKER_MAX_RUN_QUARTERS  5
+/* quiet zone samples that may be black: an icon close by, a noisy pixel */
+#define CV_MARKER_MAX_QUIET_BLACK   2
+
+/* MSVC compiles the intrinsics of every instruction set, gcc and clang per function */
+#if defined(CV_WITH_X86_KERNELS) && !defined(_MSC_VER)
+#define CV_TARGET_SSSE3             __attribute__((target("ssse3")))
+#define CV_TARGET_AVX2              __attribute__((target("avx2")))
+#else
+#define CV_TARGET_SSSE3
+#define CV_TARGET_AVX2
+#endif
+
+
+/* mask[i] = 0xFF where the gray level of BGR pixel i is below threshold, 0 elsewhere */
+typedef void (*CVBinariseFunc)(const unsigned char* bgr, int nofPixels, int threshold, unsigned char* mask);
+/* first i where row[i] is black and above[i] is white, n if there is none */
+typedef int (*CVEdgeFunc)(const unsigned char* row, const unsigned char* above, int n);
+
+
+/*
+	The codes of the slots without turn: bit j * 4 + i is the data module in column i,
+	row j. Found by a search for 10 codes at least 6 bits apart from each other in every
+	quarter turn and from their own turns.
+*/
+static const unsigned short cvMarkerCodes[CV_MARKER_NOF_CODES] =
+{
+	0x2C8C, 0xD4C0, 0xFA2B, 0x0754, 0xAC41, 0xCABE, 0xF2DC, 0xC146, 0x616D, 0xA92E
+};
+
+
+/* Where a slot was last seen */
+typedef struct _CVMarkerTrack
+{
+	int     valid;
+	int     missed;         /* frames since it was last seen */
+	float   x;              /* centre when last seen */
+	float   y;
+	float   vx;             /* pixels per frame */
+	float   vy;
+	float   size;
+} CVMarkerTrack;
+
+
+typedef struct _CVMarkerTrackerStruct
+{
+	int                 moduleSize;
+	int                 threshold;
+	int                 tracking;
+	cvKernel            kernel;
+	CVBinariseFunc      binarise;
+	CVEdgeFunc          edge;
+
+	unsigned short      codes[CV_MARKER_NOF_CODES][4];  /* every code in its four quarter turns */
+
+	/* one byte per pixel of the image, valid inside the window binarised last */
+	unsigned char      *mask;
+	size_t              maskSize;
+	int                 width;
+	int                 height;
+	int                 wx0, wy0, wx1, wy1;
+
+	CVMarkerTrack       tracks[CV_MARKER_NOF_CODES];
+	int                 framesSinceFull;
+	CVMarkerStats       stats;
+} CVMarkerTrackerStruct;
+
+
+
+/*
+	Codes
+*/
+
+/* a quarter turn clockwise: module (i, j) moves to (3 - j, i) */
+static unsigned short RotateCode(unsigned short code)
+{
+	unsigned short turned = 0;
+	int i, j;
+
+	for (j = 0; j < CV_MARKER_DATA_CELLS; j++)
+	{
+		for (i = 0; i < CV_MARKER_DATA_CELLS; i++)
+		{
+			if (code & (1u << (j * CV_MARKER_DATA_CELLS + i)))
+				turned |= (unsigned short)(1u << (i * CV_MARKER_DATA_CELLS + CV_MARKER_DATA_CELLS - 1 - j));
+		}
+	}
+	return turned;
+}
+
+
+static int CountBits(unsigned int bits)
+{
+	int n = 0;
+
+	for (; bits != 0; bits &= bits - 1)
+		n++;
+	return n;
+}
+
+
+
+/*
+	Kernels
+*/
+
+/* ((B + R) / 2 + G) / 2 with the rounding of pavgb, so every kernel gives the same mask */
+static void BinariseScalar(const unsigned char* bgr, int nofPixels, int threshold, unsigned char* mask)
+{
+	int i;
+
+	for (i = 0; i < nofPixels; i++, bgr += 3)
+	{
+		unsigned int br = (bgr[0] + bgr[2] + 1) >> 1;
+		unsigned int gray = (br + bgr[1] + 1) >> 1;
+
+		mask[i] = (gray < (unsigned int)threshold) ? 0xFF : 0;
+	}
+}
+
+
+static int EdgeScalar(const unsigned char* row, const unsigned char* above, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		if (row[i] & ~above[i])
+			return i;
+	}
+	return n;
+}
+
+
+#ifdef CV_WITH_X86_KERNELS
+
+/* pshufb masks that gather the B, G and R bytes of 16 pixels from their 48 bytes */
+alignas(16) static const signed char cvSplitBGR[9][16] =
+{
+	{  0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },   /* B from bytes 0 - 15 */
+	{ -1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14, -1, -1, -1, -1, -1 },   /* B from bytes 16 - 31 */
+	{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  1,  4,  7, 10, 13 },   /* B from bytes 32 - 47 */
+	{  1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },   /* G from bytes 0 - 15 */
+	{ -1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1 },   /* G from bytes 16 - 31 */
+	{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14 },   /* G from bytes 32 - 47 */
+	{  2,  5,  8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },   /* R from bytes 0 - 15 */
+	{ -1, -1, -1, -1, -1,  1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1 },   /* R from bytes 16 - 31 */
+	{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15 },   /* R from bytes 32 - 47 */
+};
+
+
+static inline int FirstBit(unsigned int bits)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+
+	_BitScanForward(&index, bits);
+	return (int)index;
+#else
+	return __builtin_ctz(bits);
+#endif
+}
+
+
+/*
+	A row of at least one block ends with a block that overlaps the one before: the pixels
+	of both get the same mask twice, and the edge search knows the bits before are 0. The
+	local search windows are a few blocks wide, a scalar tail would cost as much as them.
+*/
+CV_TARGET_SSSE3
+static void BinariseSSSE3(const unsigned char* bgr, int nofPixels, int threshold, unsigned char* mask)
+{
+	const __m128i *split = (const __m128i*)cvSplitBGR;
+	__m128i limit = _mm_set1_epi8((char)(threshold - 1));
+	int i;
+
+	if (nofPixels < 16)
+	{
+		BinariseScalar(bgr, nofPixels, threshold, mask);
+		return;
+	}
+	for (i = 0; i < nofPixels; i += 16)
+	{
+		const unsigned char *p;
+		__m128i c0, c1, c2, b, g, r, gray;
+
+		if (i > nofPixels - 16)
+			i = nofPixels - 16;
+		p = bgr + 3 * i;
+		c0 = _mm_loadu_si128((const __m128i*)p);
+		c1 = _mm_loadu_si128((const __m128i*)(p + 16));
+		c2 = _mm_loadu_si128((const __m128i*)(p + 32));
+		b = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, split[0]), _mm_shuffle_epi8(c1, split[1])), _mm_shuffle_epi8(c2, split[2]));
+		g = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, split[3]), _mm_shuffle_epi8(c1, split[4])), _mm_shuffle_epi8(c2, split[5]));
+		r = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, split[6]), _mm_shuffle_epi8(c1, split[7])), _mm_shuffle_epi8(c2, split[8]));
+		gray = _mm_avg_epu8(_mm_avg_epu8(b, r), g);
+		/* gray <= threshold - 1, there is no unsigned byte compare */
+		_mm_storeu_si128((__m128i*)(mask + i), _mm_cmpeq_epi8(_mm_min_epu8(gray, limit), gray));
+	}
+}
+
+
+CV_TARGET_SSSE3
+static int EdgeSSSE3(const unsigned char* row, const unsigned char* above, int n)
+{
+	int i, bits;
+
+	if (n < 16)
+		return EdgeScalar(row, above, n);
+	for (i = 0; i < n; i += 16)
+	{
+		if (i > n - 16)
+			i = n - 16;
+		bits = _mm_movemask_epi8(_mm_andnot_si128(_mm_loadu_si128((const __m128i*)(above + i)),
+		                                          _mm_loadu_si128((const __m128i*)(row + i))));
+		if (bits != 0)
+			return i + FirstBit((unsigned int)bits);
+	}
+	return n;
+}
+
+
+/* the low lanes take pixels i .. i + 15, the high lanes i + 16 .. i + 31, pshufb works per lane */
+CV_TARGET_AVX2
+static void BinariseAVX2(const unsigned char* bgr, int nofPixels, int threshold, unsigned char* mask)
+{
+	__m256i split[9];
+	__m256i limit = _mm256_set1_epi8((char)(threshold - 1));
+	int i, k;
+
+	if (nofPixels < 32)
+	{
+		BinariseScalar(bgr, nofPixels, threshold, mask);
+		return;
+	}
+	for (k = 0; k < 9; k++)
+		split[k] = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)cvSplitBGR[k]));
+	for (i = 0; i < nofPixels; i += 32)
+	{
+		const unsigned char *p;
+		__m256i c0, c1, c2, b, g, r, gray;
+
+		if (i > nofPixels - 32)
+			i = nofPixels - 32;
+		p = bgr + 3 * i;
+		c0 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p)),
+		                             _mm_loadu_si128((const __m128i*)(p + 48)), 1);
+		c1 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(p + 16))),
+		                             _mm_loadu_si128((const __m128i*)(p + 64)), 1);
+		c2 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(p + 32))),
+		                             _mm_loadu_si128((const __m128i*)(p + 80)), 1);
+		b = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(c0, split[0]), _mm256_shuffle_epi8(c1, split[1])),
+		                    _mm256_shuffle_epi8(c2, split[2]));
+		g = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(c0, split[3]), _mm256_shuffle_epi8(c1, split[4])),
+		                    _mm256_shuffle_epi8(c2, split[5]));
+		r = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(c0, split[6]), _mm256_shuffle_epi8(c1, split[7])),
+		                    _mm256_shuffle_epi8(c2, split[8]));
+		gray = _mm256_avg_epu8(_mm256_avg_epu8(b, r), g);
+		_mm256_storeu_si256((__m256i*)(mask + i), _mm256_cmpeq_epi8(_mm256_min_epu8(gray, limit), gray));
+	}
+}
+
+
+CV_TARGET_AVX2
+static int EdgeAVX2(const unsigned char* row, const unsigned char* above, int n)
+{
+	unsigned int bits;
+	int i;
+
+	if (n < 32)
+		return EdgeScalar(row, above, n);
+	for (i = 0; i < n; i += 32)
+	{
+		if (i > n - 32)
+			i = n - 32;
+		bits = (unsigned int)_mm256_movemask_epi8(_mm256_andnot_si256(_mm256_loadu_si256((const __m256i*)(above + i)),
+		                                                               _mm256_loadu_si256((const __m256i*)(row + i))));
+		if (bits != 0)
+			return i + FirstBit(bits);
+	}
+	return n;
+}
+
+
+static int HasSSSE3(void)
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 1);
+	return (info[2] & (1 << 9)) != 0;
+#else
+	return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+
+static int HasAVX2(void)
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	/* AVX, and the OS saves the YMM registers */
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 28)) == 0 || (info[2] & (1 << 27)) == 0)
+		return 0;
+	if ((_xgetbv(0) & 6) != 6)
+		return 0;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif //CV_WITH_X86_KERNELS
+
+
+/* 1 and the functions of kernel, 0 if the processor or the build does not have it */
+static int KernelFuncs(cvKernel kernel, CVBinariseFunc* binarise, CVEdgeFunc* edge)
+{
+	switch (kernel)
+	{
+	case CVKernelScalar:
+		*binarise = BinariseScalar;
+		*edge = EdgeScalar;
+		return 1;
+#ifdef CV_WITH_X86_KERNELS
+	case CVKernelSSE:
+		*binarise = BinariseSSSE3;
+		*edge = EdgeSSSE3;
+		return HasSSSE3();
+	case CVKernelAVX2:
+		*binarise = BinariseAVX2;
+		*edge = EdgeAVX2;
+		return HasAVX2();
+#endif
+	default:
+		return 0;
+	}
+}
+
+
+
+/*
+	Search
+*/
+
+static void BinariseWindow(CVMarkerTracker tracker, const CVImage* image, int x0, int y0, int x1, int y1)
+{
+	int y;
+
+	for (y = y0; y < y1; y++)
+		tracker->binarise(image->pixels + (size_t)y * image->stride + 3 * x0, x1 - x0, tracker->threshold,
+		                  tracker->mask + (size_t)y * tracker->width + x0);
+	tracker->wx0 = x0;
+	tracker->wy0 = y0;
+	tracker->wx1 = x1;
+	tracker->wy1 = y1;
+}
+
+
+/* outside the window counts as white, like the quiet zone */
+static inline int Black(CVMarkerTracker tracker, int x, int y)
+{
+	if (x < tracker->wx0 || x >= tracker->wx1 || y < tracker->wy0 || y >= tracker->wy1)
+		return 0;
+	return tracker->mask[(size_t)y * tracker->width + x] != 0;
+}
+
+
+/*
+	Checks the border square with its left top corner at x, y, side pixels wide: its border
+	black and the quiet zone around it white, sampled at the centre of every module. Then
+	reads the data and looks for the nearest code in any turn. 1 if it is a marker.
+*/
+static int ReadMarker(CVMarkerTracker tracker, int x, int y, int side, CVMarker* marker)
+{
+	float module = (float)side / CV_MARKER_CELLS;
+	int half = (int)(0.5f * module);
+	unsigned int bits = 0;
+	int best = CV_MARKER_MAX_ERRORS + 1, bestSlot = 0, bestRotation = 0;
+	int nofQuiet = 0;
+	int k, i, j, slot, rotation, errors;
+
+	for (k = 0; k < CV_MARKER_CELLS; k++)
+	{
+		int along = (int)((k + 0.5f) * module);
+
+		if (!Black(tracker, x + half, y + along) || !Black(tracker, x + side - 1 - half, y + along) ||
+			!Black(tracker, x + along, y + side - 1 - half))
+			return 0;
+		nofQuiet += Black(tracker, x - 1 - half, y + along) + Black(tracker, x + side + half, y + along) +
+		            Black(tracker, x + along, y + side + half);
+	}
+	if (nofQuiet > CV_MARKER_MAX_QUIET_BLACK)
+		return 0;
+
+	for (j = 0; j < CV_MARKER_DATA_CELLS; j++)
+	{
+		for (i = 0; i < CV_MARKER_DATA_CELLS; i++)
+		{
+			if (Black(tracker, x + (int)((i + 1.5f) * module), y + (int)((j + 1.5f) * module)))
+				bits |= 1u << (j * CV_MARKER_DATA_CELLS + i);
+		}
+	}
+	for (slot = 0; slot < CV_MARKER_NOF_CODES; slot++)
+	{
+		for (rotation = 0; rotation < 4; rotation++)
+		{
+			errors = CountBits(bits ^ tracker->codes[slot][rotation]);
+			if (errors < best)
+			{
+				best = errors;
+				bestSlot = slot;
+				bestRotation = rotation;
+			}
+		}
+	}
+	if (best > CV_MARKER_MAX_ERRORS)
+		return 0;
+
+	marker->slot = bestSlot;
+	marker->team = bestSlot / ENV_CV_PORTRAITS_PER_TEAM;
+	marker->x = x + 0.5f * side;
+	marker->y = y + 0.5f * side;
+	marker->size = (float)side;
+	marker->rotation = bestRotation;
+	marker->errors = best;
+	marker->tracked = 0;
+	return 1;
+}
+
+
+/* Binarises the window and decodes every marker in it, found keeps the best one per slot */
+static void SearchWindow(CVMarkerTracker tracker, const CVImage* image, int x0, int y0, int x1, int y1,
+                         int tracked, CVMarker* found, int* isFound)
+{
+	int width = CV_MARKER_CELLS * tracker->moduleSize;
+	int minRun = width * CV_MARKER_MIN_RUN_QUARTERS / 4;
+	int maxRun = (width * CV_MARKER_MAX_RUN_QUARTERS + 3) / 4;
+	CVMarker marker;
+	int x, y, end;
+
+	if (x0 < 0)
+		x0 = 0;
+	if (y0 < 0)
+		y0 = 0;
+	if (x1 > image->width)
+		x1 = image->width;
+	if (y1 > image->height)
+		y1 = image->height;
+	if (x1 - x0 < minRun || y1 - y0 < 2)
+		return;
+	BinariseWindow(tracker, image, x0, y0, x1, y1);
+
+	/* a top edge needs the row above, the first row of the window has none */
+	for (y = y0 + 1; y < y1; y++)
+	{
+		const unsigned char *row = tracker->mask + (size_t)y * tracker->width;
+		const unsigned char *above = row - tracker->width;
+
+		x = x0;
+		while (x < x1)
+		{
+			x += tracker->edge(row + x, above + x, x1 - x);
+			if (x >= x1)
+				break;
+			for (end = x + 1; end < x1 && (row[end] & ~above[end]) != 0; end++)
+				;
+			if (end - x >= minRun && end - x <= maxRun)
+			{
+				tracker->stats.nofCandidates++;
+				if (ReadMarker(tracker, x, y, end - x, &marker) &&
+					(!isFound[marker.slot] || marker.errors < found[marker.slot].errors))
+				{
+					marker.tracked = tracked;
+					found[marker.slot] = marker;
+					isFound[marker.slot] = 1;
+				}
+			}
+			x = end;
+		}
+	}
+}
+
+
+/* The mask fits the image, a new size forgets the tracks */
+static int Prepare(CVMarkerTracker tracker, const CVImage* image)
+{
+	size_t size = (size_t)image->width * image->height;
+	unsigned char *mask;
+
+	if (image->width == tracker->width && image->height == tracker->height)
+		return RT_RETURN_OK;
+	if (size > tracker->maskSize)
+	{
+		mask = (unsigned char*)realloc(tracker->mask, size);
+		if (mask == NULL)
+			return RT_RETURN_OUT_OF_MEMORY;
+		tracker->mask = mask;
+		tracker->maskSize = size;
+	}
+	tracker->width = image->width;
+	tracker->height = image->height;
+	CVMarkerTrackerReset(tracker);
+	return RT_RETURN_OK;
+}
+
+
+/* A slot found this frame moves its track, the speed from the last two positions */
+static void UpdateTrack(CVMarkerTrack* track, const CVMarker* marker)
+{
+	float steps = (float)(track->missed + 1);
+	float vx, vy;
+
+	if (track->valid)
+	{
+		vx = (marker->x - track->x) / steps;
+		vy = (marker->y - track->y) / steps;
+		track->vx = (track->missed == 0) ? 0.5f * (track->vx + vx) : vx;
+		track->vy = (track->missed == 0) ? 0.5f * (track->vy + vy) : vy;
+	}
+	else
+	{
+		track->vx = 0.0f;
+		track->vy = 0.0f;
+	}
+	track->x = marker->x;
+	track->y = marker->y;
+	track->size = marker->size;
+	track->missed = 0;
+	track->valid = 1;
+}
+
+
+
+/*
+	Tracker
+*/
+
+int CVMarkerTrackerCreate(const CVMarkerSettings* settings, CVMarkerTracker* tracker)
+{
+	CVMarkerSettings defaults;
+	CVMarkerTracker t;
+	int slot, rotation;
+
+	if (tracker == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*tracker = NULL;
+	if (settings == NULL)
+	{
+		memset(&defaults, 0, sizeof(defaults));
+		settings = &defaults;
+	}
+	if ((settings->moduleSize != 0 && settings->moduleSize < 2) || settings->threshold < 0 || settings->threshold > 255)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+
+	t = new (std::nothrow) CVMarkerTrackerStruct();
+	if (t == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	t->moduleSize = (settings->moduleSize != 0) ? settings->moduleSize : CV_MARKER_DEFAULT_MODULE;
+	t->threshold = (settings->threshold != 0) ? settings->threshold : CV_MARKER_DEFAULT_THRESHOLD;
+	t->tracking = !settings->noTracking;
+	for (slot = 0; slot < CV_MARKER_NOF_CODES; slot++)
+	{
+		t->codes[slot][0] = cvMarkerCodes[slot];
+		for (rotation = 1; rotation < 4; rotation++)
+			t->codes[slot][rotation] = RotateCode(t->codes[slot][rotation - 1]);
+	}
+	CVMarkerSetKernel(t, CVKernelAuto);
+	CVMarkerTrackerReset(t);
+	*tracker = t;
+	return RT_RETURN_OK;
+}
+
+
+void CVMarkerTrackerDestroy(CVMarkerTracker tracker)
+{
+	if (tracker == NULL)
+		return;
+	free(tracker->mask);
+	delete tracker;
+}
+
+
+void CVMarkerTrackerReset(CVMarkerTracker tracker)
+{
+	if (tracker == NULL)
+		return;
+	memset(tracker->tracks, 0, sizeof(tracker->tracks));
+	tracker->framesSinceFull = CV_MARKER_REACQUIRE_FRAMES;
+}
+
+
+int CVMarkerSetKernel(CVMarkerTracker tracker, cvKernel kernel)
+{
+	CVBinariseFunc binarise = NULL;
+	CVEdgeFunc edge = NULL;
+
+	if (tracker == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	if (kernel == CVKernelAuto)
+	{
+		static const cvKernel preferred[] = { CVKernelAVX2, CVKernelSSE, CVKernelScalar };
+		int k;
+
+		for (k = 0; !KernelFuncs(preferred[k], &binarise, &edge); k++)
+			;
+		kernel = preferred[k];
+	}
+	else if (!KernelFuncs(kernel, &binarise, &edge))
+	{
+		return RT_RETURN_NOT_IMPLEMENTED;
+	}
+	tracker->kernel = kernel;
+	tracker->binarise = binarise;
+	tracker->edge = edge;
+	return RT_RETURN_OK;
+}
+
+
+const char* CVMarkerGetKernelName(CVMarkerTracker tracker)
+{
+	if (tracker == NULL)
+		return "";
+	switch (tracker->kernel)
+	{
+	case CVKernelSSE:
+		return "ssse3";
+	case CVKernelAVX2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
+
+
+int CVMarkerDecode(CVMarkerTracker tracker, const CVImage* minimap, CVMarkerFrame* frame)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	CVMarker found[CV_MARKER_NOF_CODES];
+	int isFound[CV_MARKER_NOF_CODES];
+	int nofFound = 0, full, slot, ret;
+
+	if (tracker == NULL || minimap == NULL || frame == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (minimap->pixels == NULL || minimap->width <= 0 || minimap->height <= 0)
+		return RT_RETURN_ILLEGAL_DATA;
+	if ((ret = Prepare(tracker, minimap)) != RT_RETURN_OK)
+		return ret;
+	memset(frame, 0, sizeof(CVMarkerFrame));
+	memset(isFound, 0, sizeof(isFound));
+
+	/* every slot seen lately is looked for around where it should be now */
+	if (tracker->tracking)
+	{
+		for (slot = 0; slot < CV_MARKER_NOF_CODES; slot++)
+		{
+			const CVMarkerTrack *track = &tracker->tracks[slot];
+			float steps = (float)(track->missed + 1);
+			float x = track->x + track->vx * steps;
+			float y = track->y + track->vy * steps;
+			int reach;
+
+			if (!track->valid || isFound[slot])
+				continue;
+			/* the square, its quiet zone and the row above, and the search cells, more the longer it was missed */
+			reach = (int)(0.5f * track->size) + 2 * tracker->moduleSize + 1 +
+			        CV_MARKER_SEARCH_CELLS * tracker->moduleSize * (track->missed + 1);
+			SearchWindow(tracker, minimap, (int)x - reach, (int)y - reach, (int)x + reach + 1, (int)y + reach + 1,
+			             1, found, isFound);
+			tracker->stats.nofLocalSearches++;
+			if (isFound[slot])
+				tracker->stats.nofLocalHits++;
+		}
+		for (slot = 0; slot < CV_MARKER_NOF_CODES; slot++)
+			nofFound += isFound[slot];
+	}
+
+	tracker->framesSinceFull++;
+	full = !tracker->tracking ||
+	       (nofFound < CV_MARKER_NOF_CODES && tracker->framesSinceFull >= CV_MARKER_REACQUIRE_FRAMES);
+	if (full)
+	{
+		SearchWindow(tracker, minimap, 0, 0, minimap->width, minimap->height, 0, found, isFound);
+		tracker->framesSinceFull = 0;
+		tracker->stats.nofFullSearches++;
+	}
+
+	for (slot = 0; slot < CV_MARKER_NOF_CODES; slot++)
+	{
+		CVMarkerTrack *track = &tracker->tracks[slot];
+
+		if (isFound[slot])
+		{
+			UpdateTrack(track, &found[slot]);
+			frame->markers[frame->nofMarkers++] = found[slot];
+		}
+		else if (track->valid && ++track->missed > CV_MARKER_MAX_MISSED)
+		{
+			track->valid = 0;
+		}
+	}
+	frame->fullSearch = full;
+	frame->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	tracker->stats.nofFrames++;
+	tracker->stats.nofDecoded += frame->nofMarkers;
+	tracker->stats.seconds += frame->seconds;
+	if (frame->seconds > tracker->stats.maxSeconds)
+		tracker->stats.maxSeconds = frame->seconds;
+	return RT_RETURN_OK;
+}
+
+
+int CVMarkerGetStats(CVMarkerTracker tracker, CVMarkerStats* stats)
+{
+	if (tracker == NULL || stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*stats = tracker->stats;
+	return RT_RETURN_OK;
+}
+
+
+int CVMarkerDraw(CVImage* image, int slot, int moduleSize, int x, int y)
+{
+	int side = CV_MARKER_QUIET_CELLS * moduleSize;
+	int px, py, i, j, black;
+
+	if (image == NULL || image->pixels == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (slot < 0 || slot >= CV_MARKER_NOF_CODES || moduleSize < 1)
+		return RT_RETURN_ILLEGAL_DATA;
+
+	for (py = 0; py < side; py++)
+	{
+		unsigned char *row;
+
+		if (y + py < 0 || y + py >= image->height)
+			continue;
+		row = image->pixels + (size_t)(y + py) * image->stride;
+		j = py / moduleSize;
+		for (px = 0; px < side; px++)
+		{
+			if (x + px < 0 || x + px >= image->width)
+				continue;
+			i = px / moduleSize;
+			/* quiet zone, border, data */
+			if (i == 0 || j == 0 || i == CV_MARKER_QUIET_CELLS - 1 || j == CV_MARKER_QUIET_CELLS - 1)
+				black = 0;
+			else if (i == 1 || j == 1 || i == CV_MARKER_QUIET_CELLS - 2 || j == CV_MARKER_QUIET_CELLS - 2)
+				black = 1;
+			else
+				black = (cvMarkerCodes[slot] >> ((j - 2) * CV_MARKER_DATA_CELLS + i - 2)) & 1;
+			memset(row + 3 * (x + px), black ? 0 : 255, 3);
+		}
+	}
+	return RT_RETURN_OK;
+}
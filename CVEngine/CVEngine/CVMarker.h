@@ -0,0 +1,161 @@
+﻿#ifndef _CVMARKER_H_
+#define _CVMARKER_H_
+
+#include "CVEngine.h"
+#include "CVRecognition.h"
+
+/*
+	Player markers on the minimap: the hero icons replaced by a code per player slot.
+
+	A marker is a square of CV_MARKER_QUIET_CELLS x CV_MARKER_QUIET_CELLS modules: a white
+	quiet zone one module wide, a black border one module wide and CV_MARKER_DATA_CELLS x
+	CV_MARKER_DATA_CELLS data modules inside (black: 1). The data is one of
+	CV_MARKER_NOF_CODES codes, the slot of the player; the team follows from the slot. The
+	codes differ in at least 6 bits from each other in any of the four quarter turns, and
+	from their own turns, so a marker decodes with its orientation and a wrong bit is
+	corrected (CV_MARKER_MAX_ERRORS).
+
+	A generic QR decoder looks for finder patterns in the whole frame at any scale. Here
+	the search is limited to the minimap crop and to one marker size:
+
+		binarisation    gray level below the threshold is black, 16 (SSSE3) or 32 (AVX2)
+		                pixels of BGR at a time
+		finder          the top edge of a border: a run of black pixels under white ones,
+		                about as long as a marker is wide. The rows are scanned 16 or 32
+		                pixels at a time for the first edge pixel, most blocks have none.
+		verification    the border, the quiet zone around it and the data bits are sampled
+		                at the centres of their modules
+
+	A tracker remembers where every slot was seen and how fast it moved. The next frame
+	first searches a small window around the predicted position of every slot; the whole
+	crop is only searched again while a slot is missing, every CV_MARKER_REACQUIRE_FRAMES
+	frames (a dead hero is off the minimap for a while).
+
+	One tracker per video (per match), it is not thread safe.
+*/
+
+
+/** Data modules per side */
+#define CV_MARKER_DATA_CELLS        4
+/** Modules per side of the border square */
+#define CV_MARKER_CELLS             (CV_MARKER_DATA_CELLS + 2)
+/** Modules per side of a marker with its quiet zone, as CVMarkerDraw draws it */
+#define CV_MARKER_QUIET_CELLS       (CV_MARKER_CELLS + 2)
+/** One code per player slot */
+#define CV_MARKER_NOF_CODES         10
+/** Wrong data bits a decoded marker may have, the codes would correct 2 but 1 keeps terrain out */
+#define CV_MARKER_MAX_ERRORS        1
+/** Pixels per module in the 1080p minimap crop */
+#define CV_MARKER_DEFAULT_MODULE    3
+/** Gray level ((B + R) / 2 + G) / 2 below which a pixel is black */
+#define CV_MARKER_DEFAULT_THRESHOLD 96
+/** Modules around the predicted position a local search covers */
+#define CV_MARKER_SEARCH_CELLS      4
+/** Frames a slot is predicted on after it was last seen, then it needs a full search */
+#define CV_MARKER_MAX_MISSED        2
+/** Frames between full searches while a slot is missing */
+#define CV_MARKER_REACQUIRE_FRAMES  8
+
+
+/** A decoded marker */
+typedef struct _CVMarker
+{
+	int     slot;           /**< player slot, 0 .. CV_MARKER_NOF_CODES - 1 */
+	int     team;           /**< slot / ENV_CV_PORTRAITS_PER_TEAM */
+	float   x;              /**< centre in the pixels of the searched image */
+	float   y;
+	float   size;           /**< side of the border square in pixels */
+	int     rotation;       /**< quarter turns clockwise */
+	int     errors;         /**< data bits that differed from the code */
+	int     tracked;        /**< 1: found by the local search around its prediction */
+} CVMarker;
+
+
+/** Result of one frame */
+typedef struct _CVMarkerFrame
+{
+	int         nofMarkers;
+	CVMarker    markers[CV_MARKER_NOF_CODES];   /**< in slot order */
+	int         fullSearch;                     /**< 1: the whole image was searched */
+	double      seconds;                        /**< decode time of the frame */
+} CVMarkerFrame;
+
+
+/** Settings of a tracker. All zero gives the defaults. */
+typedef struct _CVMarkerSettings
+{
+	int     moduleSize;         /**< pixels per module in the searched image, 0: CV_MARKER_DEFAULT_MODULE */
+	int     threshold;          /**< 0: CV_MARKER_DEFAULT_THRESHOLD */
+	int     noTracking;         /**< 1: every frame is a full search */
+} CVMarkerSettings;
+
+
+typedef struct _CVMarkerStats
+{
+	unsigned long   nofFrames;
+	unsigned long   nofDecoded;         /**< markers of all frames */
+	unsigned long   nofFullSearches;
+	unsigned long   nofLocalSearches;   /**< windows searched around a prediction */
+	unsigned long   nofLocalHits;       /**< of those that found their slot */
+	unsigned long   nofCandidates;      /**< top edges of the right length that were verified */
+	double          seconds;            /**< decode time of all frames */
+	double          maxSeconds;         /**< of the slowest frame */
+} CVMarkerStats;
+
+
+typedef struct _CVMarkerTrackerStruct *CVMarkerTracker;
+
+
+
+/**
+ * @param[in]   settings    Settings, NULL for the defaults
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_SETTING_NOT_ALLOWED - a module size below 2 or a threshold above 255
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int CVMarkerTrackerCreate(const CVMarkerSettings* settings, CVMarkerTracker* tracker);
+
+extern void CVMarkerTrackerDestroy(CVMarkerTracker tracker);
+
+/** Forgets every position, e.g. after a seek in the video: the next frame is a full search */
+extern void CVMarkerTrackerReset(CVMarkerTracker tracker);
+
+/**
+ * Selects the binarisation and finder kernel, CVKernelAuto by default. CVKernelSSE is the
+ * SSSE3 one, the BGR pixels are split with byte shuffles.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_NOT_IMPLEMENTED - the processor or the build does not have the kernel
+ */
+extern int CVMarkerSetKernel(CVMarkerTracker tracker, cvKernel kernel);
+
+/** Name of the kernel in use: "scalar", "ssse3" or "avx2" */
+extern const char* CVMarkerGetKernelName(CVMarkerTracker tracker);
+
+/**
+ * Decodes the markers of one frame of the minimap crop.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_ILLEGAL_DATA - empty image
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int CVMarkerDecode(CVMarkerTracker tracker, const CVImage* minimap, CVMarkerFrame* frame);
+
+extern int CVMarkerGetStats(CVMarkerTracker tracker, CVMarkerStats* stats);
+
+/**
+ * Draws the marker of slot, CV_MARKER_QUIET_CELLS * moduleSize pixels wide, with its left
+ * top corner at x, y of image. The parts outside image are left out.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_ILLEGAL_DATA - no such slot or a module size below 1
+ */
+extern int CVMarkerDraw(CVImage* image, int slot, int moduleSize, int x, int y);
+
+
+
+#endif //_CVMARKER_H_
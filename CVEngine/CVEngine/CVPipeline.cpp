@@ -0,0 +1,759 @@
+﻿#include "pch.h"
+#include "CVEngine.h"
+#include "CVVideo.h"
+#include "RTPassage.h"
+#include "qthreads.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <new>
+#include <atomic>
+#include <chrono>
+
+
+/* how often DECODE checks the stop flag while it waits for a free frame */
+#define CV_STAGE_WAIT_MSEC          100
+/* mean colour change (levels) that makes CVAnalyseRegionChanges emit a region */
+#define CV_REGION_CHANGE_LEVELS     4.0
+#define CV_RESULT_MAX_LENGTH        512
+
+
+static const char* glStageNames[CV_NOF_STAGES] = { "DECODE", "CROP", "ANALYSE", "EMIT" };
+
+
+/*
+	Bounded FIFO of frames between two stages. A NULL frame marks the end of the video.
+	Every queue holds all frames of the pipeline, so a put never waits.
+*/
+typedef struct _CVFrameQueue
+{
+	QThread_Mutex       lock;
+	QThread_Semaphore   items;
+	CVFrameStruct     **ring;
+	unsigned int        capacity;
+	unsigned int        head;
+	unsigned int        tail;
+} CVFrameQueue;
+
+
+typedef struct _CVStageCounters
+{
+	std::atomic<unsigned long>  nofFrames;
+	std::atomic<double>         busySeconds;    /* written by the stage thread only */
+} CVStageCounters;
+
+
+typedef struct _CVPipelineStruct
+{
+	CVPipelineSettings          settings;
+	CVRegionChangesStruct       regionChanges;  /* context of the default analysis */
+	CVVideo                     video;
+	int                         width;
+	int                         height;
+	double                      fps;
+	int                         region[ENV_CV_NOF_REGIONS][4];  /* x, y, width, height in the frame */
+
+	CVFrameStruct              *frames;
+	unsigned char              *buffers;
+
+	CVFrameQueue                freeQueue;      /* EMIT -> DECODE */
+	CVFrameQueue                cropQueue;      /* DECODE -> CROP */
+	CVFrameQueue                analyseQueue;   /* CROP -> ANALYSE */
+	CVFrameQueue                emitQueue;      /* ANALYSE -> EMIT */
+
+	QThread                     threads[CV_NOF_STAGES];
+	int                         nofThreads;
+	int                         joined;
+
+	std::chrono::steady_clock::time_point start;
+	std::atomic<double>         endSeconds;     /* 0 while running */
+	std::atomic<int>            stop;
+	std::atomic<unsigned long>  nofFrames;
+	std::atomic<unsigned long>  nofSkipped;
+	std::atomic<unsigned long>  nofCoarse;
+	std::atomic<unsigned long>  nofEmitted;
+	std::atomic<unsigned long>  nofErrors;
+	std::atomic<double>         videoSeconds;
+	CVStageCounters             stages[CV_NOF_STAGES];
+} CVPipelineStruct;
+
+
+typedef struct _CVStageThreadData
+{
+	CVPipeline  pipeline;
+	int         stage;
+} CVStageThreadData;
+
+
+/* passage of CVAnalyseRegionChanges with its text, the userdata of the container */
+typedef struct _CVResult
+{
+	RTPassageStruct passage;
+	char            text[CV_RESULT_MAX_LENGTH];
+} CVResult;
+
+
+
+static double Elapsed(CVPipeline pipeline)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - pipeline->start).count();
+}
+
+
+static int CreateQueue(CVFrameQueue* queue, unsigned int capacity)
+{
+	queue->capacity = capacity;
+	queue->head = queue->tail = 0;
+	queue->ring = (CVFrameStruct**)calloc(capacity, sizeof(CVFrameStruct*));
+	if (queue->ring == NULL ||
+		QThread_Mutex_create(&queue->lock) != QTHREAD_RETURN_OK ||
+		QThread_Semaphore_create(&queue->items, 0) != QTHREAD_RETURN_OK)
+		return RT_RETURN_OUT_OF_MEMORY;
+	return RT_RETURN_OK;
+}
+
+
+static void DestroyQueue(CVFrameQueue* queue)
+{
+	if (queue->lock != NULL)
+		QThread_Mutex_destroy(&queue->lock);
+	if (queue->items != NULL)
+		QThread_Semaphore_destroy(&queue->items);
+	free(queue->ring);
+}
+
+
+static void PutFrame(CVFrameQueue* queue, CVFrameStruct* frame)
+{
+	QThread_Mutex_P(queue->lock);
+	queue->ring[queue->tail % queue->capacity] = frame;
+	queue->tail++;
+	QThread_Mutex_V(queue->lock);
+	QThread_Semaphore_post(queue->items);
+}
+
+
+/* PRE: the semaphore of the queue was passed */
+static CVFrameStruct* PopFrame(CVFrameQueue* queue)
+{
+	CVFrameStruct *frame;
+
+	QThread_Mutex_P(queue->lock);
+	frame = queue->ring[queue->head % queue->capacity];
+	queue->head++;
+	QThread_Mutex_V(queue->lock);
+	return frame;
+}
+
+
+/* the end marker is NULL, a stage waits for it without a timeout */
+static CVFrameStruct* GetFrame(CVFrameQueue* queue)
+{
+	QThread_Semaphore_wait(queue->items);
+	return PopFrame(queue);
+}
+
+
+/* returns 0 when the queue is empty */
+static int TryGetFrame(CVFrameQueue* queue, CVFrameStruct** frame)
+{
+	if (QThread_Semaphore_trywait(queue->items) != QTHREAD_RETURN_OK)
+		return 0;
+	*frame = PopFrame(queue);
+	return 1;
+}
+
+
+static void CountFrame(CVPipeline pipeline, int stage, double busySeconds)
+{
+	CVStageCounters *counters = &pipeline->stages[stage];
+
+	counters->busySeconds.store(counters->busySeconds.load(std::memory_order_relaxed) + busySeconds,
+	                            std::memory_order_relaxed);
+	counters->nofFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+static int CreateData(RTEngineInstance instance, RTDataStruct** data)
+{
+	return (instance != NULL) ? RTInstanceCreateData(instance, data) : RTCoreCreateData(data);
+}
+
+
+static void DestroyData(RTEngineInstance instance, RTDataStruct* data)
+{
+	if (instance != NULL)
+		RTInstanceDestroyData(instance, data);
+	else
+		RTCoreDestroyData(data);
+}
+
+
+
+/*
+	Stages
+*/
+
+static void* DecodeThread(void* threadData)
+{
+	CVPipeline pipeline = (CVPipeline)threadData;
+	unsigned long frameNr;
+	int ret = RT_RETURN_OK;
+
+	for (frameNr = 0; ret == RT_RETURN_OK && !pipeline->stop.load(); frameNr++)
+	{
+		double time = (pipeline->fps > 0.0) ? frameNr / pipeline->fps : 0.0;
+		CVFrameStruct *frame = NULL;
+		double begin;
+
+		if (pipeline->settings.realTime && pipeline->fps > 0.0)
+		{
+			double now = Elapsed(pipeline);
+
+			/* the frame arrives at its time in the video, like the live game would show it */
+			if (now < time)
+			{
+				QThread_sleep((unsigned int)((time - now) * 1000.0));
+				now = time;
+			}
+
+			/* the engine sheds load: only every CV_PIPELINE_COARSE_STRIDE frame is analysed */
+			if (frameNr % CV_PIPELINE_COARSE_STRIDE != 0 &&
+				((pipeline->settings.instance != NULL) ? RTInstanceGetLiveLevel(pipeline->settings.instance)
+				                                       : RTCoreGetLiveLevel()) >= RT_LIVE_LEVEL_COARSE_CV)
+			{
+				ret = CVVideoSkip(pipeline->video);
+				if (ret == RT_RETURN_OK)
+				{
+					pipeline->nofFrames.fetch_add(1, std::memory_order_relaxed);
+					pipeline->nofCoarse.fetch_add(1, std::memory_order_relaxed);
+					pipeline->videoSeconds.store(time, std::memory_order_relaxed);
+				}
+				continue;
+			}
+
+			/* too late, or every buffer is still in the pipeline: the analysis is behind */
+			if (now - time > pipeline->settings.maxLag || !TryGetFrame(&pipeline->freeQueue, &frame))
+			{
+				ret = CVVideoSkip(pipeline->video);
+				if (ret == RT_RETURN_OK)
+				{
+					pipeline->nofFrames.fetch_add(1, std::memory_order_relaxed);
+					pipeline->nofSkipped.fetch_add(1, std::memory_order_relaxed);
+					pipeline->videoSeconds.store(time, std::memory_order_relaxed);
+				}
+				continue;
+			}
+		}
+		else
+		{
+			/* offline every frame goes through, wait for a buffer */
+			while (frame == NULL && !pipeline->stop.load())
+			{
+				if (QThread_Semaphore_timedwait(pipeline->freeQueue.items, CV_STAGE_WAIT_MSEC) == QTHREAD_RETURN_OK)
+					frame = PopFrame(&pipeline->freeQueue);
+			}
+			if (frame == NULL)
+				break;
+		}
+
+		begin = Elapsed(pipeline);
+		ret = CVVideoRead(pipeline->video, &frame->image);
+		if (ret != RT_RETURN_OK)
+		{
+			PutFrame(&pipeline->freeQueue, frame);
+			break;
+		}
+		frame->frameNr = frameNr;
+		frame->time = time;
+		frame->gameTime = time * pipeline->settings.replaySpeed;
+		frame->sourceId = pipeline->settings.sourceId;
+		frame->data = NULL;
+		CountFrame(pipeline, CVStageDecode, Elapsed(pipeline) - begin);
+		pipeline->nofFrames.fetch_add(1, std::memory_order_relaxed);
+		pipeline->videoSeconds.store(time, std::memory_order_relaxed);
+
+		PutFrame(&pipeline->cropQueue, frame);
+	}
+
+	if (ret != RT_RETURN_OK && ret != RT_RETURN_END_OF_LOG)
+		pipeline->nofErrors.fetch_add(1, std::memory_order_relaxed);
+	PutFrame(&pipeline->cropQueue, NULL);
+	return NULL;
+}
+
+
+static void CropFrame(CVPipeline pipeline, CVFrameStruct* frame)
+{
+	int r, y;
+
+	for (r = 0; r < ENV_CV_NOF_REGIONS; r++)
+	{
+		const int *region = pipeline->region[r];
+		CVImage *crop = &frame->regions[r];
+
+		for (y = 0; y < region[3]; y++)
+		{
+			memcpy(crop->pixels + (size_t)y * crop->stride,
+			       frame->image.pixels + (size_t)(region[1] + y) * frame->image.stride + (size_t)region[0] * 3,
+			       (size_t)region[2] * 3);
+		}
+	}
+}
+
+
+static void AnalyseFrame(CVPipeline pipeline, CVFrameStruct* frame)
+{
+	int ret = pipeline->settings.analyse(frame, pipeline->settings.instance, pipeline->settings.analyseContext);
+
+	if (ret != RT_RETURN_OK)
+	{
+		pipeline->nofErrors.fetch_add(1, std::memory_order_relaxed);
+		if (frame->data != NULL)
+		{
+			DestroyData(pipeline->settings.instance, frame->data);
+			frame->data = NULL;
+		}
+	}
+}
+
+
+static void EmitFrame(CVPipeline pipeline, CVFrameStruct* frame)
+{
+	RTEngineInstance instance = pipeline->settings.instance;
+	int ret;
+
+	if (frame->data == NULL)
+		return;
+
+	/* the engine owns the data from here on, also when it is dropped */
+	ret = (instance != NULL) ? RTInstanceProcess(instance, frame->data) : RTCoreProcess(frame->data);
+	frame->data = NULL;
+	if (ret == RT_RETURN_OK)
+		pipeline->nofEmitted.fetch_add(1, std::memory_order_relaxed);
+	else
+		pipeline->nofErrors.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/* CROP, ANALYSE and EMIT: take a frame, work on it, pass it on */
+static void* StageThread(void* threadData)
+{
+	CVStageThreadData *stageData = (CVStageThreadData*)threadData;
+	CVPipeline pipeline = stageData->pipeline;
+	int stage = stageData->stage;
+	CVFrameQueue *in = (stage == CVStageCrop) ? &pipeline->cropQueue :
+	                   (stage == CVStageAnalyse) ? &pipeline->analyseQueue : &pipeline->emitQueue;
+	CVFrameQueue *out = (stage == CVStageCrop) ? &pipeline->analyseQueue :
+	                    (stage == CVStageAnalyse) ? &pipeline->emitQueue : &pipeline->freeQueue;
+
+	for (;;)
+	{
+		CVFrameStruct *frame = GetFrame(in);
+		double begin;
+
+		if (frame == NULL)
+		{
+			/* end of the video, EMIT is the last stage */
+			if (stage != CVStageEmit)
+				PutFrame(out, NULL);
+			else
+				pipeline->endSeconds.store(Elapsed(pipeline));
+			break;
+		}
+
+		begin = Elapsed(pipeline);
+		switch (stage)
+		{
+		case CVStageCrop:
+			CropFrame(pipeline, frame);
+			break;
+		case CVStageAnalyse:
+			AnalyseFrame(pipeline, frame);
+			break;
+		case CVStageEmit:
+			EmitFrame(pipeline, frame);
+			break;
+		}
+		CountFrame(pipeline, stage, Elapsed(pipeline) - begin);
+
+		PutFrame(out, frame);
+	}
+
+	delete stageData;
+	return NULL;
+}
+
+
+
+/*
+	Setup
+*/
+
+/* scales the ENV_CV.h regions to the frame, clipped to it */
+static void ScaleRegions(CVPipeline pipeline)
+{
+	int r;
+
+	for (r = 0; r < ENV_CV_NOF_REGIONS; r++)
+	{
+		const ENV_CVRegionStruct *env = &ENV_CVRegions[r];
+		int x = (int)((long long)env->x * pipeline->width / ENV_CV_REFERENCE_WIDTH);
+		int y = (int)((long long)env->y * pipeline->height / ENV_CV_REFERENCE_HEIGHT);
+		int width = (int)((long long)env->width * pipeline->width / ENV_CV_REFERENCE_WIDTH);
+		int height = (int)((long long)env->height * pipeline->height / ENV_CV_REFERENCE_HEIGHT);
+
+		if (x + width > pipeline->width)
+			width = pipeline->width - x;
+		if (y + height > pipeline->height)
+			height = pipeline->height - y;
+		pipeline->region[r][0] = x;
+		pipeline->region[r][1] = y;
+		pipeline->region[r][2] = (width > 0) ? width : 0;
+		pipeline->region[r][3] = (height > 0) ? height : 0;
+	}
+}
+
+
+/* one block per frame: the image followed by the crops */
+static int AllocateFrames(CVPipeline pipeline)
+{
+	int nofFrames = pipeline->settings.nofFrames;
+	size_t frameSize = (size_t)pipeline->width * pipeline->height * 3;
+	unsigned char *block;
+	int f, r;
+
+	for (r = 0; r < ENV_CV_NOF_REGIONS; r++)
+		frameSize += (size_t)pipeline->region[r][2] * pipeline->region[r][3] * 3;
+
+	pipeline->frames = (CVFrameStruct*)calloc(nofFrames, sizeof(CVFrameStruct));
+	pipeline->buffers = (unsigned char*)malloc(frameSize * nofFrames);
+	if (pipeline->frames == NULL || pipeline->buffers == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+
+	for (f = 0; f < nofFrames; f++)
+	{
+		CVFrameStruct *frame = &pipeline->frames[f];
+
+		block = pipeline->buffers + frameSize * f;
+		frame->image.pixels = block;
+		frame->image.width = pipeline->width;
+		frame->image.height = pipeline->height;
+		frame->image.stride = pipeline->width * 3;
+		block += (size_t)pipeline->width * pipeline->height * 3;
+
+		for (r = 0; r < ENV_CV_NOF_REGIONS; r++)
+		{
+			frame->regions[r].pixels = block;
+			frame->regions[r].width = pipeline->region[r][2];
+			frame->regions[r].height = pipeline->region[r][3];
+			frame->regions[r].stride = pipeline->region[r][2] * 3;
+			block += (size_t)pipeline->region[r][2] * pipeline->region[r][3] * 3;
+		}
+	}
+	return RT_RETURN_OK;
+}
+
+
+/* PRE: no stage thread running */
+static void FreePipeline(CVPipeline pipeline)
+{
+	DestroyQueue(&pipeline->freeQueue);
+	DestroyQueue(&pipeline->cropQueue);
+	DestroyQueue(&pipeline->analyseQueue);
+	DestroyQueue(&pipeline->emitQueue);
+	free(pipeline->frames);
+	free(pipeline->buffers);
+	if (pipeline->video != NULL)
+		CVVideoClose(pipeline->video);
+	delete pipeline;
+}
+
+
+static void JoinStages(CVPipeline pipeline)
+{
+	int i;
+
+	if (pipeline->joined)
+		return;
+	for (i = 0; i < pipeline->nofThreads; i++)
+		QThread_join(pipeline->threads[i], NULL);
+	pipeline->joined = 1;
+}
+
+
+static int StartStages(CVPipeline pipeline)
+{
+	int stage;
+
+	if (QThread_create(&pipeline->threads[0], glStageNames[CVStageDecode], DecodeThread, pipeline) != QTHREAD_RETURN_OK)
+		return RT_RETURN_INTERNAL_ERROR;
+	pipeline->nofThreads = 1;
+
+	for (stage = CVStageCrop; stage < CV_NOF_STAGES; stage++)
+	{
+		CVStageThreadData *stageData = new (std::nothrow) CVStageThreadData;
+
+		if (stageData == NULL)
+			return RT_RETURN_OUT_OF_MEMORY;
+		stageData->pipeline = pipeline;
+		stageData->stage = stage;
+		if (QThread_create(&pipeline->threads[stage], glStageNames[stage], StageThread, stageData) != QTHREAD_RETURN_OK)
+		{
+			delete stageData;
+			return RT_RETURN_INTERNAL_ERROR;
+		}
+		pipeline->nofThreads++;
+	}
+	return RT_RETURN_OK;
+}
+
+
+
+int CVPipelineOpen(const char* path, const CVPipelineSettings* settings, CVPipeline* pipeline)
+{
+	CVPipeline p;
+	int ret;
+	int f;
+
+	if (path == NULL || pipeline == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*pipeline = NULL;
+
+	p = new (std::nothrow) CVPipelineStruct();
+	if (p == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+
+	if (settings != NULL)
+		p->settings = *settings;
+	if (p->settings.nofFrames <= 0)
+		p->settings.nofFrames = CV_PIPELINE_DEFAULT_NOF_FRAMES;
+	if (p->settings.maxLag <= 0.0)
+		p->settings.maxLag = CV_PIPELINE_DEFAULT_MAX_LAG;
+	if (p->settings.replaySpeed <= 0.0)
+		p->settings.replaySpeed = 1.0;
+	if (p->settings.analyse == NULL)
+	{
+		p->settings.analyse = CVAnalyseRegionChanges;
+		p->settings.analyseContext = &p->regionChanges;
+	}
+
+	ret = CVVideoOpen(path, &p->video);
+	if (ret == RT_RETURN_OK)
+		ret = CVVideoGetFormat(p->video, &p->width, &p->height, &p->fps);
+	if (ret != RT_RETURN_OK)
+	{
+		FreePipeline(p);
+		return ret;
+	}
+	ScaleRegions(p);
+
+	/* the end marker takes a place in a queue as well */
+	if ((ret = AllocateFrames(p)) != RT_RETURN_OK ||
+		(ret = CreateQueue(&p->freeQueue, p->settings.nofFrames + 1)) != RT_RETURN_OK ||
+		(ret = CreateQueue(&p->cropQueue, p->settings.nofFrames + 1)) != RT_RETURN_OK ||
+		(ret = CreateQueue(&p->analyseQueue, p->settings.nofFrames + 1)) != RT_RETURN_OK ||
+		(ret = CreateQueue(&p->emitQueue, p->settings.nofFrames + 1)) != RT_RETURN_OK)
+	{
+		FreePipeline(p);
+		return ret;
+	}
+	for (f = 0; f < p->settings.nofFrames; f++)
+		PutFrame(&p->freeQueue, &p->frames[f]);
+
+	p->start = std::chrono::steady_clock::now();
+	ret = StartStages(p);
+	if (ret != RT_RETURN_OK)
+	{
+		/* the started stages end on the marker */
+		p->stop.store(1);
+		JoinStages(p);
+		FreePipeline(p);
+		return ret;
+	}
+
+	*pipeline = p;
+	return RT_RETURN_OK;
+}
+
+
+int CVPipelineWait(CVPipeline pipeline)
+{
+	if (pipeline == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	JoinStages(pipeline);
+	return RT_RETURN_OK;
+}
+
+
+int CVPipelineStop(CVPipeline pipeline)
+{
+	if (pipeline == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	pipeline->stop.store(1);
+	return RT_RETURN_OK;
+}
+
+
+int CVPipelineClose(CVPipeline pipeline)
+{
+	if (pipeline == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	CVPipelineStop(pipeline);
+	JoinStages(pipeline);
+	FreePipeline(pipeline);
+	return RT_RETURN_OK;
+}
+
+
+int CVPipelineGetStats(CVPipeline pipeline, CVPipelineStats* stats)
+{
+	double seconds;
+	int stage;
+
+	if (pipeline == NULL || stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	memset(stats, 0, sizeof(CVPipelineStats));
+	seconds = pipeline->endSeconds.load();
+	if (seconds == 0.0)
+		seconds = Elapsed(pipeline);
+
+	stats->nofFrames = pipeline->nofFrames.load(std::memory_order_relaxed);
+	stats->nofSkipped = pipeline->nofSkipped.load(std::memory_order_relaxed);
+	stats->nofCoarse = pipeline->nofCoarse.load(std::memory_order_relaxed);
+	stats->nofEmitted = pipeline->nofEmitted.load(std::memory_order_relaxed);
+	stats->nofErrors = pipeline->nofErrors.load(std::memory_order_relaxed);
+	stats->seconds = seconds;
+	stats->videoSeconds = pipeline->videoSeconds.load(std::memory_order_relaxed);
+	for (stage = 0; stage < CV_NOF_STAGES; stage++)
+	{
+		CVStageStats *s = &stats->stages[stage];
+
+		s->name = glStageNames[stage];
+		s->nofFrames = pipeline->stages[stage].nofFrames.load(std::memory_order_relaxed);
+		s->busySeconds = pipeline->stages[stage].busySeconds.load(std::memory_order_relaxed);
+		s->fps = (seconds > 0.0) ? s->nofFrames / seconds : 0.0;
+		s->maxFps = (s->busySeconds > 0.0) ? s->nofFrames / s->busySeconds : 0.0;
+	}
+	return RT_RETURN_OK;
+}
+
+
+void CVPipelinePrintStats(FILE* f, const CVPipelineStats* stats)
+{
+	int stage;
+
+	fprintf(f, "%lu frames (%.1f s of video) in %.3f s: %lu skipped, %lu coarse, %lu emitted, %lu errors\n",
+	        stats->nofFrames, stats->videoSeconds, stats->seconds,
+	        stats->nofSkipped, stats->nofCoarse, stats->nofEmitted, stats->nofErrors);
+	for (stage = 0; stage < CV_NOF_STAGES; stage++)
+	{
+		const CVStageStats *s = &stats->stages[stage];
+
+		fprintf(f, "  %-8s %8lu frames %9.1f fps (%.1f fps when busy)\n", s->name, s->nofFrames, s->fps, s->maxFps);
+	}
+}
+
+
+
+/*
+	Default analysis
+*/
+
+static void RegionMean(const CVImage* image, double mean[3])
+{
+	unsigned long long sum[3] = { 0, 0, 0 };
+	int x, y;
+
+	mean[0] = mean[1] = mean[2] = 0.0;
+	if (image->width == 0 || image->height == 0)
+		return;
+
+	for (y = 0; y < image->height; y++)
+	{
+		const unsigned char *row = image->pixels + (size_t)y * image->stride;
+
+		for (x = 0; x < image->width; x++)
+		{
+			sum[0] += row[3 * x];
+			sum[1] += row[3 * x + 1];
+			sum[2] += row[3 * x + 2];
+		}
+	}
+	for (x = 0; x < 3; x++)
+		mean[x] = (double)sum[x] / ((double)image->width * image->height);
+}
+
+
+int CVAnalyseRegionChanges(CVFrameStruct* frame, RTEngineInstance instance, void* context)
+{
+	CVRegionChangesStruct *state = (CVRegionChangesStruct*)context;
+	double mean[ENV_CV_NOF_REGIONS][3];
+	CVResult *result = NULL;
+	RTDataStruct *data;
+	size_t length = 0;
+	int r, c;
+	int ret;
+
+	if (frame == NULL || state == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	for (r = 0; r < ENV_CV_NOF_REGIONS; r++)
+	{
+		int changed = !state->valid;
+
+		RegionMean(&frame->regions[r], mean[r]);
+		for (c = 0; c < 3; c++)
+		{
+			if (fabs(mean[r][c] - state->mean[r][c]) > CV_REGION_CHANGE_LEVELS)
+				changed = 1;
+		}
+		if (!changed)
+			continue;
+
+		if (result == NULL)
+		{
+			result = (CVResult*)malloc(sizeof(CVResult));
+			if (result == NULL)
+				return RT_RETURN_OUT_OF_MEMORY;
+		}
+		length += snprintf(result->text + length, sizeof(result->text) - length, "%s%s %.0f %.0f %.0f",
+		                   (length > 0) ? "\n" : "", ENV_CVRegions[r].name, mean[r][0], mean[r][1], mean[r][2]);
+		if (length >= sizeof(result->text))
+			length = sizeof(result->text) - 1;
+		memcpy(state->mean[r], mean[r], sizeof(mean[r]));
+	}
+	state->valid = 1;
+	if (result == NULL)
+		return RT_RETURN_OK;
+
+	result->passage.type = RT_PASSAGE_TYPE_CV_RESULT;
+	result->passage.data = result->text;
+	result->passage.size = (unsigned int)length;
+	result->passage.recordNr = frame->frameNr + 1;
+
+	ret = CreateData(instance, &data);
+	if (ret != RT_RETURN_OK)
+	{
+		free(result);
+		return ret;
+	}
+	ret = (instance != NULL) ? RTInstanceDataSetUserData(instance, data, result, free) : RTCoreDataSetUserData(data, result, free);
+	if (ret != RT_RETURN_OK)
+	{
+		free(result);
+		DestroyData(instance, data);
+		return ret;
+	}
+	ret = (instance != NULL) ? RTInstanceDataAddpassage(instance, data, &result->passage, frame->gameTime, frame->sourceId)
+	                         : RTCoreDataAddpassage(data, &result->passage, frame->gameTime, frame->sourceId);
+	if (ret != RT_RETURN_OK)
+	{
+		DestroyData(instance, data);
+		return ret;
+	}
+	frame->data = data;
+	return RT_RETURN_OK;
+}
@@ -0,0 +1,734 @@
+﻿#include "pch.h"
+#include "CVRecognition.h"
+#include "CVVideo.h"
+#include "ENV_hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <new>
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CV_WITH_X86_KERNELS
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+
+/* the feature block grows by this many templates at a time */
+#define CV_INDEX_GROW_TEMPLATES     64
+/* alignment of the feature rows, one AVX register */
+#define CV_FEATURE_ALIGNMENT        32
+
+/* MSVC compiles the intrinsics of every instruction set, gcc and clang per function */
+#if defined(CV_WITH_X86_KERNELS) && !defined(_MSC_VER)
+#define CV_TARGET_SSE               __attribute__((target("sse2")))
+#define CV_TARGET_AVX2              __attribute__((target("avx2,fma")))
+#else
+#define CV_TARGET_SSE
+#define CV_TARGET_AVX2
+#endif
+
+
+/* similarity of one template row to every query of a batch */
+typedef void (*CVDotsFunc)(const float* row, const float* queries, int nofQueries, float* dots);
+
+
+typedef struct _CVRecognitionIndexStruct
+{
+	float                      *features;       /* nofTemplates rows of CV_FEATURE_DIM, aligned */
+	int                        *heroIds;
+	int                        *skinIds;
+	int                         nofTemplates;
+	int                         capacity;
+	float                       minSimilarity;
+	cvKernel                    kernel;
+	CVDotsFunc                  dots;
+
+	std::atomic<unsigned long>  nofQueries;
+	std::atomic<unsigned long>  nofSearches;
+	std::atomic<unsigned long>  nofCacheHits;
+	std::atomic<unsigned long>  nofRecognised;
+} CVRecognitionIndexStruct;
+
+
+typedef struct _CVIconCacheStruct
+{
+	int         nofSlots;
+	float      *features;       /* patch of the last search of every slot */
+	CVMatch    *matches;        /* and its result */
+	int        *valid;
+} CVIconCacheStruct;
+
+
+/* features of the patches of one call, one per thread so calls can run at the same time;
+   thread locals are not reliably aligned above 16 bytes, so the kernels load queries unaligned */
+typedef struct _CVQueryScratch
+{
+	alignas(CV_FEATURE_ALIGNMENT) float features[CV_MAX_BATCH * CV_FEATURE_DIM];
+	int     slots[CV_MAX_BATCH];
+} CVQueryScratch;
+
+static thread_local CVQueryScratch tlScratch;
+
+
+
+static float* AllocateFeatures(int nofRows)
+{
+	size_t size = (size_t)nofRows * CV_FEATURE_DIM * sizeof(float);
+
+#ifdef _MSC_VER
+	return (float*)_aligned_malloc(size, CV_FEATURE_ALIGNMENT);
+#else
+	void *block = NULL;
+
+	if (posix_memalign(&block, CV_FEATURE_ALIGNMENT, size) != 0)
+		return NULL;
+	return (float*)block;
+#endif
+}
+
+
+static void FreeFeatures(float* features)
+{
+#ifdef _MSC_VER
+	_aligned_free(features);
+#else
+	free(features);
+#endif
+}
+
+
+
+/*
+	Features
+*/
+
+/*
+	Averages the image down to the cells, then centres every channel and normalises the
+	vector to length 1. A flat patch has no shape and stays all zero.
+*/
+static void ComputeFeature(const CVImage* image, float* feature)
+{
+	double sum[3] = { 0.0, 0.0, 0.0 };
+	double norm = 0.0;
+	int cx, cy, x, y, c;
+
+	for (cy = 0; cy < CV_FEATURE_SIZE; cy++)
+	{
+		int y0 = cy * image->height / CV_FEATURE_SIZE;
+		int y1 = (cy + 1) * image->height / CV_FEATURE_SIZE;
+
+		/* smaller than the cells: a pixel covers several of them */
+		if (y1 <= y0)
+			y1 = y0 + 1;
+
+		for (cx = 0; cx < CV_FEATURE_SIZE; cx++)
+		{
+			int x0 = cx * image->width / CV_FEATURE_SIZE;
+			int x1 = (cx + 1) * image->width / CV_FEATURE_SIZE;
+			unsigned int cell[3] = { 0, 0, 0 };
+			float *out = feature + (cy * CV_FEATURE_SIZE + cx) * 3;
+
+			if (x1 <= x0)
+				x1 = x0 + 1;
+			for (y = y0; y < y1; y++)
+			{
+				const unsigned char *row = image->pixels + (size_t)y * image->stride;
+
+				for (x = x0; x < x1; x++)
+				{
+					cell[0] += row[3 * x];
+					cell[1] += row[3 * x + 1];
+					cell[2] += row[3 * x + 2];
+				}
+			}
+			for (c = 0; c < 3; c++)
+			{
+				out[c] = (float)cell[c] / (float)((x1 - x0) * (y1 - y0));
+				sum[c] += out[c];
+			}
+		}
+	}
+
+	for (x = 0; x < CV_FEATURE_DIM; x++)
+	{
+		feature[x] -= (float)(sum[x % 3] / (CV_FEATURE_SIZE * CV_FEATURE_SIZE));
+		norm += (double)feature[x] * feature[x];
+	}
+	norm = (norm > 1e-6) ? 1.0 / sqrt(norm) : 0.0;
+	for (x = 0; x < CV_FEATURE_DIM; x++)
+		feature[x] = (float)(feature[x] * norm);
+}
+
+
+static int IsFlat(const float* feature)
+{
+	int i;
+
+	for (i = 0; i < CV_FEATURE_DIM; i++)
+	{
+		if (feature[i] != 0.0f)
+			return 0;
+	}
+	return 1;
+}
+
+
+
+/*
+	Kernels
+*/
+
+static void DotsScalar(const float* row, const float* queries, int nofQueries, float* dots)
+{
+	int q, i;
+
+	for (q = 0; q < nofQueries; q++)
+	{
+		const float *query = queries + (size_t)q * CV_FEATURE_DIM;
+		float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+
+		for (i = 0; i < CV_FEATURE_DIM; i += 4)
+		{
+			sum0 += row[i] * query[i];
+			sum1 += row[i + 1] * query[i + 1];
+			sum2 += row[i + 2] * query[i + 2];
+			sum3 += row[i + 3] * query[i + 3];
+		}
+		dots[q] = (sum0 + sum1) + (sum2 + sum3);
+	}
+}
+
+
+#ifdef CV_WITH_X86_KERNELS
+
+CV_TARGET_SSE
+static void DotsSSE(const float* row, const float* queries, int nofQueries, float* dots)
+{
+	int q, i;
+
+	for (q = 0; q < nofQueries; q++)
+	{
+		const float *query = queries + (size_t)q * CV_FEATURE_DIM;
+		__m128 sum0 = _mm_setzero_ps();
+		__m128 sum1 = _mm_setzero_ps();
+		float lanes[4];
+
+		for (i = 0; i < CV_FEATURE_DIM; i += 8)
+		{
+			sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_load_ps(row + i), _mm_loadu_ps(query + i)));
+			sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_load_ps(row + i + 4), _mm_loadu_ps(query + i + 4)));
+		}
+		_mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+		dots[q] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	}
+}
+
+
+/* the row stays in registers for two queries at a time */
+CV_TARGET_AVX2
+static void DotsAVX2(const float* row, const float* queries, int nofQueries, float* dots)
+{
+	int q, i;
+
+	for (q = 0; q < nofQueries; q += 2)
+	{
+		const float *query0 = queries + (size_t)q * CV_FEATURE_DIM;
+		const float *query1 = (q + 1 < nofQueries) ? query0 + CV_FEATURE_DIM : query0;
+		__m256 sum0 = _mm256_setzero_ps();
+		__m256 sum1 = _mm256_setzero_ps();
+		__m128 half0, half1;
+		float lanes[4];
+
+		for (i = 0; i < CV_FEATURE_DIM; i += 8)
+		{
+			__m256 r = _mm256_load_ps(row + i);
+
+			sum0 = _mm256_fmadd_ps(r, _mm256_loadu_ps(query0 + i), sum0);
+			sum1 = _mm256_fmadd_ps(r, _mm256_loadu_ps(query1 + i), sum1);
+		}
+		/* lanes: sum0 low + high, sum1 low + high pairwise */
+		half0 = _mm_add_ps(_mm256_castps256_ps128(sum0), _mm256_extractf128_ps(sum0, 1));
+		half1 = _mm_add_ps(_mm256_castps256_ps128(sum1), _mm256_extractf128_ps(sum1, 1));
+		_mm_storeu_ps(lanes, _mm_hadd_ps(half0, half1));
+		dots[q] = lanes[0] + lanes[1];
+		if (q + 1 < nofQueries)
+			dots[q + 1] = lanes[2] + lanes[3];
+	}
+}
+
+
+static int HasSSE(void)
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	return 1;
+#elif defined(_MSC_VER)
+	int info[4];
+
+	__cpuid(info, 1);
+	return (info[3] & (1 << 26)) != 0;
+#else
+	return __builtin_cpu_supports("sse2");
+#endif
+}
+
+
+static int HasAVX2(void)
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	/* AVX and FMA, and the OS saves the YMM registers */
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (info[2] & (1 << 12)) == 0)
+		return 0;
+	if ((_xgetbv(0) & 6) != 6)
+		return 0;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+#endif //CV_WITH_X86_KERNELS
+
+
+static CVDotsFunc KernelFunc(cvKernel kernel)
+{
+	switch (kernel)
+	{
+	case CVKernelScalar:
+		return DotsScalar;
+#ifdef CV_WITH_X86_KERNELS
+	case CVKernelSSE:
+		return HasSSE() ? DotsSSE : NULL;
+	case CVKernelAVX2:
+		return HasAVX2() ? DotsAVX2 : NULL;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+
+
+/*
+	Search
+*/
+
+/* nearest template of every query, one pass over the templates for the whole batch */
+static void Search(CVRecognitionIndex index, const float* queries, int nofQueries, CVMatch* matches)
+{
+	float best[CV_MAX_BATCH];
+	float second[CV_MAX_BATCH];     /* best of another hero than the best */
+	int bestRow[CV_MAX_BATCH];
+	float dots[CV_MAX_BATCH];
+	int t, q;
+
+	for (q = 0; q < nofQueries; q++)
+	{
+		best[q] = second[q] = -2.0f;
+		bestRow[q] = -1;
+	}
+
+	for (t = 0; t < index->nofTemplates; t++)
+	{
+		int heroId = index->heroIds[t];
+
+		index->dots(index->features + (size_t)t * CV_FEATURE_DIM, queries, nofQueries, dots);
+		for (q = 0; q < nofQueries; q++)
+		{
+			if (dots[q] > best[q])
+			{
+				if (bestRow[q] >= 0 && index->heroIds[bestRow[q]] != heroId)
+					second[q] = best[q];
+				best[q] = dots[q];
+				bestRow[q] = t;
+			}
+			else if (dots[q] > second[q] && index->heroIds[bestRow[q]] != heroId)
+				second[q] = dots[q];
+		}
+	}
+
+	for (q = 0; q < nofQueries; q++)
+	{
+		CVMatch *match = &matches[q];
+
+		match->cached = 0;
+		match->similarity = (bestRow[q] >= 0) ? best[q] : -1.0f;
+		match->margin = (bestRow[q] < 0) ? 0.0f : match->similarity - ((second[q] > -2.0f) ? second[q] : -1.0f);
+		if (bestRow[q] >= 0 && best[q] >= index->minSimilarity)
+		{
+			match->heroId = index->heroIds[bestRow[q]];
+			match->skinId = index->skinIds[bestRow[q]];
+			index->nofRecognised.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			match->heroId = ENV_ID_NONE;
+			match->skinId = ENV_ID_NONE;
+		}
+	}
+	index->nofSearches.fetch_add(nofQueries, std::memory_order_relaxed);
+}
+
+
+static int CheckPatches(const CVImage* patches, int nofPatches)
+{
+	int p;
+
+	if (nofPatches < 0 || nofPatches > CV_MAX_BATCH)
+		return RT_RETURN_ILLEGAL_DATA;
+	for (p = 0; p < nofPatches; p++)
+	{
+		if (patches[p].pixels == NULL || patches[p].width <= 0 || patches[p].height <= 0)
+			return RT_RETURN_ILLEGAL_DATA;
+	}
+	return RT_RETURN_OK;
+}
+
+
+
+/*
+	Index
+*/
+
+int CVIndexCreate(CVRecognitionIndex* index)
+{
+	CVRecognitionIndex i;
+
+	if (index == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	i = new (std::nothrow) CVRecognitionIndexStruct();
+	if (i == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	i->minSimilarity = CV_DEFAULT_MIN_SIMILARITY;
+	i->kernel = CVKernelAuto;
+	CVIndexSetKernel(i, CVKernelAuto);
+	*index = i;
+	return RT_RETURN_OK;
+}
+
+
+void CVIndexDestroy(CVRecognitionIndex index)
+{
+	if (index == NULL)
+		return;
+	FreeFeatures(index->features);
+	free(index->heroIds);
+	free(index->skinIds);
+	delete index;
+}
+
+
+static int Grow(CVRecognitionIndex index)
+{
+	int capacity = index->capacity + CV_INDEX_GROW_TEMPLATES;
+	float *features = AllocateFeatures(capacity);
+	int *heroIds = (int*)realloc(index->heroIds, capacity * sizeof(int));
+	int *skinIds;
+
+	if (heroIds != NULL)
+		index->heroIds = heroIds;
+	skinIds = (int*)realloc(index->skinIds, capacity * sizeof(int));
+	if (skinIds != NULL)
+		index->skinIds = skinIds;
+	if (features == NULL || heroIds == NULL || skinIds == NULL)
+	{
+		FreeFeatures(features);
+		return RT_RETURN_OUT_OF_MEMORY;
+	}
+
+	if (index->nofTemplates > 0)
+		memcpy(features, index->features, (size_t)index->nofTemplates * CV_FEATURE_DIM * sizeof(float));
+	FreeFeatures(index->features);
+	index->features = features;
+	index->capacity = capacity;
+	return RT_RETURN_OK;
+}
+
+
+int CVIndexAdd(CVRecognitionIndex index, int heroId, int skinId, const CVImage* image)
+{
+	int ret;
+
+	if (index == NULL || image == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if ((ret = CheckPatches(image, 1)) != RT_RETURN_OK)
+		return ret;
+	if (index->nofTemplates == index->capacity && (ret = Grow(index)) != RT_RETURN_OK)
+		return ret;
+
+	ComputeFeature(image, index->features + (size_t)index->nofTemplates * CV_FEATURE_DIM);
+	index->heroIds[index->nofTemplates] = heroId;
+	index->skinIds[index->nofTemplates] = skinId;
+	index->nofTemplates++;
+	return RT_RETURN_OK;
+}
+
+
+int CVIndexAddFile(CVRecognitionIndex index, int heroId, int skinId, const char* path)
+{
+	CVVideo video;
+	CVImage image;
+	double fps;
+	int ret;
+
+	if (index == NULL || path == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	ret = CVVideoOpen(path, &video);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	ret = CVVideoGetFormat(video, &image.width, &image.height, &fps);
+	if (ret == RT_RETURN_OK)
+	{
+		image.stride = image.width * 3;
+		image.pixels = (unsigned char*)malloc((size_t)image.stride * image.height);
+		if (image.pixels == NULL)
+			ret = RT_RETURN_OUT_OF_MEMORY;
+	}
+	if (ret == RT_RETURN_OK)
+	{
+		ret = CVVideoRead(video, &image);
+		/* a video without frames is no template */
+		if (ret == RT_RETURN_END_OF_LOG)
+			ret = RT_RETURN_ILLEGAL_DATA;
+		if (ret == RT_RETURN_OK)
+			ret = CVIndexAdd(index, heroId, skinId, &image);
+		free(image.pixels);
+	}
+	CVVideoClose(video);
+	return ret;
+}
+
+
+int CVIndexGetNofTemplates(CVRecognitionIndex index)
+{
+	return (index != NULL) ? index->nofTemplates : 0;
+}
+
+
+int CVIndexSetThreshold(CVRecognitionIndex index, float minSimilarity)
+{
+	if (index == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (minSimilarity < -1.0f || minSimilarity > 1.0f)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	index->minSimilarity = minSimilarity;
+	return RT_RETURN_OK;
+}
+
+
+int CVIndexSetKernel(CVRecognitionIndex index, cvKernel kernel)
+{
+	CVDotsFunc dots = NULL;
+
+	if (index == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	if (kernel == CVKernelAuto)
+	{
+		static const cvKernel preferred[] = { CVKernelAVX2, CVKernelSSE, CVKernelScalar };
+		int k;
+
+		for (k = 0; dots == NULL; k++)
+		{
+			dots = KernelFunc(preferred[k]);
+			kernel = preferred[k];
+		}
+	}
+	else
+	{
+		dots = KernelFunc(kernel);
+		if (dots == NULL)
+			return RT_RETURN_NOT_IMPLEMENTED;
+	}
+	index->kernel = kernel;
+	index->dots = dots;
+	return RT_RETURN_OK;
+}
+
+
+const char* CVIndexGetKernelName(CVRecognitionIndex index)
+{
+	if (index == NULL)
+		return "";
+	switch (index->kernel)
+	{
+	case CVKernelSSE:
+		return "sse";
+	case CVKernelAVX2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
+
+
+int CVIndexClassify(CVRecognitionIndex index, const CVImage* patches, int nofPatches, CVMatch* matches)
+{
+	CVQueryScratch *scratch = &tlScratch;
+	int ret;
+	int p;
+
+	if (index == NULL || (nofPatches > 0 && (patches == NULL || matches == NULL)))
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if ((ret = CheckPatches(patches, nofPatches)) != RT_RETURN_OK)
+		return ret;
+
+	for (p = 0; p < nofPatches; p++)
+		ComputeFeature(&patches[p], scratch->features + (size_t)p * CV_FEATURE_DIM);
+	Search(index, scratch->features, nofPatches, matches);
+	index->nofQueries.fetch_add(nofPatches, std::memory_order_relaxed);
+	return RT_RETURN_OK;
+}
+
+
+/* the patch of a slot is the same as at its last search */
+static int Unchanged(CVIconCache cache, int slot, const float* feature)
+{
+	const float *cached = cache->features + (size_t)slot * CV_FEATURE_DIM;
+	float dot = 0.0f;
+
+	if (!cache->valid[slot])
+		return 0;
+	DotsScalar(cached, feature, 1, &dot);
+	if (dot >= CV_CACHE_MIN_SIMILARITY)
+		return 1;
+	/* two flat patches, e.g. an empty slot, have no similarity but are the same */
+	return dot == 0.0f && IsFlat(cached) && IsFlat(feature);
+}
+
+
+int CVIndexClassifyCached(CVRecognitionIndex index, CVIconCache cache,
+                          const CVImage* patches, int nofPatches, CVMatch* matches)
+{
+	CVQueryScratch *scratch = &tlScratch;
+	CVMatch searched[CV_MAX_BATCH];
+	int nofSearches = 0;
+	int ret;
+	int p, s;
+
+	if (index == NULL || cache == NULL || (nofPatches > 0 && (patches == NULL || matches == NULL)))
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (nofPatches > cache->nofSlots)
+		return RT_RETURN_ILLEGAL_DATA;
+	if ((ret = CheckPatches(patches, nofPatches)) != RT_RETURN_OK)
+		return ret;
+
+	/* the changed patches are packed at the front of the scratch block */
+	for (p = 0; p < nofPatches; p++)
+	{
+		float *feature = scratch->features + (size_t)nofSearches * CV_FEATURE_DIM;
+
+		ComputeFeature(&patches[p], feature);
+		if (Unchanged(cache, p, feature))
+		{
+			matches[p] = cache->matches[p];
+			matches[p].cached = 1;
+			continue;
+		}
+		scratch->slots[nofSearches++] = p;
+	}
+
+	if (nofSearches > 0)
+		Search(index, scratch->features, nofSearches, searched);
+	for (s = 0; s < nofSearches; s++)
+	{
+		p = scratch->slots[s];
+		memcpy(cache->features + (size_t)p * CV_FEATURE_DIM, scratch->features + (size_t)s * CV_FEATURE_DIM,
+		       CV_FEATURE_DIM * sizeof(float));
+		cache->matches[p] = searched[s];
+		cache->valid[p] = 1;
+		matches[p] = searched[s];
+	}
+
+	index->nofQueries.fetch_add(nofPatches, std::memory_order_relaxed);
+	index->nofCacheHits.fetch_add(nofPatches - nofSearches, std::memory_order_relaxed);
+	return RT_RETURN_OK;
+}
+
+
+int CVIndexGetStats(CVRecognitionIndex index, CVRecognitionStats* stats)
+{
+	if (index == NULL || stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	stats->nofQueries = index->nofQueries.load(std::memory_order_relaxed);
+	stats->nofSearches = index->nofSearches.load(std::memory_order_relaxed);
+	stats->nofCacheHits = index->nofCacheHits.load(std::memory_order_relaxed);
+	stats->nofRecognised = index->nofRecognised.load(std::memory_order_relaxed);
+	return RT_RETURN_OK;
+}
+
+
+
+/*
+	Icon cache
+*/
+
+int CVIconCacheCreate(int nofSlots, CVIconCache* cache)
+{
+	CVIconCache c;
+
+	if (cache == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*cache = NULL;
+	if (nofSlots <= 0 || nofSlots > CV_MAX_BATCH)
+		return RT_RETURN_ILLEGAL_DATA;
+
+	c = new (std::nothrow) CVIconCacheStruct();
+	if (c == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	c->nofSlots = nofSlots;
+	c->features = AllocateFeatures(nofSlots);
+	c->matches = (CVMatch*)calloc(nofSlots, sizeof(CVMatch));
+	c->valid = (int*)calloc(nofSlots, sizeof(int));
+	if (c->features == NULL || c->matches == NULL || c->valid == NULL)
+	{
+		CVIconCacheDestroy(c);
+		return RT_RETURN_OUT_OF_MEMORY;
+	}
+	*cache = c;
+	return RT_RETURN_OK;
+}
+
+
+void CVIconCacheDestroy(CVIconCache cache)
+{
+	if (cache == NULL)
+		return;
+	FreeFeatures(cache->features);
+	free(cache->matches);
+	free(cache->valid);
+	delete cache;
+}
+
+
+void CVIconCacheReset(CVIconCache cache)
+{
+	if (cache != NULL)
+		memset(cache->valid, 0, cache->nofSlots * sizeof(int));
+}
+
+
+
+int CVImageView(const CVImage* image, int x, int y, int width, int height, CVImage* view)
+{
+	if (image == NULL || view == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > image->width || y + height > image->height)
+		return RT_RETURN_ILLEGAL_DATA;
+
+	view->pixels = image->pixels + (size_t)y * image->stride + (size_t)x * 3;
+	view->width = width;
+	view->height = height;
+	view->stride = image->stride;
+	return RT_RETURN_OK;
+}
@@ -0,0 +1,146 @@
+﻿#ifndef _CVRECOGNITION_H_
+#define _CVRECOGNITION_H_
+
+#include "CVEngine.h"
+
+/*
+	Nearest neighbour recognition of hero portraits and minimap icons.
+
+	Every template (hero, skin) is reduced to a feature vector when it is added: the
+	image is averaged down to CV_FEATURE_SIZE x CV_FEATURE_SIZE BGR cells, centred and
+	normalised to length 1, so the similarity of two images is the dot product of their
+	features (1: same image). The features of the index are stored row after row in one
+	aligned block.
+
+	CVIndexClassify takes all patches of a frame (the ten minimap icons, the ten portraits)
+	at once and walks the template rows a single time for the whole batch. The dot products
+	run on AVX2 or SSE when the processor has them, otherwise on the scalar kernel.
+
+	A CVIconCache remembers the last patch and result of every icon slot: a patch that
+	still looks like the last one keeps its result without a search.
+*/
+
+
+/** Cells per side of a feature */
+#define CV_FEATURE_SIZE             12
+/** Floats per feature, a multiple of 8 so the AVX kernel has no tail */
+#define CV_FEATURE_DIM              (CV_FEATURE_SIZE * CV_FEATURE_SIZE * 3)
+/** Most patches in one CVIndexClassify call */
+#define CV_MAX_BATCH                32
+/** Matches below this similarity are not recognised by default */
+#define CV_DEFAULT_MIN_SIMILARITY   0.80f
+/** A cached icon is searched again once its patch is less similar than this to the cached one */
+#define CV_CACHE_MIN_SIMILARITY     0.995f
+
+
+/** Distance kernels */
+enum cvKernel
+{
+	CVKernelAuto,       /* best the processor supports */
+	CVKernelScalar,
+	CVKernelSSE,
+	CVKernelAVX2
+};
+
+
+/** Result for one patch */
+typedef struct _CVMatch
+{
+	int     heroId;         /**< ENV_HERO_* of the best template, ENV_ID_NONE below the threshold */
+	int     skinId;
+	float   similarity;     /**< of the best template, -1 .. 1 */
+	float   margin;         /**< best minus second best similarity of another hero */
+	int     cached;         /**< 1: result taken from the CVIconCache */
+} CVMatch;
+
+
+typedef struct _CVRecognitionStats
+{
+	unsigned long   nofQueries;         /**< patches classified */
+	unsigned long   nofSearches;        /**< patches compared against the templates */
+	unsigned long   nofCacheHits;       /**< patches answered by a CVIconCache */
+	unsigned long   nofRecognised;      /**< patches at or above the threshold */
+} CVRecognitionStats;
+
+
+typedef struct _CVRecognitionIndexStruct *CVRecognitionIndex;
+typedef struct _CVIconCacheStruct *CVIconCache;
+
+
+
+/**
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int CVIndexCreate(CVRecognitionIndex* index);
+
+extern void CVIndexDestroy(CVRecognitionIndex index);
+
+/**
+ * Adds a template. PRE: no CVIndexClassify running on the index.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_ILLEGAL_DATA - empty image
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int CVIndexAdd(CVRecognitionIndex index, int heroId, int skinId, const CVImage* image);
+
+/** Adds the first frame of a video file (a one frame .y4m per template) as template */
+extern int CVIndexAddFile(CVRecognitionIndex index, int heroId, int skinId, const char* path);
+
+extern int CVIndexGetNofTemplates(CVRecognitionIndex index);
+
+/** Similarity a match needs to be recognised, CV_DEFAULT_MIN_SIMILARITY by default */
+extern int CVIndexSetThreshold(CVRecognitionIndex index, float minSimilarity);
+
+/**
+ * Selects the distance kernel, CVKernelAuto by default.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_NOT_IMPLEMENTED - the processor or the build does not have the kernel
+ */
+extern int CVIndexSetKernel(CVRecognitionIndex index, cvKernel kernel);
+
+/** Name of the kernel in use: "scalar", "sse" or "avx2" */
+extern const char* CVIndexGetKernelName(CVRecognitionIndex index);
+
+/**
+ * Classifies nofPatches patches (at most CV_MAX_BATCH) in one pass over the templates.
+ * May be called from several threads at once.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_ILLEGAL_DATA - more than CV_MAX_BATCH patches
+ */
+extern int CVIndexClassify(CVRecognitionIndex index, const CVImage* patches, int nofPatches, CVMatch* matches);
+
+/**
+ * CVIndexClassify for the icon slots of a cache: patches[i] is the current patch of slot i.
+ * Only slots whose patch changed since their last search are searched.
+ */
+extern int CVIndexClassifyCached(CVRecognitionIndex index, CVIconCache cache,
+                                 const CVImage* patches, int nofPatches, CVMatch* matches);
+
+extern int CVIndexGetStats(CVRecognitionIndex index, CVRecognitionStats* stats);
+
+
+/** A cache for nofSlots icon slots (the ten players of a match) */
+extern int CVIconCacheCreate(int nofSlots, CVIconCache* cache);
+
+extern void CVIconCacheDestroy(CVIconCache cache);
+
+/** Forgets every cached result, e.g. after a seek in the video */
+extern void CVIconCacheReset(CVIconCache cache);
+
+
+/**
+ * Points view at a part of image, nothing is copied. The portrait of player p of a team is
+ * the p-th of ENV_CV_PORTRAITS_PER_TEAM equal parts of its portrait region.
+ */
+extern int CVImageView(const CVImage* image, int x, int y, int width, int height, CVImage* view);
+
+
+
+#endif //_CVRECOGNITION_H_
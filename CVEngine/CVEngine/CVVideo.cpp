@@ -0,0 +1,346 @@
+﻿#include "pch.h"
+#include "CVVideo.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#ifdef CV_WITH_OPENCV
+#include <opencv2/videoio.hpp>
+#endif
+
+
+#define CV_Y4M_MAGIC                "YUV4MPEG2"
+#define CV_Y4M_FRAME_TAG            "FRAME"
+#define CV_Y4M_MAX_HEADER_LENGTH    1024
+/* stdio buffer of a video file, a few frame rows at a time */
+#define CV_VIDEO_FILE_BUFFER_SIZE   (1024 * 1024)
+
+
+enum cvChroma
+{
+	CVChroma420, CVChroma422, CVChroma444, CVChromaMono
+};
+
+
+typedef struct _CVVideoStruct
+{
+	FILE           *fp;
+	int             width;
+	int             height;
+	double          fps;
+	cvChroma        chroma;
+	size_t          lumaSize;
+	size_t          chromaSize;         /* size of one chroma plane */
+	int             chromaWidth;
+	int             chromaHeight;
+	unsigned char  *planes;             /* Y, U, V of the current frame */
+	int             seekable;           /* 0 once a seek failed (a pipe): skipped frames are read */
+#ifdef CV_WITH_OPENCV
+	cv::VideoCapture *capture;
+	cv::Mat         mat;
+#endif
+} CVVideoStruct;
+
+
+
+static unsigned char ClampByte(int value)
+{
+	return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+
+/* BT.601 limited range, integer */
+static void ConvertToBGR(CVVideo video, CVImage* image)
+{
+	const unsigned char *yPlane = video->planes;
+	const unsigned char *uPlane = yPlane + video->lumaSize;
+	const unsigned char *vPlane = uPlane + video->chromaSize;
+	int xShift = (video->chroma == CVChroma444) ? 0 : 1;
+	int yShift = (video->chroma == CVChroma420) ? 1 : 0;
+	int x, y;
+
+	for (y = 0; y < video->height; y++)
+	{
+		const unsigned char *yRow = yPlane + (size_t)y * video->width;
+		const unsigned char *uRow = uPlane + (size_t)(y >> yShift) * video->chromaWidth;
+		const unsigned char *vRow = vPlane + (size_t)(y >> yShift) * video->chromaWidth;
+		unsigned char *out = image->pixels + (size_t)y * image->stride;
+
+		if (video->chroma == CVChromaMono)
+		{
+			for (x = 0; x < video->width; x++)
+			{
+				unsigned char gray = ClampByte((298 * (yRow[x] - 16) + 128) >> 8);
+
+				out[0] = out[1] = out[2] = gray;
+				out += 3;
+			}
+			continue;
+		}
+
+		for (x = 0; x < video->width; x++)
+		{
+			int c = 298 * (yRow[x] - 16) + 128;
+			int d = uRow[x >> xShift] - 128;
+			int e = vRow[x >> xShift] - 128;
+
+			out[0] = ClampByte((c + 516 * d) >> 8);
+			out[1] = ClampByte((c - 100 * d - 208 * e) >> 8);
+			out[2] = ClampByte((c + 409 * e) >> 8);
+			out += 3;
+		}
+	}
+}
+
+
+/* reads a header line up to '\n' */
+static int ReadHeaderLine(FILE* fp, char* line, int size)
+{
+	int length = 0;
+	int c;
+
+	while ((c = fgetc(fp)) != EOF && c != '\n')
+	{
+		if (length < size - 1)
+			line[length++] = (char)c;
+	}
+	line[length] = '\0';
+	return (c == EOF && length == 0) ? 0 : 1;
+}
+
+
+static int ParseY4MHeader(CVVideo video, char* header)
+{
+	char *token;
+
+	video->chroma = CVChroma420;
+	for (token = strtok(header, " "); token != NULL; token = strtok(NULL, " "))
+	{
+		switch (token[0])
+		{
+		case 'W':
+			video->width = atoi(token + 1);
+			break;
+		case 'H':
+			video->height = atoi(token + 1);
+			break;
+		case 'F':
+		{
+			int num = 0, den = 0;
+
+			if (sscanf(token + 1, "%d:%d", &num, &den) == 2 && den > 0)
+				video->fps = (double)num / den;
+			break;
+		}
+		case 'C':
+			if (strcmp(token + 1, "420") == 0 || strcmp(token + 1, "420jpeg") == 0 ||
+				strcmp(token + 1, "420mpeg2") == 0 || strcmp(token + 1, "420paldv") == 0)
+				video->chroma = CVChroma420;
+			else if (strcmp(token + 1, "422") == 0)
+				video->chroma = CVChroma422;
+			else if (strcmp(token + 1, "444") == 0)
+				video->chroma = CVChroma444;
+			else if (strcmp(token + 1, "mono") == 0)
+				video->chroma = CVChromaMono;
+			else
+				return 0;   /* high bit depth and alpha are not supported */
+			break;
+		default:
+			break;
+		}
+	}
+	return video->width > 0 && video->height > 0;
+}
+
+
+static int OpenY4M(CVVideo video)
+{
+	char header[CV_Y4M_MAX_HEADER_LENGTH];
+
+	if (!ReadHeaderLine(video->fp, header, sizeof(header)) ||
+		strncmp(header, CV_Y4M_MAGIC, strlen(CV_Y4M_MAGIC)) != 0 ||
+		!ParseY4MHeader(video, header + strlen(CV_Y4M_MAGIC)))
+		return RT_RETURN_ILLEGAL_DATA;
+
+	video->lumaSize = (size_t)video->width * video->height;
+	switch (video->chroma)
+	{
+	case CVChroma420:
+		video->chromaWidth = (video->width + 1) / 2;
+		video->chromaHeight = (video->height + 1) / 2;
+		break;
+	case CVChroma422:
+		video->chromaWidth = (video->width + 1) / 2;
+		video->chromaHeight = video->height;
+		break;
+	case CVChroma444:
+		video->chromaWidth = video->width;
+		video->chromaHeight = video->height;
+		break;
+	case CVChromaMono:
+		video->chromaWidth = 0;
+		video->chromaHeight = 0;
+		break;
+	}
+	video->chromaSize = (size_t)video->chromaWidth * video->chromaHeight;
+
+	video->planes = (unsigned char*)malloc(video->lumaSize + 2 * video->chromaSize);
+	if (video->planes == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	video->seekable = 1;
+	return RT_RETURN_OK;
+}
+
+
+/* reads the FRAME line in front of the planes */
+static int NextY4MFrame(CVVideo video)
+{
+	char line[CV_Y4M_MAX_HEADER_LENGTH];
+
+	if (!ReadHeaderLine(video->fp, line, sizeof(line)))
+		return RT_RETURN_END_OF_LOG;
+	if (strncmp(line, CV_Y4M_FRAME_TAG, strlen(CV_Y4M_FRAME_TAG)) != 0)
+		return RT_RETURN_ILLEGAL_DATA;
+	return RT_RETURN_OK;
+}
+
+
+
+int CVVideoOpen(const char* path, CVVideo* video)
+{
+	CVVideo v;
+	int ret;
+
+	if (path == NULL || video == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*video = NULL;
+
+	v = new (std::nothrow) CVVideoStruct();
+	if (v == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+
+	v->fp = fopen(path, "rb");
+	if (v->fp == NULL)
+	{
+		delete v;
+		return RT_RETURN_CANNOT_OPEN_FILE;
+	}
+	setvbuf(v->fp, NULL, _IOFBF, CV_VIDEO_FILE_BUFFER_SIZE);
+
+	ret = OpenY4M(v);
+#ifdef CV_WITH_OPENCV
+	if (ret == RT_RETURN_ILLEGAL_DATA)
+	{
+		fclose(v->fp);
+		v->fp = NULL;
+		v->capture = new cv::VideoCapture(path);
+		if (v->capture->isOpened())
+		{
+			v->width = (int)v->capture->get(cv::CAP_PROP_FRAME_WIDTH);
+			v->height = (int)v->capture->get(cv::CAP_PROP_FRAME_HEIGHT);
+			v->fps = v->capture->get(cv::CAP_PROP_FPS);
+			ret = (v->width > 0 && v->height > 0) ? RT_RETURN_OK : RT_RETURN_ILLEGAL_DATA;
+		}
+	}
+#endif
+	if (ret != RT_RETURN_OK)
+	{
+		CVVideoClose(v);
+		return ret;
+	}
+
+	*video = v;
+	return RT_RETURN_OK;
+}
+
+
+void CVVideoClose(CVVideo video)
+{
+	if (video == NULL)
+		return;
+	if (video->fp != NULL)
+		fclose(video->fp);
+	free(video->planes);
+#ifdef CV_WITH_OPENCV
+	delete video->capture;
+#endif
+	delete video;
+}
+
+
+int CVVideoGetFormat(CVVideo video, int* width, int* height, double* fps)
+{
+	if (video == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (width != NULL)
+		*width = video->width;
+	if (height != NULL)
+		*height = video->height;
+	if (fps != NULL)
+		*fps = video->fps;
+	return RT_RETURN_OK;
+}
+
+
+int CVVideoRead(CVVideo video, CVImage* image)
+{
+	size_t size;
+	int ret;
+
+	if (video == NULL || image == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+#ifdef CV_WITH_OPENCV
+	if (video->capture != NULL)
+	{
+		int y;
+
+		if (!video->capture->read(video->mat))
+			return RT_RETURN_END_OF_LOG;
+		if (video->mat.type() != CV_8UC3 || video->mat.cols != image->width || video->mat.rows != image->height)
+			return RT_RETURN_ILLEGAL_DATA;
+		for (y = 0; y < image->height; y++)
+			memcpy(image->pixels + (size_t)y * image->stride, video->mat.ptr(y), (size_t)image->width * 3);
+		return RT_RETURN_OK;
+	}
+#endif
+
+	ret = NextY4MFrame(video);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	size = video->lumaSize + 2 * video->chromaSize;
+	if (fread(video->planes, 1, size, video->fp) != size)
+		return RT_RETURN_END_OF_LOG;     /* cut off in the middle of the last frame */
+
+	ConvertToBGR(video, image);
+	return RT_RETURN_OK;
+}
+
+
+int CVVideoSkip(CVVideo video)
+{
+	size_t size;
+	int ret;
+
+	if (video == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+#ifdef CV_WITH_OPENCV
+	if (video->capture != NULL)
+		return video->capture->grab() ? RT_RETURN_OK : RT_RETURN_END_OF_LOG;
+#endif
+
+	ret = NextY4MFrame(video);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	size = video->lumaSize + 2 * video->chromaSize;
+	if (video->seekable && fseek(video->fp, (long)size, SEEK_CUR) == 0)
+		return RT_RETURN_OK;
+
+	/* a pipe (ffmpeg -f yuv4mpegpipe) does not seek: the frame is read and dropped */
+	video->seekable = 0;
+	if (fread(video->planes, 1, size, video->fp) != size)
+		return RT_RETURN_END_OF_LOG;
+	return RT_RETURN_OK;
+}
@@ -0,0 +1,44 @@
+﻿#ifndef _CVVIDEO_H_
+#define _CVVIDEO_H_
+
+#include "CVEngine.h"
+
+/*
+	Video file read by the DECODE stage of the pipeline, one frame at a time.
+
+	Y4M (YUV4MPEG2) files are read natively: 4:2:0, 4:2:2, 4:4:4 and mono, 8 bit,
+	converted to BGR. Built with CV_WITH_OPENCV anything else is handed to
+	cv::VideoCapture.
+*/
+
+
+typedef struct _CVVideoStruct *CVVideo;
+
+
+/**
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_CANNOT_OPEN_FILE
+ * @retval RT_RETURN_ILLEGAL_DATA - not a video that can be read
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int CVVideoOpen(const char* path, CVVideo* video);
+
+extern void CVVideoClose(CVVideo video);
+
+/** Frame size and frames per second (0 if the video does not tell) */
+extern int CVVideoGetFormat(CVVideo video, int* width, int* height, double* fps);
+
+/**
+ * Reads the next frame into image, which has the size of the video.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_END_OF_LOG - no frames left
+ * @retval RT_RETURN_ILLEGAL_DATA - broken frame, the video cannot be read further
+ */
+extern int CVVideoRead(CVVideo video, CVImage* image);
+
+/** Moves past the next frame without decoding it, same return values as CVVideoRead */
+extern int CVVideoSkip(CVVideo video);
+
+
+#endif //_CVVIDEO_H_
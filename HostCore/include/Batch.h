@@ -0,0 +1,105 @@
+#ifndef _Batch_H_
+#define _Batch_H_
+
+
+#include <stdio.h>
+#include <vector>
+
+#include "RTEngine.h"
+#include "ValueEngine.h"
+
+/*
+	BatchClass analyses many replay logs in parallel (nightly re-scoring after a patch).
+
+	Every replay is a MatchClass of its own (Match.h): a synchronous RTEngineInstance, a
+	GameClass with the ten players of the match and a ValueEngine bound to it. Replays
+	share nothing but the sealed environment and run on a work-stealing thread pool with
+	one worker per core. The TIME_TICK work of a replay runs in the worker that reads its
+	log, which keeps a replay on one core from start to end.
+
+	The modules of a replay are the ones of SetModules, the context of every module is
+	the MatchClass of the replay. Without them the replays get DefaultModules: "parse"
+	reads a record of ValueEngine events with RecordClass::Parse (Record.h), and "value"
+	commits it to the game (RecordClass::ApplyGame) and the Value Engine of the replay. The values the engine ends with
+	are the result of the replay.
+*/
+
+
+/* Result of one replay */
+typedef struct _BatchReplayResult
+{
+	const char     *path;
+	int             ret;                /* RT_RETURN_OK or the error that stopped the analysis */
+	unsigned long   nofEntries;         /* replay log records handled */
+	unsigned long   nofTimedEvents;     /* Event List events triggered */
+	unsigned long   nofScored;          /* records the Value Engine handled (DefaultModules) */
+	double          gameTime;           /* game time at the end of the replay */
+	double          seconds;            /* wall time of the analysis */
+	float           values[VE_NOF_NODES];   /* ValueEngine::GetValue of every node at the end */
+} BatchReplayResult;
+
+
+/* Throughput of a Run */
+typedef struct _BatchThroughput
+{
+	int             nofReplays;
+	int             nofFailed;
+	int             nofWorkers;
+	unsigned long   nofEntries;
+	unsigned long   nofTimedEvents;
+	unsigned long   nofScored;
+	unsigned long   nofSteals;          /* replays picked up by another worker than the one they were queued on */
+	double          seconds;            /* wall time of the Run */
+	double          replaysPerSecond;
+	double          eventsPerSecond;    /* replay log records per second */
+} BatchThroughput;
+
+
+class EnvironmentClass;
+
+
+#define BATCH_NOF_DEFAULT_MODULES   2
+
+
+typedef class BatchClass
+{
+public:
+	BatchClass();
+	~BatchClass();
+
+	/* Queues a replay log, path must stay valid until Run returns */
+	int AddReplay(const char* path);
+
+	/*
+		The environment of the replays, it must be sealed and outlive Run. Without one Run
+		loads the latest patch without recognition templates.
+	*/
+	void SetEnvironment(const EnvironmentClass* environment);
+
+	/* The module table of every replay, copied by Run; NULL: DefaultModules */
+	int SetModules(const RTModuleSettings* modules, int nofModules);
+
+	/* "parse" and "value", see above; modules must have room for BATCH_NOF_DEFAULT_MODULES */
+	static int DefaultModules(RTModuleSettings* modules);
+
+	/* Analyses every queued replay on nofWorkers threads (0: one per core) and waits for them */
+	int Run(int nofWorkers, BatchThroughput* throughput);
+
+	int GetNofReplays() const;
+	const BatchReplayResult* GetResult(int index) const;
+
+	/* Prints the throughput of a Run */
+	static void PrintThroughput(FILE* f, const BatchThroughput* throughput);
+
+private:
+	static void AnalyseReplay(void* taskData, int workerIndex);
+
+	std::vector<BatchReplayResult> replays;
+	const EnvironmentClass *environment;
+	std::vector<RTModuleSettings> modules;
+
+}* Batch;
+
+
+
+#endif // _Batch_H_
@@ -0,0 +1,114 @@
+#ifndef _EntityIndex_H_
+#define _EntityIndex_H_
+
+
+#include <stddef.h>
+
+#include "Player.h"
+
+/*
+	EntityIndexClass maps the unit ids of the replay (players, heroes, summons, neutral
+	camps, structures) to dense handles 0 .. GAME_MAX_UNITS - 1, so the data of a unit
+	can be kept in plain arrays indexed by its handle.
+
+	The ids are kept in one open-addressing table with linear probing, sized for a match
+	and part of the object: Find hashes the id and reads one slot, or a few neighbouring
+	ones, nothing is allocated after construction. The table is at most half full.
+	Remove moves the entries that follow back instead of leaving tombstones, so summons
+	coming and going for a whole match do not lengthen the lookups, and puts the handle
+	on a free list for the next Insert.
+*/
+
+
+enum gameUnitKind
+{
+	GameUnitPlayer,
+	GameUnitHero,
+	GameUnitSummon,
+	GameUnitCamp,           /* neutral camp, mercenaries */
+	GameUnitStructure,
+	GAME_NOF_UNIT_KINDS
+};
+
+/* Dense handle of a unit, see EntityIndexClass */
+typedef int GameUnit;
+
+#define GAME_UNIT_NONE              (-1)
+/* Unit id no unit has: the target of an event without one (-1 as an int) */
+#define GAME_UNIT_ID_NONE           0xFFFFFFFFu
+
+/* Units alive at the same time in a match */
+#define GAME_MAX_UNITS              1024
+#define GAME_UNIT_TABLE_BITS        11
+#define GAME_UNIT_TABLE_SIZE        (1 << GAME_UNIT_TABLE_BITS)     /* 2 * GAME_MAX_UNITS */
+
+
+typedef class EntityIndexClass
+{
+public:
+	EntityIndexClass();
+	~EntityIndexClass();
+
+	/* Removes every unit, handles handed out before are no longer valid */
+	void Reset();
+
+	/*
+		Gives unitId a handle. owner is the player the unit acts for (itself for a player
+		or hero, the summoner of a summon), GAME_ENTITY_NONE for camps and structures.
+		DU_RETURN_ILLEGAL_ARGUMENT if unitId is GAME_UNIT_ID_NONE or in the index already,
+		DU_RETURN_ILLEGAL_SIZE if GAME_MAX_UNITS are.
+	*/
+	int Insert(unsigned int unitId, int kind, GameEntity owner, GameUnit* unit);
+
+	/* DU_RETURN_NOT_FOUND if unitId is not in the index */
+	int Remove(unsigned int unitId);
+
+	/* The handle of unitId, GAME_UNIT_NONE if it is not in the index */
+	GameUnit Find(unsigned int unitId) const;
+
+	unsigned int GetUnitId(GameUnit unit) const;
+	int GetKind(GameUnit unit) const;
+	GameEntity GetOwner(GameUnit unit) const;
+
+	int GetNofUnits() const;
+
+	/* Slots the longest lookup in the index reads */
+	int GetMaxProbes() const;
+
+	/*
+		Snapshot of the index: the units and their table slots, not the table. Restore
+		gives every unit its handle back. DU_RETURN_ILLEGAL_SIZE if size is too small,
+		DU_RETURN_ILLEGAL_ARGUMENT if buffer holds no snapshot of an index.
+	*/
+	size_t GetSnapshotSize() const;
+	int SaveSnapshot(void* buffer, size_t size, size_t* written) const;
+	int RestoreSnapshot(const void* buffer, size_t size);
+
+private:
+	EntityIndexClass(const EntityIndexClass&);
+	EntityIndexClass& operator=(const EntityIndexClass&);
+
+	static unsigned int Home(unsigned int unitId);
+
+	/* open-addressing table, unit is GAME_UNIT_NONE in an empty slot */
+	struct
+	{
+		unsigned int    id;
+		GameUnit        unit;
+	} table[GAME_UNIT_TABLE_SIZE];
+
+	/* per handle */
+	unsigned int ids[GAME_MAX_UNITS];
+	GameEntity owners[GAME_MAX_UNITS];
+	unsigned char kinds[GAME_MAX_UNITS];
+
+	GameUnit freeUnits[GAME_MAX_UNITS];     /* removed handles, taken first */
+	int nofFree;
+	int nextUnit;                           /* handles below have been handed out */
+	int nofUnits;
+
+}* EntityIndex;
+
+
+
+#endif // _EntityIndex_H_
@@ -0,0 +1,71 @@
+#ifndef _Environment_H_
+#define _Environment_H_
+
+
+#include <stddef.h>
+
+#include "RTEngine.h"
+#include "CVRecognition.h"
+#include "ENV_patches.h"
+
+/*
+	EnvironmentClass is what every match of the process reads and no match changes: the
+	ENV tables of the patch and the hero recognition models. It is loaded once, templates
+	added, then sealed; a sealed environment is only read, by any number of matches on
+	any number of threads (CVIndexClassify may run on several at once), so a match
+	(MatchClass) holds a pointer to it and no copy.
+
+	The ENV tables are static const data of the program, the environment only picks the
+	patch. The recognition index is what costs memory, a feature vector per template, and
+	it is built once here instead of once per match.
+
+	PRE: Load, the Add calls and Seal from one thread, before the first match opens.
+	The environment outlives every match opened on it.
+*/
+
+
+typedef class EnvironmentClass
+{
+public:
+	EnvironmentClass();
+	~EnvironmentClass();
+
+	/*
+		Selects the patch (NULL: the newest) and creates the empty recognition index.
+		RT_RETURN_NOT_FOUND for an unsupported version, RT_RETURN_SETTING_NOT_ALLOWED
+		once sealed, RT_RETURN_OUT_OF_MEMORY.
+	*/
+	int Load(const char* patchVersion);
+
+	/*
+		Templates of the recognition index, see CVIndexAdd and CVIndexAddFile.
+		RT_RETURN_LIB_NOT_INITIALIZED before Load, RT_RETURN_SETTING_NOT_ALLOWED once sealed.
+	*/
+	int AddTemplate(int heroId, int skinId, const CVImage* image);
+	int AddTemplateFile(int heroId, int skinId, const char* path);
+
+	/* Nothing changes from here on. RT_RETURN_LIB_NOT_INITIALIZED before Load. */
+	int Seal();
+	int IsSealed() const;
+
+	const ENV_PatchStruct* GetPatch() const;
+	/* Shared by the matches, only CVIndexClassify and CVIndexClassifyCached once sealed */
+	CVRecognitionIndex GetRecognitionIndex() const;
+	/* Bytes of the recognition models, held once for all matches */
+	size_t GetModelBytes() const;
+
+private:
+	EnvironmentClass(const EnvironmentClass&);
+	EnvironmentClass& operator=(const EnvironmentClass&);
+
+	int CheckOpen() const;
+
+	const ENV_PatchStruct *patch;
+	CVRecognitionIndex index;
+	int sealed;
+
+}* Environment;
+
+
+
+#endif // _Environment_H_
@@ -1,22 +1,35 @@
-
-
 #ifndef _Game_H_
 #define _Game_H_
 
 
 #include "du.h"
 #include "logging.h"
+#include "Player.h"
+#include "EntityIndex.h"
+#include "ENV_patches.h"
 
 /*
 	GameClass is the skeleton of the program.
 
+	The state of a match is kept in one block of arrays (GameState) with one entry
+	per player slot, so an update or a scan of the Value Engine walks contiguous
+	memory instead of following list nodes and object pointers. Matches are 5v5:
+	slots 0 - 4 are the blue team, 5 - 9 the red team. The slot of a player is its
+	GameEntity, which stays the same for the whole match.
+
+	PlayersTeamBlue and PlayersTeamRed still list the players of a team, their
+	elements are PlayerClass views on the slots.
+
+	Hero ids are the ENV_HERO_* ids of ENV_characters.h, their stats come from the
+	patch of the game (the newest one unless SetPatch picks another).
+
+	The units of the replay (heroes, summons, camps, structures) are known by their unit
+	ids; AddUnit registers one in the EntityIndex of the game, ResolveUnit turns the id
+	of a source or target into the player it acts for in O(1).
 */
 
 
 /*	Remove these as they are implemented	*/
-extern class PlayerClass;
-typedef PlayerClass* Player;
-
 extern class TeamClass;
 typedef TeamClass* Team;
 
@@ -24,17 +37,126 @@ extern class HeroClass;
 typedef HeroClass* Hero;
 
 
+#define GAME_NOF_TEAMS              2
+#define GAME_PLAYERS_PER_TEAM       5
+#define GAME_NOF_SLOTS              (GAME_NOF_TEAMS * GAME_PLAYERS_PER_TEAM)
+/* Q, W, E, R and the trait */
+#define GAME_NOF_ABILITIES          5
+
+#define GAME_ENTITY_NONE            (-1)
+#define GAME_HERO_NONE              (-1)
+
+
+enum gameTeam
+{
+	GameTeamBlue, GameTeamRed
+};
+
+
+/* State of a match, entry [e] of a per slot array belongs to GameEntity e */
+typedef struct _GameStateStruct
+{
+	int             heroId[GAME_NOF_SLOTS];         /* GAME_HERO_NONE for an empty slot */
+	float           hp[GAME_NOF_SLOTS];
+	float           maxHp[GAME_NOF_SLOTS];
+	float           posX[GAME_NOF_SLOTS];
+	float           posY[GAME_NOF_SLOTS];
+	int             level[GAME_NOF_SLOTS];
+	float           cooldown[GAME_NOF_ABILITIES][GAME_NOF_SLOTS];   /* seconds left, one row per ability */
+	unsigned char   alive[GAME_NOF_SLOTS];
+	unsigned char   used[GAME_NOF_SLOTS];           /* slot has a player */
+
+	/* team aggregates, kept up to date by the setters of GameClass */
+	float           teamHp[GAME_NOF_TEAMS];
+	float           teamMaxHp[GAME_NOF_TEAMS];
+	int             teamLevel[GAME_NOF_TEAMS];      /* highest level in the team */
+	int             teamNofAlive[GAME_NOF_TEAMS];
+	int             teamNofPlayers[GAME_NOF_TEAMS];
+
+	unsigned long   version;                        /* incremented on every change */
+} GameState;
+
+
+/* Called for every player of GameClass::Iterate */
+typedef void (*GameEntityIterator) (const GameState* state, GameEntity entity, void* context);
+
+
 typedef class GameClass
 {
 public:
 	GameClass();
 	~GameClass();
 
+	/* Removes every player, entities handed out before are no longer valid */
+	void Reset();
+
+	/* Selects the ENV tables of a patch version, DU_RETURN_NOT_FOUND if it is not supported */
+	int SetPatch(const char* version);
+	const ENV_PatchStruct* GetPatch() const;
+
+	/* Puts a player in the next free slot of team, *entity is its handle for the rest of the match */
+	int AddPlayer(int team, int heroId, GameEntity* entity);
+
+	int SetHero(GameEntity entity, int heroId);
+	int SetHp(GameEntity entity, float hp, float maxHp);
+	int SetPosition(GameEntity entity, float x, float y);
+	int SetLevel(GameEntity entity, int level);
+	int SetAlive(GameEntity entity, int alive);
+	int SetCooldown(GameEntity entity, int ability, float seconds);
+
+	/* Counts down every cooldown of every player */
+	void AdvanceCooldowns(float seconds);
+
+	int IsValidEntity(GameEntity entity) const;
+	Player GetPlayer(GameEntity entity);
+	DuList GetPlayers(int team);
+
+	/*
+		Linear access for the Value Engine: the entities of team are TeamBegin(team) up
+		to TeamEnd(team), state->used tells which of them hold a player.
+	*/
+	const GameState* GetState() const;
+	static GameEntity TeamBegin(int team);
+	static GameEntity TeamEnd(int team);
+	static int TeamOf(GameEntity entity);
+
+	/* Calls fun for every player of team, or of both teams if team is -1 */
+	void Iterate(int team, GameEntityIterator fun, void* context) const;
+
+	/*
+		Units of the replay, see EntityIndexClass::Insert. DU_RETURN_ILLEGAL_INDEX if owner
+		is neither GAME_ENTITY_NONE nor a player of the game.
+	*/
+	int AddUnit(unsigned int unitId, int kind, GameEntity owner, GameUnit* unit);
+	int RemoveUnit(unsigned int unitId);
+
+	/* The player unitId acts for, GAME_ENTITY_NONE for an unknown or neutral unit */
+	GameEntity ResolveUnit(unsigned int unitId) const;
+	const EntityIndexClass* GetUnits() const;
+
+	/*
+		Snapshot of the match: the GameState, the patch and the units. The players of
+		PlayersTeamBlue and PlayersTeamRed follow the restored slots. DU_RETURN_ILLEGAL_SIZE
+		if size is too small, DU_RETURN_ILLEGAL_ARGUMENT if buffer holds no snapshot of a game.
+	*/
+	size_t GetSnapshotSize() const;
+	int SaveSnapshot(void* buffer, size_t size, size_t* written) const;
+	int RestoreSnapshot(const void* buffer, size_t size);
+
 
 	DuList PlayersTeamBlue;
 	DuList PlayersTeamRed;
 
 private:
+	GameClass(const GameClass&);
+	GameClass& operator=(const GameClass&);
+
+	void UpdateTeamLevel(int team);
+
+	const ENV_PatchStruct *patch;
+	GameState state;
+	PlayerClass players[GAME_NOF_SLOTS];    /* the elements of PlayersTeamBlue and PlayersTeamRed */
+	EntityIndexClass units;
 
 }* Game;
 
@@ -44,4 +166,4 @@ private:
 
 
 
-#endif // _Game_H_
\ No newline at end of file
+#endif // _Game_H_
@@ -0,0 +1,125 @@
+#ifndef _Match_H_
+#define _Match_H_
+
+
+#include <stddef.h>
+
+#include "RTEngine.h"
+#include "RTBus.h"
+#include "CVRecognition.h"
+#include "CVMarker.h"
+
+/*
+	MatchClass is one match of a process that analyses several at once (a spectator
+	server with many live games). It owns everything that changes while the match is
+	analysed, and nothing else:
+
+		an RTEngineInstance     Process Buffer, TIME_TICK thread, Event List, data pool,
+		                        modules; the match is its matchContext
+		an RTBus                the messages of this match only
+		a GameClass             with the patch of the environment
+		a ValueEngine           bound to the game, subscribed to the bus and linked to
+		                        the instance (RTInstanceGetValueEngine)
+		a CVIconCache           the last icon of every slot, for the shared index
+		a CVMarkerTracker       where the markers of the slots were last seen on the minimap
+
+	The ENV tables and the recognition models come from a sealed EnvironmentClass that
+	all matches share read-only. Matches share no state with each other, so each may be
+	fed from a thread of its own.
+
+	The module table of the settings may be shared by all matches: every match copies it
+	and passes itself as the context of process, commit and the event handler, so a
+	module finds its match with (MatchClass*)context. Code that only gets the instance
+	(a CVAnalyseFunc) finds it with FromInstance.
+
+	A match asks for a smaller Process Buffer than RTCoreInit (MATCH_DEFAULT_BUFFER_CAPACITY):
+	with many matches per process the buffers are most of the memory of a match.
+*/
+
+
+#define MATCH_DEFAULT_BUFFER_CAPACITY   256
+
+
+class GameClass;
+class ValueEngine;
+class EnvironmentClass;
+
+
+typedef struct _MatchSettings
+{
+	unsigned int            processBufferCapacity;  /* 0: MATCH_DEFAULT_BUFFER_CAPACITY */
+	int                     producerMode;
+	int                     overflowPolicy;
+	double                  replaySpeed;
+	int                     synchronous;
+	const RTModuleSettings *modules;                /* copied, the context of every module becomes the match */
+	int                     nofModules;
+	RTEventHandlerFunc      eventHandler;           /* its context is the match */
+	RTLiveSettings          live;
+	CVMarkerSettings        markers;                /* of TrackMarkers, all zero: the defaults */
+	void                   *userData;               /* GetUserData */
+} MatchSettings;
+
+
+typedef class MatchClass
+{
+public:
+	MatchClass();
+	~MatchClass();
+
+	static void DefaultSettings(MatchSettings* settings);
+
+	/*
+		Creates the components of the match on environment and starts its instance, name
+		is the name of its TIME_TICK thread. RT_RETURN_LIB_NOT_INITIALIZED if environment
+		is not sealed, RT_RETURN_SETTING_NOT_ALLOWED for more than RT_MAX_NOF_MODULES
+		modules, any RTInstanceCreate error.
+	*/
+	int Open(const char* name, const EnvironmentClass* environment, const MatchSettings* settings);
+
+	/* Handles what is left in the Process Buffer and destroys the components */
+	void Close();
+
+	/* The match of an instance. PRE: the instance is the one of a MatchClass. */
+	static MatchClass* FromInstance(RTEngineInstance instance);
+
+	RTEngineInstance GetInstance() const;
+	RTBus GetBus() const;
+	GameClass* GetGame() const;
+	ValueEngine* GetEngine() const;
+	const EnvironmentClass* GetEnvironment() const;
+	void* GetUserData() const;
+
+	/*
+		Recognises the icons of the slots of the match, patches[i] is the icon of slot i:
+		CVIndexClassifyCached of the shared index with the cache of the match.
+	*/
+	int ClassifyIcons(const CVImage* patches, int nofPatches, CVMatch* matches);
+
+	/*
+		Decodes the player markers of one frame of the minimap crop of the match, with
+		the tracker of the match: frames must come in video order, after a seek call
+		CVMarkerTrackerReset on GetMarkerTracker.
+	*/
+	int TrackMarkers(const CVImage* minimap, CVMarkerFrame* frame);
+	CVMarkerTracker GetMarkerTracker() const;
+
+private:
+	MatchClass(const MatchClass&);
+	MatchClass& operator=(const MatchClass&);
+
+	const EnvironmentClass *environment;
+	RTEngineInstance instance;
+	RTBus bus;
+	GameClass *game;
+	ValueEngine *engine;
+	CVIconCache icons;
+	CVMarkerTracker markers;
+	void *userData;
+	RTModuleSettings modules[RT_MAX_NOF_MODULES];
+
+}* Match;
+
+
+
+#endif // _Match_H_
@@ -0,0 +1,175 @@
+#ifndef _ParallelReplay_H_
+#define _ParallelReplay_H_
+
+
+#include <stddef.h>
+#include <vector>
+
+#include "RTEngine.h"
+#include "RTReplayLog.h"
+#include "RTEventList.h"
+#include "Timeline.h"
+#include "RTThreadPool.h"
+
+/*
+	ParallelReplayClass analyses one long replay on several cores. A straight run is
+	bound to one core: every record needs the state all records before it left behind.
+
+	Run reads the log once and splits it into segments of about the same number of
+	records, each starting at a sync point of the caller (a death, an objective) when it
+	gives one. A state pass then applies every record with the analysis switched off and
+	saves the GameClass, the Value Engine and the Event List at the start of every
+	segment (TimelineClass::SaveState). A segment is queued on a thread pool as soon as its
+	start is saved, so the workers analyse the first segments while the state pass is
+	still on its way to the last ones. Each worker analyses in a match of its own, restored
+	to the start of the segment; the outputs are appended in segment order, which is
+	timestamp order.
+
+	The state pass only pays for what carries from record to record; the analysis (the
+	values, the scores, whatever the output is made of) is what gets spread over the
+	cores. The values may be left dirty by the state pass: before every snapshot the
+	engine is brought up to date (ValueEngine::Tick), so the two passes save equal states.
+
+	Every segment boundary is validated: the state a segment ends in is compared with the
+	snapshot the next one started from. A segment that started from another state is
+	analysed again from the end of the one before it, so the output is the one of a
+	straight run. With verify set Run also makes the straight run and diffs the outputs.
+
+	PRE: the callbacks only change state kept in the three components of their match (or
+	in nothing kept across records), the matches are not subscribed to an RTBus.
+*/
+
+
+#define PARALLEL_REPLAY_SEGMENTS_PER_WORKER     4       /* default, leaves the pool room to balance */
+#define PARALLEL_REPLAY_MIN_RECORDS             256     /* fewest records of a segment */
+
+
+/* The components of one match of the analysis, engine and events may be NULL */
+typedef struct _ParallelReplayMatch
+{
+	GameClass      *game;
+	ValueEngine    *engine;
+	RTEventList     events;
+	void           *analysis;       /* context of analyse */
+} ParallelReplayMatch;
+
+
+/*
+	Applies one record to the match of analysis and appends what the analysis makes of it
+	to output. output is NULL in the state pass: only the state is changed then.
+	RT_RETURN_OK or the error that stops the run.
+*/
+typedef int (*ParallelReplayAnalyseFunc)(const char* payload, unsigned int size, double time, void* analysis,
+                                         std::vector<char>* output);
+
+typedef struct _ParallelReplayCallbacks
+{
+	/* Sets up a match like the one of a straight run (players added, engine bound), on the calling thread */
+	int (*create)(ParallelReplayMatch* match, void* context);
+	void (*destroy)(ParallelReplayMatch* match, void* context);
+	ParallelReplayAnalyseFunc analyse;
+	/* 1 if a segment may start at the record, NULL if any record will do */
+	int (*isSync)(const char* payload, unsigned int size, double time, void* context);
+	void *context;
+} ParallelReplayCallbacks;
+
+
+typedef struct _ParallelReplaySettings
+{
+	int             nofWorkers;         /* 0: one per core */
+	int             nofSegments;        /* 0: PARALLEL_REPLAY_SEGMENTS_PER_WORKER per worker */
+	int             verify;             /* 1: also run straight and diff the outputs */
+	unsigned int    logFlags;           /* RT_REPLAY_LOG_FLAG_*, FOLLOW is not allowed */
+} ParallelReplaySettings;
+
+
+enum parallelReplayVerified
+{
+	ParallelReplayNotVerified = -1,
+	ParallelReplayDiffers,
+	ParallelReplayIdentical
+};
+
+
+typedef struct _ParallelReplayStats
+{
+	unsigned long   nofRecords;
+	int             nofSegments;
+	int             nofWorkers;
+	unsigned long   nofSteals;
+	int             nofRerun;           /* segments analysed again, their start state was not the end of the one before */
+	size_t          outputBytes;
+	double          readSeconds;        /* log read and segments planned */
+	double          stateSeconds;       /* state pass with the snapshots */
+	double          segmentSeconds;     /* from the start of the state pass until the output is stitched */
+	double          straightSeconds;    /* straight run of verify, 0 without */
+	int             verified;           /* parallelReplayVerified */
+	size_t          firstDifference;    /* offset of the first output byte that differs */
+} ParallelReplayStats;
+
+
+typedef class ParallelReplayClass
+{
+public:
+	ParallelReplayClass();
+	~ParallelReplayClass();
+
+	static void DefaultSettings(ParallelReplaySettings* settings);
+
+	/*
+		Analyses the replay log at path, GetOutput is then the output of every record in
+		log order. When verify finds a difference the output is the one of the straight
+		run and stats->verified says so. RT_RETURN_SETTING_NOT_ALLOWED for a FOLLOW log,
+		any RTReplayLog, RTThreadPool and callback error.
+	*/
+	int Run(const char* path, const ParallelReplaySettings* settings, const ParallelReplayCallbacks* callbacks,
+	        ParallelReplayStats* stats);
+
+	/* Output of the last Run, valid until the next one */
+	const char* GetOutput(size_t* size) const;
+
+private:
+	ParallelReplayClass(const ParallelReplayClass&);
+	ParallelReplayClass& operator=(const ParallelReplayClass&);
+
+	typedef struct _Record
+	{
+		double          time;
+		const char     *data;
+		unsigned int    size;
+	} Record;
+
+	typedef struct _Segment
+	{
+		unsigned long           begin;      /* first record */
+		unsigned long           end;        /* after the last record */
+		TimelineSnapshot        start;      /* state before begin, from the state pass */
+		TimelineSnapshot        finish;     /* state after end, from the analysis of the segment */
+		std::vector<char>       output;
+		ParallelReplayClass    *owner;
+		int                     ret;
+	} Segment;
+
+	static void AnalyseSegment(void* taskData, int workerIndex);
+
+	void Plan(int nofSegments);
+	int StatePass(ParallelReplayMatch* match, RTThreadPool pool);
+	int Analyse(Segment* segment, ParallelReplayMatch* match, const TimelineSnapshot* from);
+	int Straight(ParallelReplayMatch* match, std::vector<char>* straight);
+	int CreateMatch(ParallelReplayMatch* match);
+	void DestroyMatch(ParallelReplayMatch* match);
+	void Clear();
+
+	const ParallelReplayCallbacks *callbacks;
+	RTReplayLog log;
+	std::vector<Record> records;
+	std::vector<Segment> segments;
+	/* one per worker, the segments a worker takes are analysed in its match */
+	std::vector<ParallelReplayMatch> matches;
+	std::vector<char> output;
+
+}* ParallelReplay;
+
+
+
+#endif // _ParallelReplay_H_
@@ -0,0 +1,46 @@
+#ifndef _Player_H_
+#define _Player_H_
+
+
+/*
+	PlayerClass is a view on one slot of the game state. It holds no state of its
+	own, every accessor reads or writes the arrays of its GameClass.
+*/
+
+
+class GameClass;
+
+/* Stable handle of a player in a match, see GameClass */
+typedef int GameEntity;
+
+
+typedef class PlayerClass
+{
+public:
+	PlayerClass();
+	~PlayerClass();
+
+	void Bind(GameClass* game, GameEntity entity);
+
+	GameEntity GetEntity() const;
+	int GetTeam() const;
+	int GetHeroId() const;
+	float GetHp() const;
+	float GetMaxHp() const;
+	int GetLevel() const;
+	int IsAlive() const;
+	void GetPosition(float* x, float* y) const;
+	float GetCooldown(int ability) const;
+
+	void SetHp(float hp);
+	void SetPosition(float x, float y);
+
+private:
+	GameClass *game;
+	GameEntity entity;
+
+}* Player;
+
+
+
+#endif // _Player_H_
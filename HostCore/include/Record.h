@@ -0,0 +1,46 @@
+#ifndef _Record_H_
+#define _Record_H_
+
+
+#include "RTEngine.h"
+#include "ValueEngine.h"
+
+/*
+	RecordClass reads the records of a replay log of ValueEngine events, the format of
+	the Batch DefaultModules and of the StormBench logs. The payload of a record (the
+	part after the time) is
+
+		<event> <entity> <target> <team> <amount>
+
+	event one of the instruction names of ValueEngine::ActionDetected, entity a player
+	slot, target a player slot or GAME_ENTITY_NONE. Parse turns it into a VEEvent and
+	ApplyGame makes the change of the event in the game, before the Value Engine reads it.
+	The host and the bench go through these two, so they apply a log the same way.
+*/
+
+
+/* longest payload Parse accepts, NUL included */
+#define RECORD_MAX_SIZE             128
+
+
+typedef class RecordClass
+{
+public:
+	/*
+		Parses the payload of a record, it need not be NUL terminated. The time of the
+		event is 0. RT_RETURN_ILLEGAL_DATA for an unknown event, a slot or team out of
+		range, or an event that changes its target (ValueEngine::HasTarget) without one.
+	*/
+	static int Parse(const char* payload, unsigned int size, VEEvent* event);
+
+	/* What the event changes in the game; nothing for a slot that holds no player */
+	static void ApplyGame(GameClass* game, const VEEvent* event);
+
+private:
+	RecordClass();
+
+}* Record;
+
+
+
+#endif // _Record_H_
@@ -0,0 +1,174 @@
+#ifndef _Timeline_H_
+#define _Timeline_H_
+
+
+#include <stddef.h>
+#include <vector>
+
+#include "RTEngine.h"
+#include "RTReplayLog.h"
+#include "RTEventList.h"
+
+/*
+	TimelineClass makes a replay log seekable: jump to any game time, step forward, or
+	step backward from the end (reverse-from-end analysis), with the GameClass, the Value
+	Engine and the Event List of the analysis always in the state they had at that point
+	of a straight run.
+
+	Open reads the log once, applies every record and on the way takes a snapshot of the
+	three components every interval game seconds (GameClass::SaveSnapshot,
+	ValueEngine::SaveSnapshot, RTEventListSave). A seek restores the last snapshot at or
+	before the target and applies the records from there, so it never applies more than
+	the records of one interval. The records are not copied: they stay passages into the
+	log, which is kept open until Close.
+
+	The snapshots together stay below maxBytes: when a new one goes over it every other
+	snapshot is dropped and the interval doubles, seeks get slower instead of the memory
+	growing. Stepping backward keeps a few scratch snapshots inside the current interval
+	(about the square root of its records apart), so a step back applies a few records,
+	not the whole interval.
+
+	The records are applied by the TimelineApplyFunc of the caller, the same function a
+	straight run uses, so a seek sees exactly the changes a straight run makes. It must
+	only change state kept in the three components (or in nothing kept across records).
+
+	PRE: the components are set up (players added, engine bound) before Open, and only
+	changed through the timeline until Close.
+*/
+
+
+/* Applies one record of the log, RT_RETURN_OK or the error that stops the timeline */
+typedef int (*TimelineApplyFunc)(const char* payload, unsigned int size, double time, void* context);
+
+
+#define TIMELINE_DEFAULT_INTERVAL       10.0                /* game seconds between snapshots */
+#define TIMELINE_DEFAULT_MAX_BYTES      (64 << 20)
+/* most scratch snapshots kept inside one interval when stepping backward */
+#define TIMELINE_MAX_SCRATCH            64
+
+
+typedef struct _TimelineSettings
+{
+	double          interval;           /* game seconds between snapshots */
+	size_t          maxBytes;           /* of all snapshots, the interval grows to stay below */
+	unsigned int    logFlags;           /* RT_REPLAY_LOG_FLAG_*, FOLLOW is not allowed */
+} TimelineSettings;
+
+
+/*
+	The state of the three components after position records: what the Timeline keeps every
+	interval, and what ParallelReplay starts a segment from. engine and events may be NULL.
+*/
+typedef struct _TimelineSnapshot
+{
+	unsigned long       position;
+	size_t              gameSize;
+	size_t              engineSize;
+	std::vector<char>   data;       /* game, engine, events */
+} TimelineSnapshot;
+
+
+typedef struct _TimelineStats
+{
+	int             nofSnapshots;
+	size_t          snapshotBytes;
+	double          interval;           /* may be larger than the one of the settings */
+	int             nofScratch;
+	size_t          scratchBytes;
+	unsigned long   nofRestores;        /* snapshots restored since Open */
+	unsigned long   nofApplied;         /* records applied since Open, not counting Open */
+} TimelineStats;
+
+
+class GameClass;
+class ValueEngine;
+
+
+typedef class TimelineClass
+{
+public:
+	TimelineClass();
+	~TimelineClass();
+
+	static void DefaultSettings(TimelineSettings* settings);
+
+	/*
+		Opens the log and reads it to its end, the timeline is then at the end of the log.
+		engine and events may be NULL when the analysis has none. RT_RETURN_SETTING_NOT_ALLOWED
+		for a FOLLOW log or an interval that is not positive, any RTReplayLog and apply error.
+	*/
+	int Open(const char* path, const TimelineSettings* settings, GameClass* game, ValueEngine* engine,
+	         RTEventList events, TimelineApplyFunc apply, void* context);
+	void Close();
+
+	/* To the last record at or before time, before the first record if there is none */
+	int Seek(double time);
+	/* To position: the first position records of the log applied, 0 .. GetNofRecords() */
+	int SeekRecord(unsigned long position);
+
+	/* Apply the next record, RT_RETURN_END_OF_LOG at the end */
+	int Next();
+	/* Take back the last record applied, RT_RETURN_END_OF_LOG at the start */
+	int Previous();
+
+	unsigned long GetPosition() const;
+	unsigned long GetNofRecords() const;
+	/* Game time of the last record applied, 0 at the start */
+	double GetTime() const;
+
+	void GetStats(TimelineStats* stats) const;
+
+	/* Snapshot of the components, RT_RETURN_INTERNAL_ERROR if one cannot be saved */
+	static int SaveState(const GameClass* game, const ValueEngine* engine, RTEventList events,
+	                     unsigned long position, TimelineSnapshot* snapshot);
+	/* Back into components set up like the ones saved, RT_RETURN_ILLEGAL_DATA for a broken snapshot */
+	static int RestoreState(const TimelineSnapshot* snapshot, GameClass* game, ValueEngine* engine, RTEventList events);
+
+private:
+	TimelineClass(const TimelineClass&);
+	TimelineClass& operator=(const TimelineClass&);
+
+	typedef struct _Record
+	{
+		double          time;
+		const char     *data;
+		unsigned int    size;
+	} Record;
+
+	typedef TimelineSnapshot Snapshot;
+
+	int Save(unsigned long position, Snapshot* snapshot);
+	int Restore(const Snapshot* snapshot);
+	int Apply(unsigned long position);
+	int ApplyTo(unsigned long target);
+	/* the last snapshot at or before position */
+	int Before(unsigned long position) const;
+	void Thin();
+
+	RTReplayLog log;
+	GameClass *game;
+	ValueEngine *engine;
+	RTEventList events;
+	TimelineApplyFunc apply;
+	void *context;
+
+	std::vector<Record> records;
+	std::vector<Snapshot> snapshots;
+	size_t snapshotBytes;
+	size_t maxBytes;
+	double interval;
+
+	/* scratch snapshots inside the interval of snapshot scratchOf, scratchStep records apart */
+	std::vector<Snapshot> scratch;
+	int scratchOf;
+	unsigned long scratchStep;
+
+	unsigned long position;
+	unsigned long nofRestores;
+	unsigned long nofApplied;
+
+}* Timeline;
+
+
+
+#endif // _Timeline_H_
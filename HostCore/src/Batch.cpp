@@ -0,0 +1,307 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "Batch.h"
+#include "Game.h"
+#include "Environment.h"
+#include "Match.h"
+#include "Record.h"
+#include "RTPassage.h"
+#include "RTReplayLog.h"
+#include "RTThreadPool.h"
+
+
+/* One replay on the pool */
+typedef struct _BatchTask
+{
+	const EnvironmentClass     *environment;
+	const RTModuleSettings     *modules;
+	int                         nofModules;
+	BatchReplayResult          *replay;
+} BatchTask;
+
+/* user data of the match of a replay with DefaultModules */
+typedef struct _BatchReplayState
+{
+	VEEvent             event;          /* of the record being handled: parsed by "parse", committed by "value" */
+	unsigned long       nofScored;
+} BatchReplayState;
+
+
+
+/*
+	Default modules. The instance of a replay is synchronous: "value" commits a record
+	before "parse" gets the next one, so the match keeps one event.
+*/
+
+static int ParseProcess(RTDataStruct* data, int moduleIndex, void* context)
+{
+	BatchReplayState *state = (BatchReplayState*)((MatchClass*)context)->GetUserData();
+	const RTPassageStruct *passage;
+
+	(void)moduleIndex;
+	if (data->nofpassages < 1)
+		return RT_RETURN_ILLEGAL_DATA;
+	passage = (const RTPassageStruct*)data->passages[0];
+	return RecordClass::Parse(passage->data, passage->size, &state->event);
+}
+
+
+static int ValueProcess(RTDataStruct* data, int moduleIndex, void* context)
+{
+	(void)data;
+	(void)moduleIndex;
+	(void)context;
+	return RT_RETURN_OK;
+}
+
+
+static void ValueCommit(RTDataStruct* data, int moduleIndex, void* context)
+{
+	MatchClass *match = (MatchClass*)context;
+	BatchReplayState *state = (BatchReplayState*)match->GetUserData();
+
+	if (data->haserror || data->moduleReturnValue[moduleIndex] != RT_RETURN_OK)
+		return;
+	state->event.time = data->timeStamp;
+	RecordClass::ApplyGame(match->GetGame(), &state->event);
+	if (match->GetEngine()->HandleEvent(&state->event) == DU_RETURN_OK)
+		state->nofScored++;
+	match->GetEngine()->Tick(state->event.time);
+}
+
+
+
+/*
+	Batch CLASS
+*/
+
+BatchClass::BatchClass()
+{
+	environment = NULL;
+}
+
+BatchClass::~BatchClass()
+{
+}
+
+
+int BatchClass::AddReplay(const char* path)
+{
+	BatchReplayResult replay;
+
+	if (path == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	memset(&replay, 0, sizeof(replay));
+	replay.path = path;
+	replays.push_back(replay);
+	return RT_RETURN_OK;
+}
+
+
+void BatchClass::SetEnvironment(const EnvironmentClass* env)
+{
+	environment = env;
+}
+
+
+int BatchClass::SetModules(const RTModuleSettings* table, int nofModules)
+{
+	if (nofModules < 0 || nofModules > RT_MAX_NOF_MODULES || (nofModules > 0 && table == NULL))
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	modules.assign(table, table + nofModules);
+	return RT_RETURN_OK;
+}
+
+
+int BatchClass::DefaultModules(RTModuleSettings* table)
+{
+	if (table == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	memset(table, 0, BATCH_NOF_DEFAULT_MODULES * sizeof(RTModuleSettings));
+	table[0].name = "parse";
+	table[0].inputs = RT_PRODUCT_BIT(RT_PRODUCT_PASSAGES);
+	table[0].outputs = RT_PRODUCT_BIT(RT_PRODUCT_REGISTER);
+	table[0].process = ParseProcess;
+	table[1].name = "value";
+	table[1].inputs = RT_PRODUCT_BIT(RT_PRODUCT_REGISTER);
+	table[1].outputs = RT_PRODUCT_BIT(RT_PRODUCT_MACRO_VALUE);
+	table[1].process = ValueProcess;
+	table[1].commit = ValueCommit;
+	return RT_RETURN_OK;
+}
+
+
+/*
+	One replay, start to end, in the calling worker. The match of the replay is created
+	here, nothing but the environment is shared with the other replays of the batch.
+*/
+void BatchClass::AnalyseReplay(void* taskData, int workerIndex)
+{
+	BatchTask *task = (BatchTask*)taskData;
+	BatchReplayResult *replay = task->replay;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	BatchReplayState state;
+	MatchSettings settings;
+	MatchClass match;
+	RTInstanceStats stats;
+	RTEngineInstance instance;
+	RTReplayLog log = NULL;
+	RTDataStruct *data;
+	GameEntity entity;
+	int team, i, ret;
+
+	(void)workerIndex;
+
+	memset(&state, 0, sizeof(state));
+	MatchClass::DefaultSettings(&settings);
+	settings.synchronous = 1;
+	settings.modules = task->modules;
+	settings.nofModules = task->nofModules;
+	settings.userData = &state;
+	ret = match.Open(NULL, task->environment, &settings);
+	for (team = 0; team < GAME_NOF_TEAMS && ret == RT_RETURN_OK; team++)
+	{
+		for (i = 0; i < GAME_PLAYERS_PER_TEAM && ret == RT_RETURN_OK; i++)
+			ret = (match.GetGame()->AddPlayer(team, team * GAME_PLAYERS_PER_TEAM + i, &entity) == DU_RETURN_OK)
+			      ? RT_RETURN_OK : RT_RETURN_INTERNAL_ERROR;
+	}
+	if (ret != RT_RETURN_OK)
+	{
+		replay->ret = ret;
+		return;
+	}
+	instance = match.GetInstance();
+
+	ret = RTReplayLogOpen(replay->path, 0, 0, &log);
+	if (ret == RT_RETURN_OK)
+	{
+		while ((ret = RTReplayLogReadData(log, instance, &data)) == RT_RETURN_OK)
+		{
+			ret = RTInstanceProcess(instance, data);
+			if (ret != RT_RETURN_OK)
+				break;
+		}
+		if (ret == RT_RETURN_END_OF_LOG)
+			ret = RT_RETURN_OK;
+	}
+
+	RTInstanceGetStats(instance, &stats);
+	match.GetEngine()->Tick(stats.gameTime);
+	for (i = 0; i < VE_NOF_NODES; i++)
+		replay->values[i] = match.GetEngine()->GetValue(i);
+	match.Close();
+	/* after the instance, its data referred to the log */
+	if (log != NULL)
+		RTReplayLogClose(log);
+
+	replay->ret = ret;
+	replay->nofEntries = stats.nofProcessed;
+	replay->nofTimedEvents = stats.nofEvents;
+	replay->nofScored = state.nofScored;
+	replay->gameTime = stats.gameTime;
+	replay->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+int BatchClass::Run(int nofWorkers, BatchThroughput* throughput)
+{
+	std::chrono::steady_clock::time_point start;
+	RTThreadPoolStats poolStats;
+	RTThreadPool pool;
+	RTModuleSettings defaults[BATCH_NOF_DEFAULT_MODULES];
+	EnvironmentClass latest;
+	std::vector<BatchTask> tasks(replays.size());
+	size_t i;
+	int ret;
+
+	if (throughput == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	memset(throughput, 0, sizeof(BatchThroughput));
+
+	if (environment == NULL)
+	{
+		ret = latest.Load(NULL);
+		if (ret == RT_RETURN_OK)
+			ret = latest.Seal();
+		if (ret != RT_RETURN_OK)
+			return ret;
+	}
+	DefaultModules(defaults);
+	for (i = 0; i < replays.size(); i++)
+	{
+		tasks[i].environment = (environment != NULL) ? environment : &latest;
+		tasks[i].modules = modules.empty() ? defaults : modules.data();
+		tasks[i].nofModules = modules.empty() ? BATCH_NOF_DEFAULT_MODULES : (int)modules.size();
+		tasks[i].replay = &replays[i];
+	}
+
+	ret = RTThreadPoolCreate(nofWorkers, "BATCH", &pool);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	start = std::chrono::steady_clock::now();
+	for (i = 0; i < replays.size(); i++)
+	{
+		ret = RTThreadPoolSubmit(pool, AnalyseReplay, &tasks[i]);
+		if (ret != RT_RETURN_OK)
+			replays[i].ret = ret;
+	}
+	RTThreadPoolWait(pool);
+	throughput->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	RTThreadPoolGetStats(pool, &poolStats);
+	RTThreadPoolDestroy(pool);
+
+	throughput->nofWorkers = poolStats.nofWorkers;
+	throughput->nofSteals = poolStats.nofSteals;
+	throughput->nofReplays = (int)replays.size();
+	for (i = 0; i < replays.size(); i++)
+	{
+		if (replays[i].ret != RT_RETURN_OK)
+			throughput->nofFailed++;
+		throughput->nofEntries += replays[i].nofEntries;
+		throughput->nofTimedEvents += replays[i].nofTimedEvents;
+		throughput->nofScored += replays[i].nofScored;
+	}
+	if (throughput->seconds > 0.0)
+	{
+		throughput->replaysPerSecond = throughput->nofReplays / throughput->seconds;
+		throughput->eventsPerSecond = throughput->nofEntries / throughput->seconds;
+	}
+	return RT_RETURN_OK;
+}
+
+
+int BatchClass::GetNofReplays() const
+{
+	return (int)replays.size();
+}
+
+
+const BatchReplayResult* BatchClass::GetResult(int index) const
+{
+	if (index < 0 || index >= (int)replays.size())
+		return NULL;
+	return &replays[index];
+}
+
+
+void BatchClass::PrintThroughput(FILE* f, const BatchThroughput* throughput)
+{
+	fprintf(f, "%d replays (%d failed) on %d workers in %.3f s\n",
+	        throughput->nofReplays, throughput->nofFailed, throughput->nofWorkers, throughput->seconds);
+	fprintf(f, "%.2f replays/s, %.0f events/s (%lu events, %lu scored, %lu timed events, %lu steals)\n",
+	        throughput->replaysPerSecond, throughput->eventsPerSecond,
+	        throughput->nofEntries, throughput->nofScored, throughput->nofTimedEvents, throughput->nofSteals);
+}
+
+
+
+
+/*
+	END OF Batch CLASS
+*/
@@ -0,0 +1,320 @@
+#include <string.h>
+
+#include "Game.h"
+
+/*
+	EntityIndex CLASS
+*/
+
+#define GAME_UNIT_TABLE_MASK        (GAME_UNIT_TABLE_SIZE - 1)
+#define ENTITY_INDEX_SNAPSHOT_MAGIC 0x544E4553u     /* "SENT" */
+
+
+/* Snapshot: the header, every handle handed out, the free list, the occupied table slots */
+typedef struct _EntityIndexSnapshotHeader
+{
+	unsigned int    magic;
+	unsigned int    size;           /* bytes of the snapshot */
+	int             nextUnit;
+	int             nofFree;
+	int             nofUnits;
+} EntityIndexSnapshotHeader;
+
+typedef struct _EntityIndexSnapshotUnit
+{
+	unsigned int    id;
+	GameEntity      owner;
+	int             kind;
+} EntityIndexSnapshotUnit;
+
+typedef struct _EntityIndexSnapshotSlot
+{
+	unsigned int    position;
+	unsigned int    id;
+	GameUnit        unit;
+} EntityIndexSnapshotSlot;
+
+
+EntityIndexClass::EntityIndexClass()
+{
+	Reset();
+}
+
+EntityIndexClass::~EntityIndexClass()
+{
+}
+
+
+void EntityIndexClass::Reset()
+{
+	int i;
+
+	for (i = 0; i < GAME_UNIT_TABLE_SIZE; i++)
+		table[i].unit = GAME_UNIT_NONE;
+	nofFree = 0;
+	nextUnit = 0;
+	nofUnits = 0;
+}
+
+
+/* Fibonacci hashing: consecutive ids, as the game hands them out, land far apart */
+unsigned int EntityIndexClass::Home(unsigned int unitId)
+{
+	return (unitId * 2654435769u) >> (32 - GAME_UNIT_TABLE_BITS);
+}
+
+
+int EntityIndexClass::Insert(unsigned int unitId, int kind, GameEntity owner, GameUnit* unit)
+{
+	unsigned int i;
+	GameUnit u;
+
+	if (unit == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	*unit = GAME_UNIT_NONE;
+	if (kind < 0 || kind >= GAME_NOF_UNIT_KINDS || unitId == GAME_UNIT_ID_NONE)
+		return DU_RETURN_ILLEGAL_ARGUMENT;
+
+	/* the table is never full, the probe ends in an empty slot */
+	for (i = Home(unitId); table[i].unit != GAME_UNIT_NONE; i = (i + 1) & GAME_UNIT_TABLE_MASK)
+	{
+		if (table[i].id == unitId)
+			return DU_RETURN_ILLEGAL_ARGUMENT;
+	}
+	if (nofUnits >= GAME_MAX_UNITS)
+		return DU_RETURN_ILLEGAL_SIZE;
+
+	u = (nofFree > 0) ? freeUnits[--nofFree] : nextUnit++;
+	table[i].id = unitId;
+	table[i].unit = u;
+	ids[u] = unitId;
+	owners[u] = owner;
+	kinds[u] = (unsigned char)kind;
+	nofUnits++;
+
+	*unit = u;
+	return DU_RETURN_OK;
+}
+
+
+int EntityIndexClass::Remove(unsigned int unitId)
+{
+	unsigned int i, j, home;
+
+	for (i = Home(unitId); table[i].unit != GAME_UNIT_NONE; i = (i + 1) & GAME_UNIT_TABLE_MASK)
+	{
+		if (table[i].id == unitId)
+			break;
+	}
+	if (table[i].unit == GAME_UNIT_NONE)
+		return DU_RETURN_NOT_FOUND;
+
+	freeUnits[nofFree++] = table[i].unit;
+	nofUnits--;
+
+	/* close the gap: an entry after it moves back unless its home lies between the gap and the entry */
+	for (j = (i + 1) & GAME_UNIT_TABLE_MASK; table[j].unit != GAME_UNIT_NONE; j = (j + 1) & GAME_UNIT_TABLE_MASK)
+	{
+		home = Home(table[j].id);
+		if (((j - home) & GAME_UNIT_TABLE_MASK) >= ((j - i) & GAME_UNIT_TABLE_MASK))
+		{
+			table[i] = table[j];
+			i = j;
+		}
+	}
+	table[i].unit = GAME_UNIT_NONE;
+	return DU_RETURN_OK;
+}
+
+
+GameUnit EntityIndexClass::Find(unsigned int unitId) const
+{
+	unsigned int i;
+
+	for (i = Home(unitId); table[i].unit != GAME_UNIT_NONE; i = (i + 1) & GAME_UNIT_TABLE_MASK)
+	{
+		if (table[i].id == unitId)
+			return table[i].unit;
+	}
+	return GAME_UNIT_NONE;
+}
+
+
+unsigned int EntityIndexClass::GetUnitId(GameUnit unit) const
+{
+	return (unit >= 0 && unit < nextUnit) ? ids[unit] : 0;
+}
+
+
+int EntityIndexClass::GetKind(GameUnit unit) const
+{
+	return (unit >= 0 && unit < nextUnit) ? kinds[unit] : -1;
+}
+
+
+GameEntity EntityIndexClass::GetOwner(GameUnit unit) const
+{
+	return (unit >= 0 && unit < nextUnit) ? owners[unit] : GAME_ENTITY_NONE;
+}
+
+
+int EntityIndexClass::GetNofUnits() const
+{
+	return nofUnits;
+}
+
+
+int EntityIndexClass::GetMaxProbes() const
+{
+	unsigned int i;
+	int probes, maxProbes = 0;
+
+	for (i = 0; i < GAME_UNIT_TABLE_SIZE; i++)
+	{
+		if (table[i].unit == GAME_UNIT_NONE)
+			continue;
+		probes = (int)((i - Home(table[i].id)) & GAME_UNIT_TABLE_MASK) + 1;
+		if (probes > maxProbes)
+			maxProbes = probes;
+	}
+	return maxProbes;
+}
+
+
+size_t EntityIndexClass::GetSnapshotSize() const
+{
+	return sizeof(EntityIndexSnapshotHeader) + nextUnit * sizeof(EntityIndexSnapshotUnit) +
+	       nofFree * sizeof(GameUnit) + nofUnits * sizeof(EntityIndexSnapshotSlot);
+}
+
+
+int EntityIndexClass::SaveSnapshot(void* buffer, size_t size, size_t* written) const
+{
+	EntityIndexSnapshotHeader *header = (EntityIndexSnapshotHeader*)buffer;
+	EntityIndexSnapshotUnit *units;
+	EntityIndexSnapshotSlot *slots;
+	GameUnit *removed;
+	size_t needed = GetSnapshotSize();
+	unsigned int i;
+	int u, n = 0;
+
+	if (written != NULL)
+		*written = 0;
+	if (buffer == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	if (size < needed)
+		return DU_RETURN_ILLEGAL_SIZE;
+
+	header->magic = ENTITY_INDEX_SNAPSHOT_MAGIC;
+	header->size = (unsigned int)needed;
+	header->nextUnit = nextUnit;
+	header->nofFree = nofFree;
+	header->nofUnits = nofUnits;
+
+	units = (EntityIndexSnapshotUnit*)(header + 1);
+	for (u = 0; u < nextUnit; u++)
+	{
+		units[u].id = ids[u];
+		units[u].owner = owners[u];
+		units[u].kind = kinds[u];
+	}
+
+	removed = (GameUnit*)(units + nextUnit);
+	for (u = 0; u < nofFree; u++)
+		removed[u] = freeUnits[u];
+
+	slots = (EntityIndexSnapshotSlot*)(removed + nofFree);
+	for (i = 0; i < GAME_UNIT_TABLE_SIZE; i++)
+	{
+		if (table[i].unit == GAME_UNIT_NONE)
+			continue;
+		slots[n].position = i;
+		slots[n].id = table[i].id;
+		slots[n].unit = table[i].unit;
+		n++;
+	}
+
+	if (written != NULL)
+		*written = needed;
+	return DU_RETURN_OK;
+}
+
+
+int EntityIndexClass::RestoreSnapshot(const void* buffer, size_t size)
+{
+	const EntityIndexSnapshotHeader *header = (const EntityIndexSnapshotHeader*)buffer;
+	const EntityIndexSnapshotUnit *units;
+	const EntityIndexSnapshotSlot *slots;
+	const GameUnit *removed;
+	unsigned char used[GAME_MAX_UNITS];         /* handle is free or in the table */
+	unsigned char taken[GAME_UNIT_TABLE_SIZE];
+	unsigned int i;
+	int u;
+
+	if (buffer == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	if (size < sizeof(EntityIndexSnapshotHeader) || header->magic != ENTITY_INDEX_SNAPSHOT_MAGIC ||
+		header->size > size ||
+		header->nextUnit < 0 || header->nextUnit > GAME_MAX_UNITS ||
+		header->nofFree < 0 || header->nofUnits < 0 || header->nofFree + header->nofUnits != header->nextUnit ||
+		header->size != sizeof(EntityIndexSnapshotHeader) + header->nextUnit * sizeof(EntityIndexSnapshotUnit) +
+		                header->nofFree * sizeof(GameUnit) + header->nofUnits * sizeof(EntityIndexSnapshotSlot))
+		return DU_RETURN_ILLEGAL_ARGUMENT;
+	units = (const EntityIndexSnapshotUnit*)(header + 1);
+	removed = (const GameUnit*)(units + header->nextUnit);
+	slots = (const EntityIndexSnapshotSlot*)(removed + header->nofFree);
+
+	/* every handle below nextUnit is either free or in one slot of the table, never both */
+	memset(used, 0, sizeof(used));
+	memset(taken, 0, sizeof(taken));
+	for (u = 0; u < header->nofFree; u++)
+	{
+		if (removed[u] < 0 || removed[u] >= header->nextUnit || used[removed[u]])
+			return DU_RETURN_ILLEGAL_ARGUMENT;
+		used[removed[u]] = 1;
+	}
+	for (u = 0; u < header->nofUnits; u++)
+	{
+		if (slots[u].position >= GAME_UNIT_TABLE_SIZE || taken[slots[u].position] ||
+			slots[u].unit < 0 || slots[u].unit >= header->nextUnit || used[slots[u].unit] ||
+			slots[u].id == GAME_UNIT_ID_NONE || slots[u].id != units[slots[u].unit].id)
+			return DU_RETURN_ILLEGAL_ARGUMENT;
+		used[slots[u].unit] = 1;
+		taken[slots[u].position] = 1;
+	}
+	/* and Find reaches it: no empty slot between its home and its position */
+	for (u = 0; u < header->nofUnits; u++)
+	{
+		for (i = Home(slots[u].id); i != slots[u].position; i = (i + 1) & GAME_UNIT_TABLE_MASK)
+		{
+			if (!taken[i])
+				return DU_RETURN_ILLEGAL_ARGUMENT;
+		}
+	}
+
+	Reset();
+	nextUnit = header->nextUnit;
+	nofFree = header->nofFree;
+	nofUnits = header->nofUnits;
+	for (u = 0; u < nextUnit; u++)
+	{
+		ids[u] = units[u].id;
+		owners[u] = units[u].owner;
+		kinds[u] = (unsigned char)units[u].kind;
+	}
+	for (u = 0; u < nofFree; u++)
+		freeUnits[u] = removed[u];
+	for (u = 0; u < nofUnits; u++)
+	{
+		table[slots[u].position].id = slots[u].id;
+		table[slots[u].position].unit = slots[u].unit;
+	}
+	return DU_RETURN_OK;
+}
+
+
+
+
+/*
+	END OF EntityIndex CLASS
+*/
@@ -0,0 +1,114 @@
+#include "Environment.h"
+
+/*
+	Environment CLASS
+*/
+
+EnvironmentClass::EnvironmentClass()
+{
+	patch = NULL;
+	index = NULL;
+	sealed = 0;
+}
+
+EnvironmentClass::~EnvironmentClass()
+{
+	if (index != NULL)
+		CVIndexDestroy(index);
+}
+
+
+int EnvironmentClass::Load(const char* patchVersion)
+{
+	const ENV_PatchStruct *found;
+	int ret;
+
+	if (sealed)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	found = (patchVersion != NULL) ? ENV_FindPatch(patchVersion) : ENV_LatestPatch();
+	if (found == NULL)
+		return RT_RETURN_NOT_FOUND;
+
+	if (index == NULL)
+	{
+		ret = CVIndexCreate(&index);
+		if (ret != RT_RETURN_OK)
+		{
+			index = NULL;
+			return ret;
+		}
+	}
+	patch = found;
+	return RT_RETURN_OK;
+}
+
+
+int EnvironmentClass::CheckOpen() const
+{
+	if (sealed)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	if (index == NULL)
+		return RT_RETURN_LIB_NOT_INITIALIZED;
+	return RT_RETURN_OK;
+}
+
+
+int EnvironmentClass::AddTemplate(int heroId, int skinId, const CVImage* image)
+{
+	int ret = CheckOpen();
+
+	if (ret != RT_RETURN_OK)
+		return ret;
+	return CVIndexAdd(index, heroId, skinId, image);
+}
+
+
+int EnvironmentClass::AddTemplateFile(int heroId, int skinId, const char* path)
+{
+	int ret = CheckOpen();
+
+	if (ret != RT_RETURN_OK)
+		return ret;
+	return CVIndexAddFile(index, heroId, skinId, path);
+}
+
+
+int EnvironmentClass::Seal()
+{
+	if (index == NULL)
+		return RT_RETURN_LIB_NOT_INITIALIZED;
+	sealed = 1;
+	return RT_RETURN_OK;
+}
+
+
+int EnvironmentClass::IsSealed() const
+{
+	return sealed;
+}
+
+
+const ENV_PatchStruct* EnvironmentClass::GetPatch() const
+{
+	return patch;
+}
+
+
+CVRecognitionIndex EnvironmentClass::GetRecognitionIndex() const
+{
+	return index;
+}
+
+
+size_t EnvironmentClass::GetModelBytes() const
+{
+	if (index == NULL)
+		return 0;
+	return (size_t)CVIndexGetNofTemplates(index) * CV_FEATURE_DIM * sizeof(float);
+}
+
+
+
+/*
+	END OF Environment CLASS
+*/
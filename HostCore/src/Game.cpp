@@ -1,4 +1,4 @@
-
+#include <string.h>
 
 #include "Game.h"
 
@@ -6,13 +6,394 @@
 	Game CLASS
 */
 
+#define GAME_SNAPSHOT_MAGIC         0x4D414753u     /* "SGAM" */
+/* longest patch version a snapshot holds, with its terminator */
+#define GAME_SNAPSHOT_PATCH_LENGTH  16
+
+/* Snapshot: the header, then the snapshot of the units. The patch is kept by its
+   version and found again with ENV_FindPatch. */
+typedef struct _GameSnapshotHeader
+{
+	unsigned int            magic;
+	unsigned int            size;       /* bytes of the snapshot, the units included */
+	char                    patch[GAME_SNAPSHOT_PATCH_LENGTH];
+	GameState               state;
+} GameSnapshotHeader;
+
+
 GameClass::GameClass()
 
 {
+	PlayersTeamBlue = NULL;
+	PlayersTeamRed = NULL;
+	patch = ENV_LatestPatch();
+	DuListCreate(&PlayersTeamBlue);
+	DuListCreate(&PlayersTeamRed);
+	Reset();
 }
 
 GameClass::~GameClass()
 {
+	if (PlayersTeamBlue != NULL)
+		DuListDestroy(PlayersTeamBlue);
+	if (PlayersTeamRed != NULL)
+		DuListDestroy(PlayersTeamRed);
+}
+
+
+void GameClass::Reset()
+{
+	void *data;
+	int e;
+
+	memset(&state, 0, sizeof(state));
+	units.Reset();
+	for (e = 0; e < GAME_NOF_SLOTS; e++)
+	{
+		state.heroId[e] = GAME_HERO_NONE;
+		players[e].Bind(this, e);
+	}
+
+	/* the views are owned by the game, only the list nodes go */
+	while (PlayersTeamBlue != NULL && DuListGetFirst(PlayersTeamBlue, &data) == DU_RETURN_OK)
+		DuListRemoveElement(PlayersTeamBlue, data);
+	while (PlayersTeamRed != NULL && DuListGetFirst(PlayersTeamRed, &data) == DU_RETURN_OK)
+		DuListRemoveElement(PlayersTeamRed, data);
+}
+
+
+int GameClass::SetPatch(const char* version)
+{
+	const ENV_PatchStruct *found = ENV_FindPatch(version);
+
+	if (found == NULL)
+		return DU_RETURN_NOT_FOUND;
+	patch = found;
+	return DU_RETURN_OK;
+}
+
+
+const ENV_PatchStruct* GameClass::GetPatch() const
+{
+	return patch;
+}
+
+
+int GameClass::AddPlayer(int team, int heroId, GameEntity* entity)
+{
+	DuList list;
+	GameEntity e;
+	int ret;
+
+	if (entity == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	*entity = GAME_ENTITY_NONE;
+	if (team != GameTeamBlue && team != GameTeamRed)
+		return DU_RETURN_ILLEGAL_ARGUMENT;
+	if (state.teamNofPlayers[team] >= GAME_PLAYERS_PER_TEAM)
+		return DU_RETURN_ILLEGAL_INDEX;
+
+	e = TeamBegin(team) + state.teamNofPlayers[team];
+	list = GetPlayers(team);
+	if (list != NULL)
+	{
+		ret = DuListAppendElement(list, &players[e]);
+		if (ret != DU_RETURN_OK)
+			return ret;
+	}
+
+	state.used[e] = 1;
+	state.heroId[e] = heroId;
+	state.alive[e] = 1;
+	state.level[e] = 1;
+	if (heroId >= 0 && heroId < ENV_NOF_HEROES && patch->heroes[heroId].available)
+	{
+		state.hp[e] = state.maxHp[e] = patch->heroes[heroId].maxHp;
+		state.teamHp[team] += state.hp[e];
+		state.teamMaxHp[team] += state.maxHp[e];
+	}
+	state.teamNofPlayers[team]++;
+	state.teamNofAlive[team]++;
+	UpdateTeamLevel(team);
+	state.version++;
+
+	*entity = e;
+	return DU_RETURN_OK;
+}
+
+
+int GameClass::SetHero(GameEntity entity, int heroId)
+{
+	if (!IsValidEntity(entity))
+		return DU_RETURN_ILLEGAL_INDEX;
+	state.heroId[entity] = heroId;
+	state.version++;
+	return DU_RETURN_OK;
+}
+
+
+int GameClass::SetHp(GameEntity entity, float hp, float maxHp)
+{
+	int team;
+
+	if (!IsValidEntity(entity))
+		return DU_RETURN_ILLEGAL_INDEX;
+
+	team = TeamOf(entity);
+	state.teamHp[team] += hp - state.hp[entity];
+	state.teamMaxHp[team] += maxHp - state.maxHp[entity];
+	state.hp[entity] = hp;
+	state.maxHp[entity] = maxHp;
+	state.version++;
+	return DU_RETURN_OK;
+}
+
+
+int GameClass::SetPosition(GameEntity entity, float x, float y)
+{
+	if (!IsValidEntity(entity))
+		return DU_RETURN_ILLEGAL_INDEX;
+	state.posX[entity] = x;
+	state.posY[entity] = y;
+	state.version++;
+	return DU_RETURN_OK;
+}
+
+
+int GameClass::SetLevel(GameEntity entity, int level)
+{
+	if (!IsValidEntity(entity))
+		return DU_RETURN_ILLEGAL_INDEX;
+	state.level[entity] = level;
+	UpdateTeamLevel(TeamOf(entity));
+	state.version++;
+	return DU_RETURN_OK;
+}
+
+
+int GameClass::SetAlive(GameEntity entity, int alive)
+{
+	alive = (alive != 0);
+	if (!IsValidEntity(entity))
+		return DU_RETURN_ILLEGAL_INDEX;
+	if (state.alive[entity] != alive)
+	{
+		state.teamNofAlive[TeamOf(entity)] += alive ? 1 : -1;
+		state.alive[entity] = (unsigned char)alive;
+		state.version++;
+	}
+	return DU_RETURN_OK;
+}
+
+
+int GameClass::SetCooldown(GameEntity entity, int ability, float seconds)
+{
+	if (!IsValidEntity(entity))
+		return DU_RETURN_ILLEGAL_INDEX;
+	if (ability < 0 || ability >= GAME_NOF_ABILITIES)
+		return DU_RETURN_ILLEGAL_ARGUMENT;
+	state.cooldown[ability][entity] = seconds;
+	state.version++;
+	return DU_RETURN_OK;
+}
+
+
+void GameClass::AdvanceCooldowns(float seconds)
+{
+	float *cooldown = &state.cooldown[0][0];
+	int i;
+
+	/* one pass over the whole block, empty slots stay at 0 */
+	for (i = 0; i < GAME_NOF_ABILITIES * GAME_NOF_SLOTS; i++)
+	{
+		cooldown[i] -= seconds;
+		if (cooldown[i] < 0.0f)
+			cooldown[i] = 0.0f;
+	}
+	state.version++;
+}
+
+
+int GameClass::IsValidEntity(GameEntity entity) const
+{
+	return entity >= 0 && entity < GAME_NOF_SLOTS && state.used[entity];
+}
+
+
+Player GameClass::GetPlayer(GameEntity entity)
+{
+	return IsValidEntity(entity) ? &players[entity] : NULL;
+}
+
+
+DuList GameClass::GetPlayers(int team)
+{
+	if (team == GameTeamBlue)
+		return PlayersTeamBlue;
+	if (team == GameTeamRed)
+		return PlayersTeamRed;
+	return NULL;
+}
+
+
+const GameState* GameClass::GetState() const
+{
+	return &state;
+}
+
+
+GameEntity GameClass::TeamBegin(int team)
+{
+	return team * GAME_PLAYERS_PER_TEAM;
+}
+
+
+GameEntity GameClass::TeamEnd(int team)
+{
+	return (team + 1) * GAME_PLAYERS_PER_TEAM;
+}
+
+
+int GameClass::TeamOf(GameEntity entity)
+{
+	return entity / GAME_PLAYERS_PER_TEAM;
+}
+
+
+void GameClass::Iterate(int team, GameEntityIterator fun, void* context) const
+{
+	GameEntity begin = (team < 0) ? 0 : TeamBegin(team);
+	GameEntity end = (team < 0) ? GAME_NOF_SLOTS : TeamEnd(team);
+	GameEntity e;
+
+	for (e = begin; e < end; e++)
+	{
+		if (state.used[e])
+			fun(&state, e, context);
+	}
+}
+
+
+int GameClass::AddUnit(unsigned int unitId, int kind, GameEntity owner, GameUnit* unit)
+{
+	if (owner != GAME_ENTITY_NONE && !IsValidEntity(owner))
+	{
+		if (unit != NULL)
+			*unit = GAME_UNIT_NONE;
+		return DU_RETURN_ILLEGAL_INDEX;
+	}
+	return units.Insert(unitId, kind, owner, unit);
+}
+
+
+int GameClass::RemoveUnit(unsigned int unitId)
+{
+	return units.Remove(unitId);
+}
+
+
+GameEntity GameClass::ResolveUnit(unsigned int unitId) const
+{
+	return units.GetOwner(units.Find(unitId));
+}
+
+
+const EntityIndexClass* GameClass::GetUnits() const
+{
+	return &units;
+}
+
+
+size_t GameClass::GetSnapshotSize() const
+{
+	return sizeof(GameSnapshotHeader) + units.GetSnapshotSize();
+}
+
+
+int GameClass::SaveSnapshot(void* buffer, size_t size, size_t* written) const
+{
+	GameSnapshotHeader *header = (GameSnapshotHeader*)buffer;
+	size_t unitsWritten;
+	int ret;
+
+	if (written != NULL)
+		*written = 0;
+	if (buffer == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	if (size < GetSnapshotSize())
+		return DU_RETURN_ILLEGAL_SIZE;
+	if (strlen(patch->version) >= GAME_SNAPSHOT_PATCH_LENGTH)
+		return DU_RETURN_ILLEGAL_ARGUMENT;
+
+	ret = units.SaveSnapshot(header + 1, size - sizeof(GameSnapshotHeader), &unitsWritten);
+	if (ret != DU_RETURN_OK)
+		return ret;
+	header->magic = GAME_SNAPSHOT_MAGIC;
+	header->size = (unsigned int)(sizeof(GameSnapshotHeader) + unitsWritten);
+	memset(header->patch, 0, sizeof(header->patch));
+	strcpy(header->patch, patch->version);
+	header->state = state;
+
+	if (written != NULL)
+		*written = sizeof(GameSnapshotHeader) + unitsWritten;
+	return DU_RETURN_OK;
+}
+
+
+int GameClass::RestoreSnapshot(const void* buffer, size_t size)
+{
+	const GameSnapshotHeader *header = (const GameSnapshotHeader*)buffer;
+	const ENV_PatchStruct *restored;
+	DuList list;
+	void *data;
+	GameEntity e;
+	int team, ret;
+
+	if (buffer == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	if (size < sizeof(GameSnapshotHeader) || header->magic != GAME_SNAPSHOT_MAGIC ||
+		header->size < sizeof(GameSnapshotHeader) || header->size > size ||
+		memchr(header->patch, 0, sizeof(header->patch)) == NULL)
+		return DU_RETURN_ILLEGAL_ARGUMENT;
+	restored = ENV_FindPatch(header->patch);
+	if (restored == NULL)
+		return DU_RETURN_ILLEGAL_ARGUMENT;
+	ret = units.RestoreSnapshot(header + 1, header->size - sizeof(GameSnapshotHeader));
+	if (ret != DU_RETURN_OK)
+		return ret;
+
+	state = header->state;
+	patch = restored;
+
+	/* AddPlayer fills the slots of a team in order, the lists list them in that order */
+	for (team = 0; team < GAME_NOF_TEAMS; team++)
+	{
+		list = GetPlayers(team);
+		if (list == NULL)
+			continue;
+		while (DuListGetFirst(list, &data) == DU_RETURN_OK)
+			DuListRemoveElement(list, data);
+		for (e = TeamBegin(team); e < TeamEnd(team); e++)
+		{
+			if (state.used[e])
+				DuListAppendElement(list, &players[e]);
+		}
+	}
+	return DU_RETURN_OK;
+}
+
+
+void GameClass::UpdateTeamLevel(int team)
+{
+	GameEntity e;
+	int level = 0;
+
+	for (e = TeamBegin(team); e < TeamEnd(team); e++)
+	{
+		if (state.used[e] && state.level[e] > level)
+			level = state.level[e];
+	}
+	state.teamLevel[team] = level;
 }
 
 
@@ -0,0 +1,229 @@
+#include <string.h>
+#include <new>
+
+#include "Match.h"
+#include "Environment.h"
+#include "Game.h"
+#include "ValueEngine.h"
+
+/*
+	Match CLASS
+*/
+
+MatchClass::MatchClass()
+{
+	environment = NULL;
+	instance = NULL;
+	bus = NULL;
+	game = NULL;
+	engine = NULL;
+	icons = NULL;
+	markers = NULL;
+	userData = NULL;
+	memset(modules, 0, sizeof(modules));
+}
+
+MatchClass::~MatchClass()
+{
+	Close();
+}
+
+
+void MatchClass::DefaultSettings(MatchSettings* settings)
+{
+	if (settings == NULL)
+		return;
+	memset(settings, 0, sizeof(MatchSettings));
+	settings->processBufferCapacity = MATCH_DEFAULT_BUFFER_CAPACITY;
+}
+
+
+int MatchClass::Open(const char* name, const EnvironmentClass* env, const MatchSettings* settings)
+{
+	RTInstanceSettings instanceSettings;
+	MatchSettings defaults;
+	int i, ret;
+
+	Close();
+	if (env == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (!env->IsSealed())
+		return RT_RETURN_LIB_NOT_INITIALIZED;
+	if (settings == NULL)
+	{
+		DefaultSettings(&defaults);
+		settings = &defaults;
+	}
+	if (settings->nofModules < 0 || settings->nofModules > RT_MAX_NOF_MODULES ||
+		(settings->nofModules > 0 && settings->modules == NULL))
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	environment = env;
+	userData = settings->userData;
+
+	game = new (std::nothrow) GameClass();
+	engine = new (std::nothrow) ValueEngine();
+	if (game == NULL || engine == NULL)
+	{
+		Close();
+		return RT_RETURN_OUT_OF_MEMORY;
+	}
+	if (game->SetPatch(env->GetPatch()->version) != DU_RETURN_OK)
+	{
+		Close();
+		return RT_RETURN_NOT_FOUND;
+	}
+	engine->Bind(game);
+
+	ret = RTBusCreate(&bus);
+	if (ret != RT_RETURN_OK)
+	{
+		bus = NULL;
+		Close();
+		return ret;
+	}
+	if (engine->Subscribe(bus) != DU_RETURN_OK)
+	{
+		Close();
+		return RT_RETURN_INTERNAL_ERROR;
+	}
+	ret = CVIconCacheCreate(GAME_NOF_SLOTS, &icons);
+	if (ret != RT_RETURN_OK)
+	{
+		icons = NULL;
+		Close();
+		return ret;
+	}
+	ret = CVMarkerTrackerCreate(&settings->markers, &markers);
+	if (ret != RT_RETURN_OK)
+	{
+		markers = NULL;
+		Close();
+		return ret;
+	}
+
+	for (i = 0; i < settings->nofModules; i++)
+	{
+		modules[i] = settings->modules[i];
+		modules[i].context = this;
+	}
+	memset(&instanceSettings, 0, sizeof(instanceSettings));
+	instanceSettings.processBufferCapacity = (settings->processBufferCapacity != 0) ? settings->processBufferCapacity
+	                                                                                : MATCH_DEFAULT_BUFFER_CAPACITY;
+	instanceSettings.producerMode = settings->producerMode;
+	instanceSettings.overflowPolicy = settings->overflowPolicy;
+	instanceSettings.replaySpeed = settings->replaySpeed;
+	instanceSettings.synchronous = settings->synchronous;
+	instanceSettings.eventHandler = settings->eventHandler;
+	instanceSettings.eventHandlerContext = this;
+	instanceSettings.bus = bus;
+	instanceSettings.modules = modules;
+	instanceSettings.nofModules = settings->nofModules;
+	instanceSettings.live = settings->live;
+	instanceSettings.valueEngine = engine;
+	instanceSettings.matchContext = this;
+	ret = RTInstanceCreate(name, &instanceSettings, &instance);
+	if (ret != RT_RETURN_OK)
+	{
+		instance = NULL;
+		Close();
+		return ret;
+	}
+	return RT_RETURN_OK;
+}
+
+
+void MatchClass::Close()
+{
+	/* the instance first, its TIME_TICK thread still commits into the game and the engine */
+	if (instance != NULL)
+		RTInstanceDestroy(instance);
+	instance = NULL;
+	if (engine != NULL)
+		engine->Subscribe(NULL);
+	if (bus != NULL)
+		RTBusDestroy(bus);
+	bus = NULL;
+	if (icons != NULL)
+		CVIconCacheDestroy(icons);
+	icons = NULL;
+	if (markers != NULL)
+		CVMarkerTrackerDestroy(markers);
+	markers = NULL;
+	delete engine;
+	engine = NULL;
+	delete game;
+	game = NULL;
+	environment = NULL;
+	userData = NULL;
+	memset(modules, 0, sizeof(modules));
+}
+
+
+MatchClass* MatchClass::FromInstance(RTEngineInstance inst)
+{
+	return (MatchClass*)RTInstanceGetMatchContext(inst);
+}
+
+
+RTEngineInstance MatchClass::GetInstance() const
+{
+	return instance;
+}
+
+
+RTBus MatchClass::GetBus() const
+{
+	return bus;
+}
+
+
+GameClass* MatchClass::GetGame() const
+{
+	return game;
+}
+
+
+ValueEngine* MatchClass::GetEngine() const
+{
+	return engine;
+}
+
+
+const EnvironmentClass* MatchClass::GetEnvironment() const
+{
+	return environment;
+}
+
+
+void* MatchClass::GetUserData() const
+{
+	return userData;
+}
+
+
+int MatchClass::ClassifyIcons(const CVImage* patches, int nofPatches, CVMatch* matches)
+{
+	if (environment == NULL)
+		return RT_RETURN_LIB_NOT_INITIALIZED;
+	return CVIndexClassifyCached(environment->GetRecognitionIndex(), icons, patches, nofPatches, matches);
+}
+
+
+int MatchClass::TrackMarkers(const CVImage* minimap, CVMarkerFrame* frame)
+{
+	if (markers == NULL)
+		return RT_RETURN_LIB_NOT_INITIALIZED;
+	return CVMarkerDecode(markers, minimap, frame);
+}
+
+
+CVMarkerTracker MatchClass::GetMarkerTracker() const
+{
+	return markers;
+}
+
+
+
+/*
+	END OF Match CLASS
+*/
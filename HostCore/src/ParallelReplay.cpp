@@ -0,0 +1,353 @@
+#include <string.h>
+#include <chrono>
+
+#include "ParallelReplay.h"
+#include "Game.h"
+#include "ValueEngine.h"
+#include "RTThreadPool.h"
+
+/*
+	ParallelReplay CLASS
+*/
+
+ParallelReplayClass::ParallelReplayClass()
+{
+	callbacks = NULL;
+	log = NULL;
+}
+
+ParallelReplayClass::~ParallelReplayClass()
+{
+	Clear();
+}
+
+
+void ParallelReplayClass::DefaultSettings(ParallelReplaySettings* settings)
+{
+	if (settings == NULL)
+		return;
+	settings->nofWorkers = 0;
+	settings->nofSegments = 0;
+	settings->verify = 0;
+	settings->logFlags = 0;
+}
+
+
+void ParallelReplayClass::Clear()
+{
+	size_t i;
+
+	for (i = 0; i < matches.size(); i++)
+		DestroyMatch(&matches[i]);
+	matches.clear();
+	segments.clear();
+	records.clear();
+	if (log != NULL)
+		RTReplayLogClose(log);
+	log = NULL;
+	callbacks = NULL;
+}
+
+
+int ParallelReplayClass::CreateMatch(ParallelReplayMatch* match)
+{
+	int ret;
+
+	memset(match, 0, sizeof(ParallelReplayMatch));
+	ret = callbacks->create(match, callbacks->context);
+	if (ret == RT_RETURN_OK && match->game == NULL)
+		ret = RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (ret != RT_RETURN_OK)
+		DestroyMatch(match);
+	return ret;
+}
+
+
+void ParallelReplayClass::DestroyMatch(ParallelReplayMatch* match)
+{
+	if (callbacks != NULL && callbacks->destroy != NULL)
+		callbacks->destroy(match, callbacks->context);
+	memset(match, 0, sizeof(ParallelReplayMatch));
+}
+
+
+/* Tick first: the state pass leaves the values dirty, a segment does not */
+static int SaveMatch(ParallelReplayMatch* match, double time, unsigned long position, TimelineSnapshot* snapshot)
+{
+	if (match->engine != NULL)
+		match->engine->Tick(time);
+	return TimelineClass::SaveState(match->game, match->engine, match->events, position, snapshot);
+}
+
+
+/*
+	Segment i starts at the first record at or after i * nofRecords / nofSegments where
+	isSync agrees. A segment left with no records is dropped.
+*/
+void ParallelReplayClass::Plan(int nofSegments)
+{
+	unsigned long nofRecords = (unsigned long)records.size(), begin = 0, target;
+	const Record *record;
+	int i;
+
+	segments.clear();
+	if (nofSegments < 1)
+		nofSegments = 1;
+	if ((unsigned long)nofSegments > nofRecords / PARALLEL_REPLAY_MIN_RECORDS)
+		nofSegments = (nofRecords / PARALLEL_REPLAY_MIN_RECORDS > 0) ? (int)(nofRecords / PARALLEL_REPLAY_MIN_RECORDS) : 1;
+
+	for (i = 1; i <= nofSegments; i++)
+	{
+		target = (i == nofSegments) ? nofRecords : (unsigned long)((unsigned long long)nofRecords * i / nofSegments);
+		if (target <= begin)
+			continue;
+		if (callbacks->isSync != NULL)
+		{
+			for (; target < nofRecords; target++)
+			{
+				record = &records[target];
+				if (callbacks->isSync(record->data, record->size, record->time, callbacks->context))
+					break;
+			}
+		}
+		segments.push_back(Segment());
+		segments.back().begin = begin;
+		segments.back().end = target;
+		segments.back().owner = this;
+		segments.back().ret = RT_RETURN_OK;
+		begin = target;
+		if (begin >= nofRecords)
+			break;
+	}
+}
+
+
+/*
+	Applies every record without output. The start of every segment is saved on the way
+	and the segment queued right away, its analysis overlaps the rest of the pass.
+*/
+int ParallelReplayClass::StatePass(ParallelReplayMatch* match, RTThreadPool pool)
+{
+	unsigned long r = 0;
+	size_t s;
+	int ret;
+
+	for (s = 0; s < segments.size(); s++)
+	{
+		ret = SaveMatch(match, (r > 0) ? records[r - 1].time : 0.0, r, &segments[s].start);
+		if (ret != RT_RETURN_OK)
+			return ret;
+		ret = RTThreadPoolSubmit(pool, AnalyseSegment, &segments[s]);
+		if (ret != RT_RETURN_OK)
+			return ret;
+		for (; r < segments[s].end; r++)
+		{
+			ret = callbacks->analyse(records[r].data, records[r].size, records[r].time, match->analysis, NULL);
+			if (ret != RT_RETURN_OK)
+				return ret;
+		}
+	}
+	return RT_RETURN_OK;
+}
+
+
+/* The records of segment from the state from, into its output and finish */
+int ParallelReplayClass::Analyse(Segment* segment, ParallelReplayMatch* match, const TimelineSnapshot* from)
+{
+	unsigned long r;
+	int ret;
+
+	segment->output.clear();
+	ret = TimelineClass::RestoreState(from, match->game, match->engine, match->events);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	for (r = segment->begin; r < segment->end; r++)
+	{
+		ret = callbacks->analyse(records[r].data, records[r].size, records[r].time, match->analysis, &segment->output);
+		if (ret != RT_RETURN_OK)
+			return ret;
+	}
+	return SaveMatch(match, (r > 0) ? records[r - 1].time : 0.0, r, &segment->finish);
+}
+
+
+void ParallelReplayClass::AnalyseSegment(void* taskData, int workerIndex)
+{
+	Segment *segment = (Segment*)taskData;
+	ParallelReplayClass *owner = segment->owner;
+
+	segment->ret = owner->Analyse(segment, &owner->matches[workerIndex], &segment->start);
+}
+
+
+int ParallelReplayClass::Straight(ParallelReplayMatch* match, std::vector<char>* straight)
+{
+	size_t r;
+	int ret;
+
+	straight->clear();
+	for (r = 0; r < records.size(); r++)
+	{
+		ret = callbacks->analyse(records[r].data, records[r].size, records[r].time, match->analysis, straight);
+		if (ret != RT_RETURN_OK)
+			return ret;
+	}
+	return RT_RETURN_OK;
+}
+
+
+int ParallelReplayClass::Run(const char* path, const ParallelReplaySettings* settings,
+                             const ParallelReplayCallbacks* cb, ParallelReplayStats* stats)
+{
+	std::chrono::steady_clock::time_point start;
+	ParallelReplaySettings defaults;
+	ParallelReplayMatch *state, straightMatch;
+	RTThreadPoolStats poolStats;
+	RTThreadPool pool;
+	std::vector<char> straight;
+	RTPassage passage;
+	Record record;
+	size_t s, n;
+	int nofWorkers, i, ret;
+
+	Clear();
+	output.clear();
+	if (path == NULL || cb == NULL || stats == NULL || cb->create == NULL || cb->analyse == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	memset(stats, 0, sizeof(ParallelReplayStats));
+	stats->verified = ParallelReplayNotVerified;
+	if (settings == NULL)
+	{
+		DefaultSettings(&defaults);
+		settings = &defaults;
+	}
+	if ((settings->logFlags & RT_REPLAY_LOG_FLAG_FOLLOW) != 0)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	callbacks = cb;
+
+	/* the records stay passages into the log, it is open until Clear */
+	start = std::chrono::steady_clock::now();
+	ret = RTReplayLogOpen(path, 0, settings->logFlags, &log);
+	if (ret != RT_RETURN_OK)
+	{
+		log = NULL;
+		Clear();
+		return ret;
+	}
+	while ((ret = RTReplayLogNext(log, &passage, &record.time)) == RT_RETURN_OK)
+	{
+		record.data = passage->data;
+		record.size = passage->size;
+		records.push_back(record);
+	}
+	if (ret != RT_RETURN_END_OF_LOG)
+	{
+		Clear();
+		return ret;
+	}
+
+	ret = RTThreadPoolCreate(settings->nofWorkers, "SEGMENT", &pool);
+	if (ret != RT_RETURN_OK)
+	{
+		Clear();
+		return ret;
+	}
+	nofWorkers = RTThreadPoolGetNofWorkers(pool);
+	Plan((settings->nofSegments > 0) ? settings->nofSegments : nofWorkers * PARALLEL_REPLAY_SEGMENTS_PER_WORKER);
+	stats->readSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	/* the matches are created here, the callbacks need not be thread safe */
+	matches.resize(nofWorkers + 1);
+	for (i = 0; i < (int)matches.size() && ret == RT_RETURN_OK; i++)
+		ret = CreateMatch(&matches[i]);
+	if (ret != RT_RETURN_OK)
+	{
+		matches.resize(i - 1);
+		RTThreadPoolDestroy(pool);
+		Clear();
+		return ret;
+	}
+	/* the last one is not a worker's: state pass and segments analysed again */
+	state = &matches.back();
+
+	start = std::chrono::steady_clock::now();
+	ret = StatePass(state, pool);
+	stats->stateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	RTThreadPoolWait(pool);
+	RTThreadPoolGetStats(pool, &poolStats);
+	RTThreadPoolDestroy(pool);
+	if (ret != RT_RETURN_OK)
+	{
+		Clear();
+		return ret;
+	}
+
+	/* boundaries in order: a segment that started elsewhere than the one before ended runs again from there */
+	for (s = 0; s < segments.size() && ret == RT_RETURN_OK; s++)
+	{
+		ret = segments[s].ret;
+		if (ret != RT_RETURN_OK || s == 0)
+			continue;
+		if (segments[s].start.data != segments[s - 1].finish.data)
+		{
+			ret = Analyse(&segments[s], state, &segments[s - 1].finish);
+			stats->nofRerun++;
+		}
+	}
+	if (ret != RT_RETURN_OK)
+	{
+		Clear();
+		return ret;
+	}
+	for (s = 0, n = 0; s < segments.size(); s++)
+		n += segments[s].output.size();
+	output.reserve(n);
+	for (s = 0; s < segments.size(); s++)
+		output.insert(output.end(), segments[s].output.begin(), segments[s].output.end());
+	stats->segmentSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (settings->verify)
+	{
+		start = std::chrono::steady_clock::now();
+		ret = CreateMatch(&straightMatch);
+		if (ret == RT_RETURN_OK)
+		{
+			ret = Straight(&straightMatch, &straight);
+			DestroyMatch(&straightMatch);
+		}
+		stats->straightSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (ret != RT_RETURN_OK)
+		{
+			Clear();
+			return ret;
+		}
+		for (n = 0; n < output.size() && n < straight.size() && output[n] == straight[n]; n++)
+			;
+		stats->firstDifference = n;
+		stats->verified = (n == output.size() && n == straight.size()) ? ParallelReplayIdentical : ParallelReplayDiffers;
+		if (stats->verified == ParallelReplayDiffers)
+			output.swap(straight);
+	}
+
+	stats->nofRecords = (unsigned long)records.size();
+	stats->nofSegments = (int)segments.size();
+	stats->nofWorkers = poolStats.nofWorkers;
+	stats->nofSteals = poolStats.nofSteals;
+	stats->outputBytes = output.size();
+	Clear();
+	return RT_RETURN_OK;
+}
+
+
+const char* ParallelReplayClass::GetOutput(size_t* size) const
+{
+	if (size != NULL)
+		*size = output.size();
+	return output.data();
+}
+
+
+
+/*
+	END OF ParallelReplay CLASS
+*/
@@ -0,0 +1,102 @@
+#include "Game.h"
+
+/*
+	Player CLASS
+*/
+
+PlayerClass::PlayerClass()
+{
+	game = NULL;
+	entity = GAME_ENTITY_NONE;
+}
+
+PlayerClass::~PlayerClass()
+{
+}
+
+
+void PlayerClass::Bind(GameClass* game, GameEntity entity)
+{
+	this->game = game;
+	this->entity = entity;
+}
+
+
+GameEntity PlayerClass::GetEntity() const
+{
+	return entity;
+}
+
+
+int PlayerClass::GetTeam() const
+{
+	return GameClass::TeamOf(entity);
+}
+
+
+int PlayerClass::GetHeroId() const
+{
+	return game->GetState()->heroId[entity];
+}
+
+
+float PlayerClass::GetHp() const
+{
+	return game->GetState()->hp[entity];
+}
+
+
+float PlayerClass::GetMaxHp() const
+{
+	return game->GetState()->maxHp[entity];
+}
+
+
+int PlayerClass::GetLevel() const
+{
+	return game->GetState()->level[entity];
+}
+
+
+int PlayerClass::IsAlive() const
+{
+	return game->GetState()->alive[entity];
+}
+
+
+void PlayerClass::GetPosition(float* x, float* y) const
+{
+	const GameState *state = game->GetState();
+
+	if (x != NULL)
+		*x = state->posX[entity];
+	if (y != NULL)
+		*y = state->posY[entity];
+}
+
+
+float PlayerClass::GetCooldown(int ability) const
+{
+	if (ability < 0 || ability >= GAME_NOF_ABILITIES)
+		return 0.0f;
+	return game->GetState()->cooldown[ability][entity];
+}
+
+
+void PlayerClass::SetHp(float hp)
+{
+	game->SetHp(entity, hp, GetMaxHp());
+}
+
+
+void PlayerClass::SetPosition(float x, float y)
+{
+	game->SetPosition(entity, x, y);
+}
+
+
+
+
+/*
+	END OF Player CLASS
+*/
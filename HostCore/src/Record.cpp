@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "Record.h"
+
+
+
+/*
+	Record CLASS
+*/
+
+int RecordClass::Parse(const char* payload, unsigned int size, VEEvent* event)
+{
+	char text[RECORD_MAX_SIZE];
+	char name[16];
+	int type;
+
+	if (payload == NULL || event == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (size >= sizeof(text))
+		return RT_RETURN_ILLEGAL_DATA;
+	memcpy(text, payload, size);
+	text[size] = '\0';
+
+	if (sscanf(text, "%15s %d %d %d %f", name, &event->entity, &event->target, &event->team, &event->amount) != 5)
+		return RT_RETURN_ILLEGAL_DATA;
+	for (type = 0; type < VE_NOF_EVENT_TYPES; type++)
+	{
+		if (strcmp(name, ValueEngine::GetEventName(type)) == 0)
+			break;
+	}
+	if (type == VE_NOF_EVENT_TYPES)
+		return RT_RETURN_ILLEGAL_DATA;
+	if (event->entity < 0 || event->entity >= GAME_NOF_SLOTS || event->target < GAME_ENTITY_NONE ||
+		event->target >= GAME_NOF_SLOTS || event->team < 0 || event->team >= GAME_NOF_TEAMS)
+		return RT_RETURN_ILLEGAL_DATA;
+	/* a damage or a heal changes the hit points of its target */
+	if (event->target == GAME_ENTITY_NONE && ValueEngine::HasTarget(type))
+		return RT_RETURN_ILLEGAL_DATA;
+
+	event->type = type;
+	event->time = 0.0;
+	return RT_RETURN_OK;
+}
+
+
+void RecordClass::ApplyGame(GameClass* game, const VEEvent* event)
+{
+	const GameState *state = game->GetState();
+	float hp;
+
+	switch (event->type)
+	{
+	case VEEventDamage:
+		if (!game->IsValidEntity(event->target))
+			break;
+		hp = state->hp[event->target] - event->amount;
+		game->SetHp(event->target, (hp > 0.0f) ? hp : 0.0f, state->maxHp[event->target]);
+		break;
+	case VEEventHeal:
+		if (!game->IsValidEntity(event->target))
+			break;
+		hp = state->hp[event->target] + event->amount;
+		game->SetHp(event->target, (hp < state->maxHp[event->target]) ? hp : state->maxHp[event->target], state->maxHp[event->target]);
+		break;
+	case VEEventDeath:
+		game->SetAlive(event->entity, 0);
+		break;
+	case VEEventRespawn:
+		if (!game->IsValidEntity(event->entity))
+			break;
+		game->SetAlive(event->entity, 1);
+		game->SetHp(event->entity, state->maxHp[event->entity], state->maxHp[event->entity]);
+		break;
+	case VEEventLevelUp:
+		if (event->team < 0 || event->team >= GAME_NOF_TEAMS)
+			break;
+		for (GameEntity e = GameClass::TeamBegin(event->team); e < GameClass::TeamEnd(event->team); e++)
+			game->SetLevel(e, (int)event->amount);
+		break;
+	}
+}
+
+
+
+/*
+	END OF Record CLASS
+*/
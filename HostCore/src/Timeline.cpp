@@ -0,0 +1,414 @@
+#include <math.h>
+#include <string.h>
+#include <utility>
+
+#include "Timeline.h"
+#include "Game.h"
+#include "ValueEngine.h"
+
+/*
+	Timeline CLASS
+*/
+
+TimelineClass::TimelineClass()
+{
+	log = NULL;
+	game = NULL;
+	engine = NULL;
+	events = NULL;
+	apply = NULL;
+	context = NULL;
+	snapshotBytes = 0;
+	maxBytes = 0;
+	interval = 0.0;
+	scratchOf = -1;
+	scratchStep = 1;
+	position = 0;
+	nofRestores = 0;
+	nofApplied = 0;
+}
+
+TimelineClass::~TimelineClass()
+{
+	Close();
+}
+
+
+void TimelineClass::DefaultSettings(TimelineSettings* settings)
+{
+	if (settings == NULL)
+		return;
+	settings->interval = TIMELINE_DEFAULT_INTERVAL;
+	settings->maxBytes = TIMELINE_DEFAULT_MAX_BYTES;
+	settings->logFlags = 0;
+}
+
+
+int TimelineClass::Open(const char* path, const TimelineSettings* settings, GameClass* g, ValueEngine* e,
+                        RTEventList list, TimelineApplyFunc applyFunc, void* applyContext)
+{
+	TimelineSettings defaults;
+	RTPassage passage;
+	Record record;
+	double time, boundary;
+	int ret;
+
+	Close();
+	if (path == NULL || g == NULL || applyFunc == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (settings == NULL)
+	{
+		DefaultSettings(&defaults);
+		settings = &defaults;
+	}
+	if ((settings->logFlags & RT_REPLAY_LOG_FLAG_FOLLOW) != 0 || !(settings->interval > 0.0))
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+
+	ret = RTReplayLogOpen(path, 0, settings->logFlags, &log);
+	if (ret != RT_RETURN_OK)
+	{
+		log = NULL;
+		return ret;
+	}
+	game = g;
+	engine = e;
+	events = list;
+	apply = applyFunc;
+	context = applyContext;
+	maxBytes = settings->maxBytes;
+	interval = settings->interval;
+
+	/* snapshot 0 is the state before the first record, a seek always finds one */
+	snapshots.push_back(Snapshot());
+	ret = Save(0, &snapshots.back());
+	snapshotBytes = snapshots.back().data.size();
+
+	boundary = interval;
+	while (ret == RT_RETURN_OK && (ret = RTReplayLogNext(log, &passage, &time)) == RT_RETURN_OK)
+	{
+		if (time >= boundary)
+		{
+			snapshots.push_back(Snapshot());
+			ret = Save((unsigned long)records.size(), &snapshots.back());
+			if (ret != RT_RETURN_OK)
+				break;
+			snapshotBytes += snapshots.back().data.size();
+			if (snapshotBytes > maxBytes)
+				Thin();
+			boundary = (floor(time / interval) + 1.0) * interval;
+		}
+
+		record.time = time;
+		record.data = passage->data;
+		record.size = passage->size;
+		records.push_back(record);
+		ret = apply(record.data, record.size, record.time, context);
+		position = (unsigned long)records.size();
+	}
+	if (ret != RT_RETURN_END_OF_LOG)
+	{
+		Close();
+		return ret;
+	}
+	return RT_RETURN_OK;
+}
+
+
+void TimelineClass::Close()
+{
+	if (log != NULL)
+		RTReplayLogClose(log);
+	log = NULL;
+	game = NULL;
+	engine = NULL;
+	events = NULL;
+	apply = NULL;
+	context = NULL;
+	records.clear();
+	snapshots.clear();
+	scratch.clear();
+	snapshotBytes = 0;
+	scratchOf = -1;
+	position = 0;
+	nofRestores = 0;
+	nofApplied = 0;
+}
+
+
+/* Drops every other snapshot, never snapshot 0, until the rest fit in maxBytes */
+void TimelineClass::Thin()
+{
+	size_t i, n;
+
+	while (snapshotBytes > maxBytes && snapshots.size() > 1)
+	{
+		snapshotBytes = 0;
+		for (i = 0, n = 0; i < snapshots.size(); i += 2, n++)
+		{
+			if (n != i)
+				std::swap(snapshots[n], snapshots[i]);
+			snapshotBytes += snapshots[n].data.size();
+		}
+		snapshots.resize(n);
+		interval *= 2.0;
+	}
+}
+
+
+int TimelineClass::SaveState(const GameClass* game, const ValueEngine* engine, RTEventList events,
+                             unsigned long at, TimelineSnapshot* snapshot)
+{
+	size_t eventsSize;
+	char *p;
+
+	if (game == NULL || snapshot == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	snapshot->position = at;
+	snapshot->gameSize = game->GetSnapshotSize();
+	snapshot->engineSize = (engine != NULL) ? engine->GetSnapshotSize() : 0;
+	eventsSize = (events != NULL) ? RTEventListGetSnapshotSize(events) : 0;
+	snapshot->data.resize(snapshot->gameSize + snapshot->engineSize + eventsSize);
+	p = snapshot->data.data();
+
+	if (game->SaveSnapshot(p, snapshot->gameSize, NULL) != DU_RETURN_OK)
+		return RT_RETURN_INTERNAL_ERROR;
+	p += snapshot->gameSize;
+	if (engine != NULL && engine->SaveSnapshot(p, snapshot->engineSize, NULL) != DU_RETURN_OK)
+		return RT_RETURN_INTERNAL_ERROR;
+	p += snapshot->engineSize;
+	if (events != NULL)
+		return RTEventListSave(events, p, eventsSize, NULL);
+	return RT_RETURN_OK;
+}
+
+
+int TimelineClass::RestoreState(const TimelineSnapshot* snapshot, GameClass* game, ValueEngine* engine, RTEventList events)
+{
+	const char *p;
+	size_t eventsSize;
+
+	if (snapshot == NULL || game == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (snapshot->gameSize + snapshot->engineSize > snapshot->data.size())
+		return RT_RETURN_ILLEGAL_DATA;
+	p = snapshot->data.data();
+	eventsSize = snapshot->data.size() - snapshot->gameSize - snapshot->engineSize;
+
+	if (game->RestoreSnapshot(p, snapshot->gameSize) != DU_RETURN_OK)
+		return RT_RETURN_ILLEGAL_DATA;
+	p += snapshot->gameSize;
+	if (engine != NULL && engine->RestoreSnapshot(p, snapshot->engineSize) != DU_RETURN_OK)
+		return RT_RETURN_ILLEGAL_DATA;
+	p += snapshot->engineSize;
+	if (events != NULL)
+		return RTEventListRestore(events, p, eventsSize);
+	return RT_RETURN_OK;
+}
+
+
+int TimelineClass::Save(unsigned long at, Snapshot* snapshot)
+{
+	return SaveState(game, engine, events, at, snapshot);
+}
+
+
+int TimelineClass::Restore(const Snapshot* snapshot)
+{
+	int ret;
+
+	ret = RestoreState(snapshot, game, engine, events);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	position = snapshot->position;
+	nofRestores++;
+	return RT_RETURN_OK;
+}
+
+
+int TimelineClass::Apply(unsigned long at)
+{
+	const Record *record = &records[at];
+	int ret;
+
+	ret = apply(record->data, record->size, record->time, context);
+	position = at + 1;
+	nofApplied++;
+	return ret;
+}
+
+
+int TimelineClass::ApplyTo(unsigned long target)
+{
+	int ret;
+
+	while (position < target)
+	{
+		ret = Apply(position);
+		if (ret != RT_RETURN_OK)
+			return ret;
+	}
+	return RT_RETURN_OK;
+}
+
+
+int TimelineClass::Before(unsigned long at) const
+{
+	int low = 0, high = (int)snapshots.size() - 1, middle;
+
+	while (low < high)
+	{
+		middle = (low + high + 1) / 2;
+		if (snapshots[middle].position <= at)
+			low = middle;
+		else
+			high = middle - 1;
+	}
+	return low;
+}
+
+
+int TimelineClass::Seek(double time)
+{
+	unsigned long low = 0, high = (unsigned long)records.size(), middle;
+
+	/* the first record after time */
+	while (low < high)
+	{
+		middle = low + (high - low) / 2;
+		if (records[middle].time <= time)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return SeekRecord(low);
+}
+
+
+int TimelineClass::SeekRecord(unsigned long target)
+{
+	const Snapshot *snapshot;
+	int ret;
+
+	if (log == NULL)
+		return RT_RETURN_NOT_FOUND;
+	if (target > records.size())
+		return RT_RETURN_NOT_FOUND;
+
+	/* going on from here applies fewer records than going on from the snapshot */
+	snapshot = &snapshots[Before(target)];
+	if (position > target || position < snapshot->position)
+	{
+		ret = Restore(snapshot);
+		if (ret != RT_RETURN_OK)
+			return ret;
+	}
+	return ApplyTo(target);
+}
+
+
+int TimelineClass::Next()
+{
+	if (log == NULL)
+		return RT_RETURN_NOT_FOUND;
+	if (position >= records.size())
+		return RT_RETURN_END_OF_LOG;
+	return Apply(position);
+}
+
+
+int TimelineClass::Previous()
+{
+	unsigned long target, start, end, length, step, k;
+	int s, ret;
+
+	if (log == NULL)
+		return RT_RETURN_NOT_FOUND;
+	if (position == 0)
+		return RT_RETURN_END_OF_LOG;
+	target = position - 1;
+	s = Before(target);
+	start = snapshots[s].position;
+
+	/* scratch k (1 based) is the state at start + k * step, taken the first time a step back passes it */
+	if (scratchOf != s)
+	{
+		end = (s + 1 < (int)snapshots.size()) ? snapshots[s + 1].position : (unsigned long)records.size();
+		length = end - start;
+		step = (unsigned long)ceil(sqrt((double)length));
+		if (step * TIMELINE_MAX_SCRATCH < length)
+			step = (length + TIMELINE_MAX_SCRATCH - 1) / TIMELINE_MAX_SCRATCH;
+		scratch.clear();
+		scratchOf = s;
+		scratchStep = (step > 0) ? step : 1;
+	}
+
+	k = (target - start) / scratchStep;
+	if (k > scratch.size())
+		k = scratch.size();
+	if (position > target || position < start + k * scratchStep)
+	{
+		ret = Restore((k == 0) ? &snapshots[s] : &scratch[k - 1]);
+		if (ret != RT_RETURN_OK)
+			return ret;
+	}
+
+	while (position < target)
+	{
+		ret = Apply(position);
+		if (ret != RT_RETURN_OK)
+			return ret;
+		if (position - start == (scratch.size() + 1) * scratchStep)
+		{
+			scratch.push_back(Snapshot());
+			ret = Save(position, &scratch.back());
+			if (ret != RT_RETURN_OK)
+			{
+				scratch.pop_back();
+				return ret;
+			}
+		}
+	}
+	return RT_RETURN_OK;
+}
+
+
+unsigned long TimelineClass::GetPosition() const
+{
+	return position;
+}
+
+
+unsigned long TimelineClass::GetNofRecords() const
+{
+	return (unsigned long)records.size();
+}
+
+
+double TimelineClass::GetTime() const
+{
+	return (position > 0) ? records[position - 1].time : 0.0;
+}
+
+
+void TimelineClass::GetStats(TimelineStats* stats) const
+{
+	size_t i;
+
+	if (stats == NULL)
+		return;
+	stats->nofSnapshots = (int)snapshots.size();
+	stats->snapshotBytes = snapshotBytes;
+	stats->interval = interval;
+	stats->nofScratch = (int)scratch.size();
+	stats->scratchBytes = 0;
+	for (i = 0; i < scratch.size(); i++)
+		stats->scratchBytes += scratch[i].data.size();
+	stats->nofRestores = nofRestores;
+	stats->nofApplied = nofApplied;
+}
+
+
+
+/*
+	END OF Timeline CLASS
+*/
@@ -1,66 +1,509 @@
-﻿#include "Logging.h"
-#include "qthreads.h"
+﻿#include "pch.h"
+#include "Logging.h"
 
+#include <stdarg.h>
+#include <string.h>
+#include <stdint.h>
+#include <new>
+#include <atomic>
+#include <chrono>
 
 
+/* longest wait of the logging thread, also how often the files are flushed when idle */
+#define LOG_THREAD_WAIT_MSEC 100
 
-static void WriteLine(logdata* dataLog, char * input) 
+
+/*
+	Bounded queue of sequenced slots. A slot is free for the producer of position 'pos'
+	when its sequence equals pos, and ready for the logging thread when it equals pos + 1.
+*/
+typedef struct _LogSlot
+{
+	std::atomic<size_t> sequence;
+	logType type;
+	long long timeMsec;             /* wall time of the message, formatted by the logging thread */
+	unsigned int length;
+	char text[LOG_MAX_MESSAGE_SIZE];
+} LogSlot;
+
+
+typedef struct _LogQueueStruct
+{
+	LogSlot slots[LOG_QUEUE_SIZE];
+	std::atomic<size_t> enqueuePos;
+	size_t dequeuePos;                  /* logging thread only */
+	std::atomic<size_t> writtenPos;     /* every message before it is written, see FlushLogs */
+
+	std::atomic<int> threadSleeping;
+	std::atomic<int> stop;
+	QThread_Semaphore wakeSemaphore;
+	std::atomic<int> nofWaitingSpace;   /* threads blocked on a full queue */
+	QThread_Semaphore spaceSemaphore;   /* posted by DrainQueue once per slot it freed for them */
+	std::atomic<int> nofWaitingFlush;   /* threads in FlushLogs */
+	QThread_Semaphore flushSemaphore;   /* posted by DrainQueue for each of them after writtenPos moved */
+
+	std::atomic<unsigned long> nofQueued;
+	std::atomic<unsigned long> nofDropped;
+	std::atomic<unsigned long> nofBlocked;
+	unsigned long nofRotations;         /* logging thread only */
+	unsigned long nofDroppedReported;   /* logging thread only */
+} LogQueueStruct;
+
+
+static const char* glLogHeaders[] = { "ERROR:   ", "WARNING: ", "MESSAGE: " };
+
+static LoggingObjectStruct glLogging = { NULL, {}, 0, 1, 1, LogOverflowDrop, NULL };
+
+/*
+	The queue of the logging thread. A thread that logs holds it (glQueueUsers) from before
+	it reads the pointer until its message is published. CloseLogFiles takes the pointer
+	away first and deletes the queue only when no thread holds it any more: a thread that
+	logs while the logs are closed either finds no queue or is done with it in time.
+	While it waits (glClosing) the last user out posts glCloseSemaphore, which is created
+	with the mutex and kept like it.
+*/
+static std::atomic<LogQueueStruct*> glQueue(NULL);
+static std::atomic<int> glQueueUsers(0);
+static std::atomic<int> glClosing(0);
+static QThread_Semaphore glCloseSemaphore = NULL;
+
+
+
+static long long NowMsec()
 {
-	fprintf(MessageLogFile, "%s \n", input);
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
 }
 
 
+/* messages of type log_type go to the logs with a level of at least LogLevel(log_type) */
+static int LogLevel(logType log_type)
+{
+	return (int)log_type + 1;
+}
+
 
-void InitLog(char* name, logType log_type)
+static void ReleaseQueue()
 {
+	/* pairs with CloseLogFiles: it either sees no user left or we see it waiting */
+	if (glQueueUsers.fetch_sub(1, std::memory_order_seq_cst) == 1 && glClosing.load(std::memory_order_seq_cst))
+		QThread_Semaphore_post(glCloseSemaphore);
+}
+
+
+/* The queue, held until ReleaseQueue; NULL (not held) when logging is not started */
+static LogQueueStruct* AcquireQueue()
+{
+	LogQueueStruct *queue;
+
+	/* pairs with CloseLogFiles: it either sees the user or the user sees no queue */
+	glQueueUsers.fetch_add(1, std::memory_order_seq_cst);
+	queue = glQueue.load(std::memory_order_seq_cst);
+	if (queue == NULL)
+		ReleaseQueue();
+	return queue;
+}
+
+
+static void WakeLoggingThread(LogQueueStruct* queue)
+{
+	/* pairs with the fence of the logging thread before it goes to sleep */
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (queue->threadSleeping.load(std::memory_order_relaxed) && queue->threadSleeping.exchange(0))
+		QThread_Semaphore_post(queue->wakeSemaphore);
+}
+
+
+/*
+	Claims a slot for a message and returns its position. Returns NULL when the
+	message is dropped.
+*/
+static LogSlot* ClaimSlot(LogQueueStruct* queue, logType log_type, size_t* slotPos)
+{
+	size_t pos = queue->enqueuePos.load(std::memory_order_relaxed);
+	int blocked = 0;
+
+	for (;;)
+	{
+		LogSlot *slot = &queue->slots[pos % LOG_QUEUE_SIZE];
+		size_t seq = slot->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+		if (diff == 0)
+		{
+			if (queue->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				*slotPos = pos;
+				return slot;
+			}
+		}
+		else if (diff < 0)
+		{
+			/* full */
+			if (glLogging.overflowPolicy == LogOverflowDrop && log_type != ErrorLog)
+			{
+				queue->nofDropped.fetch_add(1, std::memory_order_relaxed);
+				return NULL;
+			}
+			if (!blocked)
+			{
+				queue->nofBlocked.fetch_add(1, std::memory_order_relaxed);
+				blocked = 1;
+			}
+			/* pairs with the fence in DrainQueue: either we see the slot freed on the check, or
+			   it sees us waiting and posts; a token left from an earlier round only costs a retry */
+			queue->nofWaitingSpace.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			pos = queue->enqueuePos.load(std::memory_order_relaxed);
+			if ((intptr_t)queue->slots[pos % LOG_QUEUE_SIZE].sequence.load(std::memory_order_acquire) - (intptr_t)pos < 0)
+			{
+				WakeLoggingThread(queue);
+				QThread_Semaphore_wait(queue->spaceSemaphore);
+				pos = queue->enqueuePos.load(std::memory_order_relaxed);
+			}
+			queue->nofWaitingSpace.fetch_sub(1);
+		}
+		else
+		{
+			pos = queue->enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+
+static void PublishSlot(LogQueueStruct* queue, LogSlot* slot, size_t pos, int length)
+{
+	if (length < 0)
+		length = 0;
+	/* truncated messages keep what fits */
+	slot->length = (length < LOG_MAX_MESSAGE_SIZE) ? (unsigned int)length : LOG_MAX_MESSAGE_SIZE - 1;
+
+	slot->sequence.store(pos + 1, std::memory_order_release);
+	queue->nofQueued.fetch_add(1, std::memory_order_relaxed);
+	WakeLoggingThread(queue);
+}
+
+
+/* formats the message in the calling thread, straight into its slot */
+static void EnqueueMessage(logType log_type, const char* format, va_list args)
+{
+	LogQueueStruct *queue = AcquireQueue();
+	LogSlot *slot;
+	size_t pos;
+
+	if (queue == NULL)
+		return;
+	slot = ClaimSlot(queue, log_type, &pos);
+	if (slot != NULL)
+	{
+		slot->type = log_type;
+		slot->timeMsec = NowMsec();
+		PublishSlot(queue, slot, pos, vsnprintf(slot->text, LOG_MAX_MESSAGE_SIZE, format, args));
+	}
+	ReleaseQueue();
+}
+
+
+static void EnqueueString(logType log_type, const char* input)
+{
+	LogQueueStruct *queue;
+	LogSlot *slot;
+	size_t length;
+	size_t pos;
+
+	if (input == NULL || (queue = AcquireQueue()) == NULL)
+		return;
+	slot = ClaimSlot(queue, log_type, &pos);
+	if (slot != NULL)
+	{
+		slot->type = log_type;
+		slot->timeMsec = NowMsec();
+		length = strlen(input);
+		if (length >= LOG_MAX_MESSAGE_SIZE)
+			length = LOG_MAX_MESSAGE_SIZE - 1;
+		memcpy(slot->text, input, length);
+		PublishSlot(queue, slot, pos, (int)length);
+	}
+	ReleaseQueue();
+}
+
 
+/*
+	Moves name.N-1 to name.N, ..., name to name.1 and reopens name.
+	PRE: logging thread, glLogging.mutex taken.
+*/
+static void RotateLog(LogQueueStruct* queue, logdata* dataLog)
+{
+	int i;
+
+	fclose(dataLog->fp);
+	for (i = LOG_MAX_ROTATED_FILES; i > 0; i--)
+	{
+		char from[MAX_FILENAME_SIZE + 3];
+
+		snprintf(dataLog->filenameWithNr, sizeof(dataLog->filenameWithNr), "%s.%d", dataLog->filename, i);
+		if (i == LOG_MAX_ROTATED_FILES)
+			remove(dataLog->filenameWithNr);
+		if (i == 1)
+			snprintf(from, sizeof(from), "%s", dataLog->filename);
+		else
+			snprintf(from, sizeof(from), "%s.%d", dataLog->filename, i - 1);
+		rename(from, dataLog->filenameWithNr);
+	}
+
+	dataLog->fp = fopen(dataLog->filename, "w");
+	dataLog->fileSize = 0;
+	queue->nofRotations++;
+}
+
+
+/* PRE: logging thread, glLogging.mutex taken */
+static void WriteLine(LogQueueStruct* queue, logdata* dataLog, const char* line, size_t length)
+{
+	if (dataLog->fp == NULL)
+		return;
+	if (dataLog->maxFileSize != 0 && dataLog->fileSize != 0 && dataLog->fileSize + length > dataLog->maxFileSize)
+	{
+		RotateLog(queue, dataLog);
+		if (dataLog->fp == NULL)
+			return;
+	}
+	fwrite(line, 1, length, dataLog->fp);
+	dataLog->fileSize += length;
+}
+
+
+/* PRE: logging thread, glLogging.mutex taken */
+static void WriteMessage(LogQueueStruct* queue, logType log_type, long long timeMsec, const char* text, unsigned int length)
+{
+	char line[LOG_TIME_MAX_LENGHT + LOG_HEADER_MAX_LENGTH + LOG_MAX_MESSAGE_SIZE + 2];
+	size_t lineLength = 0;
+	int i;
+
+	if (glLogging.prefixWithTime)
+	{
+		time_t seconds = (time_t)(timeMsec / 1000);
+		struct tm *t = glLogging.useLocalTime ? localtime(&seconds) : gmtime(&seconds);
+
+		if (t != NULL)
+		{
+			lineLength = strftime(line, LOG_TIME_MAX_LENGHT, "%Y-%m-%d %H:%M:%S", t);
+			lineLength += snprintf(line + lineLength, LOG_TIME_MAX_LENGHT - lineLength, ".%03d ", (int)(timeMsec % 1000));
+		}
+	}
+	memcpy(line + lineLength, glLogHeaders[log_type], LOG_HEADER_MAX_LENGTH);
+	lineLength += LOG_HEADER_MAX_LENGTH;
+	memcpy(line + lineLength, text, length);
+	lineLength += length;
+	line[lineLength++] = '\n';
+
+	for (i = 0; i < glLogging.nofLogs; i++)
+	{
+		if (glLogging.logs[i].level >= LogLevel(log_type))
+			WriteLine(queue, &glLogging.logs[i], line, lineLength);
+	}
+}
+
+
+/*
+	Writes every ready message. Returns the number of messages written.
+	PRE: logging thread
+*/
+static int DrainQueue(LogQueueStruct* queue)
+{
+	unsigned long dropped;
+	int count = 0;
+	int waiting;
+	int i;
+
+	QThread_Mutex_P(glLogging.mutex);
+	for (;;)
+	{
+		LogSlot *slot = &queue->slots[queue->dequeuePos % LOG_QUEUE_SIZE];
+
+		if (slot->sequence.load(std::memory_order_acquire) != queue->dequeuePos + 1)
+			break;
+
+		WriteMessage(queue, slot->type, slot->timeMsec, slot->text, slot->length);
+		slot->sequence.store(queue->dequeuePos + LOG_QUEUE_SIZE, std::memory_order_release);
+		queue->dequeuePos++;
+		count++;
+	}
+
+	dropped = queue->nofDropped.load(std::memory_order_relaxed);
+	if (dropped != queue->nofDroppedReported)
+	{
+		char text[LOG_MAX_MESSAGE_SIZE];
+		int length = snprintf(text, sizeof(text), "%lu log messages dropped, log queue full",
+		                      dropped - queue->nofDroppedReported);
+
+		WriteMessage(queue, WarningLog, NowMsec(), text, (unsigned int)length);
+		queue->nofDroppedReported = dropped;
+	}
+
+	if (count > 0)
+	{
+		for (i = 0; i < glLogging.nofLogs; i++)
+		{
+			if (glLogging.logs[i].fp != NULL)
+				fflush(glLogging.logs[i].fp);
+		}
+	}
+	QThread_Mutex_V(glLogging.mutex);
+
+	queue->writtenPos.store(queue->dequeuePos, std::memory_order_release);
+
+	/* wake the threads waiting for room or for a flush, only pays the posts when someone waits */
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	waiting = queue->nofWaitingSpace.load(std::memory_order_relaxed);
+	for (waiting = (waiting < count) ? waiting : count; waiting > 0; waiting--)
+		QThread_Semaphore_post(queue->spaceSemaphore);
+	if (count > 0)
+	{
+		for (waiting = queue->nofWaitingFlush.load(std::memory_order_relaxed); waiting > 0; waiting--)
+			QThread_Semaphore_post(queue->flushSemaphore);
+	}
+	return count;
+}
+
+
+static int QueueIsEmpty(LogQueueStruct* queue)
+{
+	LogSlot *slot = &queue->slots[queue->dequeuePos % LOG_QUEUE_SIZE];
+
+	return slot->sequence.load(std::memory_order_acquire) != queue->dequeuePos + 1;
+}
+
+
+static void* LoggingThread(void* threadData)
+{
+	LogQueueStruct *queue = (LogQueueStruct*)threadData;
+
+	for (;;)
+	{
+		if (DrainQueue(queue) > 0)
+			continue;
+		if (queue->stop.load())
+			break;
+
+		/* announce the sleep, then check once more so a message queued meanwhile is not missed */
+		queue->threadSleeping.store(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (QueueIsEmpty(queue) && !queue->stop.load())
+			QThread_Semaphore_timedwait(queue->wakeSemaphore, LOG_THREAD_WAIT_MSEC);
+		queue->threadSleeping.store(0);
+	}
+
+	/* stop: whatever was queued before CloseLogFiles is written */
+	DrainQueue(queue);
+	return NULL;
+}
+
+
+/* PRE: no logging thread on the queue */
+static void DestroyQueue(LogQueueStruct* queue)
+{
+	if (queue->wakeSemaphore != NULL)
+		QThread_Semaphore_destroy(&queue->wakeSemaphore);
+	if (queue->spaceSemaphore != NULL)
+		QThread_Semaphore_destroy(&queue->spaceSemaphore);
+	if (queue->flushSemaphore != NULL)
+		QThread_Semaphore_destroy(&queue->flushSemaphore);
+	delete queue;
+}
+
+
+static int StartLogging()
+{
+	LogQueueStruct *queue;
+	size_t i;
+
+	if (glQueue.load() != NULL)
+		return 1;
+
+	if (glLogging.mutex == NULL && QThread_Mutex_create(&glLogging.mutex) != QTHREAD_RETURN_OK)
+		return 0;
+	if (glCloseSemaphore == NULL && QThread_Semaphore_create(&glCloseSemaphore, 0) != QTHREAD_RETURN_OK)
+		return 0;
+
+	queue = new (std::nothrow) LogQueueStruct();
+	if (queue == NULL)
+		return 0;
+	for (i = 0; i < LOG_QUEUE_SIZE; i++)
+		queue->slots[i].sequence.store(i, std::memory_order_relaxed);
+	queue->enqueuePos.store(0);
+	queue->dequeuePos = 0;
+	queue->writtenPos.store(0);
+
+	if (QThread_Semaphore_create(&queue->wakeSemaphore, 0) != QTHREAD_RETURN_OK ||
+		QThread_Semaphore_create(&queue->spaceSemaphore, 0) != QTHREAD_RETURN_OK ||
+		QThread_Semaphore_create(&queue->flushSemaphore, 0) != QTHREAD_RETURN_OK ||
+		QThread_create(&glLogging.thread, "LOGGING", LoggingThread, queue) != QTHREAD_RETURN_OK)
+	{
+		DestroyQueue(queue);
+		return 0;
+	}
+
+	glQueue.store(queue);
+	return 1;
+}
+
+
+
+int InitLogEx(const char* name, logType log_type, size_t maxFileSize, int level)
+{
 	time_t t = time(0);   // get time now
 	struct tm * now = localtime(&t);
-	char* alt;
-	char buffer[200];
-	char*path = ".//logs//";
+	const char* path = ".//logs//";
+	const char* logName;
 	char timebuffer[80];
+	logdata *dataLog;
+	int ret = 0;
+
+	if (name == NULL || !StartLogging())
+		return 0;
 
 	strftime(timebuffer, 80, "_%Y-%m-%d.", now);
 
 	switch (log_type)
 	{
 	case ErrorLog:
-
-		strcat(buffer, path);
-		strcat(buffer, name);
-		strcat(buffer, timebuffer);
-		strcat(buffer, ErrorLogName);
-
-		//alt = ;
-		ErrorLogFile = fopen(buffer, "w");
+		logName = ErrorLogName;
 		break;
-
 	case WarningLog:
-		strcat(buffer, path);
-		strcat(buffer, name);
-		strcat(buffer, timebuffer);
-		strcat(buffer, WarningLogName);
-
-		//alt = ;
-		WarningLogFile = fopen(buffer, "w");
+		logName = WarningLogName;
 		break;
-
 	case MessageLog:
-		strcat(buffer, path);
-		strcat(buffer, name);
-		strcat(buffer, timebuffer);
-		strcat(buffer, MessageLogName);
-
-		//alt = ;
-		MessageLogFile = fopen(buffer, "w");
-		break;
-
 	default:
+		logName = MessageLogName;
 		break;
 	}
 
-};
+	QThread_Mutex_P(glLogging.mutex);
+	if (glLogging.nofLogs < LOG_MAX_NOF_LOGS)
+	{
+		dataLog = &glLogging.logs[glLogging.nofLogs];
+		snprintf(dataLog->filename, MAX_FILENAME_SIZE, "%s%s%s%s", path, name, timebuffer, logName);
+		dataLog->fp = fopen(dataLog->filename, "w");
+		if (dataLog->fp != NULL)
+		{
+			dataLog->logto = log_type;
+			dataLog->maxFileSize = maxFileSize;
+			dataLog->fileSize = 0;
+			dataLog->level = level;
+			glLogging.nofLogs++;
+			ret = 1;
+		}
+	}
+	QThread_Mutex_V(glLogging.mutex);
+	return ret;
+}
+
+
+int InitLog(const char* name, logType log_type)
+{
+	return InitLogEx(name, log_type, LOG_DEFAULT_MAX_FILE_SIZE, LogLevel(log_type));
+}
 
 
 void InitLogs()
@@ -72,73 +515,127 @@ void InitLogs()
 };
 
 
-void LogMessage(LoggingObjectStruct *log,char * input) {
-	FILE* aux = fopen(log->logs[0].filename, "w+");
-	if (aux == NULL) {
-		// do nothing
-	}
-	else
-	{
-		// assing the reference created to
-		MessageLogFile = aux;
-	}
-	QThread_Mutex_P(log->mutex);
-	WriteLine(log->logs, strcat("REPORT LOG ENTRY:",input));
-	//fprintf(MessageLogFile, "%s \n", input);
+void SetLogOptions(logOverflowPolicy policy, int prefixWithTime, int useLocalTime)
+{
+	glLogging.overflowPolicy = policy;
+	glLogging.prefixWithTime = prefixWithTime;
+	glLogging.useLocalTime = useLocalTime;
+}
+
+
+void LogMessage(const char * input) {
+	EnqueueString(MessageLog, input);
 #ifdef DEBUG_GE
 	//print to console
-	printf(MessageLog, "GE_ENGINE_MESSAGE: %s \n", input);
+	printf("GE_ENGINE_MESSAGE: %s \n", input);
 #endif
-
-	QThread_Mutex_V(log->mutex);
 };
 
 
 
-void LogWarning(LoggingObjectStruct *log, char * input) {
-	FILE* aux = fopen(WarningLogName, "w+");
-	if (aux == NULL) {
-		// do nothing
-	}
-	else
-	{
+void LogWarning(const char * input) {
+	EnqueueString(WarningLog, input);
+};
 
-		// assing the reference created to
-		WarningLogFile = aux;
-	}
-	QThread_Mutex_P(log->mutex);
-	WriteLine(log->logs, strcat("WARNING LOG ENTRY:", input));
-	QThread_Mutex_V(log->mutex);
 
+void LogError(const char * input) {
+	EnqueueString(ErrorLog, input);
 };
 
 
-void LogError(LoggingObjectStruct *log, char * input) {
-	FILE* aux = fopen(WarningLogName, "w+");
-	if (aux == NULL) {
-		// do nothing
-	}
-	else
+void LogFormat(logType log_type, const char * format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	EnqueueMessage(log_type, format, args);
+	va_end(args);
+}
+
+
+void FlushLogs()
+{
+	LogQueueStruct *queue = AcquireQueue();
+	size_t target;
+
+	if (queue == NULL)
+		return;
+
+	target = queue->enqueuePos.load(std::memory_order_acquire);
+	for (;;)
 	{
-		// assing the reference created to 
-		ErrorLogFile = aux;
+		/* pairs with the fence in DrainQueue, as in ClaimSlot */
+		queue->nofWaitingFlush.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (queue->writtenPos.load(std::memory_order_acquire) >= target)
+			break;
+		WakeLoggingThread(queue);
+		QThread_Semaphore_wait(queue->flushSemaphore);
+		queue->nofWaitingFlush.fetch_sub(1);
 	}
-	QThread_Mutex_P(log->mutex);
-	WriteLine(log->logs, strcat("ERROR LOG ENTRY:", input));
-	QThread_Mutex_V(log->mutex);
+	queue->nofWaitingFlush.fetch_sub(1);
+	ReleaseQueue();
+}
 
-};
+
+int GetLogStats(LogStats* stats)
+{
+	LogQueueStruct *queue;
+
+	if (stats == NULL)
+		return 0;
+	memset(stats, 0, sizeof(LogStats));
+	if ((queue = AcquireQueue()) == NULL)
+		return 1;
+
+	stats->nofQueued = queue->nofQueued.load(std::memory_order_relaxed);
+	stats->nofWritten = (unsigned long)queue->writtenPos.load(std::memory_order_relaxed);
+	stats->nofDropped = queue->nofDropped.load(std::memory_order_relaxed);
+	stats->nofBlocked = queue->nofBlocked.load(std::memory_order_relaxed);
+	QThread_Mutex_P(glLogging.mutex);
+	stats->nofRotations = queue->nofRotations;
+	QThread_Mutex_V(glLogging.mutex);
+	ReleaseQueue();
+	return 1;
+}
 
 
 
 
 void CloseFile(FILE* log) {
-	fclose(log);
+	if (log != NULL)
+		fclose(log);
 };
 
 void CloseLogFiles() {
-	CloseFile(ErrorLogFile);
-	CloseFile(MessageLogFile);
-	CloseFile(WarningLogFile);
-};
+	LogQueueStruct *queue = glQueue.exchange(NULL, std::memory_order_seq_cst);
+	int i;
+
+	if (queue != NULL)
+	{
+		/* no new thread gets the queue, the ones that have it finish their message (a
+		   blocked one gets room from the logging thread, which still runs) */
+		glClosing.store(1, std::memory_order_seq_cst);
+		while (glQueueUsers.load(std::memory_order_seq_cst) != 0)
+			QThread_Semaphore_wait(glCloseSemaphore);
+		glClosing.store(0, std::memory_order_seq_cst);
+		/* a user that left between our check and the store may have posted once more */
+		while (QThread_Semaphore_trywait(glCloseSemaphore) == QTHREAD_RETURN_OK)
+			;
+
+		/* the logging thread writes everything that was queued before it leaves */
+		queue->stop.store(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		QThread_Semaphore_post(queue->wakeSemaphore);
+		QThread_join(glLogging.thread, NULL);
+		glLogging.thread = NULL;
+		DestroyQueue(queue);
+	}
 
+	for (i = 0; i < glLogging.nofLogs; i++)
+	{
+		CloseFile(glLogging.logs[i].fp);
+		glLogging.logs[i].fp = NULL;
+	}
+	glLogging.nofLogs = 0;
+};
@@ -1,9 +1,10 @@
 ﻿#ifndef _LOGGING_H_
-#define _LOGGING_H_ 
+#define _LOGGING_H_
 
 #include <stdio.h>
 #include <fstream>
 #include <time.h>
+#include "qthreads.h"
 using namespace std;
 
 #define ErrorLogName "error_log.txt"
@@ -12,14 +13,10 @@ using namespace std;
 
 #define LoggingPath ".\\logs\\"
 
-//using std;
-FILE* ErrorLogFile;
-FILE* WarningLogFile;
-FILE* MessageLogFile;
-
-
 
+#ifndef MAX_FILENAME_SIZE
 #define MAX_FILENAME_SIZE 512
+#endif
 /** The maximum size of a message in bytes. */
 #define LOG_MAX_MESSAGE_SIZE  256
 /** length of the longest log header string */
@@ -29,6 +26,13 @@ FILE* MessageLogFile;
 /** max nof files to log to */
 #define LOG_MAX_NOF_LOGS 5
 
+/** number of messages the log queue holds, the memory of the logger does not grow beyond it */
+#define LOG_QUEUE_SIZE 4096
+/** default size at which a log file is rotated */
+#define LOG_DEFAULT_MAX_FILE_SIZE (10 * 1024 * 1024)
+/** number of rotated files kept per log (name.1 is the newest), fits in filenameWithNr */
+#define LOG_MAX_ROTATED_FILES 9
+
 
 
 enum logType
@@ -37,6 +41,14 @@ enum logType
 };
 
 
+/** What a logging thread does when the log queue is full */
+enum logOverflowPolicy
+{
+	LogOverflowDrop,    /* drop the message and count it, errors still wait (default) */
+	LogOverflowBlock    /* every message waits until the logging thread made room */
+};
+
+
 typedef struct _logdata
 {
 	logType logto;
@@ -44,36 +56,74 @@ typedef struct _logdata
 	char filename[MAX_FILENAME_SIZE];
 	char filenameWithNr[MAX_FILENAME_SIZE + 3];
 	size_t maxFileSize;
+	size_t fileSize;
 	int level; /* levels:  1 - only errors, 2 - errors + warnings, 3 - errors + warnings + notifications */
 } logdata;
 
 
+/** Counters of the logger, see GetLogStats */
+typedef struct _LogStats
+{
+	unsigned long nofQueued;        /* messages accepted in the queue */
+	unsigned long nofWritten;       /* messages taken out of the queue by the logging thread */
+	unsigned long nofDropped;       /* messages dropped because the queue was full */
+	unsigned long nofBlocked;       /* times a thread waited for room in the queue */
+	unsigned long nofRotations;     /* log files rotated */
+} LogStats;
+
+
+/*
+	Messages are formatted by the calling thread straight into a slot of a bounded
+	lock-free queue; one logging thread takes them out in batches and writes them to
+	files that stay open. No file is opened and no lock is taken on the calling side.
+*/
 typedef struct _LoggingObjectStruct
 {
-	QThread_Mutex mutex;
+	QThread_Mutex mutex;        /* protects logs[] between InitLog and the logging thread */
 	logdata logs[LOG_MAX_NOF_LOGS];
 	int nofLogs;
 	int prefixWithTime;
 	int useLocalTime;
+	logOverflowPolicy overflowPolicy;
+	QThread thread;
 //#if defined PLATFORM_Win32 && defined SUPPORT_EVENT_LOG
 //	gcroot<System::Diagnostics::EventLog^> systemLog;
 //#endif
 } LoggingObjectStruct;
 
+typedef LoggingObjectStruct *LoggingObject;
+
 
-extern void InitLog(char* name, logType log_type);
+/** Opens a log file (in LoggingPath) that receives the messages up to the default level of log_type */
+extern int InitLog(const char* name, logType log_type);
+
+/** Opens a log file with its own rotation size and level (1 - 3, see logdata) */
+extern int InitLogEx(const char* name, logType log_type, size_t maxFileSize, int level);
 
 extern void InitLogs();
 
-extern void LogMessage(char * input);
+/** Sets the overflow policy, prefixes and time zone of the logger. PRE: before InitLog */
+extern void SetLogOptions(logOverflowPolicy policy, int prefixWithTime, int useLocalTime);
+
+extern void LogMessage(const char * input);
+
+extern void LogWarning(const char * input);
+
+extern void LogError(const char * input);
+
+/** printf style logging, the message is formatted in the calling thread */
+extern void LogFormat(logType log_type, const char * format, ...);
 
-extern void LogWarning(char * input);
+/** Waits until every message logged so far is written to the files */
+extern void FlushLogs();
 
-extern void LogError(char * input);
+extern int GetLogStats(LogStats* stats);
 
 extern void CloseFile(FILE* log);
 
+/** Writes every queued message, stops the logging thread and closes the files; a message
+    logged by another thread meanwhile is written or dropped, never lost in a freed queue */
 extern void CloseLogFiles();
 
 
-#endif
\ No newline at end of file
+#endif
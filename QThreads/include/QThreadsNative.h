@@ -0,0 +1,66 @@
+#ifndef _QThreadsNative_H_
+#define _QThreadsNative_H_
+
+
+#include "qthreads.h"
+
+/*
+	Source implementation of the Q-Threads API (qthreads.h) on std::thread and futexes,
+	a drop-in replacement of the prebuilt qthreads.lib: link QThreadsNative.cpp instead
+	of the library, the callers do not change.
+
+	Linux: mutexes and semaphores are an atomic word in user space, a thread only enters
+	the kernel (futex) to sleep when it has to wait, or to wake a sleeping one. An
+	uncontended QThread_Mutex_P / _V is one atomic instruction each. Timed waits count
+	down on the monotonic clock, a change of the wall clock does not shorten or stretch
+	them. Windows: the same on WaitOnAddress / WakeByAddress (Windows 8 and later).
+
+	The functions below are not part of the library API: thread names and CPU affinity.
+	The thread name of QThread_create is set on the thread (shown by top -H, gdb, perf).
+
+		g++ -O2 -std=c++11 -Iexternal/64bits -IQThreads/include -c QThreads/src/QThreadsNative.cpp
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Longest thread name, the platforms cut it there (Linux: 15 characters) */
+#define QTHREAD_MAX_NAME_LENGTH     15
+
+/**
+ * Called in every thread QThread_create starts, before its thread function, e.g. to pin
+ * threads by name. PRE: installed before the threads it should see are created.
+ */
+typedef void (*QThread_StartHook)(QThread thread, const char* threadName, void* context);
+
+void QThread_setStartHook(QThread_StartHook hook, void* context);
+
+/**
+ * Names a thread. A thread not started by QThread_create (QThread_self of the main
+ * thread) can only name itself. Renamed while it starts, its start hook may see either name.
+ */
+int QThread_setName(QThread thread, const char* threadName);
+
+/** The name given at creation or by QThread_setName, "" if it has none */
+const char* QThread_getName(QThread thread);
+
+/**
+ * Restricts a thread to the CPUs of cpuMask (bit n: CPU n, CPUs 0 - 63).
+ * A thread not started by QThread_create can only pin itself.
+ *
+ * On return error the CPUs are not available to the process or the platform has no affinity.
+ */
+int QThread_setAffinity(QThread thread, unsigned long long cpuMask);
+
+/** Number of CPUs the process may run on */
+int QThread_getNofCpus(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+#endif // _QThreadsNative_H_
@@ -0,0 +1,566 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#else
+#error "QThreadsNative needs futexes (Linux) or WaitOnAddress (Windows)"
+#endif
+
+#include "QThreadsNative.h"
+
+
+#define QTHREAD_NATIVE_DESCRIPTION      "Q-Threads on std::thread and futexes"
+
+/* times a contended QThread_Mutex_P retries before it sleeps, a lock is often held for less than a sleep costs */
+#define QTHREAD_MUTEX_SPIN              100
+
+/* futex word of a mutex */
+#define QTHREAD_MUTEX_UNLOCKED          0
+#define QTHREAD_MUTEX_LOCKED            1
+#define QTHREAD_MUTEX_CONTENDED         2       /* locked, and a thread may sleep on it */
+
+
+typedef struct _QThreadStruct
+{
+	std::thread             thread;
+	int                     foreign;        /* QThread_self of a thread QThread_create did not start */
+	QThread_Function        function;
+	void                   *data;
+	void                   *threadReturn;
+	char                    name[QTHREAD_MAX_NAME_LENGTH + 1];
+#if defined(__linux__)
+	pthread_t               native;         /* of a foreign thread */
+#endif
+} QThreadStruct;
+
+#if defined(__linux__)
+typedef pthread_t QThreadNative;
+#else
+typedef HANDLE QThreadNative;
+#endif
+
+typedef struct _QThread_MutexStruct
+{
+	std::atomic<int>        state;
+} QThread_MutexStruct;
+
+typedef struct _QThread_SemaphoreStruct
+{
+	std::atomic<int>        count;
+	std::atomic<int>        nofWaiters;
+} QThread_SemaphoreStruct;
+
+
+static std::atomic<QThread_StartHook> glStartHook(NULL);
+static void *glStartHookContext;
+
+static thread_local QThread glCurrentThread;
+static thread_local QThreadStruct glForeignThread;
+
+
+
+/*
+	Futex: sleep while *word == expected, at most timeoutNsec (< 0: no limit). Returns
+	early on a wake, a change of *word or a signal, the caller checks again.
+*/
+static void FutexWait(std::atomic<int>* word, int expected, long long timeoutNsec)
+{
+#if defined(__linux__)
+	struct timespec timeout;
+
+	if (timeoutNsec >= 0)
+	{
+		timeout.tv_sec = (time_t)(timeoutNsec / 1000000000);
+		timeout.tv_nsec = (long)(timeoutNsec % 1000000000);
+	}
+	/* a relative FUTEX_WAIT timeout runs on CLOCK_MONOTONIC */
+	syscall(SYS_futex, (int*)word, FUTEX_WAIT_PRIVATE, expected, (timeoutNsec >= 0) ? &timeout : NULL, NULL, 0);
+#else
+	DWORD msec = INFINITE;
+
+	if (timeoutNsec >= 0)
+		msec = (DWORD)((timeoutNsec + 999999) / 1000000);
+	WaitOnAddress((volatile VOID*)word, &expected, sizeof(int), msec);
+#endif
+}
+
+
+static void FutexWake(std::atomic<int>* word, int nofThreads)
+{
+#if defined(__linux__)
+	syscall(SYS_futex, (int*)word, FUTEX_WAKE_PRIVATE, nofThreads, NULL, NULL, 0);
+#else
+	if (nofThreads == 1)
+		WakeByAddressSingle((PVOID)word);
+	else
+		WakeByAddressAll((PVOID)word);
+#endif
+}
+
+
+static inline void CpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(_M_X64) || defined(_M_IX86)
+	YieldProcessor();
+#endif
+}
+
+
+
+/*
+	Threads
+*/
+
+static void ThreadStart(QThread thread)
+{
+	QThread_StartHook hook;
+
+	glCurrentThread = thread;
+	if (thread->name[0] != '\0')
+		QThread_setName(thread, thread->name);
+	hook = glStartHook.load(std::memory_order_acquire);
+	if (hook != NULL)
+		hook(thread, thread->name, glStartHookContext);
+
+	thread->threadReturn = thread->function(thread->data);
+}
+
+
+int QThread_create(QThread *thread, const char * const threadName, QThread_Function threadFunction, void * threadData)
+{
+	QThread created;
+
+	if (thread == NULL)
+		return QTHREAD_RETURN_ERROR;
+	*thread = NULL;
+	if (threadFunction == NULL)
+		return QTHREAD_RETURN_ERROR;
+
+	created = new (std::nothrow) QThreadStruct();
+	if (created == NULL)
+		return QTHREAD_RETURN_ERROR;
+	created->foreign = 0;
+	created->function = threadFunction;
+	created->data = threadData;
+	created->threadReturn = NULL;
+	if (threadName != NULL)
+		snprintf(created->name, sizeof(created->name), "%s", threadName);
+
+	try
+	{
+		created->thread = std::thread(ThreadStart, created);
+	}
+	catch (...)
+	{
+		delete created;
+		return QTHREAD_RETURN_ERROR;
+	}
+	*thread = created;
+	return QTHREAD_RETURN_OK;
+}
+
+
+int QThread_join(QThread thread, void **threadReturn)
+{
+	if (thread == NULL || thread->foreign || !thread->thread.joinable())
+		return QTHREAD_RETURN_ERROR;
+	if (thread->thread.get_id() == std::this_thread::get_id())
+		return QTHREAD_RETURN_WOULD_BLOCK;
+
+	thread->thread.join();
+	if (threadReturn != NULL)
+		*threadReturn = thread->threadReturn;
+	delete thread;
+	return QTHREAD_RETURN_OK;
+}
+
+
+QThread QThread_self(void)
+{
+	if (glCurrentThread == NULL)
+	{
+		glForeignThread.foreign = 1;
+#if defined(__linux__)
+		glForeignThread.native = pthread_self();
+#endif
+		glCurrentThread = &glForeignThread;
+	}
+	return glCurrentThread;
+}
+
+
+void QThread_sleep(unsigned int timeout)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+}
+
+
+
+/*
+	Mutex: the futex word is UNLOCKED, LOCKED or CONTENDED (U. Drepper, "Futexes Are
+	Tricky", mutex 2). Only a V that finds CONTENDED enters the kernel to wake a thread.
+*/
+
+int QThread_Mutex_create(QThread_Mutex *mutex)
+{
+	if (mutex == NULL)
+		return QTHREAD_RETURN_ERROR;
+	*mutex = new (std::nothrow) QThread_MutexStruct;
+	if (*mutex == NULL)
+		return QTHREAD_RETURN_ERROR;
+	(*mutex)->state.store(QTHREAD_MUTEX_UNLOCKED, std::memory_order_relaxed);
+	return QTHREAD_RETURN_OK;
+}
+
+
+int QThread_Mutex_destroy(QThread_Mutex *mutex)
+{
+	if (mutex == NULL || *mutex == NULL)
+		return QTHREAD_RETURN_ERROR;
+	delete *mutex;
+	*mutex = NULL;
+	return QTHREAD_RETURN_OK;
+}
+
+
+int QThread_Mutex_P(QThread_Mutex mutex)
+{
+	int state = QTHREAD_MUTEX_UNLOCKED;
+	int spin;
+
+	if (mutex == NULL)
+		return QTHREAD_RETURN_ERROR;
+	if (mutex->state.compare_exchange_strong(state, QTHREAD_MUTEX_LOCKED, std::memory_order_acquire, std::memory_order_relaxed))
+		return QTHREAD_RETURN_OK;
+
+	for (spin = 0; spin < QTHREAD_MUTEX_SPIN && state != QTHREAD_MUTEX_CONTENDED; spin++)
+	{
+		CpuRelax();
+		state = mutex->state.load(std::memory_order_relaxed);
+		if (state == QTHREAD_MUTEX_UNLOCKED &&
+			mutex->state.compare_exchange_weak(state, QTHREAD_MUTEX_LOCKED, std::memory_order_acquire, std::memory_order_relaxed))
+			return QTHREAD_RETURN_OK;
+	}
+
+	/* from here on the word says CONTENDED while this thread waits */
+	state = mutex->state.exchange(QTHREAD_MUTEX_CONTENDED, std::memory_order_acquire);
+	while (state != QTHREAD_MUTEX_UNLOCKED)
+	{
+		FutexWait(&mutex->state, QTHREAD_MUTEX_CONTENDED, -1);
+		state = mutex->state.exchange(QTHREAD_MUTEX_CONTENDED, std::memory_order_acquire);
+	}
+	return QTHREAD_RETURN_OK;
+}
+
+
+int QThread_Mutex_V(QThread_Mutex mutex)
+{
+	if (mutex == NULL)
+		return QTHREAD_RETURN_ERROR;
+	if (mutex->state.exchange(QTHREAD_MUTEX_UNLOCKED, std::memory_order_release) == QTHREAD_MUTEX_CONTENDED)
+		FutexWake(&mutex->state, 1);
+	return QTHREAD_RETURN_OK;
+}
+
+
+
+/*
+	Semaphore: the futex word is the count. A waiter registers in nofWaiters before it
+	sleeps on count 0, a post that sees no waiter skips the kernel.
+*/
+
+int QThread_Semaphore_create(QThread_Semaphore *semaphore, unsigned int initialCount)
+{
+	if (semaphore == NULL)
+		return QTHREAD_RETURN_ERROR;
+	*semaphore = new (std::nothrow) QThread_SemaphoreStruct;
+	if (*semaphore == NULL)
+		return QTHREAD_RETURN_ERROR;
+	(*semaphore)->count.store((int)initialCount, std::memory_order_relaxed);
+	(*semaphore)->nofWaiters.store(0, std::memory_order_relaxed);
+	return QTHREAD_RETURN_OK;
+}
+
+
+int QThread_Semaphore_destroy(QThread_Semaphore *semaphore)
+{
+	if (semaphore == NULL || *semaphore == NULL)
+		return QTHREAD_RETURN_ERROR;
+	delete *semaphore;
+	*semaphore = NULL;
+	return QTHREAD_RETURN_OK;
+}
+
+
+static int SemaphoreTryPass(QThread_Semaphore semaphore)
+{
+	int count = semaphore->count.load(std::memory_order_relaxed);
+
+	while (count > 0)
+	{
+		if (semaphore->count.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+			return 1;
+	}
+	return 0;
+}
+
+
+/* timeoutMsec < 0: no limit */
+static int SemaphoreWait(QThread_Semaphore semaphore, long long timeoutMsec)
+{
+	std::chrono::steady_clock::time_point deadline;
+	long long remaining = -1;
+
+	if (semaphore == NULL)
+		return QTHREAD_RETURN_ERROR;
+	if (SemaphoreTryPass(semaphore))
+		return QTHREAD_RETURN_OK;
+	if (timeoutMsec == 0)
+		return QTHREAD_RETURN_TIMEOUT;
+	if (timeoutMsec > 0)
+		deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMsec);
+
+	for (;;)
+	{
+		if (timeoutMsec > 0)
+		{
+			remaining = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now()).count();
+			if (remaining <= 0)
+				return SemaphoreTryPass(semaphore) ? QTHREAD_RETURN_OK : QTHREAD_RETURN_TIMEOUT;
+		}
+
+		/* seq_cst with the post: either it sees this waiter, or the futex sees its count */
+		semaphore->nofWaiters.fetch_add(1, std::memory_order_seq_cst);
+		if (semaphore->count.load(std::memory_order_seq_cst) == 0)
+			FutexWait(&semaphore->count, 0, remaining);
+		semaphore->nofWaiters.fetch_sub(1, std::memory_order_relaxed);
+
+		if (SemaphoreTryPass(semaphore))
+			return QTHREAD_RETURN_OK;
+	}
+}
+
+
+int QThread_Semaphore_wait(QThread_Semaphore semaphore)
+{
+	return SemaphoreWait(semaphore, -1);
+}
+
+
+int QThread_Semaphore_trywait(QThread_Semaphore semaphore)
+{
+	return SemaphoreWait(semaphore, 0);
+}
+
+
+int QThread_Semaphore_timedwait(QThread_Semaphore semaphore, unsigned int timeout)
+{
+	return SemaphoreWait(semaphore, timeout);
+}
+
+
+int QThread_Semaphore_post(QThread_Semaphore semaphore)
+{
+	if (semaphore == NULL)
+		return QTHREAD_RETURN_ERROR;
+	semaphore->count.fetch_add(1, std::memory_order_seq_cst);
+	if (semaphore->nofWaiters.load(std::memory_order_seq_cst) != 0)
+		FutexWake(&semaphore->count, 1);
+	return QTHREAD_RETURN_OK;
+}
+
+
+int QThread_Semaphore_value(QThread_Semaphore semaphore, unsigned int *value)
+{
+	if (semaphore == NULL || value == NULL)
+		return QTHREAD_RETURN_ERROR;
+	*value = (unsigned int)semaphore->count.load(std::memory_order_relaxed);
+	return QTHREAD_RETURN_OK;
+}
+
+
+
+/*
+	Initialization and finalization
+*/
+
+/* the signature must match the prebuilt qthreads.h, top-level const on the return type included */
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-qualifiers"
+#endif
+const char * const QThread_getVersion(
+    const char * * const major,
+    const char * * const minor,
+    const char * * const maintenance,
+    const char * * const description)
+{
+	if (major != NULL)
+		*major = QTHREAD_LIB_MAJOR;
+	if (minor != NULL)
+		*minor = QTHREAD_LIB_MINOR;
+	if (maintenance != NULL)
+		*maintenance = QTHREAD_LIB_MAINTENANCE;
+	if (description != NULL)
+		*description = QTHREAD_NATIVE_DESCRIPTION;
+	return QTHREAD_LIB_DOTTED_VERSION " " QTHREAD_NATIVE_DESCRIPTION;
+}
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+
+/* the major version of the caller's qthreads.h must match */
+int QThread_initializeVersion(const char * const version)
+{
+	size_t length = strlen(QTHREAD_LIB_MAJOR);
+
+	if (version == NULL || strncmp(version, QTHREAD_LIB_MAJOR, length) != 0 || version[length] != '.')
+		return QTHREAD_RETURN_ILLEGAL_VERSION;
+	return QTHREAD_RETURN_OK;
+}
+
+
+void QThread_finalize(void)
+{
+}
+
+
+
+/*
+	Names and CPU affinity (QThreadsNative.h)
+*/
+
+/* The handle of thread for the calling thread, 0 when it has none */
+static int GetNative(QThread thread, QThreadNative* native)
+{
+	if (thread == glCurrentThread)
+	{
+#if defined(__linux__)
+		*native = pthread_self();
+#else
+		*native = GetCurrentThread();
+#endif
+		return 1;
+	}
+	if (thread->foreign)
+	{
+#if defined(__linux__)
+		*native = thread->native;
+		return 1;
+#else
+		return 0;
+#endif
+	}
+	/* QThread_create has returned, the creating thread no longer writes thread->thread */
+	*native = (QThreadNative)thread->thread.native_handle();
+	return 1;
+}
+
+
+void QThread_setStartHook(QThread_StartHook hook, void* context)
+{
+	glStartHookContext = context;
+	glStartHook.store(hook, std::memory_order_release);
+}
+
+
+int QThread_setName(QThread thread, const char* threadName)
+{
+	QThreadNative native;
+
+	if (thread == NULL || threadName == NULL)
+		return QTHREAD_RETURN_ERROR;
+	if (thread->name != threadName)
+		snprintf(thread->name, sizeof(thread->name), "%s", threadName);
+	if (!GetNative(thread, &native))
+		return QTHREAD_RETURN_ERROR;
+
+#if defined(__linux__)
+	if (pthread_setname_np(native, thread->name) != 0)
+		return QTHREAD_RETURN_ERROR;
+	return QTHREAD_RETURN_OK;
+#else
+	{
+		typedef HRESULT (WINAPI *SetThreadDescriptionFunc)(HANDLE, PCWSTR);
+		static SetThreadDescriptionFunc setThreadDescription =
+			(SetThreadDescriptionFunc)GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription");
+		wchar_t wideName[QTHREAD_MAX_NAME_LENGTH + 1];
+		size_t i;
+
+		/* Windows 10 1607 and later */
+		if (setThreadDescription == NULL)
+			return QTHREAD_RETURN_ERROR;
+		for (i = 0; i <= strlen(thread->name); i++)
+			wideName[i] = (wchar_t)(unsigned char)thread->name[i];
+		return SUCCEEDED(setThreadDescription(native, wideName)) ? QTHREAD_RETURN_OK : QTHREAD_RETURN_ERROR;
+	}
+#endif
+}
+
+
+const char* QThread_getName(QThread thread)
+{
+	if (thread == NULL)
+		return "";
+	return thread->name;
+}
+
+
+int QThread_setAffinity(QThread thread, unsigned long long cpuMask)
+{
+	QThreadNative native;
+
+	if (thread == NULL || cpuMask == 0 || !GetNative(thread, &native))
+		return QTHREAD_RETURN_ERROR;
+
+#if defined(__linux__)
+	{
+		cpu_set_t cpus;
+		int cpu;
+
+		CPU_ZERO(&cpus);
+		for (cpu = 0; cpu < 64; cpu++)
+		{
+			if (cpuMask & (1ull << cpu))
+				CPU_SET(cpu, &cpus);
+		}
+		if (pthread_setaffinity_np(native, sizeof(cpus), &cpus) != 0)
+			return QTHREAD_RETURN_ERROR;
+		return QTHREAD_RETURN_OK;
+	}
+#else
+	if (SetThreadAffinityMask(native, (DWORD_PTR)cpuMask) == 0)
+		return QTHREAD_RETURN_ERROR;
+	return QTHREAD_RETURN_OK;
+#endif
+}
+
+
+int QThread_getNofCpus(void)
+{
+#if defined(__linux__)
+	cpu_set_t cpus;
+
+	if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0)
+		return CPU_COUNT(&cpus);
+#endif
+	return (int)std::thread::hardware_concurrency();
+}
@@ -0,0 +1,166 @@
+﻿#include "pch.h"
+#include "RTBus.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+typedef struct _RTBusSubscriber
+{
+	RTBusHandlerFunc    handler;
+	void               *context;
+} RTBusSubscriber;
+
+
+typedef struct _RTBusStruct
+{
+	RTBusSubscriber     subscribers[RT_BUS_NOF_OPCODES][RT_BUS_MAX_SUBSCRIBERS];
+	int                 nofSubscribers[RT_BUS_NOF_OPCODES];
+	unsigned long       nofPublished[RT_BUS_NOF_OPCODES];
+} RTBusStruct;
+
+
+/* instruction names of the opcodes, in rtBusOpcode order */
+static const char *rtBusOpcodeNames[RT_BUS_NOF_OPCODES] =
+{
+	"gameStart",
+	"gameEnd",
+	"updatePlayer",
+	"rtEvent",
+	"action",
+	"valueUpdate",
+	"loadLevel",
+	"unitAction",
+};
+
+
+
+int RTBusCreate(RTBus* bus)
+{
+	if (bus == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	*bus = (RTBus)calloc(1, sizeof(RTBusStruct));
+	if (*bus == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	return RT_RETURN_OK;
+}
+
+
+void RTBusDestroy(RTBus bus)
+{
+	free(bus);
+}
+
+
+int RTBusSubscribe(RTBus bus, int opcode, RTBusHandlerFunc handler, void* context)
+{
+	RTBusSubscriber *subscriber;
+
+	if (bus == NULL || handler == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (opcode < 0 || opcode >= RT_BUS_NOF_OPCODES)
+		return RT_RETURN_ILLEGAL_DATA;
+	if (bus->nofSubscribers[opcode] >= RT_BUS_MAX_SUBSCRIBERS)
+		return RT_RETURN_BUFFER_OVERFLOW;
+
+	subscriber = &bus->subscribers[opcode][bus->nofSubscribers[opcode]++];
+	subscriber->handler = handler;
+	subscriber->context = context;
+	return RT_RETURN_OK;
+}
+
+
+int RTBusSubscribeByName(RTBus bus, const char* name, RTBusHandlerFunc handler, void* context)
+{
+	int opcode = RTBusOpcodeOf(name);
+
+	if (opcode < 0)
+		return (name == NULL) ? RT_RETURN_ILLEGAL_NULL_POINTER : RT_RETURN_NOT_FOUND;
+	return RTBusSubscribe(bus, opcode, handler, context);
+}
+
+
+int RTBusUnsubscribe(RTBus bus, int opcode, RTBusHandlerFunc handler, void* context)
+{
+	RTBusSubscriber *subscribers;
+	int i;
+
+	if (bus == NULL || handler == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (opcode < 0 || opcode >= RT_BUS_NOF_OPCODES)
+		return RT_RETURN_NOT_FOUND;
+
+	subscribers = bus->subscribers[opcode];
+	for (i = 0; i < bus->nofSubscribers[opcode]; i++)
+	{
+		if (subscribers[i].handler == handler && subscribers[i].context == context)
+		{
+			/* keep the order of the others */
+			memmove(&subscribers[i], &subscribers[i + 1], (bus->nofSubscribers[opcode] - i - 1) * sizeof(RTBusSubscriber));
+			bus->nofSubscribers[opcode]--;
+			return RT_RETURN_OK;
+		}
+	}
+	return RT_RETURN_NOT_FOUND;
+}
+
+
+int RTBusGetNofSubscribers(RTBus bus, int opcode)
+{
+	if (bus == NULL || opcode < 0 || opcode >= RT_BUS_NOF_OPCODES)
+		return 0;
+	return bus->nofSubscribers[opcode];
+}
+
+
+int RTBusPublish(RTBus bus, const RTBusMessage* message)
+{
+	const RTBusSubscriber *subscriber;
+	const RTBusSubscriber *end;
+	int opcode;
+
+	if (bus == NULL || message == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	opcode = message->opcode;
+	if (opcode < 0 || opcode >= RT_BUS_NOF_OPCODES)
+		return RT_RETURN_ILLEGAL_DATA;
+
+	bus->nofPublished[opcode]++;
+	subscriber = bus->subscribers[opcode];
+	end = subscriber + bus->nofSubscribers[opcode];
+	for (; subscriber < end; subscriber++)
+		subscriber->handler(message, subscriber->context);
+	return RT_RETURN_OK;
+}
+
+
+unsigned long RTBusGetNofPublished(RTBus bus, int opcode)
+{
+	if (bus == NULL || opcode < 0 || opcode >= RT_BUS_NOF_OPCODES)
+		return 0;
+	return bus->nofPublished[opcode];
+}
+
+
+const char* RTBusOpcodeName(int opcode)
+{
+	if (opcode < 0 || opcode >= RT_BUS_NOF_OPCODES)
+		return NULL;
+	return rtBusOpcodeNames[opcode];
+}
+
+
+int RTBusOpcodeOf(const char* name)
+{
+	int opcode;
+
+	if (name == NULL)
+		return -1;
+	for (opcode = 0; opcode < RT_BUS_NOF_OPCODES; opcode++)
+	{
+		if (strcmp(name, rtBusOpcodeNames[opcode]) == 0)
+			return opcode;
+	}
+	return -1;
+}
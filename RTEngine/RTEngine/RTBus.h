@@ -0,0 +1,157 @@
+﻿#ifndef _RTBUS_H_
+#define _RTBUS_H_
+
+#include "RTEngine.h"
+#include "RTEventList.h"
+
+/*
+	Event bus between the engines and the host (the CALLBACK MAP of the documentation:
+	CB_Game_Event, CB_RT_Game_Event, CB_Action_Event and the value updates).
+
+	A message is an opcode with its payload stored inline in a tagged union, so publishing
+	copies nothing to the heap. Handlers are registered per opcode in a flat table:
+	Publish walks the handlers of its opcode and calls them, there is no lookup by name
+	and no allocation. RTBusSubscribeByName is the shim for registrations that still use
+	the instruction names ("gameStart", "updatePlayer", ...); the name is resolved once,
+	when the handler is registered.
+
+	PRE: messages are published from one thread at a time (the TIME_TICK thread), the
+	handlers run in that thread. Subscribe and Unsubscribe are not called while a message
+	is being published.
+*/
+
+
+enum rtBusOpcode
+{
+	RT_BUS_GAME_START,          /**< "gameStart", no payload */
+	RT_BUS_GAME_END,            /**< "gameEnd", no payload */
+	RT_BUS_PLAYER_UPDATE,       /**< "updatePlayer", player */
+	RT_BUS_EVENT_EXPIRED,       /**< "rtEvent", an event of the Event List ended, expired */
+	RT_BUS_ACTION,              /**< "action", action */
+	RT_BUS_VALUE_UPDATE,        /**< "valueUpdate", value */
+	RT_BUS_LOAD_LEVEL,          /**< "loadLevel", the live mode level of the instance changed, load */
+	RT_BUS_UNIT_ACTION,         /**< "unitAction", action with unit ids (GameClass::AddUnit) for entity and target */
+	RT_BUS_NOF_OPCODES
+};
+
+/** Handlers of one opcode */
+#define RT_BUS_MAX_SUBSCRIBERS      8
+
+
+/** The host changed the state of a player */
+typedef struct _RTBusPlayer
+{
+	int             entity;
+	unsigned int    states;         /**< what changed, VE_STATE_BIT of ValueEngine.h */
+} RTBusPlayer;
+
+typedef struct _RTBusExpired
+{
+	RTEventInfo     info;
+	double          endTime;
+} RTBusExpired;
+
+/** Something a player did, the fields of a VEEvent (ValueEngine.h) */
+typedef struct _RTBusAction
+{
+	int             type;           /**< veEventType */
+	int             entity;
+	int             target;         /**< -1 if the action has none, also for RT_BUS_UNIT_ACTION */
+	int             team;
+	float           amount;
+} RTBusAction;
+
+typedef struct _RTBusValue
+{
+	int             node;           /**< VE_NODE_* */
+	float           value;
+} RTBusValue;
+
+/** The instance shed more (or less) work to keep its latency, see live mode in RTEngine.h */
+typedef struct _RTBusLoad
+{
+	int             level;          /**< rtLiveLevel */
+	int             previous;
+} RTBusLoad;
+
+typedef struct _RTBusMessage
+{
+	int             opcode;         /**< rtBusOpcode, selects the member of the union */
+	double          time;           /**< game time in seconds */
+	union
+	{
+		RTBusPlayer     player;
+		RTBusExpired    expired;
+		RTBusAction     action;
+		RTBusValue      value;
+		RTBusLoad       load;
+	};
+} RTBusMessage;
+
+
+typedef void (*RTBusHandlerFunc)(const RTBusMessage* message, void* context);
+
+/* RTBus itself is declared in RTEngine.h */
+
+
+/**
+ * Creates a bus without subscribers.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int RTBusCreate(RTBus* bus);
+
+extern void RTBusDestroy(RTBus bus);
+
+/**
+ * Calls handler with context for every message of opcode, after the handlers registered before.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_ILLEGAL_DATA - unknown opcode
+ * @retval RT_RETURN_BUFFER_OVERFLOW - opcode already has RT_BUS_MAX_SUBSCRIBERS handlers
+ */
+extern int RTBusSubscribe(RTBus bus, int opcode, RTBusHandlerFunc handler, void* context);
+
+/**
+ * Shim for the instruction names of the callbacks: subscribes to the opcode named name.
+ *
+ * @retval RT_RETURN_NOT_FOUND - no opcode has that name
+ * @returns  All other RTBusSubscribe return values
+ */
+extern int RTBusSubscribeByName(RTBus bus, const char* name, RTBusHandlerFunc handler, void* context);
+
+/**
+ * Removes the handler registered with the same handler and context.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_NOT_FOUND
+ */
+extern int RTBusUnsubscribe(RTBus bus, int opcode, RTBusHandlerFunc handler, void* context);
+
+/** Number of handlers of opcode, to skip building a message nobody reads */
+extern int RTBusGetNofSubscribers(RTBus bus, int opcode);
+
+/**
+ * Delivers message to the handlers of message->opcode, in the calling thread.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_ILLEGAL_DATA - unknown opcode
+ */
+extern int RTBusPublish(RTBus bus, const RTBusMessage* message);
+
+/** Messages published with opcode */
+extern unsigned long RTBusGetNofPublished(RTBus bus, int opcode);
+
+/** The instruction name of opcode, NULL for an unknown one */
+extern const char* RTBusOpcodeName(int opcode);
+
+/** The opcode named name, -1 for an unknown one */
+extern int RTBusOpcodeOf(const char* name);
+
+
+#endif //_RTBUS_H_
@@ -0,0 +1,415 @@
+﻿#include "pch.h"
+#include "RTDataPool.h"
+
+#include <string.h>
+#include <new>
+#include <atomic>
+
+/* after the standard headers, du.h defines min/max */
+#include "du.h"
+
+
+/* every block is aligned to this, enough for the doubles in the shared block */
+#define RT_DATA_POOL_ALIGN      16
+#define RT_DATA_POOL_ROUND(size) (((size) + RT_DATA_POOL_ALIGN - 1) & ~(size_t)(RT_DATA_POOL_ALIGN - 1))
+
+
+/* userdata reference, shared by every data container (and clone) that refers to it */
+typedef struct _RTDataUserRef
+{
+	std::atomic<int>    refs;
+	void               *pUserData;
+	void              (*releaseFunc)(void* userdata);
+} RTDataUserRef;
+
+
+/* block shared between a data container and its clones until one of them is written */
+typedef struct _RTDataShared
+{
+	std::atomic<int>    refs;
+	RTPassage           passages[RT_MAX_NR_PASSAGES];
+	double              timestamps[RT_MAX_NR_PASSAGES];
+	int                 sourceIds[RT_MAX_NR_PASSAGES];
+	RTDataUserRef      *userRef;
+} RTDataShared;
+
+
+typedef enum _RTDataBlockKind
+{
+	RT_BLOCK_DATA = 0,
+	RT_BLOCK_SHARED,
+	RT_BLOCK_USERREF,
+	RT_NOF_BLOCK_KINDS
+} RTDataBlockKind;
+
+
+/* free blocks are chained through their first bytes */
+typedef struct _RTFreeBlock
+{
+	struct _RTFreeBlock *next;
+} RTFreeBlock;
+
+
+typedef struct _RTDataPoolStruct
+{
+	std::atomic_flag            lock;           /* protects the free lists, the DuMemPool and the counters below */
+	du_pool_t                  *memPool;
+	unsigned int                blocksPerSlab;
+	size_t                      blockSize[RT_NOF_BLOCK_KINDS];
+	RTFreeBlock                *freeList[RT_NOF_BLOCK_KINDS];
+
+	unsigned long               nofMallocs;
+	unsigned long               nofAllocs;
+	unsigned long               nofFrees;
+	std::atomic<unsigned long>  nofLiveData;
+	std::atomic<unsigned long>  nofClones;
+	std::atomic<unsigned long>  nofCopyOnWrite;
+} RTDataPoolStruct;
+
+
+
+static void PoolLock(RTDataPool pool)
+{
+	while (pool->lock.test_and_set(std::memory_order_acquire))
+		;
+}
+
+
+static void PoolUnlock(RTDataPool pool)
+{
+	pool->lock.clear(std::memory_order_release);
+}
+
+
+/* PRE: pool locked */
+static int RefillSlab(RTDataPool pool, RTDataBlockKind kind)
+{
+	size_t size = pool->blockSize[kind];
+	char *slab;
+	unsigned int i;
+
+	slab = (char*)DuMemPoolAlloc(pool->memPool, (unsigned long)(size * pool->blocksPerSlab));
+	if (slab == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	pool->nofMallocs++;
+
+	for (i = 0; i < pool->blocksPerSlab; i++)
+	{
+		RTFreeBlock *block = (RTFreeBlock*)(slab + i * size);
+		block->next = pool->freeList[kind];
+		pool->freeList[kind] = block;
+	}
+	return RT_RETURN_OK;
+}
+
+
+static void* AllocBlock(RTDataPool pool, RTDataBlockKind kind)
+{
+	RTFreeBlock *block = NULL;
+
+	PoolLock(pool);
+	if (pool->freeList[kind] != NULL || RefillSlab(pool, kind) == RT_RETURN_OK)
+	{
+		block = pool->freeList[kind];
+		pool->freeList[kind] = block->next;
+		pool->nofAllocs++;
+	}
+	PoolUnlock(pool);
+	return block;
+}
+
+
+static void FreeBlock(RTDataPool pool, RTDataBlockKind kind, void* ptr)
+{
+	RTFreeBlock *block = (RTFreeBlock*)ptr;
+
+	PoolLock(pool);
+	block->next = pool->freeList[kind];
+	pool->freeList[kind] = block;
+	pool->nofFrees++;
+	PoolUnlock(pool);
+}
+
+
+static void ReleaseUserRef(RTDataPool pool, RTDataUserRef* userRef)
+{
+	if (userRef == NULL)
+		return;
+	if (userRef->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	/* last reference */
+	if (userRef->releaseFunc != NULL)
+		userRef->releaseFunc(userRef->pUserData);
+	userRef->~RTDataUserRef();
+	FreeBlock(pool, RT_BLOCK_USERREF, userRef);
+}
+
+
+static void ReleaseShared(RTDataPool pool, RTDataShared* shared)
+{
+	if (shared->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	ReleaseUserRef(pool, shared->userRef);
+	shared->~RTDataShared();
+	FreeBlock(pool, RT_BLOCK_SHARED, shared);
+}
+
+
+/* points the public read only fields of data into its shared block */
+static void LinkShared(RTDataStruct* data, RTDataShared* shared)
+{
+	data->pPrivate = shared;
+	data->passages = shared->passages;
+	data->timestamps = shared->timestamps;
+	data->sourceIds = shared->sourceIds;
+	data->pUserData = (shared->userRef != NULL) ? shared->userRef->pUserData : NULL;
+}
+
+
+/*
+	Makes sure data is the only owner of its shared block, copying the block when
+	it is still shared with clones (copy-on-write).
+*/
+static int MakeWritable(RTDataPool pool, RTDataStruct* data)
+{
+	RTDataShared *shared = (RTDataShared*)data->pPrivate;
+	RTDataShared *copy;
+
+	if (shared->refs.load(std::memory_order_acquire) == 1)
+		return RT_RETURN_OK;
+
+	copy = (RTDataShared*)AllocBlock(pool, RT_BLOCK_SHARED);
+	if (copy == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	new (copy) RTDataShared();
+
+	copy->refs.store(1, std::memory_order_relaxed);
+	memcpy(copy->passages, shared->passages, sizeof(copy->passages));
+	memcpy(copy->timestamps, shared->timestamps, sizeof(copy->timestamps));
+	memcpy(copy->sourceIds, shared->sourceIds, sizeof(copy->sourceIds));
+	copy->userRef = shared->userRef;
+	if (copy->userRef != NULL)
+		copy->userRef->refs.fetch_add(1, std::memory_order_relaxed);
+
+	ReleaseShared(pool, shared);
+	LinkShared(data, copy);
+	pool->nofCopyOnWrite.fetch_add(1, std::memory_order_relaxed);
+	return RT_RETURN_OK;
+}
+
+
+static int IsValidData(RTDataStruct* data)
+{
+	return data != NULL && data->self == data && data->pPrivate != NULL;
+}
+
+
+
+int RTDataPoolCreate(unsigned int blocksPerSlab, RTDataPool* pool)
+{
+	RTDataPool p;
+
+	if (pool == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*pool = NULL;
+
+	if (blocksPerSlab == 0)
+		blocksPerSlab = RT_DATA_POOL_DEFAULT_BLOCKS_PER_SLAB;
+
+	p = new (std::nothrow) RTDataPoolStruct();
+	if (p == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+
+	p->lock.clear();
+	p->blocksPerSlab = blocksPerSlab;
+	p->blockSize[RT_BLOCK_DATA] = RT_DATA_POOL_ROUND(sizeof(RTDataStruct));
+	p->blockSize[RT_BLOCK_SHARED] = RT_DATA_POOL_ROUND(sizeof(RTDataShared));
+	p->blockSize[RT_BLOCK_USERREF] = RT_DATA_POOL_ROUND(sizeof(RTDataUserRef));
+	memset(p->freeList, 0, sizeof(p->freeList));
+	p->nofMallocs = 0;
+	p->nofAllocs = 0;
+	p->nofFrees = 0;
+	p->nofLiveData.store(0);
+	p->nofClones.store(0);
+	p->nofCopyOnWrite.store(0);
+
+	if (DuMemPoolCreate(&p->memPool, 0, (unsigned int)(p->blockSize[RT_BLOCK_DATA] * blocksPerSlab)) != DU_RETURN_OK)
+	{
+		delete p;
+		return RT_RETURN_OUT_OF_MEMORY;
+	}
+
+	*pool = p;
+	return RT_RETURN_OK;
+}
+
+
+void RTDataPoolDestroy(RTDataPool pool)
+{
+	if (pool == NULL)
+		return;
+	DuMemPoolDestroy(pool->memPool);
+	delete pool;
+}
+
+
+int RTDataPoolCreateData(RTDataPool pool, RTDataStruct** data)
+{
+	RTDataStruct *d;
+	RTDataShared *shared;
+
+	if (pool == NULL || data == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*data = NULL;
+
+	d = (RTDataStruct*)AllocBlock(pool, RT_BLOCK_DATA);
+	if (d == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	shared = (RTDataShared*)AllocBlock(pool, RT_BLOCK_SHARED);
+	if (shared == NULL)
+	{
+		FreeBlock(pool, RT_BLOCK_DATA, d);
+		return RT_RETURN_OUT_OF_MEMORY;
+	}
+
+	new (shared) RTDataShared();
+	shared->refs.store(1, std::memory_order_relaxed);
+	shared->userRef = NULL;
+
+	memset(d, 0, sizeof(RTDataStruct));
+	d->self = d;
+	LinkShared(d, shared);
+
+	pool->nofLiveData.fetch_add(1, std::memory_order_relaxed);
+	*data = d;
+	return RT_RETURN_OK;
+}
+
+
+int RTDataPoolCloneData(RTDataPool pool, RTDataStruct* srcdata, RTDataStruct** cloneddata)
+{
+	RTDataStruct *d;
+	RTDataShared *shared;
+
+	if (pool == NULL || cloneddata == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*cloneddata = NULL;
+	if (!IsValidData(srcdata))
+		return RT_RETURN_ILLEGAL_DATA;
+
+	d = (RTDataStruct*)AllocBlock(pool, RT_BLOCK_DATA);
+	if (d == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+
+	shared = (RTDataShared*)srcdata->pPrivate;
+	shared->refs.fetch_add(1, std::memory_order_relaxed);
+
+	memcpy(d, srcdata, sizeof(RTDataStruct));
+	d->self = d;
+	LinkShared(d, shared);
+
+	pool->nofLiveData.fetch_add(1, std::memory_order_relaxed);
+	pool->nofClones.fetch_add(1, std::memory_order_relaxed);
+	*cloneddata = d;
+	return RT_RETURN_OK;
+}
+
+
+int RTDataPoolAddPassage(RTDataPool pool, RTDataStruct* data, RTPassage passage,
+                         double passagetime, int passageSourceId)
+{
+	RTDataShared *shared;
+	int ret;
+
+	if (pool == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (!IsValidData(data))
+		return RT_RETURN_ILLEGAL_DATA;
+	if (data->nofpassages >= RT_MAX_NR_PASSAGES)
+		return RT_RETURN_ILLEGAL_NR_PASSAGES;
+
+	ret = MakeWritable(pool, data);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	shared = (RTDataShared*)data->pPrivate;
+	shared->passages[data->nofpassages] = passage;
+	shared->timestamps[data->nofpassages] = passagetime;
+	shared->sourceIds[data->nofpassages] = passageSourceId;
+	if (data->nofpassages == 0)
+		data->timeStamp = passagetime;
+	data->nofpassages++;
+	return RT_RETURN_OK;
+}
+
+
+int RTDataPoolSetUserData(RTDataPool pool, RTDataStruct* data, void* userdata,
+                          void (*releaseFunc)(void* userdata))
+{
+	RTDataShared *shared;
+	RTDataUserRef *userRef = NULL;
+	int ret;
+
+	if (pool == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (!IsValidData(data))
+		return RT_RETURN_ILLEGAL_DATA;
+
+	ret = MakeWritable(pool, data);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	if (userdata != NULL || releaseFunc != NULL)
+	{
+		userRef = (RTDataUserRef*)AllocBlock(pool, RT_BLOCK_USERREF);
+		if (userRef == NULL)
+			return RT_RETURN_OUT_OF_MEMORY;
+		new (userRef) RTDataUserRef();
+		userRef->refs.store(1, std::memory_order_relaxed);
+		userRef->pUserData = userdata;
+		userRef->releaseFunc = releaseFunc;
+	}
+
+	shared = (RTDataShared*)data->pPrivate;
+	ReleaseUserRef(pool, shared->userRef);
+	shared->userRef = userRef;
+	data->pUserData = userdata;
+	return RT_RETURN_OK;
+}
+
+
+int RTDataPoolDestroyData(RTDataPool pool, RTDataStruct* data)
+{
+	if (pool == NULL || data == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (!IsValidData(data))
+		return RT_RETURN_ILLEGAL_DATA;
+
+	ReleaseShared(pool, (RTDataShared*)data->pPrivate);
+	data->self = NULL;
+	data->pPrivate = NULL;
+	FreeBlock(pool, RT_BLOCK_DATA, data);
+
+	pool->nofLiveData.fetch_sub(1, std::memory_order_relaxed);
+	return RT_RETURN_OK;
+}
+
+
+int RTDataPoolGetStats(RTDataPool pool, RTDataAllocStats* stats)
+{
+	if (pool == NULL || stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	PoolLock(pool);
+	stats->nofMallocs = pool->nofMallocs;
+	stats->nofAllocs = pool->nofAllocs;
+	stats->nofFrees = pool->nofFrees;
+	PoolUnlock(pool);
+
+	stats->nofLiveData = pool->nofLiveData.load(std::memory_order_relaxed);
+	stats->nofClones = pool->nofClones.load(std::memory_order_relaxed);
+	stats->nofCopyOnWrite = pool->nofCopyOnWrite.load(std::memory_order_relaxed);
+	return RT_RETURN_OK;
+}
@@ -0,0 +1,63 @@
+﻿#ifndef _RTDATAPOOL_H_
+#define _RTDATAPOOL_H_
+
+#include "RTEngine.h"
+
+/*
+	Per-engine pool behind RTCoreCreateData / RTCoreCloneData / RTCoreDestroyData.
+
+	Data containers, the blocks they share between clones (passages, timestamps, sourceIds)
+	and the userdata references are carved from slabs that are requested from a DuMemPool
+	and never given back until the pool is destroyed. Freed blocks go to a free list, so a
+	replay in a steady state does not allocate. Sharing between clones is counted with
+	atomics, no kernel object is involved.
+
+	The pool may be used from several threads at the same time (input threads create,
+	the TIME_TICK thread destroys).
+*/
+
+
+/** Number of blocks of each kind carved from one slab */
+#define RT_DATA_POOL_DEFAULT_BLOCKS_PER_SLAB    256
+
+
+/** Forward declaration */
+typedef struct _RTDataPoolStruct *RTDataPool;
+
+
+/**
+ * Creates a data pool.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int RTDataPoolCreate(unsigned int blocksPerSlab, RTDataPool* pool);
+
+/**
+ * Destroys the pool and all its slabs. Every data container of the pool must be destroyed first.
+ */
+extern void RTDataPoolDestroy(RTDataPool pool);
+
+/** @see RTCoreCreateData */
+extern int RTDataPoolCreateData(RTDataPool pool, RTDataStruct** data);
+
+/** @see RTCoreCloneData */
+extern int RTDataPoolCloneData(RTDataPool pool, RTDataStruct* srcdata, RTDataStruct** cloneddata);
+
+/** @see RTCoreDataAddpassage */
+extern int RTDataPoolAddPassage(RTDataPool pool, RTDataStruct* data, RTPassage passage,
+                                double passagetime, int passageSourceId);
+
+/** @see RTCoreDataSetUserData */
+extern int RTDataPoolSetUserData(RTDataPool pool, RTDataStruct* data, void* userdata,
+                                 void (*releaseFunc)(void* userdata));
+
+/** @see RTCoreDestroyData */
+extern int RTDataPoolDestroyData(RTDataPool pool, RTDataStruct* data);
+
+/** @see RTCoreGetDataAllocStats */
+extern int RTDataPoolGetStats(RTDataPool pool, RTDataAllocStats* stats);
+
+
+#endif //_RTDATAPOOL_H_
@@ -1,6 +1,848 @@
 ﻿#include "pch.h"
 #include "RTEngine.h"
+#include "RTProcessBuffer.h"
+#include "RTEventList.h"
+#include "RTBus.h"
+#include "RTDataPool.h"
+#include "RTModuleGraph.h"
+#include "RTThreadPool.h"
+#include "RTLive.h"
+#include "RTStats.h"
+#include "qthreads.h"
 
+#include <stdlib.h>
+#include <new>
+#include <atomic>
+#include <chrono>
 
 
+/** Longest wait of the TIME_TICK thread when no deadline is pending, new input or finalize wake it earlier */
+#define RT_TIME_TICK_IDLE_WAIT_MSEC  10000
 
+
+/*
+	RTContext/Environment: game time of the last handled entry and the Event List
+	of effect durations and timed events.
+*/
+typedef struct _RTContextStruct
+{
+	double                                  lastTimeStampEvent;
+	RTEventList                             events;
+	std::chrono::steady_clock::time_point   lastTickWallTime;   /* wall time at lastTimeStampEvent */
+} RTContextStruct;
+
+
+/*
+	RTEngine instance. The main thread (or several input sources) push RTDataStructs
+	through RTInstanceProcess into the Process Buffer, the TIME_TICK thread drains it.
+	A synchronous instance has neither and handles the data in RTInstanceProcess.
+*/
+typedef struct _RTEngineInstanceStruct
+{
+	RTInstanceSettings          settings;
+
+	/* game seconds per wall second, 0 when game time only follows the input */
+	std::atomic<double>         replaySpeed;
+
+	RTDataPool                  dataPool;
+	RTProcessBuffer             processBuffer;
+	QThread                     timeTickThread;
+	std::atomic<int>            stopTimeTick;
+	RTContextStruct             context;
+	RTModuleGraph               modules;        /* NULL without modules */
+	RTLive                      live;           /* NULL outside live mode */
+
+	std::atomic<unsigned long>  nofProcessed;
+	std::atomic<unsigned long>  nofEvents;
+	std::atomic<double>         gameTime;
+} RTEngineInstanceStruct;
+
+
+/* settings, modules and instance of the RTCore* functions */
+static RTInstanceSettings glRTCoreSettings;
+static RTModuleSettings glRTCoreModules[RT_MAX_NOF_MODULES];
+static RTEngineInstance glRTCore;
+
+
+
+/* a target or a share, the thread settings alone need no governor */
+static int RTCoreIsLive(const RTLiveSettings* live)
+{
+	return live->targetLatency > 0.0 || live->cpuShare > 0.0;
+}
+
+
+static int RTCoreCheckSettings(const RTInstanceSettings* settings)
+{
+	if (settings->processBufferCapacity > (1u << 30))
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	if (settings->producerMode != RT_PROCESS_BUFFER_SINGLE_PRODUCER &&
+		settings->producerMode != RT_PROCESS_BUFFER_MULTI_PRODUCER)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	if (settings->overflowPolicy < RT_BUFFER_OVERFLOW_BLOCK || settings->overflowPolicy > RT_BUFFER_OVERFLOW_DROP_NEWEST)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	if (settings->replaySpeed < 0.0)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	if (settings->nofModules < 0 || settings->nofModuleWorkers < 0)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	if (settings->live.targetLatency < 0.0 || settings->live.window < 0.0 ||
+		settings->live.cpuShare < 0.0 || settings->live.cpuShare > 1.0)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	if (settings->live.priority < RT_THREAD_PRIORITY_LOWEST || settings->live.priority > RT_THREAD_PRIORITY_HIGHEST)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	/* the threads of a synchronous instance are the host's */
+	if (settings->synchronous && (RTCoreIsLive(&settings->live) || settings->live.cpuMask != 0 ||
+	                              settings->live.priority != RT_THREAD_PRIORITY_NORMAL))
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	return RT_RETURN_OK;
+}
+
+
+/*
+	Game time now, extrapolated from the last entry with the replay speed.
+*/
+static double RTCoreCurrentGameTime(RTEngineInstance inst, std::chrono::steady_clock::time_point now)
+{
+	std::chrono::duration<double> elapsed = now - inst->context.lastTickWallTime;
+	double speed = inst->replaySpeed.load(std::memory_order_relaxed);
+
+	if (speed <= 0.0)
+		return inst->context.lastTimeStampEvent;
+	return inst->context.lastTimeStampEvent + elapsed.count() * speed;
+}
+
+
+/*
+	How long the TIME_TICK thread may sleep: until the next Event List deadline, or
+	until new input when game time does not run on its own.
+*/
+static unsigned int RTCoreNextWaitTime(RTEngineInstance inst)
+{
+	double speed = inst->replaySpeed.load(std::memory_order_relaxed);
+	double nextEnd;
+	double waitMsec;
+
+	if (speed <= 0.0 || RTEventListPeekNext(inst->context.events, &nextEnd) != RT_RETURN_OK)
+		return RT_TIME_TICK_IDLE_WAIT_MSEC;
+
+	waitMsec = (nextEnd - RTCoreCurrentGameTime(inst, std::chrono::steady_clock::now())) / speed * 1000.0;
+	if (waitMsec <= 0.0)
+		return 0;
+	if (waitMsec >= RT_TIME_TICK_IDLE_WAIT_MSEC)
+		return RT_TIME_TICK_IDLE_WAIT_MSEC;
+	/* round up, waking before the deadline only costs another wait */
+	return (unsigned int)waitMsec + 1;
+}
+
+
+/* An event that ended: the EventHandler, then RT_BUS_EVENT_EXPIRED on the bus */
+static void RTCoreTriggerEvent(RTEngineInstance inst, const RTEventInfo* event, double endTime)
+{
+	RTBusMessage message;
+
+	if (inst->settings.eventHandler != NULL)
+		inst->settings.eventHandler(event, endTime, inst->settings.eventHandlerContext);
+	if (RTBusGetNofSubscribers(inst->settings.bus, RT_BUS_EVENT_EXPIRED) != 0)
+	{
+		message.opcode = RT_BUS_EVENT_EXPIRED;
+		message.time = endTime;
+		message.expired.info = *event;
+		message.expired.endTime = endTime;
+		RTBusPublish(inst->settings.bus, &message);
+	}
+}
+
+
+/*
+	Triggers every event that ended at or before time, in end time order.
+*/
+static void RTCoreExpireEvents(RTEngineInstance inst, double time)
+{
+	RTEventInfo event;
+	double endTime;
+	int triggered = (inst->settings.eventHandler != NULL || inst->settings.bus != NULL);
+#ifdef RT_WITH_STATS
+	uint64_t start = RTStatsNow();
+	uint64_t handlerStart;
+	uint64_t handlerTicks = 0;
+#endif
+
+	while (RTEventListPopExpired(inst->context.events, time, &event, &endTime) == RT_RETURN_OK)
+	{
+		if (triggered)
+		{
+#ifdef RT_WITH_STATS
+			handlerStart = RTStatsNow();
+			RTCoreTriggerEvent(inst, &event, endTime);
+			handlerStart = RTStatsNow() - handlerStart;
+			handlerTicks += handlerStart;
+			RTStatsRecord(RT_STAGE_HOST_CALLBACK, handlerStart);
+#else
+			RTCoreTriggerEvent(inst, &event, endTime);
+#endif
+		}
+		inst->nofEvents.fetch_add(1, std::memory_order_relaxed);
+	}
+
+#ifdef RT_WITH_STATS
+	/* the Event List alone, the host had its own stage */
+	RTStatsRecord(RT_STAGE_EVENT_LIST, RTStatsNow() - start - handlerTicks);
+#endif
+}
+
+
+/*
+	Handles one entry of the Process Buffer, or only the passage of time when data == NULL.
+	Without commit the time moves on to the entry, but the results of its modules are not
+	committed (the modules did not run on it).
+*/
+static void RTCoreTimeTick(RTEngineInstance inst, RTDataStruct* data, int commit)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double newTime;
+
+	if (data != NULL)
+		newTime = data->timeStamp;
+	else if (inst->replaySpeed.load(std::memory_order_relaxed) > 0.0)
+		newTime = RTCoreCurrentGameTime(inst, now);
+	else
+		return;
+
+	/* game time never runs backwards, late entries are handled at the current time */
+	if (newTime < inst->context.lastTimeStampEvent)
+		newTime = inst->context.lastTimeStampEvent;
+
+	/* effects/events that ended before this time */
+	RTCoreExpireEvents(inst, newTime);
+
+	inst->context.lastTimeStampEvent = newTime;
+	inst->context.lastTickWallTime = now;
+	inst->gameTime.store(newTime, std::memory_order_relaxed);
+
+	if (data == NULL || !commit)
+		return;
+
+	/* the modules handled the entry, their commits may add events to the Event List */
+	if (inst->modules != NULL)
+		RTModuleGraphCommit(inst->modules, data);
+
+	inst->nofProcessed.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/*
+	Live mode: the batch (or idle tick) that started at start is done. Publishes a level
+	change and sleeps off what the thread used over its share.
+*/
+static void RTCoreLiveBatchDone(RTEngineInstance inst, int count, double start)
+{
+	RTBusMessage message;
+	unsigned int throttleMsec;
+	double now = RTLiveNow();
+	int previous;
+
+	throttleMsec = RTLiveBatchDone(inst->live, count, now - start, now, &previous);
+	if (previous >= 0 && RTBusGetNofSubscribers(inst->settings.bus, RT_BUS_LOAD_LEVEL) != 0)
+	{
+		message.opcode = RT_BUS_LOAD_LEVEL;
+		message.time = inst->context.lastTimeStampEvent;
+		message.load.level = RTLiveGetLevel(inst->live);
+		message.load.previous = previous;
+		RTBusPublish(inst->settings.bus, &message);
+	}
+	/* finalizing drains at full speed */
+	if (throttleMsec > 0 && !inst->stopTimeTick.load())
+	{
+		QThread_sleep(throttleMsec);
+		RTLiveThrottled(inst->live, RTLiveNow() - now);
+	}
+}
+
+
+static void* RTCoreTimeTickThread(void* threadData)
+{
+	RTEngineInstance inst = (RTEngineInstance)threadData;
+	RTDataStruct *batch[RT_PROCESS_BUFFER_MAX_BATCH];
+	unsigned int waitMsec;
+	double start = 0.0;
+	int modulesRun;
+	int count;
+	int i;
+
+	/* a setting the system refuses leaves the thread as it was, the share is still kept */
+	if (inst->settings.live.cpuMask != 0 || inst->settings.live.priority != RT_THREAD_PRIORITY_NORMAL)
+		RTThreadSetCurrent(inst->settings.live.cpuMask, inst->settings.live.priority);
+
+	for (;;)
+	{
+		/* when finalizing only drain what is left, do not sleep anymore */
+		waitMsec = inst->stopTimeTick.load() ? 0 : RTLiveMaxWait(inst->live, RTCoreNextWaitTime(inst));
+
+		RTProcessBufferPopBatch(inst->processBuffer, batch, RT_PROCESS_BUFFER_MAX_BATCH, &count, waitMsec);
+		if (inst->live != NULL)
+			start = RTLiveNow();
+
+		if (count == 0)
+		{
+			if (inst->stopTimeTick.load())
+				break;
+			RTCoreTimeTick(inst, NULL, 0);
+			if (inst->live != NULL)
+				RTCoreLiveBatchDone(inst, 0, start);
+			continue;
+		}
+
+		/* the modules work through the batch ahead, entries are handled as they are done */
+		modulesRun = (inst->modules == NULL || RTModuleGraphRun(inst->modules, batch, count) == RT_RETURN_OK);
+
+		for (i = 0; i < count; i++)
+		{
+			if (inst->modules != NULL && modulesRun)
+			{
+				RT_STATS_BEGIN(RT_STAGE_MODULES);
+				RTModuleGraphWait(inst->modules, i);
+				RT_STATS_END(RT_STAGE_MODULES);
+			}
+			/* without module results the time still moves on to the entry, but nothing is committed */
+			RT_STATS_BEGIN(RT_STAGE_TIME_TICK);
+			RTCoreTimeTick(inst, batch[i], modulesRun);
+			RT_STATS_END(RT_STAGE_TIME_TICK);
+			if (inst->live != NULL)
+				RTLiveEntryDone(inst->live, batch[i]->arrivalTime, RTLiveNow());
+			RTDataPoolDestroyData(inst->dataPool, batch[i]);
+		}
+		if (inst->live != NULL)
+			RTCoreLiveBatchDone(inst, count, start);
+	}
+	return NULL;
+}
+
+
+/* releases whatever RTInstanceCreate managed to create */
+static void RTCoreFreeInstance(RTEngineInstance inst)
+{
+	if (inst->modules != NULL)
+		RTModuleGraphDestroy(inst->modules);
+	if (inst->live != NULL)
+		RTLiveDestroy(inst->live);
+	if (inst->context.events != NULL)
+		RTEventListDestroy(inst->context.events);
+	if (inst->processBuffer != NULL)
+		RTProcessBufferDestroy(inst->processBuffer);
+	if (inst->dataPool != NULL)
+		RTDataPoolDestroy(inst->dataPool);
+	delete inst;
+}
+
+
+
+int RTInstanceCreate(const char* instance_name, const RTInstanceSettings* settings, RTEngineInstance* instance)
+{
+	RTEngineInstance inst;
+	int ret;
+
+	if (instance == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*instance = NULL;
+
+	inst = new (std::nothrow) RTEngineInstanceStruct();
+	if (inst == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	if (settings != NULL)
+		inst->settings = *settings;
+
+	ret = RTCoreCheckSettings(&inst->settings);
+	if (ret != RT_RETURN_OK)
+	{
+		RTCoreFreeInstance(inst);
+		return ret;
+	}
+	inst->replaySpeed.store(inst->settings.synchronous ? 0.0 : inst->settings.replaySpeed);
+
+	ret = RTDataPoolCreate(RT_DATA_POOL_DEFAULT_BLOCKS_PER_SLAB, &inst->dataPool);
+	if (ret == RT_RETURN_OK && !inst->settings.synchronous)
+		ret = RTProcessBufferCreate(inst->settings.processBufferCapacity != 0 ? inst->settings.processBufferCapacity
+		                                                                      : RT_PROCESS_BUFFER_DEFAULT_CAPACITY,
+		                            inst->settings.producerMode, (RTBufferOverflowPolicy)inst->settings.overflowPolicy,
+		                            &inst->processBuffer);
+	if (ret == RT_RETURN_OK)
+		ret = RTEventListCreate(RT_EVENT_LIST_DEFAULT_CAPACITY, &inst->context.events);
+	if (ret == RT_RETURN_OK && inst->settings.nofModules > 0)
+		ret = RTModuleGraphCreate(inst->settings.modules, inst->settings.nofModules,
+		                          inst->settings.nofModuleWorkers, &inst->modules);
+	if (ret == RT_RETURN_OK && RTCoreIsLive(&inst->settings.live))
+		ret = RTLiveCreate(&inst->settings.live, &inst->live);
+	if (ret == RT_RETURN_OK && inst->modules != NULL &&
+		(inst->settings.live.cpuMask != 0 || inst->settings.live.priority != RT_THREAD_PRIORITY_NORMAL))
+		ret = RTModuleGraphSetThreadSettings(inst->modules, inst->settings.live.cpuMask, inst->settings.live.priority);
+	if (ret != RT_RETURN_OK)
+	{
+		RTCoreFreeInstance(inst);
+		return ret;
+	}
+	inst->context.lastTimeStampEvent = 0.0;
+	inst->context.lastTickWallTime = std::chrono::steady_clock::now();
+
+	if (!inst->settings.synchronous)
+	{
+		inst->stopTimeTick.store(0);
+		if (QThread_create(&inst->timeTickThread, instance_name != NULL ? instance_name : "TIME_TICK",
+		                   RTCoreTimeTickThread, inst) != QTHREAD_RETURN_OK)
+		{
+			RTCoreFreeInstance(inst);
+			return RT_RETURN_INTERNAL_ERROR;
+		}
+	}
+
+	*instance = inst;
+	return RT_RETURN_OK;
+}
+
+
+int RTInstanceDestroy(RTEngineInstance instance)
+{
+	if (instance == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	if (instance->timeTickThread != NULL)
+	{
+		/* the TIME_TICK thread drains what is left in the buffer before leaving */
+		instance->stopTimeTick.store(1);
+		RTProcessBufferWakeUp(instance->processBuffer);
+		QThread_join(instance->timeTickThread, NULL);
+	}
+	RTCoreFreeInstance(instance);
+	return RT_RETURN_OK;
+}
+
+
+int RTInstanceSetReplaySpeed(RTEngineInstance instance, double speed)
+{
+	if (instance == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (speed < 0.0)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	if (instance->settings.synchronous)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+
+	/* the TIME_TICK thread picks it up on its next wait */
+	instance->replaySpeed.store(speed);
+	RTProcessBufferWakeUp(instance->processBuffer);
+	return RT_RETURN_OK;
+}
+
+
+ValueEngineContext RTInstanceGetValueEngine(RTEngineInstance instance)
+{
+	return (instance != NULL) ? instance->settings.valueEngine : NULL;
+}
+
+
+void* RTInstanceGetMatchContext(RTEngineInstance instance)
+{
+	return (instance != NULL) ? instance->settings.matchContext : NULL;
+}
+
+
+RTEventList RTInstanceGetEventList(RTEngineInstance instance)
+{
+	return (instance != NULL) ? instance->context.events : NULL;
+}
+
+
+int RTInstanceCreateData(RTEngineInstance instance, RTDataStruct** data)
+{
+	if (instance == NULL || data == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	return RTDataPoolCreateData(instance->dataPool, data);
+}
+
+
+int RTInstanceDestroyData(RTEngineInstance instance, RTDataStruct* data)
+{
+	if (instance == NULL || data == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	return RTDataPoolDestroyData(instance->dataPool, data);
+}
+
+
+int RTInstanceCloneData(RTEngineInstance instance, RTDataStruct* srcdata, RTDataStruct** cloneddata)
+{
+	if (instance == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	return RTDataPoolCloneData(instance->dataPool, srcdata, cloneddata);
+}
+
+
+int RTInstanceDataAddpassage(RTEngineInstance instance, RTDataStruct* data, RTPassage passage,
+                             double passagetime, int passageSourceId)
+{
+	if (instance == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	return RTDataPoolAddPassage(instance->dataPool, data, passage, passagetime, passageSourceId);
+}
+
+
+int RTInstanceDataSetUserData(RTEngineInstance instance, RTDataStruct* data, void* userdata,
+                              void (*releaseFunc)(void* userdata))
+{
+	if (instance == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	return RTDataPoolSetUserData(instance->dataPool, data, userdata, releaseFunc);
+}
+
+
+int RTInstanceGetDataAllocStats(RTEngineInstance instance, RTDataAllocStats* stats)
+{
+	if (instance == NULL || stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	return RTDataPoolGetStats(instance->dataPool, stats);
+}
+
+
+int RTInstanceProcess(RTEngineInstance instance, RTDataStruct* data)
+{
+	RTProcessBufferStats bufferStats;
+	RTDataStruct *dropped;
+	int ret;
+
+	if (instance == NULL || data == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	if (instance->settings.synchronous)
+	{
+		if (instance->modules != NULL)
+		{
+			RT_STATS_BEGIN(RT_STAGE_MODULES);
+			ret = RTModuleGraphRun(instance->modules, &data, 1);
+			if (ret == RT_RETURN_OK)
+				RTModuleGraphWait(instance->modules, 0);
+			RT_STATS_END(RT_STAGE_MODULES);
+			/* the modules did not run, nothing to commit */
+			if (ret != RT_RETURN_OK)
+			{
+				RTDataPoolDestroyData(instance->dataPool, data);
+				return ret;
+			}
+		}
+		RT_STATS_BEGIN(RT_STAGE_TIME_TICK);
+		RTCoreTimeTick(instance, data, 1);
+		RT_STATS_END(RT_STAGE_TIME_TICK);
+		return RTDataPoolDestroyData(instance->dataPool, data);
+	}
+
+	if (instance->live != NULL)
+	{
+		data->arrivalTime = RTLiveNow();
+		/* an entry that would wait past the target is not worth the work */
+		if (RTLiveGetLevel(instance->live) == RT_LIVE_LEVEL_DROP_PASSAGES &&
+			RTProcessBufferGetStats(instance->processBuffer, &bufferStats) == RT_RETURN_OK &&
+			!RTLiveAdmit(instance->live, bufferStats.depth))
+		{
+			RT_STATS_COUNT(RT_COUNTER_PASSAGE_DROPPED, 1);
+			RTDataPoolDestroyData(instance->dataPool, data);
+			return RT_RETURN_PASSAGE_DROPPED;
+		}
+	}
+
+	ret = RTProcessBufferPush(instance->processBuffer, data, &dropped);
+	if (dropped != NULL)
+		RTDataPoolDestroyData(instance->dataPool, dropped);
+	return ret;
+}
+
+
+int RTInstanceGetStats(RTEngineInstance instance, RTInstanceStats* stats)
+{
+	if (instance == NULL || stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	stats->nofProcessed = instance->nofProcessed.load(std::memory_order_relaxed);
+	stats->nofEvents = instance->nofEvents.load(std::memory_order_relaxed);
+	stats->gameTime = instance->gameTime.load(std::memory_order_relaxed);
+	return RT_RETURN_OK;
+}
+
+
+int RTInstanceGetLiveLevel(RTEngineInstance instance)
+{
+	return (instance != NULL) ? RTLiveGetLevel(instance->live) : RT_LIVE_LEVEL_FULL;
+}
+
+
+int RTInstanceGetLiveStats(RTEngineInstance instance, RTLiveStats* stats)
+{
+	if (instance == NULL || stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (instance->live == NULL)
+		return RT_RETURN_NOT_FOUND;
+
+	return RTLiveGetStats(instance->live, stats);
+}
+
+
+int RTInstanceGetNofModules(RTEngineInstance instance)
+{
+	return (instance != NULL) ? RTModuleGraphGetNofModules(instance->modules) : 0;
+}
+
+
+int RTInstanceGetModuleStats(RTEngineInstance instance, int moduleIndex, RTModuleStats* stats)
+{
+	if (instance == NULL || stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (instance->modules == NULL)
+		return RT_RETURN_ILLEGAL_MODULE_INDEX;
+
+	return RTModuleGraphGetStats(instance->modules, moduleIndex, stats);
+}
+
+
+
+int RTCoreSetProcessBufferSettings(unsigned int capacity, int producerMode, int overflowPolicy)
+{
+	RTInstanceSettings settings = glRTCoreSettings;
+
+	if (glRTCore != NULL || capacity == 0)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+
+	settings.processBufferCapacity = capacity;
+	settings.producerMode = producerMode;
+	settings.overflowPolicy = overflowPolicy;
+	if (RTCoreCheckSettings(&settings) != RT_RETURN_OK)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+
+	glRTCoreSettings = settings;
+	return RT_RETURN_OK;
+}
+
+
+int RTCoreSetReplaySpeed(double speed)
+{
+	if (speed < 0.0)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+
+	/* PRE: from the main thread */
+	glRTCoreSettings.replaySpeed = speed;
+	if (glRTCore != NULL)
+		return RTInstanceSetReplaySpeed(glRTCore, speed);
+	return RT_RETURN_OK;
+}
+
+
+int RTCoreSetEventHandler(RTEventHandlerFunc handler, void* context)
+{
+	if (glRTCore != NULL)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+
+	glRTCoreSettings.eventHandler = handler;
+	glRTCoreSettings.eventHandlerContext = context;
+	return RT_RETURN_OK;
+}
+
+
+int RTCoreSetBus(RTBus bus)
+{
+	if (glRTCore != NULL)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+
+	glRTCoreSettings.bus = bus;
+	return RT_RETURN_OK;
+}
+
+
+int RTLinkToValueEngine(ValueEngineContext engine)
+{
+	if (glRTCore != NULL)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+
+	glRTCoreSettings.valueEngine = engine;
+	return RT_RETURN_OK;
+}
+
+
+int RTCoreAddModule(const RTModuleSettings* module, int* moduleIndex)
+{
+	if (module == NULL || module->process == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (glRTCore != NULL)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	if (glRTCoreSettings.nofModules >= RT_MAX_NOF_MODULES)
+		return RT_RETURN_MAX_NOF_MODULES_REACHED;
+
+	glRTCoreModules[glRTCoreSettings.nofModules] = *module;
+	if (moduleIndex != NULL)
+		*moduleIndex = glRTCoreSettings.nofModules;
+	glRTCoreSettings.modules = glRTCoreModules;
+	glRTCoreSettings.nofModules++;
+	return RT_RETURN_OK;
+}
+
+
+int RTCoreSetModuleWorkers(int nofWorkers)
+{
+	if (glRTCore != NULL || nofWorkers < 0)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+
+	glRTCoreSettings.nofModuleWorkers = nofWorkers;
+	return RT_RETURN_OK;
+}
+
+
+int RTCoreSetLiveSettings(const RTLiveSettings* live)
+{
+	RTInstanceSettings settings = glRTCoreSettings;
+
+	if (live == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (glRTCore != NULL)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+
+	settings.live = *live;
+	if (RTCoreCheckSettings(&settings) != RT_RETURN_OK)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+
+	glRTCoreSettings = settings;
+	return RT_RETURN_OK;
+}
+
+
+int RTCoreGetLiveLevel(void)
+{
+	return RTInstanceGetLiveLevel(glRTCore);
+}
+
+
+int RTCoreGetLiveStats(RTLiveStats* stats)
+{
+	if (stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (glRTCore == NULL)
+		return RT_RETURN_LIB_NOT_INITIALIZED;
+
+	return RTInstanceGetLiveStats(glRTCore, stats);
+}
+
+
+int RTCoreGetModuleStats(int moduleIndex, RTModuleStats* stats)
+{
+	if (stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (glRTCore == NULL)
+		return RT_RETURN_LIB_NOT_INITIALIZED;
+
+	return RTInstanceGetModuleStats(glRTCore, moduleIndex, stats);
+}
+
+
+RTEventList RTCoreGetEventList(void)
+{
+	return RTInstanceGetEventList(glRTCore);
+}
+
+
+int RTCoreInit(const char *instance_name, const char* options, RTEngineInstance* reference)
+{
+	int ret;
+
+	(void)options;
+
+	if (glRTCore == NULL)
+	{
+		ret = RTInstanceCreate(instance_name, &glRTCoreSettings, &glRTCore);
+		if (ret != RT_RETURN_OK)
+			return ret;
+	}
+
+	if (reference != NULL)
+		*reference = glRTCore;
+	return RT_RETURN_OK;
+}
+
+
+int RTCoreFinalize(void)
+{
+	if (glRTCore == NULL)
+		return RT_RETURN_OK;
+
+	RTInstanceDestroy(glRTCore);
+	glRTCore = NULL;
+	return RT_RETURN_OK;
+}
+
+
+int RTCoreCreateData(RTDataStruct** data)
+{
+	if (data == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (glRTCore == NULL)
+		return RT_RETURN_LIB_NOT_INITIALIZED;
+
+	return RTInstanceCreateData(glRTCore, data);
+}
+
+
+int RTCoreCloneData(RTDataStruct* srcdata, RTDataStruct** cloneddata)
+{
+	if (glRTCore == NULL)
+		return RT_RETURN_LIB_NOT_INITIALIZED;
+
+	return RTInstanceCloneData(glRTCore, srcdata, cloneddata);
+}
+
+
+int RTCoreDataAddpassage(RTDataStruct* data, RTPassage passage, double passagetime, int passageSourceId)
+{
+	if (glRTCore == NULL)
+		return RT_RETURN_LIB_NOT_INITIALIZED;
+
+	return RTInstanceDataAddpassage(glRTCore, data, passage, passagetime, passageSourceId);
+}
+
+
+int RTCoreDataSetUserData(RTDataStruct* data, void* userdata, void (*releaseFunc)(void* userdata))
+{
+	if (glRTCore == NULL)
+		return RT_RETURN_LIB_NOT_INITIALIZED;
+
+	return RTInstanceDataSetUserData(glRTCore, data, userdata, releaseFunc);
+}
+
+
+int RTCoreDestroyData(RTDataStruct* data)
+{
+	if (data == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (glRTCore == NULL)
+		return RT_RETURN_LIB_NOT_INITIALIZED;
+
+	return RTInstanceDestroyData(glRTCore, data);
+}
+
+
+int RTCoreGetDataAllocStats(RTDataAllocStats* stats)
+{
+	if (stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (glRTCore == NULL)
+		return RT_RETURN_LIB_NOT_INITIALIZED;
+
+	return RTInstanceGetDataAllocStats(glRTCore, stats);
+}
+
+
+int RTCoreProcess(RTDataStruct* data)
+{
+	if (data == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (glRTCore == NULL)
+		return RT_RETURN_LIB_NOT_INITIALIZED;
+
+	return RTInstanceProcess(glRTCore, data);
+}
@@ -10,12 +10,10 @@
 
 
 
-/*	TO DO:
-
-. Module system? ReadRegister -> to action analysis -> to grouped action passage -> to macro value
-									                                             \-> to micro value 	
-.
+/*	Module system (see RTCoreAddModule):
 
+	ReadRegister -> to action analysis -> to grouped action passage -> to macro value
+									                                   \-> to micro value
 */
 
 
@@ -25,13 +23,12 @@
 	Delete as they are defined
 */
 
-extern class RTEngineInstance;
+/** An RTEngine instance, owns everything one match needs (see RTInstanceCreate) */
+typedef struct _RTEngineInstanceStruct *RTEngineInstance;
 
-extern class RTPassage;
+/** RTPassage is a pointer to opaque data type */
+typedef struct _RTPassageStruct *RTPassage;
 
-typedef struct _RTDataStruct {
-}
-RTDataStruct;
 
 
 /**
@@ -54,6 +51,16 @@ RTDataStruct;
     is not implemented by the module. Since the value of this define is set to 100 it does not interfere
     with any RT native StormValue return messages (except return)*/
 #define RT_RETURN_OK							0
+#define RT_RETURN_OUT_OF_MEMORY                 1
+#define RT_RETURN_LIB_NOT_INITIALIZED           2
+#define RT_RETURN_ILLEGAL_NULL_POINTER          3
+#define RT_RETURN_INTERNAL_ERROR                4
+#define RT_RETURN_NOT_FOUND                     5
+#define RT_RETURN_ILLEGAL_DATA                  6
+#define RT_RETURN_ILLEGAL_NR_PASSAGES           7
+#define RT_RETURN_CANNOT_OPEN_FILE              8
+#define RT_RETURN_END_OF_LOG                    9
+#define RT_RETURN_NO_DATA_YET                   10
 #define RT_RETURN_NOT_IMPLEMENTED               100
 #define RT_RETURN_ILLEGAL_SOURCE_ID             101
 #define RT_RETURN_MAX_NOF_MODULES_REACHED       102
@@ -64,25 +71,48 @@ RTDataStruct;
 #define RT_RETURN_SETTING_NOT_ALLOWED           107
 
 
+/** Maximum number of passages in one data container */
+#define RT_MAX_NR_PASSAGES      4
+/** Maximum number of processing modules */
+#define RT_MAX_NOF_MODULES      16
+
 
-///** Represents an RTData instance. */
-//typedef struct _RTDataStruct
-//{
-//  struct _RTDataStruct   *self;
-//  int                             nofpassages;
-//  RTPassage                    passages[RT_MAX_NR_IMAGES];        /** RTPassage is a pointer to opaque data type */ 
-//  double                          timestamps[RT_MAX_NR_IMAGES];    /**< Timestamp of passage in seconds (and fraction of seconds) */
-//  int                             sourceIds[RT_MAX_NR_IMAGES];  /**< ID of originating passagesource */ 
-//  void                            *pUserData;
-//  void                            (*userDataReleaseFunc)(void* userdata);
-//  QThread_Semaphore               userDataIsInClone; /** count is more than 0 when userdata is still in a cloned instance of this data struct */
-//  void                            *moduleData[MAX_NOF_MODULES];  /**< holds the data for each module */
-//  int                             moduleReturnValue[MAX_NOF_MODULES];
-//  int                             haserror;
-//  int                             nofModules;  
-//  void                            *pPrivate; /**< private field, do not use */
-//} RTDataStruct;
-//
+/**
+ * Represents an RTData instance.
+ *
+ * Data containers come from a per-engine pool (RTCoreCreateData) and clones are copy-on-write:
+ * passages, timestamps, sourceIds and userdata live in a block that is shared between clones
+ * through an atomic reference count. The pointers below refer into that block, they are read
+ * only and may change on RTCoreDataAddpassage / RTCoreDataSetUserData.
+ */
+typedef struct _RTDataStruct
+{
+	struct _RTDataStruct   *self;
+	double                  timeStamp;          /**< game time of the entry in seconds (timestamp of the first passage) */
+	int                     nofpassages;
+	const RTPassage        *passages;           /**< RTPassage is a pointer to opaque data type */
+	const double           *timestamps;         /**< Timestamp of passage in seconds (and fraction of seconds) */
+	const int              *sourceIds;          /**< ID of originating passagesource */
+	void                   *pUserData;
+	void                   *moduleData[RT_MAX_NOF_MODULES];  /**< holds the data for each module */
+	int                     moduleReturnValue[RT_MAX_NOF_MODULES];
+	int                     haserror;
+	int                     nofModules;
+	double                  arrivalTime;        /**< steady clock seconds of RTInstanceProcess, set in live mode */
+	void                   *pPrivate; /**< private field, do not use */
+} RTDataStruct;
+
+
+/** Allocation counters of the data pool, see RTCoreGetDataAllocStats */
+typedef struct _RTDataAllocStats
+{
+	unsigned long nofMallocs;       /**< slabs requested from the system, constant in a steady state */
+	unsigned long nofAllocs;        /**< blocks handed out by the pool (data, shared blocks and userdata) */
+	unsigned long nofFrees;         /**< blocks returned to the pool */
+	unsigned long nofLiveData;      /**< data containers currently alive */
+	unsigned long nofClones;        /**< RTCoreCloneData calls */
+	unsigned long nofCopyOnWrite;   /**< shared blocks copied because a clone was written */
+} RTDataAllocStats;
 
 
 /** PRE: should be called from one thread at a time */
@@ -93,10 +123,86 @@ typedef int (*RTEngineFinitFunc)(void);
 
 
 
+
+
+/*
+	Modules
+
+	A module handles every data container the engine processes. It declares the products
+	it reads (inputs) and the products it writes (outputs); a module that reads a product
+	runs after the module that writes it. Modules that do not depend on each other, such
+	as macro and micro value, run at the same time on the module workers of the instance.
+
+	A module writes its result to data->moduleData[moduleIndex] and its return value to
+	data->moduleReturnValue[moduleIndex]. When a module fails, the modules that depend on
+	it are skipped for that data (RT_RETURN_NO_DATA_YET) and data->haserror is set.
+
+	The process function of a module runs for one data container at a time, in timestamp
+	order, but possibly on a module worker and ahead of the TIME_TICK thread. Everything
+	that touches the RTContext (Event List, game state) belongs in the commit function,
+	which the TIME_TICK thread calls in timestamp order once all modules handled the data.
+*/
+
+/** Products of the module chain. A module may define further products from RT_PRODUCT_FIRST_USER on. */
+enum rtModuleProduct
+{
+	RT_PRODUCT_PASSAGES,            /**< the passages of the data container, always available */
+	RT_PRODUCT_REGISTER,            /**< ReadRegister: the parsed entry */
+	RT_PRODUCT_ACTIONS,             /**< action analysis */
+	RT_PRODUCT_GROUPED_ACTIONS,     /**< grouped action passage */
+	RT_PRODUCT_MACRO_VALUE,
+	RT_PRODUCT_MICRO_VALUE,
+	RT_PRODUCT_FIRST_USER
+};
+
+/** Maximum number of products */
+#define RT_MAX_NOF_PRODUCTS     32
+/** Bit of a product in RTModuleSettings inputs/outputs */
+#define RT_PRODUCT_BIT(product) (1u << (product))
+
+
+/**
+ * Handles one data container.
+ *
+ * @returns RT_RETURN_OK, anything else fails the module for this data
+ */
+typedef int (*RTModuleProcessFunc)(RTDataStruct* data, int moduleIndex, void* context);
+
+/** Commits the result of a module, called from the TIME_TICK thread in timestamp order */
+typedef void (*RTModuleCommitFunc)(RTDataStruct* data, int moduleIndex, void* context);
+
+
+/** A module, see RTCoreAddModule */
+typedef struct _RTModuleSettings
+{
+	const char         *name;
+	unsigned int        inputs;         /**< RT_PRODUCT_BIT of every product the module reads */
+	unsigned int        outputs;        /**< RT_PRODUCT_BIT of every product the module writes */
+	RTModuleProcessFunc process;
+	RTModuleCommitFunc  commit;         /**< may be NULL */
+	RTEngineInitFunc    init;           /**< may be NULL, called with initdata when the instance is created */
+	void               *initdata;
+	RTEngineFinitFunc   finit;          /**< may be NULL, called when the instance is destroyed */
+	void               *context;        /**< passed to process and commit */
+} RTModuleSettings;
+
+
+/** Counters and timings of a module, read with RTInstanceGetModuleStats */
+typedef struct _RTModuleStats
+{
+	const char     *name;
+	int             level;              /**< longest chain of modules before this one, modules of a level may run in parallel */
+	unsigned long   nofRuns;            /**< data containers handled */
+	unsigned long   nofErrors;          /**< runs that did not return RT_RETURN_OK */
+	unsigned long   nofSkipped;         /**< data containers skipped because a module before failed */
+	double          busySeconds;        /**< time spent in process */
+	double          maxSeconds;         /**< longest single run */
+} RTModuleStats;
+
+
 /* I want these to work similar to Mt in intradaLive core,  but maybe I should create an instance for StormObject which contains the info for */
 
-extern class RTEngine;
-typedef RTEngine * RTEngineContext;
+typedef RTEngineInstance RTEngineContext;
 
 extern class ValueEngine;
 typedef ValueEngine * ValueEngineContext;
@@ -106,7 +212,9 @@ typedef ValueEngine * ValueEngineContext;
  * Initializes RTCore and all installed modules, should be called after RTCoreAddModule calls.
  *
  * This function should be called only once.
- * 
+ *
+ * The RTCore* functions work on one process-wide instance, *reference (optional) receives it.
+ * To analyse several matches in one process use RTInstanceCreate instead.
  *
  * @retval RT_RETURN_OK
  * @retval RT_RETURN_OUT_OF_MEMORY
@@ -126,18 +234,208 @@ extern int RTCoreInit(const char *instance_name,
 
 
 /**
- * Finalizes the RTCore library.
+ * Configures the Process Buffer that sits between RTCoreProcess (input threads)
+ * and the TIME_TICK thread. Must be called before RTCoreInit.
  *
- * The library should first have been initialized by calling RTCoreInitLibrary().
- * Note that this call does NOT call RTCoreDestroyFrameSource. Each created 
- * framesource has to be destroyed before calling finalize!
+ * @param[in]   capacity        Number of RTDataStructs the buffer can hold, rounded up to a power of 2
+ * @param[in]   producerMode    RT_PROCESS_BUFFER_SINGLE_PRODUCER (default) or RT_PROCESS_BUFFER_MULTI_PRODUCER
+ *                              when several input sources call RTCoreProcess concurrently
+ * @param[in]   overflowPolicy  One of RT_BUFFER_OVERFLOW_BLOCK, RT_BUFFER_OVERFLOW_DROP_OLDEST or
+ *                              RT_BUFFER_OVERFLOW_DROP_NEWEST
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_SETTING_NOT_ALLOWED - RTCore is already initialized or an argument is out of range
+ *
+ * @see RTProcessBuffer.h
+ */
+extern int RTCoreSetProcessBufferSettings(unsigned int capacity, int producerMode, int overflowPolicy);
+
+
+/**
+ * Links the Value Engine of the match to the RTCore instance, the modules read it back with
+ * RTInstanceGetValueEngine. PRE: should be called before RTCoreInit, NULL unlinks.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_SETTING_NOT_ALLOWED - RTCore is already initialized
+ *
+ * @see RTInstanceSettings::valueEngine
+ */
+extern int RTLinkToValueEngine(ValueEngineContext engine);
+
+
+/**
+ * Sets how fast game time runs compared to wall time (1.0 for a live game, 4.0 for a replay
+ * at 4x, ...). The TIME_TICK thread then sleeps exactly until the next Event List deadline
+ * or the next input. With 0 (default, offline replay logs) game time only advances with
+ * the timestamps of the input, so the thread just waits for the next input.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_SETTING_NOT_ALLOWED - negative speed
+ */
+extern int RTCoreSetReplaySpeed(double speed);
+
+
+/** Event List (see RTEventList.h) */
+typedef struct _RTEventListStruct *RTEventList;
+struct _RTEventInfo;
+
+/**
+ * Called from the TIME_TICK thread for each event of the Event List that ended
+ * (TRIGGER EVENTS in the roadmap), in end time order.
+ */
+typedef void (*RTEventHandlerFunc)(const struct _RTEventInfo* event, double endTime, void* context);
+
+/**
+ * Installs the EventHandler. PRE: should be called before RTCoreInit.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_SETTING_NOT_ALLOWED - RTCore is already initialized
+ */
+extern int RTCoreSetEventHandler(RTEventHandlerFunc handler, void* context);
+
+/** Event bus (see RTBus.h) */
+typedef struct _RTBusStruct *RTBus;
+
+/**
+ * Installs the event bus: every event of the Event List that ended is also published on it
+ * as RT_BUS_EVENT_EXPIRED, after the EventHandler. The bus is not owned by RTCore.
+ * PRE: should be called before RTCoreInit.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_SETTING_NOT_ALLOWED - RTCore is already initialized
+ */
+extern int RTCoreSetBus(RTBus bus);
+
+
+/*
+	Live mode
+
+	The program runs in the background while the game is played: it must leave the game
+	its cores and still deliver values while they matter. In live mode the TIME_TICK
+	thread keeps to a share of one core, and times every entry from RTInstanceProcess
+	until its commit (where the value callbacks run) returned.
+
+	At the end of every window it compares that window with the settings. If the
+	latencies missed the target or the thread used more than its share, it goes one
+	level up. After RT_LIVE_RELAX_WINDOWS windows in a row without a late entry and well
+	inside the share, it goes one level down:
+
+		RT_LIVE_LEVEL_FULL              all work is done
+		RT_LIVE_LEVEL_COARSE_CV         the CV Engine samples fewer frames (CV_PIPELINE_COARSE_STRIDE)
+		RT_LIVE_LEVEL_DEFER_VALUES      the Value Engine leaves its non-critical values dirty
+		                                until they are read (VE_NODES_NON_CRITICAL)
+		RT_LIVE_LEVEL_DROP_PASSAGES     RTInstanceProcess drops an entry that would wait
+		                                longer than the target: RT_RETURN_PASSAGE_DROPPED
+
+	Each level keeps the shedding of the levels below it. A change is published on the
+	bus of the instance as RT_BUS_LOAD_LEVEL; pollers read RTInstanceGetLiveLevel. When
+	the thread used more than its share of the window so far, it sleeps off the excess
+	before it takes the next batch.
+*/
+
+enum rtLiveLevel
+{
+	RT_LIVE_LEVEL_FULL,
+	RT_LIVE_LEVEL_COARSE_CV,
+	RT_LIVE_LEVEL_DEFER_VALUES,
+	RT_LIVE_LEVEL_DROP_PASSAGES,
+	RT_NOF_LIVE_LEVELS
+};
+
+/** Priorities of the engine threads, the values of the Windows thread priorities */
+#define RT_THREAD_PRIORITY_LOWEST       -2
+#define RT_THREAD_PRIORITY_BELOW_NORMAL -1
+#define RT_THREAD_PRIORITY_NORMAL       0
+#define RT_THREAD_PRIORITY_ABOVE_NORMAL 1
+#define RT_THREAD_PRIORITY_HIGHEST      2
+
+/** Seconds over which latency and CPU share are judged, by default */
+#define RT_LIVE_DEFAULT_WINDOW          0.5
+/** Windows well inside the settings before the level goes down */
+#define RT_LIVE_RELAX_WINDOWS           4
+
+/** Live mode settings. All zero is live mode off. */
+typedef struct _RTLiveSettings
+{
+	double              targetLatency;      /**< seconds from RTInstanceProcess to the end of the commit, 0: none */
+	double              cpuShare;           /**< of one core for the TIME_TICK thread, 0 < share < 1, 0: no budget */
+	double              window;             /**< seconds, 0: RT_LIVE_DEFAULT_WINDOW */
+	unsigned long long  cpuMask;            /**< CPUs of the TIME_TICK thread and the module workers (bit n: CPU n), 0: any */
+	int                 priority;           /**< RT_THREAD_PRIORITY_* of those threads */
+} RTLiveSettings;
+
+/** Achieved latency and shed work, read with RTInstanceGetLiveStats */
+typedef struct _RTLiveStats
+{
+	int             level;                      /**< rtLiveLevel now */
+	unsigned long   nofEntries;                 /**< entries timed, up to the last window */
+	unsigned long   nofLate;                    /**< of those, over the target latency */
+	double          meanLatency;                /**< seconds */
+	double          latency50;                  /**< seconds, upper end of the histogram bucket (at most 1/8 high) */
+	double          latency99;
+	double          maxLatency;
+	double          windowMaxLatency;           /**< in the last window */
+	double          windowShare;                /**< of a core the TIME_TICK thread used in the last window */
+	double          busySeconds;
+	double          throttledSeconds;           /**< slept to stay within the share */
+	unsigned long   nofDropped;                 /**< RT_RETURN_PASSAGE_DROPPED at RT_LIVE_LEVEL_DROP_PASSAGES */
+	unsigned long   nofLevelChanges;
+	double          levelSeconds[RT_NOF_LIVE_LEVELS];   /**< wall time at each level */
+} RTLiveStats;
+
+/**
+ * Live mode settings of the RTCore instance. PRE: should be called before RTCoreInit.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_SETTING_NOT_ALLOWED - RTCore is already initialized or a setting is out of range
+ */
+extern int RTCoreSetLiveSettings(const RTLiveSettings* settings);
+
+/** @see RTInstanceGetLiveLevel */
+extern int RTCoreGetLiveLevel(void);
+
+/** @see RTInstanceGetLiveStats */
+extern int RTCoreGetLiveStats(RTLiveStats* stats);
+
+
+/**
+ * Installs a module. PRE: should be called before RTCoreInit, modules are numbered in the
+ * order they are added.
+ *
+ * The dependencies are checked when the instance is created: RTCoreInit fails with
+ * RT_RETURN_NOT_FOUND when an input is written by no module, with RT_RETURN_SETTING_NOT_ALLOWED
+ * when a product is written by two modules and with RT_RETURN_ILLEGAL_DATA when the modules
+ * depend on each other in a cycle.
+ *
+ * @param[in]   module          The module, copied
+ * @param[out]  moduleIndex     Optionally, the index of the module in moduleData/moduleReturnValue
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER - no module or no process function
+ * @retval RT_RETURN_SETTING_NOT_ALLOWED - RTCore is already initialized
+ * @retval RT_RETURN_MAX_NOF_MODULES_REACHED
+ */
+extern int RTCoreAddModule(const RTModuleSettings* module, int* moduleIndex);
+
+/**
+ * Number of threads that run independent modules in parallel. 0 (default) runs the modules
+ * one after the other in the TIME_TICK thread. PRE: should be called before RTCoreInit.
  *
  * @retval RT_RETURN_OK
- * @retval RT_RETURN_NOT_FOUND
- * @retval RT_RETURN_ALREADY_LINKED_ENGINE
+ * @retval RT_RETURN_SETTING_NOT_ALLOWED - RTCore is already initialized or a negative number
+ */
+extern int RTCoreSetModuleWorkers(int nofWorkers);
+
+/** @see RTInstanceGetModuleStats */
+extern int RTCoreGetModuleStats(int moduleIndex, RTModuleStats* stats);
+
+/**
+ * Returns the Event List of the RTContext, NULL when RTCore is not initialized.
  *
+ * PRE: only to be used from the TIME_TICK thread (event handler and modules).
  */
-extern int RTLinkToValueEngine();
+extern RTEventList RTCoreGetEventList(void);
 
 
 /**
@@ -164,11 +462,23 @@ extern int RTCoreFinalize(void);
  */
 extern int RTCoreCreateData(RTDataStruct** data);
 
+/**
+ * Destroys a data container (DestroyRTData in the roadmap). Called by the TIME_TICK
+ * thread once the data has been processed, or by RTCoreProcess when the data is dropped.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ */
+extern int RTCoreDestroyData(RTDataStruct* data);
+
 /**
  * Makes a clone (copy) of the src data container. Note that any userdata in the data is not cloned but only the 
  * reference is copied to the clone. Therefore a change in the userdata effects all cloned data instances. However
  * only when the last clone of a data instance is destroyed any userdata in the instance is destroyed.
  *
+ * The clone is cheap: passages and userdata are shared with the source until one of both is
+ * written. Module data references and return values are copied.
+ *
  * @retval RT_RETURN_OK
  * @retval RT_RETURN_LIB_NOT_INITIALIZED
  * @retval RT_RETURN_OUT_OF_MEMORY
@@ -176,16 +486,39 @@ extern int RTCoreCreateData(RTDataStruct** data);
 extern int RTCoreCloneData(RTDataStruct* srcdata, RTDataStruct** cloneddata);
 
 /**
- * Adds an image/passage to a data container
+ * Adds an image/passage to a data container. The passage is stored as a reference. When the
+ * container shares its passages with clones they are copied first (copy-on-write).
  *
  * @retval RT_RETURN_OK
  * @retval RT_RETURN_LIB_NOT_INITIALIZED
  * @retval RT_RETURN_ILLEGAL_DATA
- * @retval RT_RETURN_ILLEGAL_NR_IMAGES - There is already a passage in the data container, only 1 passage is allowed
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ * @retval RT_RETURN_ILLEGAL_NR_PASSAGES - There are already RT_MAX_NR_PASSAGES passages in the data container
  */
 extern int RTCoreDataAddpassage(RTDataStruct* data, RTPassage passage, 
                                        double passagetime, int passageSourceId);
 
+/**
+ * Sets the userdata of a data container. releaseFunc (may be NULL) is called on the userdata
+ * when the last data container that refers to it is destroyed.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_LIB_NOT_INITIALIZED
+ * @retval RT_RETURN_ILLEGAL_DATA
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int RTCoreDataSetUserData(RTDataStruct* data, void* userdata, void (*releaseFunc)(void* userdata));
+
+/**
+ * Returns the allocation counters of the data pool. A replay in a steady state should not
+ * increase nofMallocs.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_LIB_NOT_INITIALIZED
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ */
+extern int RTCoreGetDataAllocStats(RTDataAllocStats* stats);
+
 
 /**
  * Process the data.
@@ -199,16 +532,157 @@ extern int RTCoreDataAddpassage(RTDataStruct* data, RTPassage passage,
  * @param[in]   passage     Reference to the passage to be processed
  * @param[in]   userdata  Reference to some user data. The userdata reference is stored in the data struct
  *
+ * The data is queued in the Process Buffer and handled by the TIME_TICK thread.
+ * When the buffer is full the configured overflow policy applies (see 
+ * RTCoreSetProcessBufferSettings); in both drop cases the dropped data is destroyed.
+ *
  * @retval RT_RETURN_OK
  * @retval RT_RETURN_LIB_NOT_INITIALIZED
  * @retval RT_RETURN_ILLEGAL_IMAGE
  * @retval RT_RETURN_ILLEGAL_NULL_POINTER
  * @retval RT_RETURN_INTERNAL_ERROR - passage has illegal/non existing sourceId
+ * @retval RT_RETURN_BUFFER_OVERFLOW - buffer full, this data was dropped (RT_BUFFER_OVERFLOW_DROP_NEWEST)
+ * @retval RT_RETURN_PASSAGE_DROPPED - buffer full, the oldest queued data was dropped (RT_BUFFER_OVERFLOW_DROP_OLDEST),
+ *                                     or live mode dropped this data (RT_LIVE_LEVEL_DROP_PASSAGES)
  */
 extern int RTCoreProcess(RTDataStruct* data);
 
 
 
+/*
+	Instance API
+
+	Every RTEngineInstance owns its data pool, Process Buffer, Event List and TIME_TICK
+	thread; instances share nothing, so any number of them can run concurrently (batch
+	analysis of many replays, several live matches). The RTCore* functions above are the
+	same calls on the instance created by RTCoreInit.
+*/
+
+/** Settings of an instance. All zero gives the defaults of RTCoreInit. */
+typedef struct _RTInstanceSettings
+{
+	unsigned int        processBufferCapacity;  /**< 0: RT_PROCESS_BUFFER_DEFAULT_CAPACITY, @see RTCoreSetProcessBufferSettings */
+	int                 producerMode;
+	int                 overflowPolicy;
+	double              replaySpeed;            /**< @see RTCoreSetReplaySpeed */
+	RTEventHandlerFunc  eventHandler;           /**< @see RTCoreSetEventHandler */
+	void               *eventHandlerContext;
+	RTBus               bus;                    /**< @see RTCoreSetBus */
+	int                 synchronous;            /**< 1: no Process Buffer and no TIME_TICK thread, RTInstanceProcess
+	                                                 handles the data in the calling thread (batch analysis).
+	                                                 Game time then only follows the input. */
+	const RTModuleSettings *modules;            /**< the modules of the instance, copied, @see RTCoreAddModule */
+	int                 nofModules;
+	int                 nofModuleWorkers;       /**< @see RTCoreSetModuleWorkers, keep 0 when instances already run in parallel */
+	RTLiveSettings      live;                   /**< @see RTCoreSetLiveSettings, not with synchronous */
+	ValueEngineContext  valueEngine;            /**< @see RTLinkToValueEngine */
+	void               *matchContext;           /**< host state of the match the instance analyses, @see RTInstanceGetMatchContext */
+} RTInstanceSettings;
+
+/** Counters of an instance, read with RTInstanceGetStats */
+typedef struct _RTInstanceStats
+{
+	unsigned long   nofProcessed;       /**< data containers handled by TIME_TICK */
+	unsigned long   nofEvents;          /**< Event List events that ended and were triggered */
+	double          gameTime;           /**< game time of the last handled entry */
+} RTInstanceStats;
+
+
+/**
+ * Creates an instance and, unless settings->synchronous, starts its TIME_TICK thread.
+ *
+ * @param[in]   instance_name   Name of the instance (and of its thread), may be NULL
+ * @param[in]   settings        Settings, NULL for the defaults
+ * @param[out]  instance        The created instance
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_SETTING_NOT_ALLOWED
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ * @retval RT_RETURN_INTERNAL_ERROR - the TIME_TICK thread could not be started
+ */
+extern int RTInstanceCreate(const char* instance_name, const RTInstanceSettings* settings, RTEngineInstance* instance);
+
+/**
+ * Handles what is left in the Process Buffer, stops the TIME_TICK thread and destroys the instance.
+ * PRE: every data container of the instance the user still holds is destroyed.
+ */
+extern int RTInstanceDestroy(RTEngineInstance instance);
+
+/** The Value Engine linked to the instance, NULL if none. May be called from any thread. */
+extern ValueEngineContext RTInstanceGetValueEngine(RTEngineInstance instance);
+
+/**
+ * The matchContext of the settings, NULL if none. Lets code that only gets the instance
+ * (CVAnalyseFunc, the modules of a shared module table) find the match it works for.
+ * May be called from any thread.
+ */
+extern void* RTInstanceGetMatchContext(RTEngineInstance instance);
+
+/** @see RTCoreSetReplaySpeed */
+extern int RTInstanceSetReplaySpeed(RTEngineInstance instance, double speed);
+
+/** @see RTCoreGetEventList */
+extern RTEventList RTInstanceGetEventList(RTEngineInstance instance);
+
+/** @see RTCoreCreateData */
+extern int RTInstanceCreateData(RTEngineInstance instance, RTDataStruct** data);
+
+/** @see RTCoreDestroyData */
+extern int RTInstanceDestroyData(RTEngineInstance instance, RTDataStruct* data);
+
+/** @see RTCoreCloneData */
+extern int RTInstanceCloneData(RTEngineInstance instance, RTDataStruct* srcdata, RTDataStruct** cloneddata);
+
+/** @see RTCoreDataAddpassage */
+extern int RTInstanceDataAddpassage(RTEngineInstance instance, RTDataStruct* data, RTPassage passage,
+                                    double passagetime, int passageSourceId);
+
+/** @see RTCoreDataSetUserData */
+extern int RTInstanceDataSetUserData(RTEngineInstance instance, RTDataStruct* data, void* userdata,
+                                     void (*releaseFunc)(void* userdata));
+
+/** @see RTCoreGetDataAllocStats */
+extern int RTInstanceGetDataAllocStats(RTEngineInstance instance, RTDataAllocStats* stats);
+
+/**
+ * @see RTCoreProcess
+ *
+ * A synchronous instance handles the data before returning, the data is destroyed afterwards.
+ */
+extern int RTInstanceProcess(RTEngineInstance instance, RTDataStruct* data);
+
+/**
+ * Returns the counters of the instance. May be called from any thread.
+ */
+extern int RTInstanceGetStats(RTEngineInstance instance, RTInstanceStats* stats);
+
+/** The rtLiveLevel of the instance, RT_LIVE_LEVEL_FULL without live mode. May be called from any thread. */
+extern int RTInstanceGetLiveLevel(RTEngineInstance instance);
+
+/**
+ * Returns the live mode stats, as of the end of the last window. May be called from any thread.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_NOT_FOUND - the instance is not in live mode
+ */
+extern int RTInstanceGetLiveStats(RTEngineInstance instance, RTLiveStats* stats);
+
+/** Returns the number of modules of the instance */
+extern int RTInstanceGetNofModules(RTEngineInstance instance);
+
+/**
+ * Returns the counters and timings of a module. May be called from any thread.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_ILLEGAL_MODULE_INDEX
+ */
+extern int RTInstanceGetModuleStats(RTEngineInstance instance, int moduleIndex, RTModuleStats* stats);
+
+
+
 
 
 #endif //_RTENGINE_H_
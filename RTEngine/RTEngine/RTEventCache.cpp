@@ -0,0 +1,369 @@
+﻿#include "pch.h"
+#include "RTEventCache.h"
+#include "RTFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+
+#define RT_EVENT_CACHE_BYTE_ORDER       0x01020304u
+/* records the writer starts with, doubled when full */
+#define RT_EVENT_CACHE_INITIAL_RECORDS  4096
+
+#define RT_HASH_PRIME1                  0x9E3779B185EBCA87ull
+#define RT_HASH_PRIME2                  0xC2B2AE3D27D4EB4Full
+#define RT_HASH_PRIME3                  0x165667B19E3779F9ull
+
+
+typedef struct _RTEventCacheStruct
+{
+	RTFileMapStruct                 file;
+	const RTEventCacheHeader        *header;
+	const RTEventCacheIndexEntry    *index;
+	const RTEventCacheRecord        *records;
+	const char                      *source;        /* the mapped log, where the payloads are */
+	uint64_t                        sourceSize;
+	uint64_t                        next;           /* record RTEventCacheNext returns */
+} RTEventCacheStruct;
+
+
+typedef struct _RTEventCacheWriterStruct
+{
+	char                *path;
+	uint64_t            sourceSize;
+	uint64_t            sourceTime;
+	RTEventCacheRecord  *records;
+	uint64_t            nofRecords;
+	uint64_t            maxRecords;
+} RTEventCacheWriterStruct;
+
+
+
+static uint64_t Rotl(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+
+static uint64_t Round(uint64_t acc, uint64_t word)
+{
+	acc += word * RT_HASH_PRIME2;
+	acc = Rotl(acc, 31);
+	return acc * RT_HASH_PRIME1;
+}
+
+
+/* four independent lanes over 32 bytes per step, then the tail and a final mix */
+uint64_t RTEventCacheHash(const void* data, size_t size)
+{
+	const unsigned char *p = (const unsigned char*)data;
+	const unsigned char *end = p + size;
+	uint64_t lane[4] = { RT_HASH_PRIME1 + RT_HASH_PRIME2, RT_HASH_PRIME2, 0, 0 - RT_HASH_PRIME1 };
+	uint64_t h, word;
+	int i;
+
+	for (; end - p >= 32; p += 32)
+	{
+		for (i = 0; i < 4; i++)
+		{
+			memcpy(&word, p + 8 * i, 8);
+			lane[i] = Round(lane[i], word);
+		}
+	}
+
+	h = Rotl(lane[0], 1) + Rotl(lane[1], 7) + Rotl(lane[2], 12) + Rotl(lane[3], 18);
+	h ^= (uint64_t)size * RT_HASH_PRIME3;
+	for (; end - p >= 8; p += 8)
+	{
+		memcpy(&word, p, 8);
+		h ^= Round(0, word);
+		h = Rotl(h, 27) * RT_HASH_PRIME1 + RT_HASH_PRIME3;
+	}
+	for (; p < end; p++)
+	{
+		h ^= *p * RT_HASH_PRIME3;
+		h = Rotl(h, 11) * RT_HASH_PRIME1;
+	}
+
+	h ^= h >> 33;
+	h *= RT_HASH_PRIME2;
+	h ^= h >> 29;
+	h *= RT_HASH_PRIME3;
+	h ^= h >> 32;
+	return h;
+}
+
+
+
+/* the start and the end of the log, what a cache is matched to its log with */
+static uint64_t HeadHash(const char* source, uint64_t size)
+{
+	return RTEventCacheHash(source, (size_t)((size < RT_EVENT_CACHE_CHECK_BLOCK) ? size : RT_EVENT_CACHE_CHECK_BLOCK));
+}
+
+
+static uint64_t TailHash(const char* source, uint64_t size)
+{
+	uint64_t length = (size < RT_EVENT_CACHE_CHECK_BLOCK) ? size : RT_EVENT_CACHE_CHECK_BLOCK;
+
+	return RTEventCacheHash(source + (size - length), (size_t)length);
+}
+
+
+
+/* Every part of the file lies inside it and in the order of the layout */
+static int CheckLayout(const RTEventCacheHeader* h, size_t size)
+{
+	if (h->fileSize != size)
+		return 0;
+	if (h->indexOffset != sizeof(RTEventCacheHeader) ||
+		h->nofIndexEntries != (h->nofRecords + RT_EVENT_CACHE_INDEX_STRIDE - 1) / RT_EVENT_CACHE_INDEX_STRIDE)
+		return 0;
+	if (h->nofIndexEntries > size / sizeof(RTEventCacheIndexEntry) ||
+		h->recordsOffset != h->indexOffset + h->nofIndexEntries * sizeof(RTEventCacheIndexEntry))
+		return 0;
+	if (h->nofRecords > size / sizeof(RTEventCacheRecord) ||
+		h->fileSize != h->recordsOffset + h->nofRecords * sizeof(RTEventCacheRecord))
+		return 0;
+	return 1;
+}
+
+
+int RTEventCacheOpen(const char* path, const char* source, uint64_t sourceSize, uint64_t sourceTime,
+                     RTEventCache* cache)
+{
+	RTEventCache c;
+	const RTEventCacheHeader *h;
+	RTFileMapStruct file;
+	int ret;
+
+	if (path == NULL || source == NULL || cache == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*cache = NULL;
+
+	ret = RTFileMap(path, sizeof(RTEventCacheHeader), RT_FILE_MAP_SEQUENTIAL, &file);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	h = (const RTEventCacheHeader*)file.base;
+	if (memcmp(h->magic, RT_EVENT_CACHE_MAGIC, sizeof(h->magic)) != 0 ||
+		h->version != RT_EVENT_CACHE_VERSION || h->byteOrder != RT_EVENT_CACHE_BYTE_ORDER ||
+		h->sourceSize != sourceSize || h->sourceTime != sourceTime || !CheckLayout(h, file.size) ||
+		h->sourceHeadHash != HeadHash(source, sourceSize) || h->sourceTailHash != TailHash(source, sourceSize))
+	{
+		RTFileUnmap(&file);
+		return RT_RETURN_ILLEGAL_DATA;
+	}
+
+	c = new (std::nothrow) RTEventCacheStruct();
+	if (c == NULL)
+	{
+		RTFileUnmap(&file);
+		return RT_RETURN_OUT_OF_MEMORY;
+	}
+	c->file = file;
+	c->header = h;
+	c->index = (const RTEventCacheIndexEntry*)(file.base + h->indexOffset);
+	c->records = (const RTEventCacheRecord*)(file.base + h->recordsOffset);
+	c->source = source;
+	c->sourceSize = sourceSize;
+	c->next = 0;
+
+	*cache = c;
+	return RT_RETURN_OK;
+}
+
+
+void RTEventCacheClose(RTEventCache cache)
+{
+	if (cache == NULL)
+		return;
+	RTFileUnmap(&cache->file);
+	delete cache;
+}
+
+
+const RTEventCacheHeader* RTEventCacheGetHeader(RTEventCache cache)
+{
+	return (cache != NULL) ? cache->header : NULL;
+}
+
+
+int RTEventCacheNext(RTEventCache cache, const RTEventCacheRecord** record, const char** payload)
+{
+	const RTEventCacheRecord *r;
+
+	if (cache == NULL || record == NULL || payload == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (cache->next >= cache->header->nofRecords)
+		return RT_RETURN_END_OF_LOG;
+
+	r = &cache->records[cache->next];
+	if (r->offset > cache->sourceSize || r->size > cache->sourceSize - r->offset)
+		return RT_RETURN_ILLEGAL_DATA;
+	cache->next++;
+
+	*record = r;
+	*payload = cache->source + r->offset;
+	return RT_RETURN_OK;
+}
+
+
+/*
+	The index keeps the latest time up to each of its records, which never decreases
+	even when a late record does: every record before the first index entry at or
+	after time is earlier than time.
+*/
+int RTEventCacheSeek(RTEventCache cache, double time)
+{
+	uint64_t low, high, middle, r;
+
+	if (cache == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	/* the last index entry before time, the record wanted is in its stride or right after */
+	low = 0;
+	high = cache->header->nofIndexEntries;
+	while (low < high)
+	{
+		middle = low + (high - low) / 2;
+		if (cache->index[middle].time < time)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	r = (low > 0) ? cache->index[low - 1].record : 0;
+
+	while (r < cache->header->nofRecords && cache->records[r].time < time)
+		r++;
+	cache->next = r;
+	return RT_RETURN_OK;
+}
+
+
+
+int RTEventCacheWriterCreate(const char* path, uint64_t sourceSize, uint64_t sourceTime, RTEventCacheWriter* writer)
+{
+	RTEventCacheWriter w;
+
+	if (path == NULL || writer == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*writer = NULL;
+
+	w = new (std::nothrow) RTEventCacheWriterStruct();
+	if (w == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	w->path = (char*)malloc(strlen(path) + 1);
+	if (w->path == NULL)
+	{
+		delete w;
+		return RT_RETURN_OUT_OF_MEMORY;
+	}
+	strcpy(w->path, path);
+	w->sourceSize = sourceSize;
+	w->sourceTime = sourceTime;
+
+	*writer = w;
+	return RT_RETURN_OK;
+}
+
+
+int RTEventCacheWriterAdd(RTEventCacheWriter writer, double time, uint64_t offset, uint32_t size, uint32_t recordNr)
+{
+	RTEventCacheRecord *r;
+	uint64_t maxRecords;
+
+	if (writer == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	if (writer->nofRecords == writer->maxRecords)
+	{
+		maxRecords = (writer->maxRecords == 0) ? RT_EVENT_CACHE_INITIAL_RECORDS : writer->maxRecords * 2;
+		if (maxRecords > SIZE_MAX / sizeof(RTEventCacheRecord))
+			return RT_RETURN_OUT_OF_MEMORY;
+		r = (RTEventCacheRecord*)realloc(writer->records, (size_t)maxRecords * sizeof(RTEventCacheRecord));
+		if (r == NULL)
+			return RT_RETURN_OUT_OF_MEMORY;
+		writer->records = r;
+		writer->maxRecords = maxRecords;
+	}
+
+	r = &writer->records[writer->nofRecords++];
+	r->time = time;
+	r->offset = offset;
+	r->size = size;
+	r->recordNr = recordNr;
+	return RT_RETURN_OK;
+}
+
+
+static int WriteCache(RTEventCacheWriter w, FILE* f, const char* source, uint64_t nofSkipped)
+{
+	RTEventCacheHeader header;
+	RTEventCacheIndexEntry entry;
+	double latest = 0.0;
+	uint64_t i, r;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RT_EVENT_CACHE_MAGIC, sizeof(header.magic));
+	header.version = RT_EVENT_CACHE_VERSION;
+	header.byteOrder = RT_EVENT_CACHE_BYTE_ORDER;
+	header.sourceSize = w->sourceSize;
+	header.sourceTime = w->sourceTime;
+	header.sourceHeadHash = HeadHash(source, w->sourceSize);
+	header.sourceTailHash = TailHash(source, w->sourceSize);
+	header.sourceHash = RTEventCacheHash(source, (size_t)w->sourceSize);
+	header.nofRecords = w->nofRecords;
+	header.nofSkipped = nofSkipped;
+	header.nofIndexEntries = (w->nofRecords + RT_EVENT_CACHE_INDEX_STRIDE - 1) / RT_EVENT_CACHE_INDEX_STRIDE;
+	header.indexOffset = sizeof(RTEventCacheHeader);
+	header.recordsOffset = header.indexOffset + header.nofIndexEntries * sizeof(RTEventCacheIndexEntry);
+	header.fileSize = header.recordsOffset + w->nofRecords * sizeof(RTEventCacheRecord);
+	if (fwrite(&header, sizeof(header), 1, f) != 1)
+		return 0;
+
+	for (i = 0, r = 0; i < w->nofRecords; i += RT_EVENT_CACHE_INDEX_STRIDE)
+	{
+		for (; r <= i; r++)
+		{
+			if (r == 0 || w->records[r].time > latest)
+				latest = w->records[r].time;
+		}
+		entry.time = latest;
+		entry.record = i;
+		if (fwrite(&entry, sizeof(entry), 1, f) != 1)
+			return 0;
+	}
+
+	if (w->nofRecords > 0 &&
+		fwrite(w->records, sizeof(RTEventCacheRecord), (size_t)w->nofRecords, f) != (size_t)w->nofRecords)
+		return 0;
+	return 1;
+}
+
+
+int RTEventCacheWriterCommit(RTEventCacheWriter writer, const char* source, uint64_t nofSkipped)
+{
+	FILE *f;
+	int ret;
+
+	if (writer == NULL || source == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	ret = RTFileWriteBegin(writer->path, &f);
+	if (ret != RT_RETURN_OK)
+		return ret;
+	return RTFileWriteEnd(writer->path, f, WriteCache(writer, f, source, nofSkipped));
+}
+
+
+void RTEventCacheWriterDestroy(RTEventCacheWriter writer)
+{
+	if (writer == NULL)
+		return;
+	free(writer->records);
+	free(writer->path);
+	delete writer;
+}
@@ -0,0 +1,145 @@
+﻿#ifndef _RTEVENTCACHE_H_
+#define _RTEVENTCACHE_H_
+
+#include "RTEngine.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+	Event cache: the records a replay log was parsed into, stored in a binary file next
+	to the log (<log>.rtc) so the next run maps it instead of parsing the text again.
+
+	The file is fixed width and read in place, all offsets from the start of the file:
+
+		RTEventCacheHeader
+		time index          RTEventCacheIndexEntry, one per RT_EVENT_CACHE_INDEX_STRIDE records
+		records             RTEventCacheRecord, in log order
+
+	The payloads are not copied: a record keeps where its payload is in the log, which is
+	mapped next to the cache, so the cache holds 24 bytes per record and no text.
+
+	A cache belongs to one version of its log: the header keeps the size and the last
+	write time of the log and a hash (RTEventCacheHash) of its first and of its last
+	RT_EVENT_CACHE_CHECK_BLOCK bytes. Opening a cache checks these and never reads the
+	whole log; a cache that does not match them, or was written with another format
+	version or byte order, is not used. The hash of the whole log is taken when the
+	cache is written (the log was just read to its end) and kept in the header.
+
+	The file is written under a temporary name and renamed when complete, so a reader
+	never sees half a cache.
+*/
+
+
+#define RT_EVENT_CACHE_EXTENSION        ".rtc"
+#define RT_EVENT_CACHE_MAGIC            "SVEVCACH"
+#define RT_EVENT_CACHE_VERSION          3
+/** Records between two entries of the time index */
+#define RT_EVENT_CACHE_INDEX_STRIDE     256
+/** Bytes at the start and at the end of the log that are hashed to match a cache to its log */
+#define RT_EVENT_CACHE_CHECK_BLOCK      (64 << 10)
+
+
+typedef struct _RTEventCacheHeader
+{
+	char            magic[8];       /**< RT_EVENT_CACHE_MAGIC */
+	uint32_t        version;        /**< RT_EVENT_CACHE_VERSION */
+	uint32_t        byteOrder;      /**< 0x01020304 as written */
+	uint64_t        sourceSize;     /**< bytes of the log */
+	uint64_t        sourceTime;     /**< last write time of the log, as the file system reports it */
+	uint64_t        sourceHeadHash; /**< RTEventCacheHash of the first RT_EVENT_CACHE_CHECK_BLOCK bytes of the log */
+	uint64_t        sourceTailHash; /**< RTEventCacheHash of the last RT_EVENT_CACHE_CHECK_BLOCK bytes of the log */
+	uint64_t        sourceHash;     /**< RTEventCacheHash of the whole log when the cache was written */
+	uint64_t        nofRecords;
+	uint64_t        nofSkipped;     /**< lines of the log without a valid time */
+	uint64_t        nofIndexEntries;
+	uint64_t        indexOffset;
+	uint64_t        recordsOffset;
+	uint64_t        fileSize;
+} RTEventCacheHeader;
+
+typedef struct _RTEventCacheIndexEntry
+{
+	double          time;           /**< latest time of the records up to and including this one */
+	uint64_t        record;         /**< index of the record, a multiple of RT_EVENT_CACHE_INDEX_STRIDE */
+} RTEventCacheIndexEntry;
+
+typedef struct _RTEventCacheRecord
+{
+	double          time;           /**< game time in seconds */
+	uint64_t        offset;         /**< of the payload, from the start of the log */
+	uint32_t        size;           /**< of the payload */
+	uint32_t        recordNr;       /**< line of the record in the log */
+} RTEventCacheRecord;
+
+
+/** Forward declarations */
+typedef struct _RTEventCacheStruct *RTEventCache;
+typedef struct _RTEventCacheWriterStruct *RTEventCacheWriter;
+
+
+/**
+ * Content hash of a log, 64 bits, reads 8 bytes per step.
+ */
+extern uint64_t RTEventCacheHash(const void* data, size_t size);
+
+/**
+ * Maps the cache at path when it belongs to the log source (mapped, sourceSize bytes,
+ * written at sourceTime). The log must stay mapped until RTEventCacheClose.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_CANNOT_OPEN_FILE - no cache
+ * @retval RT_RETURN_ILLEGAL_DATA - the cache is damaged, of another version or of another log
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int RTEventCacheOpen(const char* path, const char* source, uint64_t sourceSize, uint64_t sourceTime,
+                            RTEventCache* cache);
+
+extern void RTEventCacheClose(RTEventCache cache);
+
+extern const RTEventCacheHeader* RTEventCacheGetHeader(RTEventCache cache);
+
+/**
+ * Returns the next record, its payload points into the mapped log.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_END_OF_LOG
+ * @retval RT_RETURN_ILLEGAL_DATA - the payload of the record lies outside the log
+ */
+extern int RTEventCacheNext(RTEventCache cache, const RTEventCacheRecord** record, const char** payload);
+
+/**
+ * The next RTEventCacheNext returns the first record, in log order, at or after time. The
+ * records after it follow in log order, a late one among them may be earlier than time.
+ */
+extern int RTEventCacheSeek(RTEventCache cache, double time);
+
+
+/**
+ * Starts collecting the records of a log of sourceSize bytes written at sourceTime; the
+ * cache is written to path by RTEventCacheWriterCommit.
+ */
+extern int RTEventCacheWriterCreate(const char* path, uint64_t sourceSize, uint64_t sourceTime, RTEventCacheWriter* writer);
+
+/**
+ * Adds a record, its payload is the size bytes at offset of the log.
+ */
+extern int RTEventCacheWriterAdd(RTEventCacheWriter writer, double time, uint64_t offset, uint32_t size, uint32_t recordNr);
+
+/**
+ * Writes the cache, source is the log the offsets of the records refer to; it is hashed
+ * for the header.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_CANNOT_OPEN_FILE - the cache could not be written, the log is not affected
+ */
+extern int RTEventCacheWriterCommit(RTEventCacheWriter writer, const char* source, uint64_t nofSkipped);
+
+/**
+ * Discards the records, nothing is written if the writer was not committed.
+ */
+extern void RTEventCacheWriterDestroy(RTEventCacheWriter writer);
+
+
+#endif //_RTEVENTCACHE_H_
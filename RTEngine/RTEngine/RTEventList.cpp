@@ -0,0 +1,509 @@
+﻿#include "pch.h"
+#include "RTEventList.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/* handle = generation << RT_EVENT_SLOT_BITS | (slot + 1) */
+#define RT_EVENT_SLOT_BITS      20
+#define RT_EVENT_SLOT_MASK      ((1u << RT_EVENT_SLOT_BITS) - 1)
+#define RT_EVENT_MAX_SLOTS      ((int)RT_EVENT_SLOT_MASK - 1)
+#define RT_EVENT_GEN_MASK       ((1u << (32 - RT_EVENT_SLOT_BITS)) - 1)
+
+#define RT_EVENT_FREE           (-1)
+
+
+typedef struct _RTEventSlot
+{
+	RTEventInfo     info;
+	double          endTime;
+	unsigned long   sequence;       /* insertion order, breaks ties between equal end times */
+	int             heapPos;        /* RT_EVENT_FREE when the slot is not in use */
+	unsigned int    generation;
+	int             nextFree;
+} RTEventSlot;
+
+
+/* Snapshot: the header, the generation and free list link of every slot, the live events in heap order */
+#define RT_EVENT_SNAPSHOT_MAGIC     0x45564C53u     /* "SLVE" */
+
+typedef struct _RTEventSnapshotHeader
+{
+	unsigned int    magic;
+	int             capacity;
+	int             size;
+	int             firstFree;
+	unsigned long   nextSequence;
+} RTEventSnapshotHeader;
+
+typedef struct _RTEventSnapshotSlot
+{
+	unsigned int    generation;
+	int             nextFree;
+} RTEventSnapshotSlot;
+
+typedef struct _RTEventSnapshotEvent
+{
+	RTEventInfo     info;
+	double          endTime;
+	unsigned long   sequence;
+	int             slot;
+} RTEventSnapshotEvent;
+
+
+typedef struct _RTEventListStruct
+{
+	RTEventSlot    *slots;
+	int            *heap;           /* slot indices, heap[0] ends first */
+	int             size;
+	int             capacity;
+	int             firstFree;
+	unsigned long   nextSequence;
+} RTEventListStruct;
+
+
+
+static int EndsBefore(RTEventList list, int slotA, int slotB)
+{
+	const RTEventSlot *a = &list->slots[slotA];
+	const RTEventSlot *b = &list->slots[slotB];
+
+	if (a->endTime != b->endTime)
+		return a->endTime < b->endTime;
+	return a->sequence < b->sequence;
+}
+
+
+static void HeapSet(RTEventList list, int pos, int slot)
+{
+	list->heap[pos] = slot;
+	list->slots[slot].heapPos = pos;
+}
+
+
+static void SiftUp(RTEventList list, int pos)
+{
+	int slot = list->heap[pos];
+
+	while (pos > 0)
+	{
+		int parent = (pos - 1) >> 1;
+		if (!EndsBefore(list, slot, list->heap[parent]))
+			break;
+		HeapSet(list, pos, list->heap[parent]);
+		pos = parent;
+	}
+	HeapSet(list, pos, slot);
+}
+
+
+static void SiftDown(RTEventList list, int pos)
+{
+	int slot = list->heap[pos];
+
+	for (;;)
+	{
+		int child = 2 * pos + 1;
+		if (child >= list->size)
+			break;
+		if (child + 1 < list->size && EndsBefore(list, list->heap[child + 1], list->heap[child]))
+			child++;
+		if (!EndsBefore(list, list->heap[child], slot))
+			break;
+		HeapSet(list, pos, list->heap[child]);
+		pos = child;
+	}
+	HeapSet(list, pos, slot);
+}
+
+
+static void Reposition(RTEventList list, int pos)
+{
+	if (pos > 0 && EndsBefore(list, list->heap[pos], list->heap[(pos - 1) >> 1]))
+		SiftUp(list, pos);
+	else
+		SiftDown(list, pos);
+}
+
+
+static int Grow(RTEventList list, int newCapacity)
+{
+	RTEventSlot *slots;
+	int *heap;
+	int i;
+
+	if (list->capacity >= RT_EVENT_MAX_SLOTS)
+		return RT_RETURN_OUT_OF_MEMORY;
+	if (newCapacity > RT_EVENT_MAX_SLOTS)
+		newCapacity = RT_EVENT_MAX_SLOTS;
+
+	slots = (RTEventSlot*)realloc(list->slots, newCapacity * sizeof(RTEventSlot));
+	if (slots == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	list->slots = slots;
+
+	heap = (int*)realloc(list->heap, newCapacity * sizeof(int));
+	if (heap == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	list->heap = heap;
+
+	for (i = list->capacity; i < newCapacity; i++)
+	{
+		list->slots[i].heapPos = RT_EVENT_FREE;
+		list->slots[i].generation = 0;
+		list->slots[i].nextFree = (i + 1 < newCapacity) ? i + 1 : RT_EVENT_FREE;
+	}
+	list->firstFree = list->capacity;
+	list->capacity = newCapacity;
+	return RT_RETURN_OK;
+}
+
+
+/* returns the slot of a live event, or RT_EVENT_FREE */
+static int LookupHandle(RTEventList list, RTEventHandle handle)
+{
+	int slot;
+
+	if (list == NULL || handle == RT_EVENT_HANDLE_INVALID)
+		return RT_EVENT_FREE;
+
+	slot = (int)(handle & RT_EVENT_SLOT_MASK) - 1;
+	if (slot < 0 || slot >= list->capacity)
+		return RT_EVENT_FREE;
+	if (list->slots[slot].heapPos == RT_EVENT_FREE ||
+		list->slots[slot].generation != (handle >> RT_EVENT_SLOT_BITS))
+		return RT_EVENT_FREE;
+	return slot;
+}
+
+
+static void RemoveAt(RTEventList list, int pos)
+{
+	int slot = list->heap[pos];
+	int last = list->heap[--list->size];
+
+	if (pos < list->size)
+	{
+		HeapSet(list, pos, last);
+		Reposition(list, pos);
+	}
+
+	list->slots[slot].heapPos = RT_EVENT_FREE;
+	list->slots[slot].generation = (list->slots[slot].generation + 1) & RT_EVENT_GEN_MASK;
+	list->slots[slot].nextFree = list->firstFree;
+	list->firstFree = slot;
+}
+
+
+
+int RTEventListCreate(unsigned int initialCapacity, RTEventList* list)
+{
+	RTEventList l;
+
+	if (list == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*list = NULL;
+
+	if (initialCapacity < 16)
+		initialCapacity = 16;
+	if (initialCapacity > (unsigned int)RT_EVENT_MAX_SLOTS)
+		initialCapacity = (unsigned int)RT_EVENT_MAX_SLOTS;
+
+	l = (RTEventList)calloc(1, sizeof(RTEventListStruct));
+	if (l == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+
+	l->firstFree = RT_EVENT_FREE;
+	if (Grow(l, (int)initialCapacity) != RT_RETURN_OK)
+	{
+		RTEventListDestroy(l);
+		return RT_RETURN_OUT_OF_MEMORY;
+	}
+
+	*list = l;
+	return RT_RETURN_OK;
+}
+
+
+void RTEventListDestroy(RTEventList list)
+{
+	if (list == NULL)
+		return;
+	free(list->slots);
+	free(list->heap);
+	free(list);
+}
+
+
+void RTEventListClear(RTEventList list)
+{
+	if (list == NULL)
+		return;
+	while (list->size > 0)
+		RemoveAt(list, list->size - 1);
+}
+
+
+int RTEventListInsert(RTEventList list, double endTime, const RTEventInfo* info, RTEventHandle* handle)
+{
+	int slot;
+	int ret;
+
+	if (list == NULL || info == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	if (list->firstFree == RT_EVENT_FREE)
+	{
+		ret = Grow(list, list->capacity * 2);
+		if (ret != RT_RETURN_OK)
+			return ret;
+	}
+
+	slot = list->firstFree;
+	list->firstFree = list->slots[slot].nextFree;
+
+	list->slots[slot].info = *info;
+	list->slots[slot].endTime = endTime;
+	list->slots[slot].sequence = list->nextSequence++;
+
+	list->heap[list->size] = slot;
+	list->slots[slot].heapPos = list->size;
+	list->size++;
+	SiftUp(list, list->size - 1);
+
+	if (handle != NULL)
+		*handle = (list->slots[slot].generation << RT_EVENT_SLOT_BITS) | (unsigned int)(slot + 1);
+	return RT_RETURN_OK;
+}
+
+
+int RTEventListCancel(RTEventList list, RTEventHandle handle)
+{
+	int slot = LookupHandle(list, handle);
+
+	if (slot == RT_EVENT_FREE)
+		return RT_RETURN_NOT_FOUND;
+	RemoveAt(list, list->slots[slot].heapPos);
+	return RT_RETURN_OK;
+}
+
+
+int RTEventListRefresh(RTEventList list, RTEventHandle handle, double newEndTime)
+{
+	int slot = LookupHandle(list, handle);
+
+	if (slot == RT_EVENT_FREE)
+		return RT_RETURN_NOT_FOUND;
+	list->slots[slot].endTime = newEndTime;
+	Reposition(list, list->slots[slot].heapPos);
+	return RT_RETURN_OK;
+}
+
+
+int RTEventListAddStacks(RTEventList list, RTEventHandle handle, int stacks, double newEndTime)
+{
+	int slot = LookupHandle(list, handle);
+
+	if (slot == RT_EVENT_FREE)
+		return RT_RETURN_NOT_FOUND;
+	list->slots[slot].info.stacks += stacks;
+	list->slots[slot].endTime = newEndTime;
+	Reposition(list, list->slots[slot].heapPos);
+	return RT_RETURN_OK;
+}
+
+
+int RTEventListCancelTarget(RTEventList list, int targetId, int* nofCancelled)
+{
+	int pos;
+	int n = 0;
+
+	if (list == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	/* Walk backwards. RemoveAt moves the (visited) last element into pos; when it sifts up,
+	   the unvisited parent comes down into pos, so pos is looked at again. */
+	for (pos = list->size - 1; pos >= 0; pos--)
+	{
+		if (pos < list->size && list->slots[list->heap[pos]].info.targetId == targetId)
+		{
+			RemoveAt(list, pos);
+			n++;
+			pos++;
+		}
+	}
+
+	if (nofCancelled != NULL)
+		*nofCancelled = n;
+	return RT_RETURN_OK;
+}
+
+
+int RTEventListGetEvent(RTEventList list, RTEventHandle handle, RTEventInfo* info, double* endTime)
+{
+	int slot = LookupHandle(list, handle);
+
+	if (slot == RT_EVENT_FREE)
+		return RT_RETURN_NOT_FOUND;
+	if (info != NULL)
+		*info = list->slots[slot].info;
+	if (endTime != NULL)
+		*endTime = list->slots[slot].endTime;
+	return RT_RETURN_OK;
+}
+
+
+int RTEventListPeekNext(RTEventList list, double* endTime)
+{
+	if (list == NULL || endTime == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (list->size == 0)
+		return RT_RETURN_NOT_FOUND;
+	*endTime = list->slots[list->heap[0]].endTime;
+	return RT_RETURN_OK;
+}
+
+
+int RTEventListPopExpired(RTEventList list, double time, RTEventInfo* info, double* endTime)
+{
+	RTEventSlot *first;
+
+	if (list == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (list->size == 0)
+		return RT_RETURN_NOT_FOUND;
+
+	first = &list->slots[list->heap[0]];
+	if (first->endTime > time)
+		return RT_RETURN_NOT_FOUND;
+
+	if (info != NULL)
+		*info = first->info;
+	if (endTime != NULL)
+		*endTime = first->endTime;
+	RemoveAt(list, 0);
+	return RT_RETURN_OK;
+}
+
+
+int RTEventListGetSize(RTEventList list)
+{
+	return (list != NULL) ? list->size : 0;
+}
+
+
+size_t RTEventListGetSnapshotSize(RTEventList list)
+{
+	if (list == NULL)
+		return 0;
+	return sizeof(RTEventSnapshotHeader) + list->capacity * sizeof(RTEventSnapshotSlot) +
+	       list->size * sizeof(RTEventSnapshotEvent);
+}
+
+
+int RTEventListSave(RTEventList list, void* buffer, size_t size, size_t* written)
+{
+	RTEventSnapshotHeader *header = (RTEventSnapshotHeader*)buffer;
+	RTEventSnapshotSlot *slots;
+	RTEventSnapshotEvent *events;
+	const RTEventSlot *slot;
+	size_t needed = RTEventListGetSnapshotSize(list);
+	int i;
+
+	if (written != NULL)
+		*written = 0;
+	if (list == NULL || buffer == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (size < needed)
+		return RT_RETURN_BUFFER_OVERFLOW;
+
+	header->magic = RT_EVENT_SNAPSHOT_MAGIC;
+	header->capacity = list->capacity;
+	header->size = list->size;
+	header->firstFree = list->firstFree;
+	header->nextSequence = list->nextSequence;
+
+	slots = (RTEventSnapshotSlot*)(header + 1);
+	for (i = 0; i < list->capacity; i++)
+	{
+		slots[i].generation = list->slots[i].generation;
+		slots[i].nextFree = list->slots[i].nextFree;
+	}
+
+	events = (RTEventSnapshotEvent*)(slots + list->capacity);
+	for (i = 0; i < list->size; i++)
+	{
+		slot = &list->slots[list->heap[i]];
+		events[i].info = slot->info;
+		events[i].endTime = slot->endTime;
+		events[i].sequence = slot->sequence;
+		events[i].slot = list->heap[i];
+	}
+
+	if (written != NULL)
+		*written = needed;
+	return RT_RETURN_OK;
+}
+
+
+int RTEventListRestore(RTEventList list, const void* buffer, size_t size)
+{
+	const RTEventSnapshotHeader *header = (const RTEventSnapshotHeader*)buffer;
+	const RTEventSnapshotSlot *slots;
+	const RTEventSnapshotEvent *events;
+	RTEventSlot *newSlots;
+	int *newHeap;
+	int i, slot;
+
+	if (list == NULL || buffer == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (size < sizeof(RTEventSnapshotHeader) || header->magic != RT_EVENT_SNAPSHOT_MAGIC ||
+		header->capacity <= 0 || header->capacity > RT_EVENT_MAX_SLOTS ||
+		header->size < 0 || header->size > header->capacity ||
+		header->firstFree < RT_EVENT_FREE || header->firstFree >= header->capacity ||
+		size < sizeof(RTEventSnapshotHeader) + header->capacity * sizeof(RTEventSnapshotSlot) +
+		       header->size * sizeof(RTEventSnapshotEvent))
+		return RT_RETURN_ILLEGAL_DATA;
+	slots = (const RTEventSnapshotSlot*)(header + 1);
+	events = (const RTEventSnapshotEvent*)(slots + header->capacity);
+	for (i = 0; i < header->size; i++)
+	{
+		if (events[i].slot < 0 || events[i].slot >= header->capacity)
+			return RT_RETURN_ILLEGAL_DATA;
+	}
+
+	/* a list that grew beyond the snapshot keeps its memory, the slots above are unused */
+	if (list->capacity < header->capacity)
+	{
+		newSlots = (RTEventSlot*)realloc(list->slots, header->capacity * sizeof(RTEventSlot));
+		if (newSlots == NULL)
+			return RT_RETURN_OUT_OF_MEMORY;
+		list->slots = newSlots;
+		newHeap = (int*)realloc(list->heap, header->capacity * sizeof(int));
+		if (newHeap == NULL)
+			return RT_RETURN_OUT_OF_MEMORY;
+		list->heap = newHeap;
+	}
+
+	list->capacity = header->capacity;
+	list->size = header->size;
+	list->firstFree = header->firstFree;
+	list->nextSequence = header->nextSequence;
+	for (i = 0; i < list->capacity; i++)
+	{
+		list->slots[i].heapPos = RT_EVENT_FREE;
+		list->slots[i].generation = slots[i].generation;
+		list->slots[i].nextFree = slots[i].nextFree;
+	}
+	for (i = 0; i < list->size; i++)
+	{
+		slot = events[i].slot;
+		list->slots[slot].info = events[i].info;
+		list->slots[slot].endTime = events[i].endTime;
+		list->slots[slot].sequence = events[i].sequence;
+		list->heap[i] = slot;
+		list->slots[slot].heapPos = i;
+	}
+	return RT_RETURN_OK;
+}
@@ -0,0 +1,164 @@
+﻿#ifndef _RTEVENTLIST_H_
+#define _RTEVENTLIST_H_
+
+#include "RTEngine.h"
+
+#include <stddef.h>
+
+/*
+	Event List of the RTContext: effect durations and timed events (buffs, cleanses,
+	respawns, death timers, ...) ordered by the game time at which they end.
+
+	Indexed binary min-heap keyed on the end time. Every event keeps its position in
+	the heap, so insert, cancel (death/cleanse), refresh and stack are O(log n) and
+	looking at the next deadline is O(1). Events that end at the same time come out
+	in insertion order.
+
+	PRE: an Event List is used from one thread at a time (the TIME_TICK thread).
+*/
+
+
+/** Handle to an event in the Event List, RT_EVENT_HANDLE_INVALID is never returned for a valid event */
+typedef unsigned int RTEventHandle;
+
+#define RT_EVENT_HANDLE_INVALID     0
+
+/** Default number of events the Event List is sized for, it grows when needed */
+#define RT_EVENT_LIST_DEFAULT_CAPACITY  256
+
+
+/** What an event is about, copied into the Event List */
+typedef struct _RTEventInfo
+{
+	int     type;           /**< event/effect type, defined by the module that creates it */
+	int     sourceId;       /**< id of the character that caused the event */
+	int     targetId;       /**< id of the character the event applies to */
+	int     stacks;         /**< number of stacks of the effect */
+	double  startTime;      /**< game time in seconds at which the event started */
+	void   *userData;       /**< reference only, not released by the Event List */
+} RTEventInfo;
+
+
+/* RTEventList itself is declared in RTEngine.h */
+
+
+/**
+ * Creates an empty Event List.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int RTEventListCreate(unsigned int initialCapacity, RTEventList* list);
+
+/**
+ * Destroys an Event List.
+ */
+extern void RTEventListDestroy(RTEventList list);
+
+/**
+ * Removes all events.
+ */
+extern void RTEventListClear(RTEventList list);
+
+/**
+ * Adds an event that ends at endTime (game time in seconds).
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int RTEventListInsert(RTEventList list, double endTime, const RTEventInfo* info, RTEventHandle* handle);
+
+/**
+ * Removes an event before it ends (death, cleanse, ...).
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_NOT_FOUND - the event already ended or was cancelled
+ */
+extern int RTEventListCancel(RTEventList list, RTEventHandle handle);
+
+/**
+ * Moves the end time of an event (refresh buff). The new end time may be earlier or later.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_NOT_FOUND
+ */
+extern int RTEventListRefresh(RTEventList list, RTEventHandle handle, double newEndTime);
+
+/**
+ * Adds stacks to an event and refreshes its end time (stacked effects).
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_NOT_FOUND
+ */
+extern int RTEventListAddStacks(RTEventList list, RTEventHandle handle, int stacks, double newEndTime);
+
+/**
+ * Cancels every event that applies to targetId (e.g. on death). O(n), meant for rare events.
+ *
+ * @param[out] nofCancelled  Optionally, the number of events removed
+ */
+extern int RTEventListCancelTarget(RTEventList list, int targetId, int* nofCancelled);
+
+/**
+ * Retrieves an event.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_NOT_FOUND
+ */
+extern int RTEventListGetEvent(RTEventList list, RTEventHandle handle, RTEventInfo* info, double* endTime);
+
+/**
+ * Returns the end time of the first event to end.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_NOT_FOUND - the list is empty
+ */
+extern int RTEventListPeekNext(RTEventList list, double* endTime);
+
+/**
+ * Removes the first event if it ends at or before time.
+ *
+ * @retval RT_RETURN_OK - an event was removed and copied to info/endTime
+ * @retval RT_RETURN_NOT_FOUND - no event ends at or before time
+ */
+extern int RTEventListPopExpired(RTEventList list, double time, RTEventInfo* info, double* endTime);
+
+/**
+ * Returns the number of events in the list.
+ */
+extern int RTEventListGetSize(RTEventList list);
+
+/**
+ * Bytes RTEventListSave needs for the list as it is now: the live events and a few bytes
+ * per free slot, not the capacity of the list.
+ */
+extern size_t RTEventListGetSnapshotSize(RTEventList list);
+
+/**
+ * Writes the state of the list to buffer. RTEventListRestore puts the list back in exactly
+ * that state: the same events in the same order, the handles valid at the save valid
+ * again, and the same handles for the events inserted after it. userData is saved as a
+ * reference.
+ *
+ * @param[out]  written     Optionally, the bytes written
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_BUFFER_OVERFLOW - size is less than RTEventListGetSnapshotSize
+ */
+extern int RTEventListSave(RTEventList list, void* buffer, size_t size, size_t* written);
+
+/**
+ * Restores a state written by RTEventListSave, of this or of another Event List.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_ILLEGAL_DATA - buffer holds no snapshot of an Event List
+ * @retval RT_RETURN_OUT_OF_MEMORY - the list is unchanged
+ */
+extern int RTEventListRestore(RTEventList list, const void* buffer, size_t size);
+
+
+#endif //_RTEVENTLIST_H_
@@ -0,0 +1,167 @@
+﻿#include "pch.h"
+#include "RTFile.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+#define RT_FILE_TMP_EXTENSION       ".tmp"
+
+
+
+int RTFileMap(const char* path, size_t minSize, unsigned int flags, RTFileMapStruct* map)
+{
+	if (path == NULL || map == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (minSize == 0)
+		minSize = 1;
+
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+	LARGE_INTEGER size;
+	FILETIME written;
+	const char *base = NULL;
+
+	/* a live log is still being written by the game */
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+	                   OPEN_EXISTING, (flags & RT_FILE_MAP_SEQUENTIAL) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL,
+	                   NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return RT_RETURN_CANNOT_OPEN_FILE;
+	if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size) || !GetFileTime(file, NULL, NULL, &written))
+	{
+		CloseHandle(file);
+		return RT_RETURN_CANNOT_OPEN_FILE;
+	}
+	if ((unsigned long long)size.QuadPart < minSize || (unsigned long long)size.QuadPart > (SIZE_MAX >> 1))
+	{
+		CloseHandle(file);
+		return RT_RETURN_ILLEGAL_DATA;
+	}
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != NULL)
+	{
+		base = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		/* the view keeps the mapping alive */
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	if (base == NULL)
+		return RT_RETURN_CANNOT_OPEN_FILE;
+
+	map->base = base;
+	map->size = (size_t)size.QuadPart;
+	map->time = ((uint64_t)written.dwHighDateTime << 32) | written.dwLowDateTime;
+#else
+	struct stat st;
+	void *base;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return RT_RETURN_CANNOT_OPEN_FILE;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		close(fd);
+		return RT_RETURN_CANNOT_OPEN_FILE;
+	}
+	if ((unsigned long long)st.st_size < minSize || (unsigned long long)st.st_size > (SIZE_MAX >> 1))
+	{
+		close(fd);
+		return RT_RETURN_ILLEGAL_DATA;
+	}
+
+	base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	/* the mapping keeps the file alive */
+	close(fd);
+	if (base == MAP_FAILED)
+		return RT_RETURN_CANNOT_OPEN_FILE;
+	if (flags & RT_FILE_MAP_SEQUENTIAL)
+		madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+	map->base = (const char*)base;
+	map->size = (size_t)st.st_size;
+	map->time = (uint64_t)st.st_mtim.tv_sec * 1000000000u + (uint64_t)st.st_mtim.tv_nsec;
+#endif
+	return RT_RETURN_OK;
+}
+
+
+void RTFileUnmap(const RTFileMapStruct* map)
+{
+	if (map == NULL || map->base == NULL)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(map->base);
+#else
+	munmap((void*)map->base, map->size);
+#endif
+}
+
+
+
+static char* TmpPath(const char* path)
+{
+	char *tmpPath = (char*)malloc(strlen(path) + sizeof(RT_FILE_TMP_EXTENSION));
+
+	if (tmpPath != NULL)
+	{
+		strcpy(tmpPath, path);
+		strcat(tmpPath, RT_FILE_TMP_EXTENSION);
+	}
+	return tmpPath;
+}
+
+
+int RTFileWriteBegin(const char* path, FILE** file)
+{
+	char *tmpPath;
+
+	if (path == NULL || file == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	tmpPath = TmpPath(path);
+	if (tmpPath == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	*file = fopen(tmpPath, "wb");
+	free(tmpPath);
+	return (*file != NULL) ? RT_RETURN_OK : RT_RETURN_CANNOT_OPEN_FILE;
+}
+
+
+int RTFileWriteEnd(const char* path, FILE* file, int ok)
+{
+	char *tmpPath;
+
+	if (path == NULL || file == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (fclose(file) != 0)
+		ok = 0;
+	tmpPath = TmpPath(path);
+	if (tmpPath == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+
+	/* replace in one step, a reader sees the old file or the new one; rename does not replace on Windows */
+	if (ok)
+	{
+#ifdef _WIN32
+		ok = (MoveFileExA(tmpPath, path, MOVEFILE_REPLACE_EXISTING) != 0);
+#else
+		ok = (rename(tmpPath, path) == 0);
+#endif
+	}
+	if (!ok)
+		remove(tmpPath);
+	free(tmpPath);
+	return ok ? RT_RETURN_OK : RT_RETURN_CANNOT_OPEN_FILE;
+}
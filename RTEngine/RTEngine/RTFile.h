@@ -0,0 +1,71 @@
+﻿#ifndef _RTFILE_H_
+#define _RTFILE_H_
+
+#include "RTEngine.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+	Files of the engine on disk: whole files mapped read only, and files written in one
+	piece. The replay log, the event cache and the event store of the Value Engine use them.
+
+	RTFileMap maps a whole regular file. The file is closed once mapped: it can be
+	replaced or removed while the mapping keeps the version that was opened.
+
+	RTFileWriteBegin opens <path>.tmp and RTFileWriteEnd renames it over path in one step
+	when every write succeeded, so a reader sees the old file or the new one, never a half
+	written or missing one; otherwise the temporary file is removed and path is left as it was.
+*/
+
+
+/** The file is read from front to back, the OS is told so */
+#define RT_FILE_MAP_SEQUENTIAL      (1 << 0)
+
+
+typedef struct _RTFileMapStruct
+{
+	const char      *base;
+	size_t          size;
+	uint64_t        time;           /**< last write time, in the units of the file system */
+} RTFileMapStruct;
+
+
+/**
+ * Maps the file at path read only.
+ *
+ * @param[in]   minSize     Smallest size the file may have, at least 1
+ * @param[in]   flags       RT_FILE_MAP_*
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_CANNOT_OPEN_FILE - no regular file at path, or it cannot be mapped
+ * @retval RT_RETURN_ILLEGAL_DATA - the file is smaller than minSize or too large for the address space
+ */
+extern int RTFileMap(const char* path, size_t minSize, unsigned int flags, RTFileMapStruct* map);
+
+extern void RTFileUnmap(const RTFileMapStruct* map);
+
+/**
+ * Opens the temporary file of path for writing.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ * @retval RT_RETURN_CANNOT_OPEN_FILE
+ */
+extern int RTFileWriteBegin(const char* path, FILE** file);
+
+/**
+ * Closes file and replaces path with it when ok and the close succeeded, else removes it.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ * @retval RT_RETURN_CANNOT_OPEN_FILE - not ok, or the file could not be closed or renamed
+ */
+extern int RTFileWriteEnd(const char* path, FILE* file, int ok);
+
+
+#endif //_RTFILE_H_
@@ -0,0 +1,338 @@
+﻿#include "pch.h"
+#include "RTLive.h"
+#include "qthreads.h"
+
+#include <string.h>
+#include <math.h>
+#include <new>
+#include <atomic>
+#include <chrono>
+
+
+typedef struct _RTLiveStruct
+{
+	RTLiveSettings              settings;           /* window set */
+	std::atomic<int>            level;
+	std::atomic<double>         serviceTime;        /* seconds per entry, moving average */
+	std::atomic<unsigned long>  nofDropped;
+
+	/* TIME_TICK thread only */
+	double                      windowStart;
+	unsigned long               windowEntries;
+	unsigned long               windowLate;
+	double                      windowBusy;
+	double                      windowMax;
+	double                      windowThrottled;
+	int                         nofRelaxed;         /* windows in a row well inside the settings */
+	unsigned long               nofEntries;
+	unsigned long               nofLate;
+	double                      latencySum;
+	double                      maxLatency;
+	unsigned long               histogram[RT_LIVE_HISTOGRAM_BUCKETS];
+	double                      busySeconds;
+	double                      throttledSeconds;
+	unsigned long               nofLevelChanges;
+	double                      levelSeconds[RT_NOF_LIVE_LEVELS];
+
+	QThread_Mutex               lock;               /* of published */
+	RTLiveStats                 published;
+} RTLiveStruct;
+
+
+
+/* bucket of a latency of us microseconds, us = m * 2^e with m in [0.5, 1) */
+static int RTLiveBucket(double us)
+{
+	double m;
+	int e, b;
+
+	if (us < 1.0)
+		return 0;
+	m = frexp(us, &e);
+	b = 1 + (e - 1) * RT_LIVE_HISTOGRAM_SUB_BUCKETS + (int)((2.0 * m - 1.0) * RT_LIVE_HISTOGRAM_SUB_BUCKETS);
+	return (b < RT_LIVE_HISTOGRAM_BUCKETS) ? b : RT_LIVE_HISTOGRAM_BUCKETS - 1;
+}
+
+
+/* upper end of bucket b in microseconds */
+static double RTLiveBucketEnd(int b)
+{
+	int octave, sub;
+
+	if (b == 0)
+		return 1.0;
+	octave = (b - 1) / RT_LIVE_HISTOGRAM_SUB_BUCKETS;
+	sub = (b - 1) % RT_LIVE_HISTOGRAM_SUB_BUCKETS;
+	return ldexp(1.0 + (double)(sub + 1) / RT_LIVE_HISTOGRAM_SUB_BUCKETS, octave);
+}
+
+
+/* upper end of the bucket below which fraction of the entries are */
+static double RTLivePercentile(const unsigned long* histogram, unsigned long nofEntries, double fraction)
+{
+	unsigned long count = 0;
+	int b;
+
+	if (nofEntries == 0)
+		return 0.0;
+	for (b = 0; b < RT_LIVE_HISTOGRAM_BUCKETS - 1; b++)
+	{
+		count += histogram[b];
+		if ((double)count >= fraction * (double)nofEntries)
+			break;
+	}
+	return RTLiveBucketEnd(b) * 1e-6;
+}
+
+
+static void RTLivePublish(RTLive live, double share)
+{
+	RTLiveStats stats;
+
+	stats.level = live->level.load(std::memory_order_relaxed);
+	stats.nofEntries = live->nofEntries;
+	stats.nofLate = live->nofLate;
+	stats.meanLatency = (live->nofEntries > 0) ? live->latencySum / (double)live->nofEntries : 0.0;
+	stats.latency50 = RTLivePercentile(live->histogram, live->nofEntries, 0.5);
+	stats.latency99 = RTLivePercentile(live->histogram, live->nofEntries, 0.99);
+	stats.maxLatency = live->maxLatency;
+	stats.windowMaxLatency = live->windowMax;
+	stats.windowShare = share;
+	stats.busySeconds = live->busySeconds;
+	stats.throttledSeconds = live->throttledSeconds;
+	stats.nofDropped = live->nofDropped.load(std::memory_order_relaxed);
+	stats.nofLevelChanges = live->nofLevelChanges;
+	memcpy(stats.levelSeconds, live->levelSeconds, sizeof(stats.levelSeconds));
+
+	QThread_Mutex_P(live->lock);
+	live->published = stats;
+	QThread_Mutex_V(live->lock);
+}
+
+
+/*
+	End of a window: one level up when it missed the target or the share, one level
+	down after RT_LIVE_RELAX_WINDOWS windows without a late entry and well inside the
+	share. Returns the level before.
+*/
+static int RTLiveCloseWindow(RTLive live, double now)
+{
+	double elapsed = now - live->windowStart;
+	double share = (elapsed > 0.0) ? live->windowBusy / elapsed : 0.0;
+	int level = live->level.load(std::memory_order_relaxed);
+	int previous = level;
+	int missed, inside;
+
+	missed = (live->windowEntries > 0 && (double)live->windowLate > RT_LIVE_LATE_SHARE * (double)live->windowEntries) ||
+	         live->windowThrottled > 0.0 ||
+	         (live->settings.cpuShare > 0.0 && share > live->settings.cpuShare);
+	inside = live->windowLate == 0 &&
+	         (live->settings.cpuShare <= 0.0 || share < live->settings.cpuShare * 0.75);
+
+	if (missed)
+	{
+		live->nofRelaxed = 0;
+		if (level < RT_LIVE_LEVEL_DROP_PASSAGES)
+			level++;
+	}
+	else if (inside)
+	{
+		if (++live->nofRelaxed >= RT_LIVE_RELAX_WINDOWS && level > RT_LIVE_LEVEL_FULL)
+		{
+			level--;
+			live->nofRelaxed = 0;
+		}
+	}
+	else
+	{
+		live->nofRelaxed = 0;
+	}
+
+	live->levelSeconds[previous] += elapsed;
+	if (level != previous)
+	{
+		live->level.store(level, std::memory_order_relaxed);
+		live->nofLevelChanges++;
+	}
+	RTLivePublish(live, share);
+
+	live->windowStart = now;
+	live->windowEntries = 0;
+	live->windowLate = 0;
+	live->windowBusy = 0.0;
+	live->windowMax = 0.0;
+	live->windowThrottled = 0.0;
+	return previous;
+}
+
+
+
+int RTLiveCreate(const RTLiveSettings* settings, RTLive* live)
+{
+	RTLive l;
+
+	if (settings == NULL || live == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*live = NULL;
+
+	l = new (std::nothrow) RTLiveStruct();
+	if (l == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	if (QThread_Mutex_create(&l->lock) != QTHREAD_RETURN_OK)
+	{
+		delete l;
+		return RT_RETURN_OUT_OF_MEMORY;
+	}
+	l->settings = *settings;
+	if (l->settings.window <= 0.0)
+		l->settings.window = RT_LIVE_DEFAULT_WINDOW;
+	l->level.store(RT_LIVE_LEVEL_FULL);
+	l->serviceTime.store(0.0);
+	l->nofDropped.store(0);
+	l->windowStart = RTLiveNow();
+	RTLivePublish(l, 0.0);
+
+	*live = l;
+	return RT_RETURN_OK;
+}
+
+
+void RTLiveDestroy(RTLive live)
+{
+	if (live == NULL)
+		return;
+	QThread_Mutex_destroy(&live->lock);
+	delete live;
+}
+
+
+double RTLiveNow(void)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+int RTLiveGetLevel(RTLive live)
+{
+	return (live != NULL) ? live->level.load(std::memory_order_relaxed) : RT_LIVE_LEVEL_FULL;
+}
+
+
+void RTLiveEntryDone(RTLive live, double arrival, double now)
+{
+	double latency = now - arrival;
+
+	if (live == NULL || arrival <= 0.0)
+		return;
+	if (latency < 0.0)
+		latency = 0.0;
+
+	live->histogram[RTLiveBucket(latency * 1e6)]++;
+	live->nofEntries++;
+	live->windowEntries++;
+	live->latencySum += latency;
+	if (latency > live->maxLatency)
+		live->maxLatency = latency;
+	if (latency > live->windowMax)
+		live->windowMax = latency;
+	if (live->settings.targetLatency > 0.0 && latency > live->settings.targetLatency)
+	{
+		live->nofLate++;
+		live->windowLate++;
+	}
+}
+
+
+unsigned int RTLiveBatchDone(RTLive live, int count, double busy, double now, int* previous)
+{
+	double service, excess, left;
+
+	*previous = -1;
+	if (live == NULL)
+		return 0;
+
+	if (count > 0)
+	{
+		service = live->serviceTime.load(std::memory_order_relaxed);
+		service += (busy / count - service) * RT_LIVE_SERVICE_WEIGHT;
+		live->serviceTime.store(service, std::memory_order_relaxed);
+	}
+	live->windowBusy += busy;
+	live->busySeconds += busy;
+
+	/* over the share of the window so far: sleep the excess off, at most to the end of the window */
+	if (live->settings.cpuShare > 0.0)
+	{
+		excess = live->windowBusy / live->settings.cpuShare - (now - live->windowStart);
+		left = live->windowStart + live->settings.window - now;
+		if (excess > left)
+			excess = left;
+		if (excess * 1000.0 >= 1.0)
+			return (unsigned int)(excess * 1000.0);
+	}
+
+	if (now - live->windowStart >= live->settings.window)
+	{
+		*previous = RTLiveCloseWindow(live, now);
+		if (*previous == live->level.load(std::memory_order_relaxed))
+			*previous = -1;
+	}
+	return 0;
+}
+
+
+void RTLiveThrottled(RTLive live, double seconds)
+{
+	if (live == NULL)
+		return;
+	live->windowThrottled += seconds;
+	live->throttledSeconds += seconds;
+}
+
+
+unsigned int RTLiveMaxWait(RTLive live, unsigned int waitMsec)
+{
+	double left;
+
+	if (live == NULL)
+		return waitMsec;
+	left = (live->windowStart + live->settings.window - RTLiveNow()) * 1000.0;
+	if (left <= 0.0)
+		return 0;
+	/* round up, waking before the end of the window only costs another wait */
+	if (left + 1.0 < (double)waitMsec)
+		return (unsigned int)left + 1;
+	return waitMsec;
+}
+
+
+int RTLiveAdmit(RTLive live, unsigned int depth)
+{
+	double limit, service;
+
+	if (live == NULL || live->level.load(std::memory_order_relaxed) < RT_LIVE_LEVEL_DROP_PASSAGES)
+		return 1;
+	limit = (live->settings.targetLatency > 0.0) ? live->settings.targetLatency : live->settings.window;
+	/* a thread held to its share takes that much longer per entry */
+	service = live->serviceTime.load(std::memory_order_relaxed);
+	if (live->settings.cpuShare > 0.0)
+		service /= live->settings.cpuShare;
+	if ((double)(depth + 1) * service <= limit)
+		return 1;
+	live->nofDropped.fetch_add(1, std::memory_order_relaxed);
+	return 0;
+}
+
+
+int RTLiveGetStats(RTLive live, RTLiveStats* stats)
+{
+	if (live == NULL || stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	QThread_Mutex_P(live->lock);
+	*stats = live->published;
+	QThread_Mutex_V(live->lock);
+	/* the one counter of the producers is kept current */
+	stats->nofDropped = live->nofDropped.load(std::memory_order_relaxed);
+	return RT_RETURN_OK;
+}
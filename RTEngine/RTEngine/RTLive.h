@@ -0,0 +1,89 @@
+﻿#ifndef _RTLIVE_H_
+#define _RTLIVE_H_
+
+#include "RTEngine.h"
+
+/*
+	Governor of live mode (RTLiveSettings in RTEngine.h).
+
+	The TIME_TICK thread reports every entry it finished (RTLiveEntryDone) and every batch
+	or idle tick (RTLiveBatchDone) with the time it was busy. The governor sums up the
+	window, moves the level at its end and tells the thread how long to sleep to stay in
+	its share. Producers read the level (RTLiveGetLevel) and ask RTLiveAdmit whether a
+	new entry still makes the target.
+
+	Busy time is wall time from the pop of a batch to the end of its last commit, waits
+	for the modules included: the share is what the thread keeps from other work, not
+	only what it computes itself.
+*/
+
+
+/** Share of late entries in a window that raises the level */
+#define RT_LIVE_LATE_SHARE              0.05
+/** Weight of the last batch in the service time per entry */
+#define RT_LIVE_SERVICE_WEIGHT          0.125
+/** Powers of two of microseconds the latency histogram covers */
+#define RT_LIVE_HISTOGRAM_OCTAVES       32
+/** Buckets per power of two: a percentile read from the histogram is at most 1/8 too high */
+#define RT_LIVE_HISTOGRAM_SUB_BUCKETS   8
+/** Bucket 0 counts latencies below 1 microsecond, then every power of two is split in
+    RT_LIVE_HISTOGRAM_SUB_BUCKETS buckets of equal width */
+#define RT_LIVE_HISTOGRAM_BUCKETS       (1 + RT_LIVE_HISTOGRAM_OCTAVES * RT_LIVE_HISTOGRAM_SUB_BUCKETS)
+
+
+/** Forward declaration */
+typedef struct _RTLiveStruct *RTLive;
+
+
+/**
+ * Creates a governor at RT_LIVE_LEVEL_FULL.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int RTLiveCreate(const RTLiveSettings* settings, RTLive* live);
+
+extern void RTLiveDestroy(RTLive live);
+
+/** Steady clock in seconds, the time base of arrivalTime */
+extern double RTLiveNow(void);
+
+/** The rtLiveLevel, RT_LIVE_LEVEL_FULL for NULL. Any thread. */
+extern int RTLiveGetLevel(RTLive live);
+
+/** TIME_TICK thread: the entry that arrived at arrival has been committed at now */
+extern void RTLiveEntryDone(RTLive live, double arrival, double now);
+
+/**
+ * TIME_TICK thread: a batch of count entries (0: an idle tick) kept it busy for busy
+ * seconds until now. Closes the window when it is over and sets *previous to the level
+ * before when that moved the level, to -1 otherwise.
+ *
+ * @return msec the thread should sleep to stay within its share
+ */
+extern unsigned int RTLiveBatchDone(RTLive live, int count, double busy, double now, int* previous);
+
+/** TIME_TICK thread: it slept seconds to stay within its share */
+extern void RTLiveThrottled(RTLive live, double seconds);
+
+/** TIME_TICK thread: waitMsec cut to the end of the window, so an idle window still closes */
+extern unsigned int RTLiveMaxWait(RTLive live, unsigned int waitMsec);
+
+/**
+ * Producers: 0 if the entry should be dropped: at RT_LIVE_LEVEL_DROP_PASSAGES an entry
+ * behind depth queued ones that is not expected to be committed within the target
+ * latency (the window without one). Counts the drop. 1 otherwise.
+ */
+extern int RTLiveAdmit(RTLive live, unsigned int depth);
+
+/**
+ * The stats as of the end of the last window. Any thread.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ */
+extern int RTLiveGetStats(RTLive live, RTLiveStats* stats);
+
+
+#endif //_RTLIVE_H_
@@ -0,0 +1,533 @@
+﻿#include "pch.h"
+#include "RTModuleGraph.h"
+#include "RTProcessBuffer.h"
+#include "RTThreadPool.h"
+#include "qthreads.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <new>
+#include <atomic>
+#include <chrono>
+
+/* after the standard headers, du.h defines min/max */
+#include "du.h"
+
+
+#define RT_MODULE_BIT(module)   (1u << (module))
+
+
+/* a module on a data container of the run */
+typedef struct _RTModuleTask
+{
+	struct _RTModuleGraphStruct    *graph;
+	int                             item;
+	int                             module;
+	struct _RTModuleTask           *next;   /* in the inline list of the thread */
+} RTModuleTask;
+
+
+typedef struct _RTModuleCounters
+{
+	std::atomic<unsigned long>  nofRuns;
+	std::atomic<unsigned long>  nofErrors;
+	std::atomic<unsigned long>  nofSkipped;
+	std::atomic<double>         busySeconds;    /* written by one thread at a time, a module never runs twice at once */
+	std::atomic<double>         maxSeconds;
+} RTModuleCounters;
+
+
+typedef struct _RTModuleGraphStruct
+{
+	RTModuleSettings            modules[RT_MAX_NOF_MODULES];
+	int                         nofModules;
+	int                         nofInitialized;
+
+	unsigned int                before[RT_MAX_NOF_MODULES];     /* RT_MODULE_BIT of the modules a module reads from */
+	int                         nofBefore[RT_MAX_NOF_MODULES];
+	int                         after[RT_MAX_NOF_MODULES][RT_MAX_NOF_MODULES];
+	int                         nofAfter[RT_MAX_NOF_MODULES];
+	int                         level[RT_MAX_NOF_MODULES];
+	int                         order[RT_MAX_NOF_MODULES];      /* by level, then by index */
+
+	RTThreadPool                pool;           /* NULL: the modules run in RTModuleGraphWait */
+	QThread_Semaphore           itemDone;       /* posted once per finished container, in order */
+
+	/* current run */
+	RTDataStruct              **batch;
+	int                         count;
+	RTModuleTask               *tasks;          /* [item * RT_MAX_NOF_MODULES + module] */
+	std::atomic<int>           *pending;        /* modules a task still waits for, same index */
+	std::atomic<int>            remaining[RT_PROCESS_BUFFER_MAX_BATCH];
+	std::atomic<unsigned int>   failed[RT_PROCESS_BUFFER_MAX_BATCH];    /* RT_MODULE_BIT of failed or skipped modules */
+
+	RTModuleCounters            counters[RT_MAX_NOF_MODULES];
+} RTModuleGraphStruct;
+
+
+
+/*
+	Graph
+*/
+
+/* checks who writes what, every product has at most one writer */
+static int FindWriters(RTModuleGraph graph, int writer[RT_MAX_NOF_PRODUCTS])
+{
+	int m, p;
+
+	for (p = 0; p < RT_MAX_NOF_PRODUCTS; p++)
+		writer[p] = -1;
+
+	for (m = 0; m < graph->nofModules; m++)
+	{
+		for (p = 0; p < RT_MAX_NOF_PRODUCTS; p++)
+		{
+			if ((graph->modules[m].outputs & RT_PRODUCT_BIT(p)) == 0)
+				continue;
+			if (p == RT_PRODUCT_PASSAGES || writer[p] >= 0)
+				return RT_RETURN_SETTING_NOT_ALLOWED;
+			writer[p] = m;
+		}
+	}
+
+	for (m = 0; m < graph->nofModules; m++)
+	{
+		for (p = RT_PRODUCT_PASSAGES + 1; p < RT_MAX_NOF_PRODUCTS; p++)
+		{
+			if ((graph->modules[m].inputs & RT_PRODUCT_BIT(p)) != 0 && writer[p] < 0)
+				return RT_RETURN_NOT_FOUND;
+		}
+	}
+	return RT_RETURN_OK;
+}
+
+
+/* edges writer -> reader, then sorted into levels (Kahn) */
+static int SortModules(RTModuleGraph graph, DuGraph du, const int writer[RT_MAX_NOF_PRODUCTS])
+{
+	DuGraphVertex vertices[RT_MAX_NOF_MODULES];
+	int indegree[RT_MAX_NOF_MODULES];
+	int queue[RT_MAX_NOF_MODULES];
+	int head = 0, tail = 0;
+	int m, p, i, j;
+
+	for (m = 0; m < graph->nofModules; m++)
+	{
+		if (DuGraphAddVertex(du, (void*)(intptr_t)m, &vertices[m]) != DU_RETURN_OK)
+			return RT_RETURN_OUT_OF_MEMORY;
+	}
+
+	for (m = 0; m < graph->nofModules; m++)
+	{
+		for (p = RT_PRODUCT_PASSAGES + 1; p < RT_MAX_NOF_PRODUCTS; p++)
+		{
+			DuGraphEdge edge;
+			int w = writer[p];
+
+			if ((graph->modules[m].inputs & RT_PRODUCT_BIT(p)) == 0 || (graph->before[m] & RT_MODULE_BIT(w)) != 0)
+				continue;
+			/* a module that reads what it writes waits for itself */
+			if (w == m)
+				return RT_RETURN_ILLEGAL_DATA;
+			if (DuGraphAddEdge(vertices[w], vertices[m], NULL, &edge) != DU_RETURN_OK)
+				return RT_RETURN_OUT_OF_MEMORY;
+			graph->before[m] |= RT_MODULE_BIT(w);
+		}
+	}
+
+	for (m = 0; m < graph->nofModules; m++)
+	{
+		DuGraphVertex *in;
+		DuGraphEdge *inEdges;
+		long nofIn;
+
+		DuGraphGetInList(vertices[m], &nofIn, &in, &inEdges);
+		graph->nofBefore[m] = indegree[m] = (int)nofIn;
+		if (nofIn == 0)
+			queue[tail++] = m;
+	}
+
+	while (head < tail)
+	{
+		DuGraphVertex *out;
+		DuGraphEdge *outEdges;
+		long nofOut;
+
+		m = queue[head++];
+		DuGraphGetOutList(vertices[m], &nofOut, &out, &outEdges);
+		for (i = 0; i < nofOut; i++)
+		{
+			void *vertexData;
+			int next;
+
+			DuGraphGetVertexData(out[i], &vertexData);
+			next = (int)(intptr_t)vertexData;
+			graph->after[m][graph->nofAfter[m]++] = next;
+			if (graph->level[next] < graph->level[m] + 1)
+				graph->level[next] = graph->level[m] + 1;
+			if (--indegree[next] == 0)
+				queue[tail++] = next;
+		}
+	}
+	/* the modules of a cycle never get free */
+	if (tail < graph->nofModules)
+		return RT_RETURN_ILLEGAL_DATA;
+
+	for (i = 0; i < graph->nofModules; i++)
+	{
+		m = i;
+		for (j = i; j > 0 && graph->level[graph->order[j - 1]] > graph->level[m]; j--)
+			graph->order[j] = graph->order[j - 1];
+		graph->order[j] = m;
+	}
+	return RT_RETURN_OK;
+}
+
+
+static int BuildGraph(RTModuleGraph graph)
+{
+	int writer[RT_MAX_NOF_PRODUCTS];
+	DuGraph du;
+	int ret;
+
+	ret = FindWriters(graph, writer);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	if (DuGraphCreate(&du) != DU_RETURN_OK)
+		return RT_RETURN_OUT_OF_MEMORY;
+	ret = SortModules(graph, du, writer);
+	DuGraphDestroy(du);
+	return ret;
+}
+
+
+
+/*
+	Run
+*/
+
+static void RunModule(RTModuleGraph graph, int item, int module)
+{
+	RTDataStruct *data = graph->batch[item];
+	RTModuleSettings *settings = &graph->modules[module];
+	RTModuleCounters *counters = &graph->counters[module];
+	std::chrono::steady_clock::time_point begin;
+	double seconds;
+	int ret;
+
+	if ((graph->failed[item].load(std::memory_order_acquire) & graph->before[module]) != 0)
+	{
+		/* an input is missing, and so is this module's output */
+		data->moduleReturnValue[module] = RT_RETURN_NO_DATA_YET;
+		graph->failed[item].fetch_or(RT_MODULE_BIT(module), std::memory_order_acq_rel);
+		counters->nofSkipped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	begin = std::chrono::steady_clock::now();
+	ret = settings->process(data, module, settings->context);
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	data->moduleReturnValue[module] = ret;
+	if (ret != RT_RETURN_OK)
+	{
+		graph->failed[item].fetch_or(RT_MODULE_BIT(module), std::memory_order_acq_rel);
+		counters->nofErrors.fetch_add(1, std::memory_order_relaxed);
+	}
+	counters->busySeconds.store(counters->busySeconds.load(std::memory_order_relaxed) + seconds,
+	                            std::memory_order_relaxed);
+	if (seconds > counters->maxSeconds.load(std::memory_order_relaxed))
+		counters->maxSeconds.store(seconds, std::memory_order_relaxed);
+	counters->nofRuns.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+static void ModuleTask(void* taskData, int workerIndex);
+
+
+/* tasks the pool had no room for, run by the thread that got refused */
+static thread_local RTModuleTask *tlInlineTasks;
+static thread_local int tlRunningInline;
+
+
+static void SubmitModule(RTModuleGraph graph, int item, int module)
+{
+	RTModuleTask *task = &graph->tasks[item * RT_MAX_NOF_MODULES + module];
+
+	if (RTThreadPoolSubmit(graph->pool, ModuleTask, task) == RT_RETURN_OK)
+		return;
+
+	/* no room in the pool, run it here rather than lose it: queued, so the tasks it releases do not nest */
+	task->next = tlInlineTasks;
+	tlInlineTasks = task;
+	if (tlRunningInline)
+		return;
+
+	tlRunningInline = 1;
+	while (tlInlineTasks != NULL)
+	{
+		task = tlInlineTasks;
+		tlInlineTasks = task->next;
+		ModuleTask(task, -1);
+	}
+	tlRunningInline = 0;
+}
+
+
+/* one module less to wait for, the task runs when there is none left */
+static void ReleaseModule(RTModuleGraph graph, int item, int module)
+{
+	if (graph->pending[item * RT_MAX_NOF_MODULES + module].fetch_sub(1, std::memory_order_acq_rel) == 1)
+		SubmitModule(graph, item, module);
+}
+
+
+static void ModuleTask(void* taskData, int workerIndex)
+{
+	RTModuleTask *task = (RTModuleTask*)taskData;
+	RTModuleGraph graph = task->graph;
+	int item = task->item;
+	int module = task->module;
+	int count = graph->count;
+	int i;
+
+	(void)workerIndex;
+
+	RunModule(graph, item, module);
+
+	for (i = 0; i < graph->nofAfter[module]; i++)
+		ReleaseModule(graph, item, graph->after[module][i]);
+
+	/*
+		Done with the item before the next item gets this module: the next item can then not
+		finish first, so the posts come in item order. Once the last item is posted the next
+		run may start, the task must not touch the run anymore.
+	*/
+	if (graph->remaining[item].fetch_sub(1, std::memory_order_acq_rel) == 1)
+		QThread_Semaphore_post(graph->itemDone);
+	if (item + 1 < count)
+		ReleaseModule(graph, item + 1, module);
+}
+
+
+
+/* PRE: no worker running */
+static void FreeGraph(RTModuleGraph graph)
+{
+	int i;
+
+	if (graph->pool != NULL)
+		RTThreadPoolDestroy(graph->pool);
+	for (i = graph->nofInitialized - 1; i >= 0; i--)
+	{
+		RTModuleSettings *settings = &graph->modules[graph->order[i]];
+
+		if (settings->finit != NULL)
+			settings->finit();
+	}
+	if (graph->itemDone != NULL)
+		QThread_Semaphore_destroy(&graph->itemDone);
+	delete[] graph->tasks;
+	delete[] graph->pending;
+	delete graph;
+}
+
+
+
+int RTModuleGraphCreate(const RTModuleSettings* modules, int nofModules, int nofWorkers, RTModuleGraph* graph)
+{
+	RTModuleGraph g;
+	int ret;
+	int m;
+
+	if (graph == NULL || (nofModules > 0 && modules == NULL))
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*graph = NULL;
+	if (nofModules > RT_MAX_NOF_MODULES)
+		return RT_RETURN_MAX_NOF_MODULES_REACHED;
+	for (m = 0; m < nofModules; m++)
+	{
+		if (modules[m].process == NULL)
+			return RT_RETURN_ILLEGAL_NULL_POINTER;
+	}
+
+	g = new (std::nothrow) RTModuleGraphStruct();
+	if (g == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	g->nofModules = nofModules;
+	if (nofModules > 0)
+		memcpy(g->modules, modules, nofModules * sizeof(RTModuleSettings));
+
+	ret = BuildGraph(g);
+	if (ret != RT_RETURN_OK)
+	{
+		FreeGraph(g);
+		return ret;
+	}
+
+	/* a module is initialized after the modules it reads from */
+	for (m = 0; m < nofModules; m++)
+	{
+		RTModuleSettings *settings = &g->modules[g->order[m]];
+
+		if (settings->init != NULL && (ret = settings->init(settings->initdata)) != RT_RETURN_OK)
+		{
+			FreeGraph(g);
+			return ret;
+		}
+		g->nofInitialized++;
+	}
+
+	if (nofWorkers > 0)
+	{
+		g->tasks = new (std::nothrow) RTModuleTask[RT_PROCESS_BUFFER_MAX_BATCH * RT_MAX_NOF_MODULES];
+		g->pending = new (std::nothrow) std::atomic<int>[RT_PROCESS_BUFFER_MAX_BATCH * RT_MAX_NOF_MODULES];
+		if (g->tasks == NULL || g->pending == NULL ||
+			QThread_Semaphore_create(&g->itemDone, 0) != QTHREAD_RETURN_OK)
+		{
+			FreeGraph(g);
+			return RT_RETURN_OUT_OF_MEMORY;
+		}
+		ret = RTThreadPoolCreate(nofWorkers, "RT_MODULES", &g->pool);
+		if (ret != RT_RETURN_OK)
+		{
+			FreeGraph(g);
+			return ret;
+		}
+	}
+
+	*graph = g;
+	return RT_RETURN_OK;
+}
+
+
+void RTModuleGraphDestroy(RTModuleGraph graph)
+{
+	if (graph != NULL)
+		FreeGraph(graph);
+}
+
+
+int RTModuleGraphRun(RTModuleGraph graph, RTDataStruct** batch, int count)
+{
+	int n, m;
+
+	if (graph == NULL || (count > 0 && batch == NULL))
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (count < 0 || count > RT_PROCESS_BUFFER_MAX_BATCH)
+		return RT_RETURN_ILLEGAL_DATA;
+
+	graph->batch = batch;
+	graph->count = count;
+	for (n = 0; n < count; n++)
+	{
+		batch[n]->nofModules = graph->nofModules;
+		graph->failed[n].store(0, std::memory_order_relaxed);
+		graph->remaining[n].store(graph->nofModules, std::memory_order_relaxed);
+	}
+	if (graph->pool == NULL || count == 0 || graph->nofModules == 0)
+		return RT_RETURN_OK;
+
+	for (n = 0; n < count; n++)
+	{
+		for (m = 0; m < graph->nofModules; m++)
+		{
+			RTModuleTask *task = &graph->tasks[n * RT_MAX_NOF_MODULES + m];
+
+			task->graph = graph;
+			task->item = n;
+			task->module = m;
+			/* the modules it reads from, and itself on the container before */
+			graph->pending[n * RT_MAX_NOF_MODULES + m].store(graph->nofBefore[m] + (n > 0 ? 1 : 0),
+			                                                 std::memory_order_relaxed);
+		}
+	}
+
+	/* the submit publishes everything above to the workers */
+	for (m = 0; m < graph->nofModules; m++)
+	{
+		if (graph->nofBefore[m] == 0)
+			SubmitModule(graph, 0, m);
+	}
+	return RT_RETURN_OK;
+}
+
+
+void RTModuleGraphWait(RTModuleGraph graph, int item)
+{
+	RTDataStruct *data;
+	int m;
+
+	if (graph == NULL || item < 0 || item >= graph->count || graph->nofModules == 0)
+		return;
+	data = graph->batch[item];
+
+	if (graph->pool != NULL)
+	{
+		QThread_Semaphore_wait(graph->itemDone);
+	}
+	else
+	{
+		for (m = 0; m < graph->nofModules; m++)
+			RunModule(graph, item, graph->order[m]);
+	}
+
+	if (graph->failed[item].load(std::memory_order_acquire) != 0)
+		data->haserror = 1;
+}
+
+
+void RTModuleGraphCommit(RTModuleGraph graph, RTDataStruct* data)
+{
+	int m;
+
+	if (graph == NULL || data == NULL)
+		return;
+
+	for (m = 0; m < graph->nofModules; m++)
+	{
+		int module = graph->order[m];
+		RTModuleSettings *settings = &graph->modules[module];
+
+		if (settings->commit != NULL && data->moduleReturnValue[module] == RT_RETURN_OK)
+			settings->commit(data, module, settings->context);
+	}
+}
+
+
+int RTModuleGraphGetNofModules(RTModuleGraph graph)
+{
+	return (graph != NULL) ? graph->nofModules : 0;
+}
+
+
+int RTModuleGraphSetThreadSettings(RTModuleGraph graph, unsigned long long cpuMask, int priority)
+{
+	if (graph == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	return (graph->pool != NULL) ? RTThreadPoolSetThreadSettings(graph->pool, cpuMask, priority) : RT_RETURN_OK;
+}
+
+
+int RTModuleGraphGetStats(RTModuleGraph graph, int moduleIndex, RTModuleStats* stats)
+{
+	RTModuleCounters *counters;
+
+	if (graph == NULL || stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (moduleIndex < 0 || moduleIndex >= graph->nofModules)
+		return RT_RETURN_ILLEGAL_MODULE_INDEX;
+
+	counters = &graph->counters[moduleIndex];
+	stats->name = graph->modules[moduleIndex].name;
+	stats->level = graph->level[moduleIndex];
+	stats->nofRuns = counters->nofRuns.load(std::memory_order_relaxed);
+	stats->nofErrors = counters->nofErrors.load(std::memory_order_relaxed);
+	stats->nofSkipped = counters->nofSkipped.load(std::memory_order_relaxed);
+	stats->busySeconds = counters->busySeconds.load(std::memory_order_relaxed);
+	stats->maxSeconds = counters->maxSeconds.load(std::memory_order_relaxed);
+	return RT_RETURN_OK;
+}
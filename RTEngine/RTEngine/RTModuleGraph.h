@@ -0,0 +1,78 @@
+﻿#ifndef _RTMODULEGRAPH_H_
+#define _RTMODULEGRAPH_H_
+
+#include "RTEngine.h"
+
+/*
+	Module graph of an instance: the modules of RTInstanceSettings ordered by the
+	products they read and write.
+
+	The dependencies are built into a DuGraph (an edge from the module that writes a
+	product to every module that reads it) and sorted once into levels. At run time a
+	module runs for a data container as soon as the modules it depends on are done with
+	that container and it is done with the container before it. Modules therefore see
+	the data in timestamp order, while independent modules, and the early modules of the
+	next containers, run at the same time on the module workers.
+
+	Containers finish in the order they were given; the TIME_TICK thread waits for each
+	one in turn and commits it.
+
+	PRE: Run, Wait and Commit are called from one thread (the TIME_TICK thread).
+*/
+
+
+/** Forward declaration */
+typedef struct _RTModuleGraphStruct *RTModuleGraph;
+
+
+/**
+ * Checks the dependencies of the modules, calls their init functions and starts the workers.
+ *
+ * @param[in]   modules     nofModules modules, copied
+ * @param[in]   nofWorkers  Module workers, 0 to run the modules in the thread that waits for them
+ * @param[out]  graph       The graph
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_MAX_NOF_MODULES_REACHED
+ * @retval RT_RETURN_NOT_FOUND - an input no module writes
+ * @retval RT_RETURN_SETTING_NOT_ALLOWED - a product written by two modules, or the passages written
+ * @retval RT_RETURN_ILLEGAL_DATA - the dependencies have a cycle
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ * @retval RT_RETURN_INTERNAL_ERROR - a worker could not be started
+ * @returns the return value of a failing init function
+ */
+extern int RTModuleGraphCreate(const RTModuleSettings* modules, int nofModules, int nofWorkers, RTModuleGraph* graph);
+
+/**
+ * Stops the workers and calls the finit functions. PRE: no run in progress.
+ */
+extern void RTModuleGraphDestroy(RTModuleGraph graph);
+
+/**
+ * Starts the modules on count data containers (at most RT_PROCESS_BUFFER_MAX_BATCH).
+ * PRE: every container of the previous run was waited for.
+ */
+extern int RTModuleGraphRun(RTModuleGraph graph, RTDataStruct** batch, int count);
+
+/**
+ * Waits until every module is done with container item of the run, items in order.
+ * Without workers the modules run here.
+ */
+extern void RTModuleGraphWait(RTModuleGraph graph, int item);
+
+/**
+ * Calls the commit functions of the modules that handled data, in dependency order.
+ */
+extern void RTModuleGraphCommit(RTModuleGraph graph, RTDataStruct* data);
+
+extern int RTModuleGraphGetNofModules(RTModuleGraph graph);
+
+/** @see RTThreadPoolSetThreadSettings, nothing to do without workers */
+extern int RTModuleGraphSetThreadSettings(RTModuleGraph graph, unsigned long long cpuMask, int priority);
+
+/** @see RTInstanceGetModuleStats */
+extern int RTModuleGraphGetStats(RTModuleGraph graph, int moduleIndex, RTModuleStats* stats);
+
+
+#endif //_RTMODULEGRAPH_H_
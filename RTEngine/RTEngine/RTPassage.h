@@ -0,0 +1,27 @@
+﻿#ifndef _RTPASSAGE_H_
+#define _RTPASSAGE_H_
+
+#include "RTEngine.h"
+
+/*
+	What an RTPassage refers to. A passage is a view: data points into memory owned by
+	the passage source (a mapped replay log, a frame buffer, ...) and is never copied
+	into the data container. The source keeps the memory valid until it is closed.
+*/
+
+
+/** Passage types */
+#define RT_PASSAGE_TYPE_LOG_RECORD      1   /**< one record (line) of a replay log, see RTReplayLog.h */
+#define RT_PASSAGE_TYPE_CV_RESULT       2   /**< analysis result of a video frame, see CVEngine.h; data is owned by the userdata */
+
+
+typedef struct _RTPassageStruct
+{
+	int             type;           /**< RT_PASSAGE_TYPE_* */
+	const char     *data;           /**< payload, NOT null terminated */
+	unsigned int    size;           /**< payload size in bytes */
+	unsigned long   recordNr;       /**< position of the passage in its source (line number for a log), 1 based */
+} RTPassageStruct;
+
+
+#endif //_RTPASSAGE_H_
@@ -0,0 +1,383 @@
+﻿#include "pch.h"
+#include "RTProcessBuffer.h"
+#include "RTStats.h"
+#include "qthreads.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <new>
+#include <atomic>
+
+
+#define RT_CACHE_LINE_SIZE 64
+
+/*
+	Bounded ring of sequenced cells. A cell is free for the producer of position 'pos'
+	when its sequence equals pos, and ready for the consumer when it equals pos + 1.
+	Dequeue always claims with a CAS since producers with RT_BUFFER_OVERFLOW_DROP_OLDEST
+	also take entries out.
+*/
+typedef struct _RTProcessBufferCell
+{
+	std::atomic<size_t>  sequence;
+	RTDataStruct        *data;
+#ifdef RT_WITH_STATS
+	uint64_t             queuedAt;      /* RTStatsNow of the push */
+#endif
+} RTProcessBufferCell;
+
+
+typedef struct _RTProcessBufferStruct
+{
+	/* read-only after creation */
+	RTProcessBufferCell        *cells;
+	size_t                      mask;
+	int                         producerMode;
+	RTBufferOverflowPolicy      policy;
+	QThread_Semaphore           dataSemaphore;    /* posted when the sleeping consumer has to wake up */
+	QThread_Semaphore           spaceSemaphore;   /* posted once per blocked producer the consumer made room for */
+
+	alignas(RT_CACHE_LINE_SIZE) std::atomic<size_t>  enqueuePos;
+	alignas(RT_CACHE_LINE_SIZE) std::atomic<size_t>  dequeuePos;
+
+	alignas(RT_CACHE_LINE_SIZE) std::atomic<int>     consumerSleeping;
+	std::atomic<int>                                 producersWaiting;
+
+	/* statistics, relaxed */
+	alignas(RT_CACHE_LINE_SIZE) std::atomic<unsigned long> nofPushed;
+	std::atomic<unsigned long>  nofDropped;
+	std::atomic<unsigned long>  nofBlocked;
+	unsigned long               nofPopped;     /* consumer only */
+	unsigned long               nofWakeups;    /* consumer only */
+} RTProcessBufferStruct;
+
+
+
+static int TryEnqueue(RTProcessBuffer buffer, RTDataStruct* data)
+{
+	RTProcessBufferCell *cell;
+	size_t pos = buffer->enqueuePos.load(std::memory_order_relaxed);
+
+	for (;;)
+	{
+		cell = &buffer->cells[pos & buffer->mask];
+		size_t seq = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+		if (diff == 0)
+		{
+			if (buffer->producerMode == RT_PROCESS_BUFFER_SINGLE_PRODUCER)
+			{
+				buffer->enqueuePos.store(pos + 1, std::memory_order_relaxed);
+				break;
+			}
+			if (buffer->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+		{
+			return 0; /* full */
+		}
+		else
+		{
+			pos = buffer->enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->data = data;
+#ifdef RT_WITH_STATS
+	cell->queuedAt = RTStatsNow();
+#endif
+	cell->sequence.store(pos + 1, std::memory_order_release);
+	return 1;
+}
+
+
+static RTDataStruct* TryDequeue(RTProcessBuffer buffer)
+{
+	RTProcessBufferCell *cell;
+	RTDataStruct *data;
+	size_t pos = buffer->dequeuePos.load(std::memory_order_relaxed);
+
+	for (;;)
+	{
+		cell = &buffer->cells[pos & buffer->mask];
+		size_t seq = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+		if (diff == 0)
+		{
+			if (buffer->dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+		{
+			return NULL; /* empty */
+		}
+		else
+		{
+			pos = buffer->dequeuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	data = cell->data;
+	RT_STATS_RECORD(RT_STAGE_BUFFER_WAIT, RTStatsNow() - cell->queuedAt);
+	cell->sequence.store(pos + buffer->mask + 1, std::memory_order_release);
+	return data;
+}
+
+
+static int DrainBatch(RTProcessBuffer buffer, RTDataStruct** batch, int maxCount)
+{
+	int n = 0;
+	int waiting;
+	RTDataStruct *data;
+
+#ifdef RT_WITH_STATS
+	size_t depth = buffer->enqueuePos.load(std::memory_order_relaxed) - buffer->dequeuePos.load(std::memory_order_relaxed);
+	/* the positions were read apart, an empty buffer can look like one with -1 entries */
+	if ((intptr_t)depth > 0)
+	{
+		RTStatsCount(RT_COUNTER_QUEUE_SAMPLES, 1);
+		RTStatsCount(RT_COUNTER_QUEUE_DEPTH_SUM, depth);
+		RTStatsGaugeMax(RT_GAUGE_QUEUE_DEPTH_MAX, depth);
+	}
+#endif
+
+	while (n < maxCount && (data = TryDequeue(buffer)) != NULL)
+		batch[n++] = data;
+
+	if (n > 0)
+	{
+		buffer->nofPopped += n;
+
+		/* room was made, wake as many blocked producers as there are free cells (only pays the posts when someone waits) */
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		waiting = buffer->producersWaiting.load(std::memory_order_relaxed);
+		for (waiting = (waiting < n) ? waiting : n; waiting > 0; waiting--)
+			QThread_Semaphore_post(buffer->spaceSemaphore);
+	}
+	return n;
+}
+
+
+static void SignalConsumer(RTProcessBuffer buffer)
+{
+	/* pairs with the fence in RTProcessBufferPopBatch: either the consumer sees the new
+	   entry on its re-check, or we see that it is going to sleep and post */
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (buffer->consumerSleeping.load(std::memory_order_relaxed) != 0 &&
+		buffer->consumerSleeping.exchange(0) != 0)
+	{
+		QThread_Semaphore_post(buffer->dataSemaphore);
+	}
+}
+
+
+
+int RTProcessBufferCreate(unsigned int capacity, int producerMode,
+                          RTBufferOverflowPolicy policy, RTProcessBuffer* buffer)
+{
+	RTProcessBuffer b;
+	size_t size = 2;
+	size_t i;
+
+	if (buffer == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*buffer = NULL;
+
+	if (producerMode != RT_PROCESS_BUFFER_SINGLE_PRODUCER && producerMode != RT_PROCESS_BUFFER_MULTI_PRODUCER)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	if (policy < RT_BUFFER_OVERFLOW_BLOCK || policy > RT_BUFFER_OVERFLOW_DROP_NEWEST)
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+	if (capacity > (1u << 30))
+		return RT_RETURN_SETTING_NOT_ALLOWED;
+
+	while (size < capacity)
+		size <<= 1;
+
+	b = new (std::nothrow) RTProcessBufferStruct();
+	if (b == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+
+	b->cells = new (std::nothrow) RTProcessBufferCell[size];
+	if (b->cells == NULL)
+	{
+		delete b;
+		return RT_RETURN_OUT_OF_MEMORY;
+	}
+	for (i = 0; i < size; i++)
+	{
+		b->cells[i].sequence.store(i, std::memory_order_relaxed);
+		b->cells[i].data = NULL;
+	}
+
+	b->mask = size - 1;
+	b->producerMode = producerMode;
+	b->policy = policy;
+	b->enqueuePos.store(0);
+	b->dequeuePos.store(0);
+	b->consumerSleeping.store(0);
+	b->producersWaiting.store(0);
+	b->nofPushed.store(0);
+	b->nofDropped.store(0);
+	b->nofBlocked.store(0);
+	b->nofPopped = 0;
+	b->nofWakeups = 0;
+
+	if (QThread_Semaphore_create(&b->dataSemaphore, 0) != QTHREAD_RETURN_OK ||
+		QThread_Semaphore_create(&b->spaceSemaphore, 0) != QTHREAD_RETURN_OK)
+	{
+		RTProcessBufferDestroy(b);
+		return RT_RETURN_OUT_OF_MEMORY;
+	}
+
+	*buffer = b;
+	return RT_RETURN_OK;
+}
+
+
+void RTProcessBufferDestroy(RTProcessBuffer buffer)
+{
+	if (buffer == NULL)
+		return;
+
+	if (buffer->dataSemaphore != NULL)
+		QThread_Semaphore_destroy(&buffer->dataSemaphore);
+	if (buffer->spaceSemaphore != NULL)
+		QThread_Semaphore_destroy(&buffer->spaceSemaphore);
+
+	delete[] buffer->cells;
+	delete buffer;
+}
+
+
+int RTProcessBufferPush(RTProcessBuffer buffer, RTDataStruct* data, RTDataStruct** dropped)
+{
+	int ret = RT_RETURN_OK;
+
+	if (buffer == NULL || data == NULL || dropped == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*dropped = NULL;
+
+	while (!TryEnqueue(buffer, data))
+	{
+		switch (buffer->policy)
+		{
+		case RT_BUFFER_OVERFLOW_DROP_NEWEST:
+			buffer->nofDropped.fetch_add(1, std::memory_order_relaxed);
+			RT_STATS_COUNT(RT_COUNTER_BUFFER_OVERFLOW, 1);
+			*dropped = data;
+			return RT_RETURN_BUFFER_OVERFLOW;
+
+		case RT_BUFFER_OVERFLOW_DROP_OLDEST:
+			/* the consumer may have emptied the buffer in between, then just retry */
+			if (*dropped == NULL && (*dropped = TryDequeue(buffer)) != NULL)
+			{
+				buffer->nofDropped.fetch_add(1, std::memory_order_relaxed);
+				RT_STATS_COUNT(RT_COUNTER_PASSAGE_DROPPED, 1);
+				ret = RT_RETURN_PASSAGE_DROPPED;
+			}
+			else if (*dropped != NULL)
+			{
+				/* other producers refilled the slot we freed, give the consumer a moment */
+				QThread_sleep(0);
+			}
+			break;
+
+		case RT_BUFFER_OVERFLOW_BLOCK:
+		default:
+			buffer->nofBlocked.fetch_add(1, std::memory_order_relaxed);
+			RT_STATS_COUNT(RT_COUNTER_BUFFER_BLOCKED, 1);
+			/* pairs with the fence in DrainBatch: either we see the room on the re-check, or the
+			   consumer sees us waiting and posts; a token left from an earlier round only costs a retry */
+			buffer->producersWaiting.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (!TryEnqueue(buffer, data))
+			{
+				/* the consumer might be asleep with a full buffer only if we never signalled it */
+				SignalConsumer(buffer);
+				QThread_Semaphore_wait(buffer->spaceSemaphore);
+				buffer->producersWaiting.fetch_sub(1);
+				continue;
+			}
+			buffer->producersWaiting.fetch_sub(1);
+			buffer->nofPushed.fetch_add(1, std::memory_order_relaxed);
+			SignalConsumer(buffer);
+			return RT_RETURN_OK;
+		}
+	}
+
+	buffer->nofPushed.fetch_add(1, std::memory_order_relaxed);
+	SignalConsumer(buffer);
+	return ret;
+}
+
+
+int RTProcessBufferPopBatch(RTProcessBuffer buffer, RTDataStruct** batch, int maxCount,
+                            int* count, unsigned int timeoutMsec)
+{
+	int n;
+
+	if (buffer == NULL || batch == NULL || count == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	n = DrainBatch(buffer, batch, maxCount);
+	if (n > 0 || timeoutMsec == 0)
+	{
+		*count = n;
+		return RT_RETURN_OK;
+	}
+
+	/* announce that we go to sleep, then look once more before actually sleeping */
+	buffer->consumerSleeping.store(1);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	n = DrainBatch(buffer, batch, maxCount);
+	if (n > 0)
+	{
+		/* a producer may already have consumed our flag and posted, eat that token */
+		if (buffer->consumerSleeping.exchange(0) == 0)
+			QThread_Semaphore_trywait(buffer->dataSemaphore);
+		*count = n;
+		return RT_RETURN_OK;
+	}
+
+	if (QThread_Semaphore_timedwait(buffer->dataSemaphore, timeoutMsec) == QTHREAD_RETURN_OK)
+		buffer->nofWakeups++;
+	buffer->consumerSleeping.store(0);
+
+	*count = DrainBatch(buffer, batch, maxCount);
+	return RT_RETURN_OK;
+}
+
+
+void RTProcessBufferWakeUp(RTProcessBuffer buffer)
+{
+	if (buffer == NULL)
+		return;
+	/* post unconditionally: the consumer may be about to sleep without having announced it
+	   yet, the token then ends its next wait right away */
+	buffer->consumerSleeping.store(0);
+	QThread_Semaphore_post(buffer->dataSemaphore);
+}
+
+
+int RTProcessBufferGetStats(RTProcessBuffer buffer, RTProcessBufferStats* stats)
+{
+	size_t enq, deq;
+
+	if (buffer == NULL || stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	enq = buffer->enqueuePos.load(std::memory_order_relaxed);
+	deq = buffer->dequeuePos.load(std::memory_order_relaxed);
+
+	stats->nofPushed = buffer->nofPushed.load(std::memory_order_relaxed);
+	stats->nofPopped = buffer->nofPopped;
+	stats->nofDropped = buffer->nofDropped.load(std::memory_order_relaxed);
+	stats->nofBlocked = buffer->nofBlocked.load(std::memory_order_relaxed);
+	stats->nofWakeups = buffer->nofWakeups;
+	stats->depth = (enq > deq) ? (unsigned int)(enq - deq) : 0;
+	stats->capacity = (unsigned int)(buffer->mask + 1);
+	return RT_RETURN_OK;
+}
@@ -0,0 +1,121 @@
+﻿#ifndef _RTPROCESSBUFFER_H_
+#define _RTPROCESSBUFFER_H_
+
+#include "RTEngine.h"
+
+/*
+	Process Buffer between the input threads (AddDataToProcessBuffer in the roadmap)
+	and the TIME_TICK thread.
+
+	Bounded lock-free ring of RTDataStruct references. Producers never take a lock,
+	the TIME_TICK thread drains every ready entry in one call and only sleeps on
+	a semaphore when the buffer is empty. The semaphore is only posted when the
+	consumer has announced that it is going to sleep, so a busy replay costs no
+	kernel calls per passage.
+*/
+
+
+/** Only one thread calls RTProcessBufferPush (default, cheapest) */
+#define RT_PROCESS_BUFFER_SINGLE_PRODUCER       0
+/** Several input sources call RTProcessBufferPush concurrently */
+#define RT_PROCESS_BUFFER_MULTI_PRODUCER        1
+
+/** Default number of entries of the Process Buffer */
+#define RT_PROCESS_BUFFER_DEFAULT_CAPACITY      4096
+/** Maximum number of entries the TIME_TICK thread takes out of the buffer per wakeup */
+#define RT_PROCESS_BUFFER_MAX_BATCH             256
+
+
+/** What to do when a passage arrives and the Process Buffer is full */
+typedef enum _RTBufferOverflowPolicy
+{
+	RT_BUFFER_OVERFLOW_BLOCK = 0,       /**< wait until the TIME_TICK thread made room */
+	RT_BUFFER_OVERFLOW_DROP_OLDEST,     /**< drop the oldest queued entry, RT_RETURN_PASSAGE_DROPPED */
+	RT_BUFFER_OVERFLOW_DROP_NEWEST      /**< drop the new entry, RT_RETURN_BUFFER_OVERFLOW */
+} RTBufferOverflowPolicy;
+
+
+/** Counters of a Process Buffer, read with RTProcessBufferGetStats */
+typedef struct _RTProcessBufferStats
+{
+	unsigned long nofPushed;        /**< entries accepted in the buffer */
+	unsigned long nofPopped;        /**< entries handed to the consumer */
+	unsigned long nofDropped;       /**< entries dropped (oldest or newest) */
+	unsigned long nofBlocked;       /**< times a producer had to wait for room */
+	unsigned long nofWakeups;       /**< times the consumer was woken through the semaphore */
+	unsigned int  depth;            /**< approximate number of queued entries */
+	unsigned int  capacity;
+} RTProcessBufferStats;
+
+
+/** Forward declaration */
+typedef struct _RTProcessBufferStruct *RTProcessBuffer;
+
+
+/**
+ * Creates a Process Buffer.
+ *
+ * @param[in]   capacity        Number of entries, rounded up to a power of 2 (minimum 2)
+ * @param[in]   producerMode    RT_PROCESS_BUFFER_SINGLE_PRODUCER or RT_PROCESS_BUFFER_MULTI_PRODUCER
+ * @param[in]   policy          Overflow policy
+ * @param[out]  buffer          The created buffer
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_SETTING_NOT_ALLOWED
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int RTProcessBufferCreate(unsigned int capacity, int producerMode,
+                                 RTBufferOverflowPolicy policy, RTProcessBuffer* buffer);
+
+/**
+ * Destroys a Process Buffer. Entries still queued are NOT destroyed, drain the buffer first.
+ */
+extern void RTProcessBufferDestroy(RTProcessBuffer buffer);
+
+/**
+ * Queues data in the buffer.
+ *
+ * @param[in]   data     Data to queue
+ * @param[out]  dropped  Set to the data that did not make it into the buffer (the new data
+ *                       or the oldest queued data, depending on the policy), NULL otherwise.
+ *                       The caller owns the dropped data.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_BUFFER_OVERFLOW - buffer full, *dropped == data (RT_BUFFER_OVERFLOW_DROP_NEWEST)
+ * @retval RT_RETURN_PASSAGE_DROPPED - buffer full, *dropped is the oldest entry (RT_BUFFER_OVERFLOW_DROP_OLDEST)
+ */
+extern int RTProcessBufferPush(RTProcessBuffer buffer, RTDataStruct* data, RTDataStruct** dropped);
+
+/**
+ * Takes every ready entry out of the buffer (up to maxCount) in FIFO order. Blocks only when the
+ * buffer is empty, for at most timeoutMsec milliseconds.
+ *
+ * PRE: only called from one thread (the TIME_TICK thread).
+ *
+ * @param[out]  batch        Array of at least maxCount entries
+ * @param[in]   maxCount     Maximum number of entries to take
+ * @param[out]  count        Number of entries taken, 0 when the wait timed out or RTProcessBufferWakeUp was called
+ * @param[in]   timeoutMsec  Maximum waiting time in milliseconds, 0 does not block
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ */
+extern int RTProcessBufferPopBatch(RTProcessBuffer buffer, RTDataStruct** batch, int maxCount,
+                                   int* count, unsigned int timeoutMsec);
+
+/**
+ * Wakes up a consumer that is waiting in RTProcessBufferPopBatch, used on finalize and
+ * when the consumer has to recompute its wait time. When the consumer is not waiting,
+ * its next wait returns immediately.
+ */
+extern void RTProcessBufferWakeUp(RTProcessBuffer buffer);
+
+/**
+ * Returns the counters of the buffer.
+ */
+extern int RTProcessBufferGetStats(RTProcessBuffer buffer, RTProcessBufferStats* stats);
+
+
+#endif //_RTPROCESSBUFFER_H_
@@ -0,0 +1,587 @@
+﻿#include "pch.h"
+#include "RTReplayLog.h"
+#include "RTEventCache.h"
+#include "RTFile.h"
+#include "RTStats.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <new>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+/* after the standard headers, du.h defines min/max */
+#include "du.h"
+
+
+/* passage views are carved from slabs of this many views */
+#define RT_REPLAY_LOG_PASSAGES_PER_SLAB     1024
+
+#define RT_REPLAY_LOG_STDIN_FD              0
+
+
+typedef struct _RTReplayLogStruct
+{
+	int                 sourceId;
+	unsigned int        flags;
+	int                 mapped;
+
+	/* the bytes being parsed: the whole mapping, or the current chunk */
+	const char         *buf;
+	size_t              pos;            /* first byte not parsed yet */
+	size_t              end;            /* end of the valid bytes */
+
+	/* memory mapped log */
+	RTFileMapStruct     file;
+	size_t              prefetchEnd;    /* the mapping up to here was prefetched */
+
+	/* event cache, read from (cache) or written at the end of the log (writer) */
+	RTEventCache        cache;
+	RTEventCacheWriter  writer;
+
+	/* chunked reader */
+	int                 fd;
+	int                 ownsFd;
+	int                 eof;
+	char               *chunk;
+	size_t              chunkSize;
+	du_pool_t          *chunkPool;
+
+	/* passage views, released with the pool on close */
+	du_pool_t          *passagePool;
+	RTPassageStruct    *passages;
+	unsigned int        nofFreePassages;
+
+	unsigned long       lineNr;
+	RTReplayLogStats    stats;
+} RTReplayLogStruct;
+
+
+
+static int IsSeparator(char c)
+{
+	return c == ' ' || c == '\t' || c == ',' || c == ';';
+}
+
+
+static int IsDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+
+/*
+	Parses "<seconds>[.fff]" or "[hh:]mm:ss[.fff]" in place (the record is not null terminated).
+	Returns 0 when the record does not start with a valid time.
+*/
+static int ParseTime(const char* p, const char* end, double* time, const char** next)
+{
+	double value = 0.0;
+	double group = 0.0;
+	double fraction = 0.0;
+	double divisor = 1.0;
+	int digits = 0;
+	int groups = 0;
+
+	while (p < end)
+	{
+		if (IsDigit(*p))
+		{
+			group = group * 10.0 + (*p - '0');
+			digits++;
+		}
+		else if (*p == ':' && digits > 0 && groups < 2)
+		{
+			value = (value + group) * 60.0;
+			group = 0.0;
+			digits = 0;
+			groups++;
+		}
+		else
+		{
+			break;
+		}
+		p++;
+	}
+	if (digits == 0)
+		return 0;
+
+	if (p < end && *p == '.')
+	{
+		for (p++; p < end && IsDigit(*p); p++)
+		{
+			fraction = fraction * 10.0 + (*p - '0');
+			divisor *= 10.0;
+		}
+	}
+	if (p < end && !IsSeparator(*p))
+		return 0;
+
+	*time = value + group + fraction / divisor;
+	*next = p;
+	return 1;
+}
+
+
+static RTPassageStruct* AllocPassage(RTReplayLog log)
+{
+	if (log->nofFreePassages == 0)
+	{
+		log->passages = (RTPassageStruct*)DuMemPoolAlloc(log->passagePool,
+		                        (unsigned long)(sizeof(RTPassageStruct) * RT_REPLAY_LOG_PASSAGES_PER_SLAB));
+		if (log->passages == NULL)
+			return NULL;
+		log->nofFreePassages = RT_REPLAY_LOG_PASSAGES_PER_SLAB;
+	}
+	log->nofFreePassages--;
+	return log->passages++;
+}
+
+
+/*
+	Tries to map path. Returns 0 when the file cannot be mapped (not a regular file,
+	empty, too large for the address space, ...), the caller then falls back to the
+	chunked reader.
+*/
+static int MapLog(RTReplayLog log, const char* path)
+{
+	if (RTFileMap(path, 1, RT_FILE_MAP_SEQUENTIAL, &log->file) != RT_RETURN_OK)
+		return 0;
+
+	log->buf = log->file.base;
+	log->end = log->file.size;
+	log->mapped = 1;
+	log->pos = 0;
+	log->prefetchEnd = 0;
+	return 1;
+}
+
+
+/*
+	Asks the OS to read the next window of the mapping while the current one is parsed.
+	Windows are multiples of the page size, so prefetchEnd stays page aligned.
+*/
+static void PrefetchLog(RTReplayLog log)
+{
+	size_t length;
+
+	if (log->prefetchEnd >= log->end || log->pos + RT_REPLAY_LOG_PREFETCH_SIZE / 2 < log->prefetchEnd)
+		return;
+
+	length = log->end - log->prefetchEnd;
+	if (length > RT_REPLAY_LOG_PREFETCH_SIZE)
+		length = RT_REPLAY_LOG_PREFETCH_SIZE;
+
+#ifdef _WIN32
+#if _WIN32_WINNT >= 0x0602
+	WIN32_MEMORY_RANGE_ENTRY range;
+
+	range.VirtualAddress = (PVOID)(log->buf + log->prefetchEnd);
+	range.NumberOfBytes = length;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+	madvise((void*)(log->buf + log->prefetchEnd), length, MADV_WILLNEED);
+#endif
+	log->prefetchEnd += length;
+}
+
+
+static int OpenStream(RTReplayLog log, const char* path)
+{
+	if (strcmp(path, "-") == 0)
+	{
+		log->fd = RT_REPLAY_LOG_STDIN_FD;
+		log->ownsFd = 0;
+#ifdef _WIN32
+		_setmode(log->fd, _O_BINARY);
+#endif
+	}
+	else
+	{
+#ifdef _WIN32
+		log->fd = _open(path, _O_RDONLY | _O_BINARY | _O_SEQUENTIAL);
+#else
+		log->fd = open(path, O_RDONLY);
+#endif
+		if (log->fd < 0)
+			return RT_RETURN_CANNOT_OPEN_FILE;
+		log->ownsFd = 1;
+#if !defined(_WIN32) && defined(POSIX_FADV_SEQUENTIAL)
+		posix_fadvise(log->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+	}
+
+	if (DuMemPoolCreate(&log->chunkPool, 0, RT_REPLAY_LOG_CHUNK_SIZE) != DU_RETURN_OK)
+		return RT_RETURN_OUT_OF_MEMORY;
+
+	/* the first Fill allocates the first chunk */
+	log->mapped = 0;
+	log->chunk = NULL;
+	log->chunkSize = 0;
+	log->buf = NULL;
+	log->pos = 0;
+	log->end = 0;
+	return RT_RETURN_OK;
+}
+
+
+/*
+	Reads more of the log into the current chunk. When the chunk is full a new one is
+	started and the incomplete record at the end of the old chunk is moved to it; the
+	old chunk stays alive for the passages that refer into it.
+
+	@retval RT_RETURN_OK - more bytes available
+	@retval RT_RETURN_NO_DATA_YET - end of a followed log, nothing new yet
+	@retval RT_RETURN_END_OF_LOG
+	@retval RT_RETURN_OUT_OF_MEMORY
+*/
+static int Fill(RTReplayLog log)
+{
+	long n;
+
+	if (log->eof)
+		return RT_RETURN_END_OF_LOG;
+
+	if (log->end == log->chunkSize)
+	{
+		size_t partial = log->end - log->pos;
+		size_t size = RT_REPLAY_LOG_CHUNK_SIZE;
+		char *chunk;
+
+		/* a record longer than a chunk gets a chunk of its own */
+		if (partial * 2 > size)
+			size = partial * 2;
+
+		chunk = (char*)DuMemPoolAlloc(log->chunkPool, (unsigned long)size);
+		if (chunk == NULL)
+			return RT_RETURN_OUT_OF_MEMORY;
+		if (partial > 0)
+		{
+			memcpy(chunk, log->chunk + log->pos, partial);
+			log->stats.nofCarried++;
+		}
+		log->chunk = chunk;
+		log->chunkSize = size;
+		log->buf = chunk;
+		log->pos = 0;
+		log->end = partial;
+		log->stats.nofChunks++;
+	}
+
+#ifdef _WIN32
+	n = _read(log->fd, log->chunk + log->end, (unsigned int)(log->chunkSize - log->end));
+#else
+	n = (long)read(log->fd, log->chunk + log->end, log->chunkSize - log->end);
+#endif
+	if (n > 0)
+	{
+		log->end += (size_t)n;
+		return RT_RETURN_OK;
+	}
+
+	/* at the end of a growing log the writer may still be in the middle of a record */
+	if (n == 0 && (log->flags & RT_REPLAY_LOG_FLAG_FOLLOW))
+		return RT_RETURN_NO_DATA_YET;
+
+	log->eof = 1;
+	return RT_RETURN_END_OF_LOG;
+}
+
+
+
+/*
+	Reads the log from its event cache when the cache matches the mapped log, else gets
+	a writer ready to cache it. Without a cache the log is simply parsed. Matching the
+	cache reads only the start and the end of the log, not all of it.
+*/
+static void OpenCache(RTReplayLog log, const char* path)
+{
+	char *cachePath;
+
+	cachePath = (char*)malloc(strlen(path) + sizeof(RT_EVENT_CACHE_EXTENSION));
+	if (cachePath == NULL)
+		return;
+	strcpy(cachePath, path);
+	strcat(cachePath, RT_EVENT_CACHE_EXTENSION);
+
+	if (RTEventCacheOpen(cachePath, log->buf, log->end, log->file.time, &log->cache) == RT_RETURN_OK)
+		log->stats.nofSkipped = (unsigned long)RTEventCacheGetHeader(log->cache)->nofSkipped;
+	else
+		RTEventCacheWriterCreate(cachePath, log->end, log->file.time, &log->writer);
+	free(cachePath);
+}
+
+
+/* Writes the cache once the whole log was parsed; a failed write only costs the cache */
+static void CommitCache(RTReplayLog log)
+{
+	if (RTEventCacheWriterCommit(log->writer, log->buf, log->stats.nofSkipped) == RT_RETURN_OK)
+		log->stats.cacheWritten = 1;
+	RTEventCacheWriterDestroy(log->writer);
+	log->writer = NULL;
+}
+
+
+static int NextCached(RTReplayLog log, RTPassage* passage, double* time)
+{
+	const RTEventCacheRecord *record;
+	const char *payload;
+	RTPassageStruct *p;
+	int ret;
+
+	ret = RTEventCacheNext(log->cache, &record, &payload);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	p = AllocPassage(log);
+	if (p == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	p->type = RT_PASSAGE_TYPE_LOG_RECORD;
+	p->data = payload;
+	p->size = record->size;
+	p->recordNr = record->recordNr;
+
+	log->stats.nofRecords++;
+	log->stats.nofBytes += record->size;
+	*time = record->time;
+	*passage = p;
+	return RT_RETURN_OK;
+}
+
+
+
+int RTReplayLogOpen(const char* path, int sourceId, unsigned int flags, RTReplayLog* log)
+{
+	RTReplayLog l;
+	int ret;
+
+	if (path == NULL || log == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*log = NULL;
+
+	l = new (std::nothrow) RTReplayLogStruct();
+	if (l == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	l->sourceId = sourceId;
+	l->flags = flags;
+	l->fd = -1;
+
+	if (DuMemPoolCreate(&l->passagePool, 0,
+	                    (unsigned int)(sizeof(RTPassageStruct) * RT_REPLAY_LOG_PASSAGES_PER_SLAB)) != DU_RETURN_OK)
+	{
+		delete l;
+		return RT_RETURN_OUT_OF_MEMORY;
+	}
+
+	if ((flags & (RT_REPLAY_LOG_FLAG_STREAM | RT_REPLAY_LOG_FLAG_FOLLOW)) != 0 ||
+		strcmp(path, "-") == 0 || !MapLog(l, path))
+	{
+		ret = OpenStream(l, path);
+		if (ret != RT_RETURN_OK)
+		{
+			RTReplayLogClose(l);
+			return ret;
+		}
+	}
+
+	if (l->mapped && (flags & RT_REPLAY_LOG_FLAG_NO_CACHE) == 0)
+		OpenCache(l, path);
+
+	l->stats.mapped = l->mapped;
+	l->stats.cached = (l->cache != NULL);
+	*log = l;
+	return RT_RETURN_OK;
+}
+
+
+void RTReplayLogClose(RTReplayLog log)
+{
+	if (log == NULL)
+		return;
+
+	RTEventCacheWriterDestroy(log->writer);
+	RTEventCacheClose(log->cache);
+	if (log->mapped)
+		RTFileUnmap(&log->file);
+	if (log->ownsFd)
+	{
+#ifdef _WIN32
+		_close(log->fd);
+#else
+		close(log->fd);
+#endif
+	}
+	if (log->chunkPool != NULL)
+		DuMemPoolDestroy(log->chunkPool);
+	if (log->passagePool != NULL)
+		DuMemPoolDestroy(log->passagePool);
+	delete log;
+}
+
+
+static int NextRecord(RTReplayLog log, RTPassage* passage, double* time)
+{
+	RTPassageStruct *p;
+	const char *record;
+	const char *recordEnd;
+	const char *payload;
+	const char *newline;
+	size_t length;
+	size_t consumed;
+	int ret;
+
+	if (log == NULL || passage == NULL || time == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (log->cache != NULL)
+		return NextCached(log, passage, time);
+
+	for (;;)
+	{
+		record = log->buf + log->pos;
+		length = log->end - log->pos;
+		newline = (length > 0) ? (const char*)memchr(record, '\n', length) : NULL;
+
+		if (newline != NULL)
+		{
+			length = (size_t)(newline - record);
+			consumed = length + 1;
+		}
+		else
+		{
+			if (!log->mapped)
+			{
+				ret = Fill(log);
+				if (ret == RT_RETURN_OK)
+					continue;
+				if (ret != RT_RETURN_END_OF_LOG)
+					return ret;
+			}
+			/* last record without a newline */
+			if (length == 0)
+			{
+				if (log->writer != NULL)
+					CommitCache(log);
+				return RT_RETURN_END_OF_LOG;
+			}
+			consumed = length;
+		}
+
+		log->pos += consumed;
+		log->lineNr++;
+		log->stats.nofBytes += consumed;
+		if (log->mapped)
+			PrefetchLog(log);
+
+		if (length > 0 && record[length - 1] == '\r')
+			length--;
+		if (length == 0 || record[0] == '#')
+			continue;
+
+		recordEnd = record + length;
+		if (!ParseTime(record, recordEnd, time, &payload))
+		{
+			log->stats.nofSkipped++;
+			continue;
+		}
+		while (payload < recordEnd && IsSeparator(*payload))
+			payload++;
+
+		p = AllocPassage(log);
+		if (p == NULL)
+			return RT_RETURN_OUT_OF_MEMORY;
+		p->type = RT_PASSAGE_TYPE_LOG_RECORD;
+		p->data = payload;
+		p->size = (unsigned int)(recordEnd - payload);
+		p->recordNr = log->lineNr;
+
+		/* a record the cache cannot take costs the cache, not the record */
+		if (log->writer != NULL &&
+			RTEventCacheWriterAdd(log->writer, *time, (uint64_t)(payload - log->buf), p->size,
+			                      (uint32_t)log->lineNr) != RT_RETURN_OK)
+		{
+			RTEventCacheWriterDestroy(log->writer);
+			log->writer = NULL;
+		}
+
+		log->stats.nofRecords++;
+		*passage = p;
+		return RT_RETURN_OK;
+	}
+}
+
+
+int RTReplayLogNext(RTReplayLog log, RTPassage* passage, double* time)
+{
+	int ret;
+
+	RT_STATS_BEGIN(RT_STAGE_PARSE);
+	ret = NextRecord(log, passage, time);
+	RT_STATS_END(RT_STAGE_PARSE);
+	return ret;
+}
+
+
+int RTReplayLogSeek(RTReplayLog log, double time)
+{
+	if (log == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	if (log->cache == NULL)
+		return RT_RETURN_NOT_IMPLEMENTED;
+	return RTEventCacheSeek(log->cache, time);
+}
+
+
+int RTReplayLogReadData(RTReplayLog log, RTEngineInstance instance, RTDataStruct** data)
+{
+	RTPassage passage;
+	double time;
+	int ret;
+
+	if (log == NULL || data == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*data = NULL;
+
+	ret = RTReplayLogNext(log, &passage, &time);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	if (instance == NULL)
+	{
+		ret = RTCoreCreateData(data);
+		if (ret != RT_RETURN_OK)
+			return ret;
+		ret = RTCoreDataAddpassage(*data, passage, time, log->sourceId);
+		if (ret != RT_RETURN_OK)
+			RTCoreDestroyData(*data);
+	}
+	else
+	{
+		ret = RTInstanceCreateData(instance, data);
+		if (ret != RT_RETURN_OK)
+			return ret;
+		ret = RTInstanceDataAddpassage(instance, *data, passage, time, log->sourceId);
+		if (ret != RT_RETURN_OK)
+			RTInstanceDestroyData(instance, *data);
+	}
+	if (ret != RT_RETURN_OK)
+		*data = NULL;
+	return ret;
+}
+
+
+int RTReplayLogGetStats(RTReplayLog log, RTReplayLogStats* stats)
+{
+	if (log == NULL || stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	*stats = log->stats;
+	return RT_RETURN_OK;
+}
@@ -0,0 +1,133 @@
+﻿#ifndef _RTREPLAYLOG_H_
+#define _RTREPLAYLOG_H_
+
+#include "RTEngine.h"
+#include "RTPassage.h"
+
+/*
+	Replay Log passage source (Read_Log_Line in the roadmap).
+
+	A replay log is a text file with one register record per line:
+
+		<time><separator><payload>
+
+	time is in seconds ("754.25") or as [hh:]mm:ss[.fff] ("12:34.25"), separator is one
+	or more spaces, tabs, ',' or ';'. Empty lines and lines starting with '#' are ignored,
+	lines without a valid time are skipped and counted.
+
+	Regular files are memory mapped and parsed in place: every record becomes an RTPassage
+	(RT_PASSAGE_TYPE_LOG_RECORD) whose data points into the mapping, nothing is copied and
+	nothing is allocated per line. The mapping is read sequentially, the OS is told so
+	(madvise / FILE_FLAG_SEQUENTIAL_SCAN) and the next window is prefetched.
+
+	Pipes, stdin ("-") and files that are still being written during a live game
+	(RT_REPLAY_LOG_FLAG_FOLLOW) are read in large chunks instead. Chunks are kept until
+	the log is closed since passages refer into them; only a record that straddles two
+	chunks is moved (once) to the start of the next chunk.
+
+	A mapped log is cached: the records it was parsed into are written to <log>.rtc
+	(RTEventCache.h) when the log was read to its end, and the next open of the same log
+	(same size, write time and first and last block) reads them from the mapped cache
+	instead of parsing the text. Passages still point into the mapped log. A cache that cannot be written is skipped,
+	RT_REPLAY_LOG_FLAG_NO_CACHE neither reads nor writes one.
+
+	Passages stay valid until RTReplayLogClose, so close the log only after the data read
+	from it was processed (e.g. after RTCoreFinalize).
+
+	PRE: a Replay Log is read from one thread at a time.
+*/
+
+
+/** Read the log through the chunked reader even when it could be mapped */
+#define RT_REPLAY_LOG_FLAG_STREAM       (1 << 0)
+/** The log is still growing (live game): at its end RTReplayLogNext returns RT_RETURN_NO_DATA_YET
+    instead of RT_RETURN_END_OF_LOG and a later call picks up what was appended. Implies STREAM. */
+#define RT_REPLAY_LOG_FLAG_FOLLOW       (1 << 1)
+/** Parse the text even when a valid event cache exists, and do not write one */
+#define RT_REPLAY_LOG_FLAG_NO_CACHE     (1 << 2)
+
+/** Size of one chunk of the chunked reader */
+#define RT_REPLAY_LOG_CHUNK_SIZE        (1 << 20)
+/** Bytes of the mapping that are prefetched ahead of the parser */
+#define RT_REPLAY_LOG_PREFETCH_SIZE     (4 << 20)
+
+
+/** Counters of a Replay Log, read with RTReplayLogGetStats */
+typedef struct _RTReplayLogStats
+{
+	unsigned long       nofRecords;     /**< passages returned */
+	unsigned long       nofSkipped;     /**< lines without a valid time */
+	unsigned long long  nofBytes;       /**< bytes parsed */
+	unsigned long       nofChunks;      /**< chunks allocated by the chunked reader, 0 when mapped */
+	unsigned long       nofCarried;     /**< records moved between chunks */
+	int                 mapped;         /**< 1 when the log is memory mapped */
+	int                 cached;         /**< 1 when the records are read from the event cache */
+	int                 cacheWritten;   /**< 1 when the event cache was written at the end of the log */
+} RTReplayLogStats;
+
+
+/** Forward declaration */
+typedef struct _RTReplayLogStruct *RTReplayLog;
+
+
+/**
+ * Opens a replay log.
+ *
+ * @param[in]   path        File name, "-" reads stdin
+ * @param[in]   sourceId    passageSourceId given to RTCoreDataAddpassage for every record
+ * @param[in]   flags       RT_REPLAY_LOG_FLAG_*
+ * @param[out]  log         The opened log
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_CANNOT_OPEN_FILE
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int RTReplayLogOpen(const char* path, int sourceId, unsigned int flags, RTReplayLog* log);
+
+/**
+ * Closes the log, unmaps it and releases every passage returned from it.
+ */
+extern void RTReplayLogClose(RTReplayLog log);
+
+/**
+ * Returns the next record of the log as a passage.
+ *
+ * @param[out]  passage     View on the record, valid until RTReplayLogClose
+ * @param[out]  time        Game time of the record in seconds
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ * @retval RT_RETURN_END_OF_LOG
+ * @retval RT_RETURN_NO_DATA_YET - RT_REPLAY_LOG_FLAG_FOLLOW and no complete record available, try again later
+ */
+extern int RTReplayLogNext(RTReplayLog log, RTPassage* passage, double* time);
+
+/**
+ * The next record returned is the first one, in log order, at or after time; the records
+ * after it follow in log order, a late record among them may be earlier than time.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_NOT_IMPLEMENTED - the log is not read from its event cache
+ */
+extern int RTReplayLogSeek(RTReplayLog log, double time);
+
+/**
+ * Read_Log_Line: creates a data container of instance (RTCoreCreateData when instance is NULL)
+ * with the next record of the log as its passage. The passage is added as a reference, the
+ * record is not copied.
+ *
+ * @retval RT_RETURN_OK
+ * @returns All RTReplayLogNext, RTInstanceCreateData and RTInstanceDataAddpassage return values
+ */
+extern int RTReplayLogReadData(RTReplayLog log, RTEngineInstance instance, RTDataStruct** data);
+
+/**
+ * Returns the counters of the log.
+ */
+extern int RTReplayLogGetStats(RTReplayLog log, RTReplayLogStats* stats);
+
+
+#endif //_RTREPLAYLOG_H_
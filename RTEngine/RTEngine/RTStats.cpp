@@ -0,0 +1,421 @@
+﻿#include "pch.h"
+#include "RTStats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define RT_STATS_WITH_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define RT_STATS_WITH_TSC
+#endif
+
+
+#ifdef RT_WITH_STATS
+
+/*
+	The block of one thread. Only its thread writes it, with a load and a store (no
+	read-modify-write); other threads only read it, except for RTStatsReset. The fields
+	are atomics so these reads are defined, relaxed they cost what a plain access does.
+*/
+typedef struct _RTStatsBlockStruct
+{
+	std::atomic<uint64_t>       count[RT_NOF_STATS_STAGES];
+	std::atomic<uint64_t>       totalTicks[RT_NOF_STATS_STAGES];
+	std::atomic<uint64_t>       maxTicks[RT_NOF_STATS_STAGES];
+	std::atomic<uint64_t>       buckets[RT_NOF_STATS_STAGES][RT_STATS_NOF_BUCKETS];
+	std::atomic<uint64_t>       counters[RT_NOF_STATS_COUNTERS];
+	std::atomic<uint64_t>       gauges[RT_NOF_STATS_GAUGES];
+	std::atomic<int>            inUse;      /* a thread records in it */
+	struct _RTStatsBlockStruct  *next;
+} RTStatsBlock;
+
+
+/*
+	The blocks of all threads that recorded, never freed: a thread may end while its block
+	is read. A thread that ends gives its block back, the next new thread records in it
+	on top of what is there, so the totals stay and the list only grows to the most
+	threads recording at the same time.
+*/
+static std::atomic<RTStatsBlock*> rtStatsBlocks(NULL);
+static thread_local RTStatsBlock *rtStatsBlock = NULL;
+
+
+/* gives the block of the thread back when the thread ends */
+class RTStatsBlockOwner
+{
+public:
+	RTStatsBlockOwner() : block(NULL) {}
+	~RTStatsBlockOwner()
+	{
+		if (block != NULL)
+			block->inUse.store(0, std::memory_order_release);
+	}
+
+	RTStatsBlock *block;
+};
+
+static thread_local RTStatsBlockOwner rtStatsBlockOwner;
+
+/* the clocks when the program started, to convert ticks to nanoseconds */
+static const uint64_t rtStatsStartTicks = RTStatsNow();
+static const std::chrono::steady_clock::time_point rtStatsStartTime = std::chrono::steady_clock::now();
+
+
+static inline void Add(std::atomic<uint64_t>& field, uint64_t n)
+{
+	field.store(field.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+
+static RTStatsBlock* GetBlock()
+{
+	RTStatsBlock *block = rtStatsBlock;
+	int s, c, g, b;
+
+	if (block != NULL)
+		return block;
+
+	/* the block of a thread that ended */
+	for (block = rtStatsBlocks.load(std::memory_order_acquire); block != NULL; block = block->next)
+	{
+		int unused = 0;
+
+		if (block->inUse.load(std::memory_order_relaxed) == 0 &&
+			block->inUse.compare_exchange_strong(unused, 1, std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			rtStatsBlockOwner.block = block;
+			rtStatsBlock = block;
+			return block;
+		}
+	}
+
+	block = new (std::nothrow) RTStatsBlock;
+	if (block == NULL)
+		return NULL;
+	for (s = 0; s < RT_NOF_STATS_STAGES; s++)
+	{
+		block->count[s].store(0, std::memory_order_relaxed);
+		block->totalTicks[s].store(0, std::memory_order_relaxed);
+		block->maxTicks[s].store(0, std::memory_order_relaxed);
+		for (b = 0; b < RT_STATS_NOF_BUCKETS; b++)
+			block->buckets[s][b].store(0, std::memory_order_relaxed);
+	}
+	for (c = 0; c < RT_NOF_STATS_COUNTERS; c++)
+		block->counters[c].store(0, std::memory_order_relaxed);
+	for (g = 0; g < RT_NOF_STATS_GAUGES; g++)
+		block->gauges[g].store(0, std::memory_order_relaxed);
+	block->inUse.store(1, std::memory_order_relaxed);
+
+	/* once per block */
+	block->next = rtStatsBlocks.load(std::memory_order_relaxed);
+	while (!rtStatsBlocks.compare_exchange_weak(block->next, block, std::memory_order_release, std::memory_order_relaxed))
+		;
+	rtStatsBlockOwner.block = block;
+	rtStatsBlock = block;
+	return block;
+}
+
+
+/* floor(log2(ticks)), 0 for 0 */
+static inline int Bucket(uint64_t ticks)
+{
+	int b = 0;
+
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	if (_BitScanReverse64(&index, ticks))
+		b = (int)index;
+#elif defined(__GNUC__)
+	if (ticks != 0)
+		b = 63 - __builtin_clzll(ticks);
+#else
+	while (ticks > 1)
+	{
+		ticks >>= 1;
+		b++;
+	}
+#endif
+	return (b < RT_STATS_NOF_BUCKETS) ? b : RT_STATS_NOF_BUCKETS - 1;
+}
+
+
+static double NsecPerTick()
+{
+#ifdef RT_STATS_WITH_TSC
+	uint64_t ticks = RTStatsNow() - rtStatsStartTicks;
+	double nsec = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - rtStatsStartTime).count();
+
+	/* too early to tell, assume 1 tick per nanosecond */
+	if (ticks < 1000000 || nsec <= 0.0)
+		return 1.0;
+	return nsec / (double)ticks;
+#else
+	return 1.0;
+#endif
+}
+
+#endif //RT_WITH_STATS
+
+
+uint64_t RTStatsNow(void)
+{
+#ifdef RT_STATS_WITH_TSC
+	return __rdtsc();
+#else
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+void RTStatsRecord(int stage, uint64_t ticks)
+{
+#ifdef RT_WITH_STATS
+	RTStatsBlock *block;
+
+	if ((unsigned int)stage >= RT_NOF_STATS_STAGES)
+		return;
+	block = GetBlock();
+	if (block == NULL)
+		return;
+	/* the counter went back, another core */
+	if ((int64_t)ticks < 0)
+		ticks = 0;
+
+	Add(block->count[stage], 1);
+	Add(block->totalTicks[stage], ticks);
+	if (ticks > block->maxTicks[stage].load(std::memory_order_relaxed))
+		block->maxTicks[stage].store(ticks, std::memory_order_relaxed);
+	Add(block->buckets[stage][Bucket(ticks)], 1);
+#else
+	(void)stage;
+	(void)ticks;
+#endif
+}
+
+
+void RTStatsCount(int counter, uint64_t n)
+{
+#ifdef RT_WITH_STATS
+	RTStatsBlock *block;
+
+	if ((unsigned int)counter >= RT_NOF_STATS_COUNTERS)
+		return;
+	block = GetBlock();
+	if (block != NULL)
+		Add(block->counters[counter], n);
+#else
+	(void)counter;
+	(void)n;
+#endif
+}
+
+
+void RTStatsGaugeMax(int gauge, uint64_t value)
+{
+#ifdef RT_WITH_STATS
+	RTStatsBlock *block;
+
+	if ((unsigned int)gauge >= RT_NOF_STATS_GAUGES)
+		return;
+	block = GetBlock();
+	if (block != NULL && value > block->gauges[gauge].load(std::memory_order_relaxed))
+		block->gauges[gauge].store(value, std::memory_order_relaxed);
+#else
+	(void)gauge;
+	(void)value;
+#endif
+}
+
+
+int RTStatsGet(RTStats* stats)
+{
+#ifdef RT_WITH_STATS
+	RTStatsBlock *block;
+	double nsecPerTick, ticks;
+	uint64_t maxTicks[RT_NOF_STATS_STAGES], v;
+	int s, c, g, b;
+
+	if (stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	memset(stats, 0, sizeof(*stats));
+	memset(maxTicks, 0, sizeof(maxTicks));
+	for (block = rtStatsBlocks.load(std::memory_order_acquire); block != NULL; block = block->next)
+	{
+		for (s = 0; s < RT_NOF_STATS_STAGES; s++)
+		{
+			stats->stages[s].count += block->count[s].load(std::memory_order_relaxed);
+			stats->stages[s].totalNsec += (double)block->totalTicks[s].load(std::memory_order_relaxed);
+			v = block->maxTicks[s].load(std::memory_order_relaxed);
+			if (v > maxTicks[s])
+				maxTicks[s] = v;
+			for (b = 0; b < RT_STATS_NOF_BUCKETS; b++)
+				stats->stages[s].buckets[b] += block->buckets[s][b].load(std::memory_order_relaxed);
+		}
+		for (c = 0; c < RT_NOF_STATS_COUNTERS; c++)
+			stats->counters[c] += block->counters[c].load(std::memory_order_relaxed);
+		for (g = 0; g < RT_NOF_STATS_GAUGES; g++)
+		{
+			v = block->gauges[g].load(std::memory_order_relaxed);
+			if (v > stats->gauges[g])
+				stats->gauges[g] = v;
+		}
+		stats->nofThreads++;
+	}
+
+	/* totalNsec still holds ticks */
+	nsecPerTick = NsecPerTick();
+	for (s = 0; s < RT_NOF_STATS_STAGES; s++)
+	{
+		ticks = stats->stages[s].totalNsec;
+		stats->stages[s].totalNsec = ticks * nsecPerTick;
+		stats->stages[s].maxNsec = (double)maxTicks[s] * nsecPerTick;
+		stats->stages[s].bucketNsec = nsecPerTick;
+	}
+	return RT_RETURN_OK;
+#else
+	(void)stats;
+	return RT_RETURN_NOT_IMPLEMENTED;
+#endif
+}
+
+
+int RTStatsReset(void)
+{
+#ifdef RT_WITH_STATS
+	RTStatsBlock *block;
+	int s, c, g, b;
+
+	for (block = rtStatsBlocks.load(std::memory_order_acquire); block != NULL; block = block->next)
+	{
+		for (s = 0; s < RT_NOF_STATS_STAGES; s++)
+		{
+			block->count[s].store(0, std::memory_order_relaxed);
+			block->totalTicks[s].store(0, std::memory_order_relaxed);
+			block->maxTicks[s].store(0, std::memory_order_relaxed);
+			for (b = 0; b < RT_STATS_NOF_BUCKETS; b++)
+				block->buckets[s][b].store(0, std::memory_order_relaxed);
+		}
+		for (c = 0; c < RT_NOF_STATS_COUNTERS; c++)
+			block->counters[c].store(0, std::memory_order_relaxed);
+		for (g = 0; g < RT_NOF_STATS_GAUGES; g++)
+			block->gauges[g].store(0, std::memory_order_relaxed);
+	}
+	return RT_RETURN_OK;
+#else
+	return RT_RETURN_NOT_IMPLEMENTED;
+#endif
+}
+
+
+double RTStatsPercentile(const RTStatsStage* stage, double p)
+{
+	uint64_t rank, seen = 0;
+	double upper;
+	int b;
+
+	if (stage == NULL || stage->count == 0)
+		return 0.0;
+	if (p <= 0.0)
+		p = 0.0;
+	if (p >= 1.0)
+		return stage->maxNsec;
+
+	rank = (uint64_t)(p * (double)stage->count) + 1;
+	for (b = 0; b < RT_STATS_NOF_BUCKETS; b++)
+	{
+		seen += stage->buckets[b];
+		if (seen >= rank)
+		{
+			upper = (double)(2ull << b) * stage->bucketNsec;
+			return (upper < stage->maxNsec) ? upper : stage->maxNsec;
+		}
+	}
+	return stage->maxNsec;
+}
+
+
+const char* RTStatsStageName(int stage)
+{
+	static const char* names[RT_NOF_STATS_STAGES] =
+	{
+		"parse", "buffer_wait", "modules", "time_tick", "event_list", "host_callback", "value_engine"
+	};
+
+	if ((unsigned int)stage >= RT_NOF_STATS_STAGES)
+		return "unknown";
+	return names[stage];
+}
+
+
+const char* RTStatsCounterName(int counter)
+{
+	static const char* names[RT_NOF_STATS_COUNTERS] =
+	{
+		"passage_dropped", "buffer_overflow", "buffer_blocked", "queue_samples", "queue_depth_sum"
+	};
+
+	if ((unsigned int)counter >= RT_NOF_STATS_COUNTERS)
+		return "unknown";
+	return names[counter];
+}
+
+
+int RTStatsWrite(int format, RTStatsLineFunc fun, void* context)
+{
+#ifdef RT_WITH_STATS
+	/* fits LOG_MAX_MESSAGE_SIZE of the logging */
+	char line[256];
+	RTStats stats;
+	const RTStatsStage *stage;
+	double mean, queueDepth;
+	int s, ret;
+
+	if (fun == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	ret = RTStatsGet(&stats);
+	if (ret != RT_RETURN_OK)
+		return ret;
+
+	for (s = 0; s < RT_NOF_STATS_STAGES; s++)
+	{
+		stage = &stats.stages[s];
+		mean = (stage->count != 0) ? stage->totalNsec / (double)stage->count : 0.0;
+		if (format == RT_STATS_FORMAT_JSON)
+			snprintf(line, sizeof(line), "{\"stage\":\"%s\",\"count\":%llu,\"mean_ns\":%.0f,\"p50_ns\":%.0f,\"p90_ns\":%.0f,\"p99_ns\":%.0f,\"max_ns\":%.0f}",
+				RTStatsStageName(s), (unsigned long long)stage->count, mean, RTStatsPercentile(stage, 0.5),
+				RTStatsPercentile(stage, 0.9), RTStatsPercentile(stage, 0.99), stage->maxNsec);
+		else
+			snprintf(line, sizeof(line), "%-14s %10llu  mean %10.2f us  p50 %10.2f us  p90 %10.2f us  p99 %10.2f us  max %10.2f us",
+				RTStatsStageName(s), (unsigned long long)stage->count, mean / 1000.0, RTStatsPercentile(stage, 0.5) / 1000.0,
+				RTStatsPercentile(stage, 0.9) / 1000.0, RTStatsPercentile(stage, 0.99) / 1000.0, stage->maxNsec / 1000.0);
+		fun(line, context);
+	}
+
+	queueDepth = (stats.counters[RT_COUNTER_QUEUE_SAMPLES] != 0) ?
+		(double)stats.counters[RT_COUNTER_QUEUE_DEPTH_SUM] / (double)stats.counters[RT_COUNTER_QUEUE_SAMPLES] : 0.0;
+	if (format == RT_STATS_FORMAT_JSON)
+		snprintf(line, sizeof(line), "{\"counters\":{\"passage_dropped\":%llu,\"buffer_overflow\":%llu,\"buffer_blocked\":%llu,\"queue_depth_mean\":%.2f,\"queue_depth_max\":%llu},\"threads\":%d}",
+			(unsigned long long)stats.counters[RT_COUNTER_PASSAGE_DROPPED], (unsigned long long)stats.counters[RT_COUNTER_BUFFER_OVERFLOW],
+			(unsigned long long)stats.counters[RT_COUNTER_BUFFER_BLOCKED], queueDepth,
+			(unsigned long long)stats.gauges[RT_GAUGE_QUEUE_DEPTH_MAX], stats.nofThreads);
+	else
+		snprintf(line, sizeof(line), "passage dropped %llu, buffer overflow %llu, buffer blocked %llu, queue depth mean %.2f max %llu, %d threads",
+			(unsigned long long)stats.counters[RT_COUNTER_PASSAGE_DROPPED], (unsigned long long)stats.counters[RT_COUNTER_BUFFER_OVERFLOW],
+			(unsigned long long)stats.counters[RT_COUNTER_BUFFER_BLOCKED], queueDepth,
+			(unsigned long long)stats.gauges[RT_GAUGE_QUEUE_DEPTH_MAX], stats.nofThreads);
+	fun(line, context);
+	return RT_RETURN_OK;
+#else
+	(void)format;
+	(void)fun;
+	(void)context;
+	return RT_RETURN_NOT_IMPLEMENTED;
+#endif
+}
@@ -0,0 +1,154 @@
+﻿#ifndef _RTSTATS_H_
+#define _RTSTATS_H_
+
+#include "RTEngine.h"
+
+#include <stdint.h>
+
+/*
+	Latency histograms and counters of the hot path, from the arrival of an input to the
+	Value Engine.
+
+	Every thread records into a block of its own (created on its first record), with
+	plain loads and stores: no lock and no read-modify-write on the hot path. The blocks
+	of all threads are merged when the stats are read, so a read taken while threads
+	record may be off by the records in flight.
+
+	Time is taken with the time stamp counter where there is one (rdtsc), otherwise with
+	the steady clock, and converted to nanoseconds when the stats are read. A histogram
+	has one bucket per power of 2 ticks.
+
+	Defining RT_NO_STATS compiles every RT_STATS_* macro to nothing; the functions stay
+	and return RT_RETURN_NOT_IMPLEMENTED. The Release-NoStats configuration
+	of the solution defines it.
+*/
+
+
+#ifndef RT_NO_STATS
+#define RT_WITH_STATS
+#endif
+
+
+/** Stages with a latency histogram */
+enum rtStatsStage
+{
+	RT_STAGE_PARSE,             /**< one record of a replay log (RTReplayLogNext) */
+	RT_STAGE_BUFFER_WAIT,       /**< an entry in the Process Buffer, push to pop or drop */
+	RT_STAGE_MODULES,           /**< the TIME_TICK thread waiting for the modules of an entry */
+	RT_STAGE_TIME_TICK,         /**< RTCoreTimeTick of an entry */
+	RT_STAGE_EVENT_LIST,        /**< Event List update of a tick, without the callbacks */
+	RT_STAGE_HOST_CALLBACK,     /**< one call of the event handler of the host */
+	RT_STAGE_VALUE_ENGINE,      /**< an event or a recomputation of the Value Engine */
+	RT_NOF_STATS_STAGES
+};
+
+/** Counters, summed over the threads */
+enum rtStatsCounter
+{
+	RT_COUNTER_PASSAGE_DROPPED,     /**< entries dropped for RT_RETURN_PASSAGE_DROPPED */
+	RT_COUNTER_BUFFER_OVERFLOW,     /**< entries refused with RT_RETURN_BUFFER_OVERFLOW */
+	RT_COUNTER_BUFFER_BLOCKED,      /**< pushes that waited for room */
+	RT_COUNTER_QUEUE_SAMPLES,       /**< pops of the Process Buffer, see RT_COUNTER_QUEUE_DEPTH_SUM */
+	RT_COUNTER_QUEUE_DEPTH_SUM,     /**< entries queued at each pop, summed */
+	RT_NOF_STATS_COUNTERS
+};
+
+/** Gauges, the maximum over the threads */
+enum rtStatsGauge
+{
+	RT_GAUGE_QUEUE_DEPTH_MAX,       /**< most entries queued at a pop */
+	RT_NOF_STATS_GAUGES
+};
+
+
+#define RT_STATS_NOF_BUCKETS        48
+
+
+typedef struct _RTStatsStageStruct
+{
+	uint64_t        count;
+	double          totalNsec;
+	double          maxNsec;
+	uint64_t        buckets[RT_STATS_NOF_BUCKETS];  /**< [b]: latencies below 2^(b + 1) ticks */
+	double          bucketNsec;                     /**< nanoseconds per tick, bucket b ends at 2^(b + 1) * bucketNsec */
+} RTStatsStage;
+
+typedef struct _RTStatsStruct
+{
+	RTStatsStage    stages[RT_NOF_STATS_STAGES];
+	uint64_t        counters[RT_NOF_STATS_COUNTERS];
+	uint64_t        gauges[RT_NOF_STATS_GAUGES];
+	int             nofThreads;                     /**< threads that recorded */
+} RTStats;
+
+
+enum rtStatsFormat
+{
+	RT_STATS_FORMAT_TEXT,
+	RT_STATS_FORMAT_JSON        /**< one JSON object per line */
+};
+
+/** Receives the lines of RTStatsWrite, without line end. Hand them to LogMessage. */
+typedef void (*RTStatsLineFunc) (const char* line, void* context);
+
+
+/** Current time in ticks */
+extern uint64_t RTStatsNow(void);
+
+extern void RTStatsRecord(int stage, uint64_t ticks);
+extern void RTStatsCount(int counter, uint64_t n);
+extern void RTStatsGaugeMax(int gauge, uint64_t value);
+
+/**
+ * Merges the blocks of all threads.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_NOT_IMPLEMENTED - built with RT_NO_STATS
+ */
+extern int RTStatsGet(RTStats* stats);
+
+/**
+ * Zeroes the blocks of all threads. Records made at the same time may be lost or kept.
+ */
+extern int RTStatsReset(void);
+
+/** Latency below which a fraction p (0 - 1) of the stage falls, in nanoseconds (upper end of its bucket) */
+extern double RTStatsPercentile(const RTStatsStage* stage, double p);
+
+extern const char* RTStatsStageName(int stage);
+extern const char* RTStatsCounterName(int counter);
+
+/**
+ * Merges the stats and writes them as lines (one per stage and one for the counters) to fun.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_NOT_IMPLEMENTED - built with RT_NO_STATS
+ */
+extern int RTStatsWrite(int format, RTStatsLineFunc fun, void* context);
+
+
+#ifdef RT_WITH_STATS
+
+/** Starts timing stage in the current scope, RT_STATS_END records it */
+#define RT_STATS_BEGIN(stage)           uint64_t rtStatsStart_##stage = RTStatsNow()
+#define RT_STATS_END(stage)             RTStatsRecord(stage, RTStatsNow() - rtStatsStart_##stage)
+#define RT_STATS_RECORD(stage, ticks)   RTStatsRecord(stage, ticks)
+#define RT_STATS_NOW()                  RTStatsNow()
+#define RT_STATS_COUNT(counter, n)      RTStatsCount(counter, n)
+#define RT_STATS_GAUGE_MAX(gauge, v)    RTStatsGaugeMax(gauge, v)
+
+#else
+
+#define RT_STATS_BEGIN(stage)           ((void)0)
+#define RT_STATS_END(stage)             ((void)0)
+#define RT_STATS_RECORD(stage, ticks)   ((void)0)
+#define RT_STATS_NOW()                  ((uint64_t)0)
+#define RT_STATS_COUNT(counter, n)      ((void)0)
+#define RT_STATS_GAUGE_MAX(gauge, v)    ((void)0)
+
+#endif //RT_WITH_STATS
+
+
+#endif //_RTSTATS_H_
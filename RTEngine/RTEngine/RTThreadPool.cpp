@@ -0,0 +1,472 @@
+﻿#include "pch.h"
+#include "RTThreadPool.h"
+#include "qthreads.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <atomic>
+#include <thread>
+
+#if defined(__linux__)
+/* QThread_setAffinity; on Linux QThreads is always the source implementation */
+#include "QThreadsNative.h"
+#include <errno.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+#define RT_THREAD_NICE_PER_PRIORITY         5
+
+
+#define RT_CACHE_LINE_SIZE 64
+
+#define RT_THREAD_POOL_INITIAL_DEQUE_SIZE   64
+
+
+typedef struct _RTTask
+{
+	RTTaskFunc  func;
+	void       *taskData;
+} RTTask;
+
+
+/*
+	Deque of one worker: the owner pushes and pops at bottom, thieves take from top.
+	tasks is a ring of 'mask + 1' entries, top <= bottom.
+*/
+typedef struct _RTThreadPoolWorker
+{
+	struct _RTThreadPoolStruct *pool;
+	int                         index;
+	QThread                     thread;
+
+	QThread_Mutex               lock;
+	RTTask                     *tasks;
+	unsigned long               mask;
+	unsigned long               top;
+	unsigned long               bottom;
+
+	std::atomic<unsigned long>  nofTasks;
+	std::atomic<unsigned long>  nofSteals;
+
+	char                        pad[RT_CACHE_LINE_SIZE];    /* keeps the locks of two workers apart */
+} RTThreadPoolWorker;
+
+
+typedef struct _RTThreadPoolStruct
+{
+	RTThreadPoolWorker        **workers;
+	int                         nofWorkers;
+	QThread_Semaphore           workSemaphore;      /* posted once per queued task */
+	QThread_Semaphore           doneSemaphore;      /* posted once per waiter when the last pending task finished */
+	std::atomic<long>           pending;            /* tasks queued or running */
+	std::atomic<int>            nofWaiting;         /* threads in RTThreadPoolWait */
+	std::atomic<unsigned int>   nextWorker;         /* round robin for submits from outside */
+	std::atomic<int>            stop;
+
+	/* RTThreadPoolSetThreadSettings, a worker applies them when generation moved on */
+	std::atomic<unsigned long>  generation;
+	std::atomic<unsigned long long> cpuMask;
+	std::atomic<int>            priority;
+} RTThreadPoolStruct;
+
+
+/* worker the calling thread is, NULL outside every pool */
+static thread_local RTThreadPoolWorker *tlCurrentWorker;
+
+
+
+static int PushTask(RTThreadPoolWorker* worker, RTTaskFunc func, void* taskData)
+{
+	int ret = RT_RETURN_OK;
+
+	QThread_Mutex_P(worker->lock);
+	if (worker->bottom - worker->top > worker->mask)
+	{
+		/* full, double the ring */
+		unsigned long size = (worker->mask + 1) * 2;
+		RTTask *tasks = (RTTask*)malloc(size * sizeof(RTTask));
+		unsigned long i;
+
+		if (tasks == NULL)
+		{
+			ret = RT_RETURN_OUT_OF_MEMORY;
+		}
+		else
+		{
+			for (i = worker->top; i != worker->bottom; i++)
+				tasks[i & (size - 1)] = worker->tasks[i & worker->mask];
+			free(worker->tasks);
+			worker->tasks = tasks;
+			worker->mask = size - 1;
+		}
+	}
+	if (ret == RT_RETURN_OK)
+	{
+		worker->tasks[worker->bottom & worker->mask].func = func;
+		worker->tasks[worker->bottom & worker->mask].taskData = taskData;
+		worker->bottom++;
+	}
+	QThread_Mutex_V(worker->lock);
+	return ret;
+}
+
+
+/* owner side, newest task first */
+static int PopTask(RTThreadPoolWorker* worker, RTTask* task)
+{
+	int found = 0;
+
+	QThread_Mutex_P(worker->lock);
+	if (worker->bottom != worker->top)
+	{
+		worker->bottom--;
+		*task = worker->tasks[worker->bottom & worker->mask];
+		found = 1;
+	}
+	QThread_Mutex_V(worker->lock);
+	return found;
+}
+
+
+/* thief side, oldest task first */
+static int StealTask(RTThreadPoolWorker* victim, RTTask* task)
+{
+	int found = 0;
+
+	QThread_Mutex_P(victim->lock);
+	if (victim->bottom != victim->top)
+	{
+		*task = victim->tasks[victim->top & victim->mask];
+		victim->top++;
+		found = 1;
+	}
+	QThread_Mutex_V(victim->lock);
+	return found;
+}
+
+
+static int FindTask(RTThreadPoolWorker* worker, RTTask* task)
+{
+	RTThreadPool pool = worker->pool;
+	int i;
+
+	if (PopTask(worker, task))
+		return 1;
+
+	for (i = 1; i < pool->nofWorkers; i++)
+	{
+		if (StealTask(pool->workers[(worker->index + i) % pool->nofWorkers], task))
+		{
+			worker->nofSteals.fetch_add(1, std::memory_order_relaxed);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+/* pairs with the fence in RTThreadPoolWait: either the waiter sees pending at 0 on its re-check,
+   or we see it waiting and post; a token left from an earlier round only costs a retry */
+static void TaskDone(RTThreadPool pool)
+{
+	int waiting;
+
+	if (pool->pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	for (waiting = pool->nofWaiting.load(std::memory_order_relaxed); waiting > 0; waiting--)
+		QThread_Semaphore_post(pool->doneSemaphore);
+}
+
+
+static void* WorkerThread(void* threadData)
+{
+	RTThreadPoolWorker *worker = (RTThreadPoolWorker*)threadData;
+	RTThreadPool pool = worker->pool;
+	unsigned long generation = 0;
+	RTTask task;
+
+	tlCurrentWorker = worker;
+
+	for (;;)
+	{
+		if (pool->generation.load(std::memory_order_acquire) != generation)
+		{
+			generation = pool->generation.load(std::memory_order_acquire);
+			RTThreadSetCurrent(pool->cpuMask.load(std::memory_order_relaxed), pool->priority.load(std::memory_order_relaxed));
+		}
+
+		if (FindTask(worker, &task))
+		{
+			task.func(task.taskData, worker->index);
+			worker->nofTasks.fetch_add(1, std::memory_order_relaxed);
+			TaskDone(pool);
+			continue;
+		}
+
+		if (pool->stop.load())
+			break;
+		/* every task posts one token after it was pushed: the worker that takes it scans the
+		   deques afterwards and only comes back here once that task was taken by someone */
+		QThread_Semaphore_wait(pool->workSemaphore);
+	}
+
+	tlCurrentWorker = NULL;
+	return NULL;
+}
+
+
+static void DestroyWorker(RTThreadPoolWorker* worker)
+{
+	if (worker->lock != NULL)
+		QThread_Mutex_destroy(&worker->lock);
+	free(worker->tasks);
+	delete worker;
+}
+
+
+/* PRE: no worker thread running */
+static void FreePool(RTThreadPool pool)
+{
+	int i;
+
+	if (pool->workers != NULL)
+	{
+		for (i = 0; i < pool->nofWorkers; i++)
+		{
+			if (pool->workers[i] != NULL)
+				DestroyWorker(pool->workers[i]);
+		}
+		free(pool->workers);
+	}
+	if (pool->workSemaphore != NULL)
+		QThread_Semaphore_destroy(&pool->workSemaphore);
+	if (pool->doneSemaphore != NULL)
+		QThread_Semaphore_destroy(&pool->doneSemaphore);
+	delete pool;
+}
+
+
+static void StopWorkers(RTThreadPool pool, int nofStarted)
+{
+	int i;
+
+	pool->stop.store(1);
+	for (i = 0; i < nofStarted; i++)
+		QThread_Semaphore_post(pool->workSemaphore);
+	for (i = 0; i < nofStarted; i++)
+		QThread_join(pool->workers[i]->thread, NULL);
+}
+
+
+
+int RTThreadPoolCreate(int nofWorkers, const char* name, RTThreadPool* pool)
+{
+	RTThreadPool p;
+	int i;
+
+	if (pool == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+	*pool = NULL;
+
+	if (nofWorkers <= 0)
+		nofWorkers = (int)std::thread::hardware_concurrency();
+	if (nofWorkers <= 0)
+		nofWorkers = 1;
+
+	p = new (std::nothrow) RTThreadPoolStruct();
+	if (p == NULL)
+		return RT_RETURN_OUT_OF_MEMORY;
+	p->nofWorkers = nofWorkers;
+	p->pending.store(0);
+	p->nofWaiting.store(0);
+	p->nextWorker.store(0);
+	p->stop.store(0);
+	p->generation.store(0);
+	p->cpuMask.store(0);
+	p->priority.store(RT_THREAD_PRIORITY_NORMAL);
+
+	p->workers = (RTThreadPoolWorker**)calloc(nofWorkers, sizeof(RTThreadPoolWorker*));
+	if (p->workers == NULL ||
+		QThread_Semaphore_create(&p->workSemaphore, 0) != QTHREAD_RETURN_OK ||
+		QThread_Semaphore_create(&p->doneSemaphore, 0) != QTHREAD_RETURN_OK)
+	{
+		FreePool(p);
+		return RT_RETURN_OUT_OF_MEMORY;
+	}
+
+	for (i = 0; i < nofWorkers; i++)
+	{
+		RTThreadPoolWorker *worker = new (std::nothrow) RTThreadPoolWorker();
+
+		if (worker == NULL)
+		{
+			FreePool(p);
+			return RT_RETURN_OUT_OF_MEMORY;
+		}
+		p->workers[i] = worker;
+		worker->pool = p;
+		worker->index = i;
+		worker->mask = RT_THREAD_POOL_INITIAL_DEQUE_SIZE - 1;
+		worker->tasks = (RTTask*)malloc(RT_THREAD_POOL_INITIAL_DEQUE_SIZE * sizeof(RTTask));
+		if (worker->tasks == NULL || QThread_Mutex_create(&worker->lock) != QTHREAD_RETURN_OK)
+		{
+			FreePool(p);
+			return RT_RETURN_OUT_OF_MEMORY;
+		}
+	}
+
+	for (i = 0; i < nofWorkers; i++)
+	{
+		if (QThread_create(&p->workers[i]->thread, name != NULL ? name : "RT_WORKER",
+		                   WorkerThread, p->workers[i]) != QTHREAD_RETURN_OK)
+		{
+			StopWorkers(p, i);
+			FreePool(p);
+			return RT_RETURN_INTERNAL_ERROR;
+		}
+	}
+
+	*pool = p;
+	return RT_RETURN_OK;
+}
+
+
+void RTThreadPoolDestroy(RTThreadPool pool)
+{
+	if (pool == NULL)
+		return;
+
+	RTThreadPoolWait(pool);
+	StopWorkers(pool, pool->nofWorkers);
+	FreePool(pool);
+}
+
+
+int RTThreadPoolSubmit(RTThreadPool pool, RTTaskFunc func, void* taskData)
+{
+	RTThreadPoolWorker *worker = tlCurrentWorker;
+	int ret;
+
+	if (pool == NULL || func == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	if (worker == NULL || worker->pool != pool)
+		worker = pool->workers[pool->nextWorker.fetch_add(1, std::memory_order_relaxed) % pool->nofWorkers];
+
+	/* counted before it can run, so pending never drops to 0 with this task still to come */
+	pool->pending.fetch_add(1, std::memory_order_acq_rel);
+	ret = PushTask(worker, func, taskData);
+	if (ret != RT_RETURN_OK)
+	{
+		TaskDone(pool);
+		return ret;
+	}
+
+	QThread_Semaphore_post(pool->workSemaphore);
+	return RT_RETURN_OK;
+}
+
+
+void RTThreadPoolWait(RTThreadPool pool)
+{
+	if (pool == NULL)
+		return;
+
+	pool->nofWaiting.fetch_add(1);
+	for (;;)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (pool->pending.load(std::memory_order_acquire) == 0)
+			break;
+		QThread_Semaphore_wait(pool->doneSemaphore);
+	}
+	pool->nofWaiting.fetch_sub(1);
+}
+
+
+int RTThreadPoolGetNofWorkers(RTThreadPool pool)
+{
+	return (pool != NULL) ? pool->nofWorkers : 0;
+}
+
+
+int RTThreadPoolGetStats(RTThreadPool pool, RTThreadPoolStats* stats)
+{
+	int i;
+
+	if (pool == NULL || stats == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	memset(stats, 0, sizeof(RTThreadPoolStats));
+	stats->nofWorkers = pool->nofWorkers;
+	for (i = 0; i < pool->nofWorkers; i++)
+	{
+		stats->nofTasks += pool->workers[i]->nofTasks.load(std::memory_order_relaxed);
+		stats->nofSteals += pool->workers[i]->nofSteals.load(std::memory_order_relaxed);
+	}
+	return RT_RETURN_OK;
+}
+
+
+int RTThreadPoolSetThreadSettings(RTThreadPool pool, unsigned long long cpuMask, int priority)
+{
+	int i;
+
+	if (pool == NULL)
+		return RT_RETURN_ILLEGAL_NULL_POINTER;
+
+	pool->cpuMask.store(cpuMask, std::memory_order_relaxed);
+	pool->priority.store(priority, std::memory_order_relaxed);
+	pool->generation.fetch_add(1, std::memory_order_release);
+	/* idle workers apply them now rather than with their next task */
+	for (i = 0; i < pool->nofWorkers; i++)
+		QThread_Semaphore_post(pool->workSemaphore);
+	return RT_RETURN_OK;
+}
+
+
+int RTThreadSetCurrent(unsigned long long cpuMask, int priority)
+{
+	int ret = RT_RETURN_OK;
+
+	if (priority < RT_THREAD_PRIORITY_LOWEST)
+		priority = RT_THREAD_PRIORITY_LOWEST;
+	if (priority > RT_THREAD_PRIORITY_HIGHEST)
+		priority = RT_THREAD_PRIORITY_HIGHEST;
+
+#if defined(__linux__)
+	if (cpuMask != 0 && QThread_setAffinity(QThread_self(), cpuMask) != QTHREAD_RETURN_OK)
+		ret = RT_RETURN_SETTING_NOT_ALLOWED;
+
+	/* the nice value of a thread is the one of its thread id. Priorities are relative to
+	   the nice value of the process: NORMAL on a thread that has it changes nothing, so it
+	   needs no right a niced process or a user without CAP_SYS_NICE lacks */
+	{
+		id_t thread = (id_t)syscall(SYS_gettid);
+		int base, current, nice;
+
+		errno = 0;
+		base = getpriority(PRIO_PROCESS, (id_t)getpid());
+		current = getpriority(PRIO_PROCESS, thread);
+		if (errno != 0)
+			return RT_RETURN_SETTING_NOT_ALLOWED;
+		nice = base - RT_THREAD_NICE_PER_PRIORITY * priority;
+		if (nice < -20)
+			nice = -20;
+		if (nice > 19)
+			nice = 19;
+		if (nice != current && setpriority(PRIO_PROCESS, thread, nice) != 0)
+			ret = RT_RETURN_SETTING_NOT_ALLOWED;
+	}
+#else
+	if (cpuMask != 0 && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)cpuMask) == 0)
+		ret = RT_RETURN_SETTING_NOT_ALLOWED;
+	if (!SetThreadPriority(GetCurrentThread(), priority))
+		ret = RT_RETURN_SETTING_NOT_ALLOWED;
+#endif
+	return ret;
+}
@@ -0,0 +1,101 @@
+﻿#ifndef _RTTHREADPOOL_H_
+#define _RTTHREADPOOL_H_
+
+#include "RTEngine.h"
+
+/*
+	Work-stealing thread pool.
+
+	Every worker owns a deque of tasks. A worker takes its own tasks newest first
+	(tasks it spawned itself are still hot in its cache) and, when it runs out, steals
+	the oldest task of another worker. Tasks submitted from outside the pool are spread
+	over the workers round robin. Each deque has its own lock, so workers only meet
+	when stealing; idle workers sleep on a semaphore.
+
+	Meant for coarse tasks (a replay, a segment, a module run), not for single passages.
+*/
+
+
+/** Task function, workerIndex is 0 .. RTThreadPoolGetNofWorkers() - 1 */
+typedef void (*RTTaskFunc)(void* taskData, int workerIndex);
+
+/** Counters of a pool, read with RTThreadPoolGetStats */
+typedef struct _RTThreadPoolStats
+{
+	unsigned long nofTasks;         /**< tasks executed */
+	unsigned long nofSteals;        /**< tasks executed by another worker than the one they were queued on */
+	int           nofWorkers;
+} RTThreadPoolStats;
+
+
+/** Forward declaration */
+typedef struct _RTThreadPoolStruct *RTThreadPool;
+
+
+/**
+ * Creates a pool and starts its workers.
+ *
+ * @param[in]   nofWorkers  Number of worker threads, 0 for one per core
+ * @param[in]   name        Name of the worker threads, may be NULL
+ * @param[out]  pool        The created pool
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ * @retval RT_RETURN_INTERNAL_ERROR - a worker thread could not be started
+ */
+extern int RTThreadPoolCreate(int nofWorkers, const char* name, RTThreadPool* pool);
+
+/**
+ * Waits for all queued tasks, stops the workers and destroys the pool.
+ */
+extern void RTThreadPoolDestroy(RTThreadPool pool);
+
+/**
+ * Queues a task. May be called from any thread, also from a task (the new task is then
+ * queued on the deque of the calling worker).
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ * @retval RT_RETURN_OUT_OF_MEMORY
+ */
+extern int RTThreadPoolSubmit(RTThreadPool pool, RTTaskFunc func, void* taskData);
+
+/**
+ * Waits until every task queued so far (and every task they queued) has finished.
+ * PRE: not called from a task.
+ */
+extern void RTThreadPoolWait(RTThreadPool pool);
+
+/**
+ * Returns the number of worker threads.
+ */
+extern int RTThreadPoolGetNofWorkers(RTThreadPool pool);
+
+/**
+ * Returns the counters of the pool.
+ */
+extern int RTThreadPoolGetStats(RTThreadPool pool, RTThreadPoolStats* stats);
+
+/**
+ * Pins the workers to the CPUs of cpuMask (bit n: CPU n, 0: leave them where they are)
+ * and sets their priority (RT_THREAD_PRIORITY_*). Every worker applies the settings
+ * itself before it looks for its next task; a setting the system refuses is skipped.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_ILLEGAL_NULL_POINTER
+ */
+extern int RTThreadPoolSetThreadSettings(RTThreadPool pool, unsigned long long cpuMask, int priority);
+
+/**
+ * Pins the calling thread to the CPUs of cpuMask (0: any) and sets its priority.
+ * On Linux the priority is a nice value of -5 per step from the one of the process: NORMAL
+ * keeps the nice value of the process, above normal needs CAP_SYS_NICE.
+ *
+ * @retval RT_RETURN_OK
+ * @retval RT_RETURN_SETTING_NOT_ALLOWED - the system refused the mask or the priority
+ */
+extern int RTThreadSetCurrent(unsigned long long cpuMask, int priority);
+
+
+#endif //_RTTHREADPOOL_H_
@@ -0,0 +1,689 @@
+﻿#include "pch.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <map>
+#include <algorithm>
+
+#include "VEEventStore.h"
+
+
+#define VE_STORE_BYTE_ORDER         0x01020304u
+/* rows Select hands out at a time */
+#define VE_STORE_SCAN_ROWS          256
+
+#define VE_STORE_ALIGN(offset)      (((offset) + 7) & ~(uint64_t)7)
+
+
+/* Offsets of the sections for the counts in header, as written and as checked */
+static void Layout(VEStoreSegmentHeader* h)
+{
+	uint64_t nofPostings = 0;
+	int role, slot;
+
+	for (role = 0; role < 2; role++)
+		for (slot = 0; slot < GAME_NOF_SLOTS; slot++)
+			nofPostings += h->nofPostings[role][slot];
+
+	h->blocksOffset = sizeof(VEStoreSegmentHeader);
+	h->timeOffset = h->blocksOffset + h->nofBlocks * sizeof(VEStoreBlock);
+	h->amountOffset = h->timeOffset + h->nofRows * sizeof(double);
+	h->valueOffset = VE_STORE_ALIGN(h->amountOffset + h->nofRows * sizeof(float));
+	h->abilityOffset = VE_STORE_ALIGN(h->valueOffset + h->nofRows * sizeof(float));
+	h->typeOffset = VE_STORE_ALIGN(h->abilityOffset + h->nofRows * sizeof(int32_t));
+	h->sourceOffset = VE_STORE_ALIGN(h->typeOffset + h->nofRows);
+	h->targetOffset = VE_STORE_ALIGN(h->sourceOffset + h->nofRows);
+	h->postingsOffset = VE_STORE_ALIGN(h->targetOffset + h->nofRows);
+	h->fileSize = h->postingsOffset + nofPostings * sizeof(uint32_t);
+}
+
+
+/* Writes a section of bytes at *offset, then zeros up to next */
+static int WriteSection(FILE* f, const void* data, uint64_t bytes, uint64_t* offset, uint64_t next)
+{
+	static const char zeros[8] = { 0 };
+
+	if (bytes > 0 && fwrite(data, 1, (size_t)bytes, f) != (size_t)bytes)
+		return 0;
+	*offset += bytes;
+	if (next - *offset > sizeof(zeros) || fwrite(zeros, 1, (size_t)(next - *offset), f) != (size_t)(next - *offset))
+		return 0;
+	*offset = next;
+	return 1;
+}
+
+
+static void AddTotals(VEStoreTotals* to, const VEStoreTotals* from)
+{
+	to->count += from->count;
+	to->amount += from->amount;
+	to->value += from->value;
+}
+
+
+static bool HigherValue(const VEStoreGroup& a, const VEStoreGroup& b)
+{
+	if (a.totals.value != b.totals.value)
+		return a.totals.value > b.totals.value;
+	return a.key < b.key;
+}
+
+
+static bool HigherCount(const VEStoreGroup& a, const VEStoreGroup& b)
+{
+	if (a.totals.count != b.totals.count)
+		return a.totals.count > b.totals.count;
+	return a.key < b.key;
+}
+
+
+
+/*
+	VEEventStore CLASS
+*/
+
+VEEventStore::VEEventStore()
+{
+	segment.base = NULL;
+	segment.size = 0;
+	Reset();
+}
+
+VEEventStore::~VEEventStore()
+{
+	CloseSegment();
+}
+
+
+void VEEventStore::CloseSegment()
+{
+	RTFileUnmap(&segment);
+	segment.base = NULL;
+	segment.size = 0;
+}
+
+
+void VEEventStore::Reset()
+{
+	int role, slot;
+
+	CloseSegment();
+	time.clear();
+	amount.clear();
+	value.clear();
+	ability.clear();
+	type.clear();
+	source.clear();
+	target.clear();
+	blocks.clear();
+	for (role = 0; role < 2; role++)
+		for (slot = 0; slot < GAME_NOF_SLOTS; slot++)
+			postings[role][slot].clear();
+	sorted = 1;
+	for (slot = 0; slot < GAME_NOF_SLOTS; slot++)
+		playerIds[slot] = slot;
+}
+
+
+void VEEventStore::SetPlayers(const int* ids)
+{
+	int slot;
+
+	if (ids == NULL)
+		return;
+	for (slot = 0; slot < GAME_NOF_SLOTS; slot++)
+		playerIds[slot] = ids[slot];
+}
+
+
+int VEEventStore::GetPlayerId(GameEntity slot) const
+{
+	return (slot >= 0 && slot < GAME_NOF_SLOTS) ? playerIds[slot] : GAME_ENTITY_NONE;
+}
+
+
+int VEEventStore::Append(const VEStoredEvent* event)
+{
+	unsigned long row = (unsigned long)time.size();
+	VEStoreBlock block;
+
+	if (event == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	if (segment.base != NULL || event->type < 0 || event->type >= VE_NOF_EVENT_TYPES ||
+		event->source < GAME_ENTITY_NONE || event->source >= GAME_NOF_SLOTS ||
+		event->target < GAME_ENTITY_NONE || event->target >= GAME_NOF_SLOTS)
+		return DU_RETURN_ILLEGAL_ARGUMENT;
+	if (row >= 0xffffffffUL)
+		return DU_RETURN_ILLEGAL_SIZE;
+
+	if (row % VE_STORE_BLOCK_ROWS == 0)
+	{
+		block.minTime = event->time;
+		block.maxTime = event->time;
+		blocks.push_back(block);
+	}
+	else
+	{
+		if (event->time < blocks.back().minTime)
+			blocks.back().minTime = event->time;
+		if (event->time > blocks.back().maxTime)
+			blocks.back().maxTime = event->time;
+	}
+	if (row > 0 && event->time < time.back())
+		sorted = 0;
+
+	time.push_back(event->time);
+	amount.push_back(event->amount);
+	value.push_back(event->value);
+	ability.push_back(event->ability);
+	type.push_back((int8_t)event->type);
+	source.push_back((int8_t)event->source);
+	target.push_back((int8_t)event->target);
+	if (event->source != GAME_ENTITY_NONE)
+		postings[0][event->source].push_back((uint32_t)row);
+	if (event->target != GAME_ENTITY_NONE)
+		postings[1][event->target].push_back((uint32_t)row);
+	return DU_RETURN_OK;
+}
+
+
+int VEEventStore::AppendEvent(const VEEvent* event, int abilityId, float score)
+{
+	VEStoredEvent row;
+
+	if (event == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	row.time = event->time;
+	row.type = event->type;
+	row.source = event->entity;
+	row.target = event->target;
+	row.ability = abilityId;
+	row.amount = event->amount;
+	row.value = score;
+	return Append(&row);
+}
+
+
+void VEEventStore::GetColumns(Columns* c) const
+{
+	const VEStoreSegmentHeader *h = (const VEStoreSegmentHeader*)segment.base;
+	const uint32_t *p;
+	int role, slot;
+
+	if (segment.base != NULL)
+	{
+		c->nofRows = (unsigned long)h->nofRows;
+		c->nofBlocks = (unsigned long)h->nofBlocks;
+		c->sorted = (int)h->sorted;
+		c->blocks = (const VEStoreBlock*)(segment.base + h->blocksOffset);
+		c->time = (const double*)(segment.base + h->timeOffset);
+		c->amount = (const float*)(segment.base + h->amountOffset);
+		c->value = (const float*)(segment.base + h->valueOffset);
+		c->ability = (const int32_t*)(segment.base + h->abilityOffset);
+		c->type = (const int8_t*)(segment.base + h->typeOffset);
+		c->source = (const int8_t*)(segment.base + h->sourceOffset);
+		c->target = (const int8_t*)(segment.base + h->targetOffset);
+		p = (const uint32_t*)(segment.base + h->postingsOffset);
+		for (role = 0; role < 2; role++)
+		{
+			for (slot = 0; slot < GAME_NOF_SLOTS; slot++)
+			{
+				c->postings[role][slot] = p;
+				c->nofPostings[role][slot] = (unsigned long)h->nofPostings[role][slot];
+				p += h->nofPostings[role][slot];
+			}
+		}
+		return;
+	}
+
+	c->nofRows = (unsigned long)time.size();
+	c->nofBlocks = (unsigned long)blocks.size();
+	c->sorted = sorted;
+	c->blocks = blocks.data();
+	c->time = time.data();
+	c->amount = amount.data();
+	c->value = value.data();
+	c->ability = ability.data();
+	c->type = type.data();
+	c->source = source.data();
+	c->target = target.data();
+	for (role = 0; role < 2; role++)
+	{
+		for (slot = 0; slot < GAME_NOF_SLOTS; slot++)
+		{
+			c->postings[role][slot] = postings[role][slot].data();
+			c->nofPostings[role][slot] = (unsigned long)postings[role][slot].size();
+		}
+	}
+}
+
+
+unsigned long VEEventStore::GetNofRows() const
+{
+	if (segment.base != NULL)
+		return (unsigned long)((const VEStoreSegmentHeader*)segment.base)->nofRows;
+	return (unsigned long)time.size();
+}
+
+
+int VEEventStore::GetRow(unsigned long row, VEStoredEvent* event) const
+{
+	Columns c;
+
+	if (event == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	GetColumns(&c);
+	if (row >= c.nofRows)
+		return DU_RETURN_ILLEGAL_INDEX;
+	event->time = c.time[row];
+	event->type = c.type[row];
+	event->source = c.source[row];
+	event->target = c.target[row];
+	event->ability = c.ability[row];
+	event->amount = c.amount[row];
+	event->value = c.value[row];
+	return DU_RETURN_OK;
+}
+
+
+void VEEventStore::InitQuery(VEStoreQuery* query)
+{
+	if (query == NULL)
+		return;
+	query->from = -HUGE_VAL;
+	query->to = HUGE_VAL;
+	query->type = VE_STORE_ANY;
+	query->source = VE_STORE_ANY;
+	query->target = VE_STORE_ANY;
+	query->ability = VE_STORE_ANY;
+}
+
+
+/* The slots of the players of query, empty when one of them did not play in this match */
+int VEEventStore::Resolve(const VEStoreQuery* query, Filter* filter) const
+{
+	int slot;
+
+	filter->from = query->from;
+	filter->to = query->to;
+	filter->type = query->type;
+	filter->ability = query->ability;
+	filter->source = VE_STORE_ANY;
+	filter->target = VE_STORE_ANY;
+	filter->empty = 0;
+	for (slot = 0; slot < GAME_NOF_SLOTS; slot++)
+	{
+		if (query->source != VE_STORE_ANY && playerIds[slot] == query->source)
+			filter->source = slot;
+		if (query->target != VE_STORE_ANY && playerIds[slot] == query->target)
+			filter->target = slot;
+	}
+	if ((query->source != VE_STORE_ANY && filter->source == VE_STORE_ANY) ||
+		(query->target != VE_STORE_ANY && filter->target == VE_STORE_ANY))
+		filter->empty = 1;
+	return DU_RETURN_OK;
+}
+
+
+/* Walks the shorter posting list of the players of the query, else the rows; sorted rows start at from */
+void VEEventStore::Start(const Columns* c, const Filter* filter, Cursor* cursor) const
+{
+	unsigned long low, high, middle;
+
+	cursor->list = NULL;
+	cursor->length = c->nofRows;
+	cursor->next = 0;
+	if (filter->source != VE_STORE_ANY)
+	{
+		cursor->list = c->postings[0][filter->source];
+		cursor->length = c->nofPostings[0][filter->source];
+	}
+	if (filter->target != VE_STORE_ANY && (cursor->list == NULL || c->nofPostings[1][filter->target] < cursor->length))
+	{
+		cursor->list = c->postings[1][filter->target];
+		cursor->length = c->nofPostings[1][filter->target];
+	}
+	if (!c->sorted)
+		return;
+
+	low = 0;
+	if (cursor->list != NULL)
+	{
+		high = cursor->length;
+		while (low < high)
+		{
+			middle = low + (high - low) / 2;
+			if (cursor->list[middle] < c->nofRows && c->time[cursor->list[middle]] < filter->from)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		cursor->next = low;
+	}
+	else
+	{
+		high = c->nofBlocks;
+		while (low < high)
+		{
+			middle = low + (high - low) / 2;
+			if (c->blocks[middle].maxTime < filter->from)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		cursor->next = low * VE_STORE_BLOCK_ROWS;
+	}
+}
+
+
+int VEEventStore::Match(const Columns* c, const Filter* filter, unsigned long row) const
+{
+	return c->time[row] >= filter->from && c->time[row] < filter->to &&
+	       (filter->type == VE_STORE_ANY || c->type[row] == filter->type) &&
+	       (filter->source == VE_STORE_ANY || c->source[row] == filter->source) &&
+	       (filter->target == VE_STORE_ANY || c->target[row] == filter->target) &&
+	       (filter->ability == VE_STORE_ANY || c->ability[row] == filter->ability);
+}
+
+
+/* Up to VE_STORE_SCAN_ROWS rows of the query into rows, 0 at the end */
+unsigned int VEEventStore::Select(const Columns* c, const Filter* filter, Cursor* cursor, uint32_t* rows) const
+{
+	const VEStoreBlock *block;
+	unsigned long row;
+	unsigned int n = 0;
+
+	if (cursor->list != NULL)
+	{
+		while (cursor->next < cursor->length && n < VE_STORE_SCAN_ROWS)
+		{
+			row = cursor->list[cursor->next++];
+			if (row >= c->nofRows)
+				continue;
+			if (c->sorted && c->time[row] >= filter->to)
+			{
+				cursor->next = cursor->length;
+				break;
+			}
+			if (Match(c, filter, row))
+				rows[n++] = (uint32_t)row;
+		}
+		return n;
+	}
+
+	while (cursor->next < cursor->length && n < VE_STORE_SCAN_ROWS)
+	{
+		row = cursor->next;
+		if (row % VE_STORE_BLOCK_ROWS == 0)
+		{
+			block = &c->blocks[row / VE_STORE_BLOCK_ROWS];
+			if (block->minTime >= filter->to && c->sorted)
+			{
+				cursor->next = cursor->length;
+				break;
+			}
+			if (block->minTime >= filter->to || block->maxTime < filter->from)
+			{
+				cursor->next += VE_STORE_BLOCK_ROWS;
+				continue;
+			}
+		}
+		cursor->next++;
+		if (Match(c, filter, row))
+			rows[n++] = (uint32_t)row;
+	}
+	return n;
+}
+
+
+int VEEventStore::Aggregate(const VEStoreQuery* query, VEStoreTotals* totals) const
+{
+	uint32_t rows[VE_STORE_SCAN_ROWS];
+	VEStoreTotals sum;
+	Columns c;
+	Filter filter;
+	Cursor cursor;
+	unsigned int i, n;
+
+	if (query == NULL || totals == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	Resolve(query, &filter);
+	if (filter.empty)
+		return DU_RETURN_OK;
+
+	memset(&sum, 0, sizeof(sum));
+	GetColumns(&c);
+	Start(&c, &filter, &cursor);
+	while ((n = Select(&c, &filter, &cursor, rows)) > 0)
+	{
+		for (i = 0; i < n; i++)
+		{
+			sum.amount += c.amount[rows[i]];
+			sum.value += c.value[rows[i]];
+		}
+		sum.count += n;
+	}
+	AddTotals(totals, &sum);
+	return DU_RETURN_OK;
+}
+
+
+int VEEventStore::Group(const VEStoreQuery* query, int by, std::vector<VEStoreGroup>* groups) const
+{
+	uint32_t rows[VE_STORE_SCAN_ROWS];
+	VEStoreTotals small[VE_NOF_EVENT_TYPES > GAME_NOF_SLOTS ? VE_NOF_EVENT_TYPES : GAME_NOF_SLOTS];
+	std::map<int, VEStoreTotals> abilities;
+	std::map<int, VEStoreTotals>::iterator a;
+	VEStoreGroup group;
+	VEStoreTotals *totals;
+	const int8_t *keys = NULL;
+	Columns c;
+	Filter filter;
+	Cursor cursor;
+	unsigned int i, n;
+	int key, nofKeys = 0;
+	size_t g;
+
+	if (query == NULL || groups == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	if (by < 0 || by >= VE_NOF_STORE_KEYS)
+		return DU_RETURN_ILLEGAL_ARGUMENT;
+	Resolve(query, &filter);
+	if (filter.empty)
+		return DU_RETURN_OK;
+
+	memset(small, 0, sizeof(small));
+	GetColumns(&c);
+	switch (by)
+	{
+	case VEStoreBySource:   keys = c.source;    nofKeys = GAME_NOF_SLOTS;       break;
+	case VEStoreByTarget:   keys = c.target;    nofKeys = GAME_NOF_SLOTS;       break;
+	case VEStoreByType:     keys = c.type;      nofKeys = VE_NOF_EVENT_TYPES;   break;
+	}
+
+	Start(&c, &filter, &cursor);
+	while ((n = Select(&c, &filter, &cursor, rows)) > 0)
+	{
+		for (i = 0; i < n; i++)
+		{
+			if (keys != NULL)
+			{
+				key = keys[rows[i]];
+				if (key < 0 || key >= nofKeys)
+					continue;
+				totals = &small[key];
+			}
+			else
+			{
+				key = c.ability[rows[i]];
+				if (key == VE_ABILITY_NONE)
+					continue;
+				totals = &abilities[key];
+			}
+			totals->count++;
+			totals->amount += c.amount[rows[i]];
+			totals->value += c.value[rows[i]];
+		}
+	}
+
+	/* into the groups of the caller, by player id for the slots */
+	for (key = 0, a = abilities.begin(); ; key++)
+	{
+		if (keys != NULL)
+		{
+			if (key >= nofKeys)
+				break;
+			if (small[key].count == 0)
+				continue;
+			group.key = (by == VEStoreByType) ? key : playerIds[key];
+			group.totals = small[key];
+		}
+		else
+		{
+			if (a == abilities.end())
+				break;
+			group.key = a->first;
+			group.totals = a->second;
+			++a;
+		}
+		for (g = 0; g < groups->size() && (*groups)[g].key != group.key; g++)
+			;
+		if (g < groups->size())
+			AddTotals(&(*groups)[g].totals, &group.totals);
+		else
+			groups->push_back(group);
+	}
+	return DU_RETURN_OK;
+}
+
+
+void VEEventStore::TopK(std::vector<VEStoreGroup>* groups, int k, int byCount)
+{
+	size_t keep;
+
+	if (groups == NULL || k < 0)
+		return;
+	keep = ((size_t)k < groups->size()) ? (size_t)k : groups->size();
+	std::partial_sort(groups->begin(), groups->begin() + keep, groups->end(), byCount ? HigherCount : HigherValue);
+	groups->resize(keep);
+}
+
+
+int VEEventStore::WriteSegment(const char* path) const
+{
+	VEStoreSegmentHeader header;
+	Columns c;
+	uint64_t offset = 0, next;
+	FILE *f;
+	int role, slot, ok;
+
+	if (path == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	GetColumns(&c);
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, VE_STORE_SEGMENT_MAGIC, sizeof(header.magic));
+	header.version = VE_STORE_SEGMENT_VERSION;
+	header.byteOrder = VE_STORE_BYTE_ORDER;
+	header.sorted = (uint32_t)c.sorted;
+	for (slot = 0; slot < GAME_NOF_SLOTS; slot++)
+		header.playerIds[slot] = playerIds[slot];
+	header.nofRows = c.nofRows;
+	header.nofBlocks = c.nofBlocks;
+	for (role = 0; role < 2; role++)
+		for (slot = 0; slot < GAME_NOF_SLOTS; slot++)
+			header.nofPostings[role][slot] = c.nofPostings[role][slot];
+	Layout(&header);
+
+	if (RTFileWriteBegin(path, &f) != RT_RETURN_OK)
+		return DU_RETURN_CANNOT_OPEN_FILE;
+
+	ok = WriteSection(f, &header, sizeof(header), &offset, header.blocksOffset) &&
+	     WriteSection(f, c.blocks, c.nofBlocks * sizeof(VEStoreBlock), &offset, header.timeOffset) &&
+	     WriteSection(f, c.time, c.nofRows * sizeof(double), &offset, header.amountOffset) &&
+	     WriteSection(f, c.amount, c.nofRows * sizeof(float), &offset, header.valueOffset) &&
+	     WriteSection(f, c.value, c.nofRows * sizeof(float), &offset, header.abilityOffset) &&
+	     WriteSection(f, c.ability, c.nofRows * sizeof(int32_t), &offset, header.typeOffset) &&
+	     WriteSection(f, c.type, c.nofRows, &offset, header.sourceOffset) &&
+	     WriteSection(f, c.source, c.nofRows, &offset, header.targetOffset) &&
+	     WriteSection(f, c.target, c.nofRows, &offset, header.postingsOffset);
+	for (role = 0; role < 2 && ok; role++)
+	{
+		for (slot = 0; slot < GAME_NOF_SLOTS && ok; slot++)
+		{
+			next = offset + c.nofPostings[role][slot] * sizeof(uint32_t);
+			ok = WriteSection(f, c.postings[role][slot], next - offset, &offset, next);
+		}
+	}
+	return (RTFileWriteEnd(path, f, ok) == RT_RETURN_OK) ? DU_RETURN_OK : DU_RETURN_CANNOT_OPEN_FILE;
+}
+
+
+int VEEventStore::OpenSegment(const char* path)
+{
+	VEStoreSegmentHeader expected;
+	const VEStoreSegmentHeader *h;
+	RTFileMapStruct file;
+	int role, slot, ret, ok;
+
+	if (path == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	Reset();
+
+	ret = RTFileMap(path, sizeof(VEStoreSegmentHeader), 0, &file);
+	if (ret == RT_RETURN_ILLEGAL_DATA)
+		return DU_RETURN_ILLEGAL_FORMAT;
+	if (ret != RT_RETURN_OK)
+		return DU_RETURN_CANNOT_OPEN_FILE;
+
+	/* the counts decide the layout, a segment is only used when it has exactly that layout */
+	h = (const VEStoreSegmentHeader*)file.base;
+	ok = h->nofRows <= file.size;
+	for (role = 0; role < 2; role++)
+		for (slot = 0; slot < GAME_NOF_SLOTS; slot++)
+			ok = ok && h->nofPostings[role][slot] <= h->nofRows;
+	expected = *h;
+	Layout(&expected);
+	if (!ok || memcmp(h->magic, VE_STORE_SEGMENT_MAGIC, sizeof(h->magic)) != 0 ||
+		h->version != VE_STORE_SEGMENT_VERSION || h->byteOrder != VE_STORE_BYTE_ORDER ||
+		h->nofBlocks != (h->nofRows + VE_STORE_BLOCK_ROWS - 1) / VE_STORE_BLOCK_ROWS ||
+		memcmp(&expected, h, sizeof(expected)) != 0 || h->fileSize != file.size)
+	{
+		RTFileUnmap(&file);
+		return DU_RETURN_ILLEGAL_FORMAT;
+	}
+
+	segment = file;
+	for (slot = 0; slot < GAME_NOF_SLOTS; slot++)
+		playerIds[slot] = h->playerIds[slot];
+	return DU_RETURN_OK;
+}
+
+
+int VEEventStore::IsSegment() const
+{
+	return segment.base != NULL;
+}
+
+
+size_t VEEventStore::GetSize() const
+{
+	size_t size;
+	int role, slot;
+
+	if (segment.base != NULL)
+		return segment.size;
+	size = time.size() * (sizeof(double) + 2 * sizeof(float) + sizeof(int32_t) + 3 * sizeof(int8_t)) +
+	       blocks.size() * sizeof(VEStoreBlock);
+	for (role = 0; role < 2; role++)
+		for (slot = 0; slot < GAME_NOF_SLOTS; slot++)
+			size += postings[role][slot].size() * sizeof(uint32_t);
+	return size;
+}
+
+
+
+/*
+	END OF VEEventStore CLASS
+*/
@@ -0,0 +1,255 @@
+﻿#ifndef _VEEVENTSTORE_H_
+#define _VEEVENTSTORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "ValueEngine.h"
+#include "RTFile.h"
+
+/*
+	Event store of the Statistics Controller: the events the Value Engine handled, with
+	the ability behind them and their score, kept for queries over a match or a season
+	("value of the abilities of a player", "healing of a player in the first ten minutes").
+
+	Rows are appended and never change. Every column is an array of its own (time, type,
+	source, target, ability, amount, value), so a query only reads the columns it tests
+	and adds up, in one pass through them. Two indexes come with the columns:
+
+		blocks      the lowest and highest time of every VE_STORE_BLOCK_ROWS rows, a query
+		            over a time window skips the blocks outside it
+		postings    the rows of every slot as source and as target, in row order, a query
+		            about a player reads the rows of that player only
+
+	Source and target are slots of the match. SetPlayers gives the player id of every slot
+	and queries name players by id, so one query runs unchanged over the stores of many
+	matches; a store adds its rows to the totals and groups the caller passes in.
+
+	WriteSegment stores the columns and indexes in a segment file laid out like the
+	memory, OpenSegment maps one read only: opening reads the header, a query reads the
+	pages of the columns it needs. A season is a set of segments queried one by one.
+
+	Segment file, all offsets from the start of the file, every section 8 byte aligned:
+
+		VEStoreSegmentHeader
+		blocks          VEStoreBlock, one per VE_STORE_BLOCK_ROWS rows
+		time            double per row
+		amount          float per row
+		value           float per row
+		ability         int32 per row
+		type            int8 per row
+		source          int8 per row, GAME_ENTITY_NONE for none
+		target          int8 per row
+		postings        uint32 rows: the source lists of the slots, then the target lists
+
+	PRE: a store is changed from one thread at a time; queries only read it.
+*/
+
+
+#define VE_STORE_BLOCK_ROWS         1024
+/* Query field that matches every row */
+#define VE_STORE_ANY                (-0x7fffffff - 1)
+#define VE_ABILITY_NONE             (-1)
+
+#define VE_STORE_SEGMENT_MAGIC      "SVSTORE1"
+#define VE_STORE_SEGMENT_VERSION    1
+
+
+/* One row, as appended and read back */
+typedef struct _VEStoredEventStruct
+{
+	double          time;           /* game time in seconds */
+	int             type;           /* veEventType */
+	GameEntity      source;
+	GameEntity      target;         /* GAME_ENTITY_NONE if the event has none */
+	int             ability;        /* VE_ABILITY_NONE if no ability caused it */
+	float           amount;
+	float           value;          /* score of the event */
+} VEStoredEvent;
+
+
+/* Rows with from <= time < to that match every field not VE_STORE_ANY */
+typedef struct _VEStoreQueryStruct
+{
+	double          from;
+	double          to;
+	int             type;
+	int             source;         /* player id */
+	int             target;         /* player id */
+	int             ability;
+} VEStoreQuery;
+
+
+typedef struct _VEStoreTotalsStruct
+{
+	unsigned long   count;
+	double          amount;
+	double          value;
+} VEStoreTotals;
+
+
+/* What Group groups by */
+enum veStoreKey
+{
+	VEStoreBySource,                /* key: player id */
+	VEStoreByTarget,                /* key: player id, rows without target are left out */
+	VEStoreByAbility,               /* key: ability, rows without ability are left out */
+	VEStoreByType,
+	VE_NOF_STORE_KEYS
+};
+
+typedef struct _VEStoreGroupStruct
+{
+	int             key;
+	VEStoreTotals   totals;
+} VEStoreGroup;
+
+
+typedef struct _VEStoreBlockStruct
+{
+	double          minTime;
+	double          maxTime;
+} VEStoreBlock;
+
+
+typedef struct _VEStoreSegmentHeader
+{
+	char            magic[8];       /* VE_STORE_SEGMENT_MAGIC */
+	uint32_t        version;        /* VE_STORE_SEGMENT_VERSION */
+	uint32_t        byteOrder;      /* 0x01020304 as written */
+	uint32_t        sorted;         /* 1 when the times never decrease */
+	uint32_t        reserved;
+	int32_t         playerIds[GAME_NOF_SLOTS];
+	uint64_t        nofRows;
+	uint64_t        nofBlocks;
+	uint64_t        blocksOffset;
+	uint64_t        timeOffset;
+	uint64_t        amountOffset;
+	uint64_t        valueOffset;
+	uint64_t        abilityOffset;
+	uint64_t        typeOffset;
+	uint64_t        sourceOffset;
+	uint64_t        targetOffset;
+	uint64_t        postingsOffset;
+	uint64_t        nofPostings[2][GAME_NOF_SLOTS];     /* source lists, target lists */
+	uint64_t        fileSize;
+} VEStoreSegmentHeader;
+
+
+class VEEventStore
+{
+public:
+	VEEventStore();
+	~VEEventStore();
+
+	/* Empties the store and closes its segment, the player ids go back to the slots */
+	void Reset();
+
+	/* playerIds has GAME_NOF_SLOTS entries, until set the id of a player is its slot */
+	void SetPlayers(const int* playerIds);
+	int GetPlayerId(GameEntity slot) const;
+
+	/* DU_RETURN_ILLEGAL_ARGUMENT for an unknown type or slot, or when the store is a segment */
+	int Append(const VEStoredEvent* event);
+	/* event as the Value Engine handled it, ability and value as the engine scored it */
+	int AppendEvent(const VEEvent* event, int ability, float value);
+
+	unsigned long GetNofRows() const;
+	int GetRow(unsigned long row, VEStoredEvent* event) const;
+
+	/* from and to open, every field VE_STORE_ANY */
+	static void InitQuery(VEStoreQuery* query);
+
+	/* Adds the rows of query to totals */
+	int Aggregate(const VEStoreQuery* query, VEStoreTotals* totals) const;
+
+	/* Adds the rows of query to groups by key (veStoreKey), the groups of another key are merged */
+	int Group(const VEStoreQuery* query, int by, std::vector<VEStoreGroup>* groups) const;
+
+	/* Keeps the k groups with the highest value (count when byCount), the highest first */
+	static void TopK(std::vector<VEStoreGroup>* groups, int k, int byCount);
+
+	/*
+		Writes the store as a segment, under a temporary name renamed when complete.
+		DU_RETURN_CANNOT_OPEN_FILE when it cannot be written.
+	*/
+	int WriteSegment(const char* path) const;
+
+	/*
+		Maps a segment read only in place of the rows of the store.
+		DU_RETURN_CANNOT_OPEN_FILE, DU_RETURN_ILLEGAL_FORMAT for a damaged segment or one
+		of another version or byte order.
+	*/
+	int OpenSegment(const char* path);
+	int IsSegment() const;
+
+	/* Bytes of the columns and indexes, the segment size when mapped */
+	size_t GetSize() const;
+
+private:
+	VEEventStore(const VEEventStore&);
+	VEEventStore& operator=(const VEEventStore&);
+
+	/* the columns, in the vectors below or in the mapped segment */
+	typedef struct _Columns
+	{
+		unsigned long       nofRows;
+		unsigned long       nofBlocks;
+		int                 sorted;
+		const VEStoreBlock  *blocks;
+		const double        *time;
+		const float         *amount;
+		const float         *value;
+		const int32_t       *ability;
+		const int8_t        *type;
+		const int8_t        *source;
+		const int8_t        *target;
+		const uint32_t      *postings[2][GAME_NOF_SLOTS];
+		unsigned long       nofPostings[2][GAME_NOF_SLOTS];
+	} Columns;
+
+	/* a query with its players resolved to slots */
+	typedef struct _Filter
+	{
+		double              from;
+		double              to;
+		int                 type;
+		int                 source;     /* slot, VE_STORE_ANY */
+		int                 target;
+		int                 ability;
+		int                 empty;      /* a player of the query is not in the store */
+	} Filter;
+
+	typedef struct _Cursor
+	{
+		const uint32_t      *list;      /* posting list walked, NULL: the rows */
+		unsigned long       length;
+		unsigned long       next;       /* index into the list or row */
+	} Cursor;
+
+	void GetColumns(Columns* columns) const;
+	int Resolve(const VEStoreQuery* query, Filter* filter) const;
+	void Start(const Columns* columns, const Filter* filter, Cursor* cursor) const;
+	unsigned int Select(const Columns* columns, const Filter* filter, Cursor* cursor, uint32_t* rows) const;
+	int Match(const Columns* columns, const Filter* filter, unsigned long row) const;
+	void CloseSegment();
+
+	std::vector<double> time;
+	std::vector<float> amount;
+	std::vector<float> value;
+	std::vector<int32_t> ability;
+	std::vector<int8_t> type;
+	std::vector<int8_t> source;
+	std::vector<int8_t> target;
+	std::vector<VEStoreBlock> blocks;
+	std::vector<uint32_t> postings[2][GAME_NOF_SLOTS];
+	int sorted;
+
+	int playerIds[GAME_NOF_SLOTS];
+
+	RTFileMapStruct segment;
+};
+
+
+#endif //_VEEVENTSTORE_H_
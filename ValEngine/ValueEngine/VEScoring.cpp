@@ -0,0 +1,230 @@
+﻿#include "pch.h"
+#include "VEScoring.h"
+
+#include <string.h>
+
+/* x64 always has SSE2, 32 bit builds only with /arch:SSE2 (the MSVC default) or -msse2 */
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define VE_WITH_SSE2
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+/*
+	Both paths must round the same way: a multiply and an add per term, never fused.
+	Do not build this file with /fp:fast, /fp:contract or -ffp-contract=fast.
+*/
+#ifdef _MSC_VER
+#pragma fp_contract (off)
+#endif
+
+
+void VEDefaultCoefficients(VECoefficients* c)
+{
+	int t;
+
+	memset(c, 0, sizeof(*c));
+	for (t = 0; t < VE_NOF_EVENT_TYPES; t++)
+	{
+		c->levelLead[t] = 0.02f;
+		c->aliveLead[t] = 0.05f;
+	}
+
+	c->amount[VEEventDamage] = 0.001f;
+	c->targetHp[VEEventDamage] = -0.2f;     /* damage on a target that is low is worth more */
+	c->amount[VEEventHeal] = 0.0012f;
+	c->targetHp[VEEventHeal] = -0.3f;
+	c->base[VEEventAbility] = 0.05f;
+	c->base[VEEventTakedown] = 1.0f;
+	c->time[VEEventTakedown] = 0.0005f;     /* late takedowns keep the enemy dead longer */
+	c->base[VEEventDeath] = -1.2f;
+	c->time[VEEventDeath] = -0.0005f;
+	c->base[VEEventLevelUp] = 0.5f;
+	c->amount[VEEventObjective] = 0.01f;
+	c->base[VEEventObjective] = 1.5f;
+}
+
+
+float VEScoreAction(const VECoefficients* c, const VEAction* action)
+{
+	int t = action->type;
+	float s;
+
+	if ((unsigned int)t >= VE_NOF_EVENT_TYPES)
+		return 0.0f;
+
+	s = c->base[t];
+	s = s + c->amount[t] * action->amount;
+	s = s + c->levelLead[t] * action->levelLead;
+	s = s + c->targetHp[t] * action->targetHp;
+	s = s + c->aliveLead[t] * action->aliveLead;
+	s = s + c->time[t] * (float)action->time;
+	return s;
+}
+
+
+/*
+	The coefficients of a type as one row, so a block gathers a row per action and
+	transposes them into one register per coefficient. Row VE_NOF_EVENT_TYPES is all 0,
+	for unknown types.
+*/
+#define VE_ROW_SIZE                 8
+
+enum veRowColumn
+{
+	VERowBase, VERowAmount, VERowLevelLead, VERowTargetHp, VERowAliveLead, VERowTime
+};
+
+typedef struct _VECoefficientRowsStruct
+{
+	float           row[VE_NOF_EVENT_TYPES + 1][VE_ROW_SIZE];
+} VECoefficientRows;
+
+
+static void MakeRows(const VECoefficients* c, VECoefficientRows* rows)
+{
+	int t;
+
+	memset(rows, 0, sizeof(*rows));
+	for (t = 0; t < VE_NOF_EVENT_TYPES; t++)
+	{
+		rows->row[t][VERowBase] = c->base[t];
+		rows->row[t][VERowAmount] = c->amount[t];
+		rows->row[t][VERowLevelLead] = c->levelLead[t];
+		rows->row[t][VERowTargetHp] = c->targetHp[t];
+		rows->row[t][VERowAliveLead] = c->aliveLead[t];
+		rows->row[t][VERowTime] = c->time[t];
+	}
+}
+
+
+/* Scores the actions [0, end), end a multiple of VE_SCORE_BLOCK. Returns the number of unknown types. */
+#ifdef VE_WITH_SSE2
+
+static int ScoreBlocks(const VECoefficientRows* rows, const VEActionColumns* a, int end, float* scores)
+{
+	__m128 r0, r1, r2, r3, q0, q1, q2, q3, s, time;
+	const float *row[VE_SCORE_BLOCK];
+	int i, k, t, nofUnknown = 0;
+
+	for (i = 0; i < end; i += VE_SCORE_BLOCK)
+	{
+		for (k = 0; k < VE_SCORE_BLOCK; k++)
+		{
+			t = a->type[i + k];
+			if ((unsigned int)t >= VE_NOF_EVENT_TYPES)
+			{
+				t = VE_NOF_EVENT_TYPES;
+				nofUnknown++;
+			}
+			row[k] = rows->row[t];
+		}
+
+		/* base, amount, levelLead, targetHp */
+		r0 = _mm_loadu_ps(row[0]);
+		r1 = _mm_loadu_ps(row[1]);
+		r2 = _mm_loadu_ps(row[2]);
+		r3 = _mm_loadu_ps(row[3]);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		/* aliveLead, time */
+		q0 = _mm_loadu_ps(row[0] + 4);
+		q1 = _mm_loadu_ps(row[1] + 4);
+		q2 = _mm_loadu_ps(row[2] + 4);
+		q3 = _mm_loadu_ps(row[3] + 4);
+		_MM_TRANSPOSE4_PS(q0, q1, q2, q3);
+
+		time = _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(a->time + i)), _mm_cvtpd_ps(_mm_loadu_pd(a->time + i + 2)));
+
+		s = r0;
+		s = _mm_add_ps(s, _mm_mul_ps(r1, _mm_loadu_ps(a->amount + i)));
+		s = _mm_add_ps(s, _mm_mul_ps(r2, _mm_loadu_ps(a->levelLead + i)));
+		s = _mm_add_ps(s, _mm_mul_ps(r3, _mm_loadu_ps(a->targetHp + i)));
+		s = _mm_add_ps(s, _mm_mul_ps(q0, _mm_loadu_ps(a->aliveLead + i)));
+		s = _mm_add_ps(s, _mm_mul_ps(q1, time));
+		_mm_storeu_ps(scores + i, s);
+	}
+	return nofUnknown;
+}
+
+#else
+
+static int ScoreBlocks(const VECoefficientRows* rows, const VEActionColumns* a, int end, float* scores)
+{
+	const float *row;
+	float s;
+	int i, t, nofUnknown = 0;
+
+	for (i = 0; i < end; i++)
+	{
+		t = a->type[i];
+		if ((unsigned int)t >= VE_NOF_EVENT_TYPES)
+		{
+			t = VE_NOF_EVENT_TYPES;
+			nofUnknown++;
+		}
+		row = rows->row[t];
+		s = row[VERowBase];
+		s = s + row[VERowAmount] * a->amount[i];
+		s = s + row[VERowLevelLead] * a->levelLead[i];
+		s = s + row[VERowTargetHp] * a->targetHp[i];
+		s = s + row[VERowAliveLead] * a->aliveLead[i];
+		s = s + row[VERowTime] * (float)a->time[i];
+		scores[i] = s;
+	}
+	return nofUnknown;
+}
+
+#endif //VE_WITH_SSE2
+
+
+int VEScoreActions(const VECoefficients* c, const VEActionColumns* a, float* scores, float* totals)
+{
+	VECoefficientRows rows;
+	VEAction action;
+	int i, end, nofUnknown;
+
+	if (c == NULL || a == NULL || scores == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	if (a->count > 0 && (a->type == NULL || a->time == NULL || a->amount == NULL ||
+		a->levelLead == NULL || a->targetHp == NULL || a->aliveLead == NULL ||
+		(totals != NULL && a->source == NULL)))
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+
+	MakeRows(c, &rows);
+	end = a->count - a->count % VE_SCORE_BLOCK;
+	nofUnknown = ScoreBlocks(&rows, a, end, scores);
+
+	/* the tail through the single action path */
+	for (i = end; i < a->count; i++)
+	{
+		action.type = a->type[i];
+		action.time = a->time[i];
+		action.amount = a->amount[i];
+		action.levelLead = a->levelLead[i];
+		action.targetHp = a->targetHp[i];
+		action.aliveLead = a->aliveLead[i];
+		if ((unsigned int)action.type >= VE_NOF_EVENT_TYPES)
+			nofUnknown++;
+		scores[i] = VEScoreAction(c, &action);
+	}
+
+	if (totals != NULL)
+	{
+		for (i = 0; i < a->count; i++)
+		{
+			if (a->source[i] >= 0 && a->source[i] < GAME_NOF_SLOTS)
+				totals[a->source[i]] += scores[i];
+		}
+	}
+	return (nofUnknown != 0) ? DU_RETURN_ILLEGAL_ARGUMENT : DU_RETURN_OK;
+}
+
+
+const char* VEGetScoreKernelName()
+{
+#ifdef VE_WITH_SSE2
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,84 @@
+﻿#ifndef _VESCORING_H_
+#define _VESCORING_H_
+
+#include "ValueEngine.h"
+
+/*
+	Scores of single actions, for re-scoring recorded actions against new coefficients
+	(after a patch) as well as for the live engine.
+
+	The score of an action is linear in its context features with coefficients that
+	depend on the type of the action:
+
+		score = base + amount * a + levelLead * l + targetHp * h + aliveLead * n + time * t
+
+	evaluated in exactly this order. VEScoreAction scores one action; VEScoreActions
+	scores columns of actions in blocks of VE_SCORE_BLOCK with SIMD and gives the same
+	bits for every action, so a batch re-score can stand in for replaying the events.
+*/
+
+
+#define VE_SCORE_BLOCK              4
+
+
+/* Coefficients of the scores, every column has one entry per veEventType */
+typedef struct _VECoefficientsStruct
+{
+	float           base[VE_NOF_EVENT_TYPES];
+	float           amount[VE_NOF_EVENT_TYPES];
+	float           levelLead[VE_NOF_EVENT_TYPES];
+	float           targetHp[VE_NOF_EVENT_TYPES];
+	float           aliveLead[VE_NOF_EVENT_TYPES];
+	float           time[VE_NOF_EVENT_TYPES];       /* per second of game time */
+} VECoefficients;
+
+
+/* One action and its context when it happened */
+typedef struct _VEActionStruct
+{
+	int             type;           /* veEventType */
+	GameEntity      source;
+	GameEntity      target;         /* GAME_ENTITY_NONE if the action has none */
+	double          time;           /* game time in seconds */
+	float           amount;
+	float           levelLead;      /* team level of the source minus that of the enemy */
+	float           targetHp;       /* hp fraction of the target, 1 without one */
+	float           aliveLead;      /* alive players of the source team minus the enemy's */
+} VEAction;
+
+
+/* count actions as columns, entry i of every column belongs to action i */
+typedef struct _VEActionColumnsStruct
+{
+	int             count;
+	const int       *type;
+	const GameEntity *source;
+	const GameEntity *target;
+	const double    *time;
+	const float     *amount;
+	const float     *levelLead;
+	const float     *targetHp;
+	const float     *aliveLead;
+} VEActionColumns;
+
+
+extern void VEDefaultCoefficients(VECoefficients* coefficients);
+
+/* The score of one action, 0 for an unknown type */
+extern float VEScoreAction(const VECoefficients* coefficients, const VEAction* action);
+
+/**
+ * Scores columns->count actions into scores. totals (GAME_NOF_SLOTS entries or NULL)
+ * gets the scores added per source, in the order of the actions.
+ *
+ * @retval DU_RETURN_OK
+ * @retval DU_RETURN_ILLEGAL_NULL_POINTER
+ * @retval DU_RETURN_ILLEGAL_ARGUMENT - an unknown type, the action scored 0, the others are scored
+ */
+extern int VEScoreActions(const VECoefficients* coefficients, const VEActionColumns* columns, float* scores, float* totals);
+
+/* "sse2" or "scalar" */
+extern const char* VEGetScoreKernelName();
+
+
+#endif //_VESCORING_H_
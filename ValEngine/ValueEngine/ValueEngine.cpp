@@ -1,2 +1,940 @@
 ﻿#include "pch.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+
 #include "ValueEngine.h"
+#include "VEScoring.h"
+#include "VEEventStore.h"
+#include "RTStats.h"
+
+
+/*
+	Declaration of the values: what a value of each kind reads and is computed from.
+
+	reads       states of its own slot (own team for the team values)
+	teamReads   states of every slot of its team
+	allReads    states of every slot
+	teamValues  values of its team (the player impacts of its slots, the team value itself)
+	allValues   values of both teams
+
+	A value may only be computed from kinds declared before it, so computing the nodes in
+	index order always finds the inputs up to date.
+*/
+typedef struct _VEValueStruct
+{
+	const char      *name;
+	int             perTeam;        /* one node per team, else one per slot */
+	unsigned int    reads;
+	unsigned int    teamReads;
+	unsigned int    allReads;
+	unsigned int    teamValues;     /* 1 << veValue */
+	unsigned int    allValues;
+} VEValueStruct;
+
+static const VEValueStruct veValues[VE_NOF_VALUES] =
+{
+	/* VEValuePlayerImpact */
+	{ "playerImpact", 0,
+		VE_STATE_BIT(VEStateHp) | VE_STATE_BIT(VEStateLevel) | VE_STATE_BIT(VEStateAlive) | VE_STATE_BIT(VEStateActions),
+		0, 0, 0, 0 },
+	/* VEValueTeamFight */
+	{ "teamFight", 1,
+		0,
+		VE_STATE_BIT(VEStatePosition),
+		VE_STATE_BIT(VEStateAlive),
+		1u << VEValuePlayerImpact, 0 },
+	/* VEValueObjective */
+	{ "objective", 1,
+		VE_STATE_BIT(VEStateObjectives),
+		0,
+		VE_STATE_BIT(VEStateLevel),
+		0, 1u << VEValueTeamFight },
+};
+
+
+/*
+	State an event changes: on its entity, on its target, and on every slot of the team
+	(VEStateObjectives on the team itself).
+*/
+typedef struct _VEEventEffectStruct
+{
+	const char      *instruction;
+	unsigned int    entityStates;
+	unsigned int    targetStates;
+	unsigned int    teamStates;
+} VEEventEffectStruct;
+
+static const VEEventEffectStruct veEventEffects[VE_NOF_EVENT_TYPES] =
+{
+	/* VEEventDamage */     { "damage", VE_STATE_BIT(VEStateActions), VE_STATE_BIT(VEStateHp), 0 },
+	/* VEEventHeal */       { "heal", VE_STATE_BIT(VEStateActions), VE_STATE_BIT(VEStateHp), 0 },
+	/* VEEventAbility */    { "ability", VE_STATE_BIT(VEStateActions) | VE_STATE_BIT(VEStateCooldown), 0, 0 },
+	/* VEEventTakedown */   { "takedown", VE_STATE_BIT(VEStateActions), 0, 0 },
+	/* VEEventDeath */      { "death", VE_STATE_BIT(VEStateActions) | VE_STATE_BIT(VEStateAlive) | VE_STATE_BIT(VEStateHp), 0, 0 },
+	/* VEEventRespawn */    { "respawn", VE_STATE_BIT(VEStateAlive) | VE_STATE_BIT(VEStateHp) | VE_STATE_BIT(VEStatePosition), 0, 0 },
+	/* VEEventLevelUp */    { "levelUp", 0, 0, VE_STATE_BIT(VEStateLevel) },
+	/* VEEventMove */       { "move", VE_STATE_BIT(VEStatePosition), 0, 0 },
+	/* VEEventObjective */  { "objective", 0, 0, VE_STATE_BIT(VEStateObjectives) },
+};
+
+
+/* weights of the values */
+#define VE_DAMAGE_WEIGHT            1.0f
+#define VE_HEALING_WEIGHT           1.2f
+#define VE_TAKEDOWN_WEIGHT          300.0f
+#define VE_DEATH_WEIGHT             400.0f
+#define VE_ABILITY_WEIGHT           10.0f
+#define VE_LEVEL_WEIGHT             0.1f        /* per level */
+#define VE_DEAD_WEIGHT              0.5f        /* of the impact of a dead player */
+#define VE_ADVANTAGE_WEIGHT         0.15f       /* per player more alive */
+#define VE_GROUPING_DISTANCE        1000.0f     /* spread that halves the team fight value */
+#define VE_LEVEL_LEAD_WEIGHT        100.0f      /* per level */
+#define VE_FIGHT_LEAD_WEIGHT        0.1f
+
+
+static int NofBits(unsigned int bits)
+{
+	int n = 0;
+
+	for (; bits != 0; bits &= bits - 1)
+		n++;
+	return n;
+}
+
+
+static int ValueOfNode(int node)
+{
+	if (node < GAME_NOF_SLOTS)
+		return VEValuePlayerImpact;
+	if (node < VE_NODE_OBJECTIVE(0))
+		return VEValueTeamFight;
+	return VEValueObjective;
+}
+
+
+/* Nodes of kind value that belong to team, or to both teams if team is -1 */
+static unsigned int NodesOf(int value, int team)
+{
+	unsigned int nodes = 0;
+	int t;
+
+	for (t = 0; t < GAME_NOF_TEAMS; t++)
+	{
+		if (team >= 0 && t != team)
+			continue;
+		switch (value)
+		{
+		case VEValuePlayerImpact:
+			nodes |= ((1u << GAME_PLAYERS_PER_TEAM) - 1) << GameClass::TeamBegin(t);
+			break;
+		case VEValueTeamFight:
+			nodes |= 1u << VE_NODE_TEAM_FIGHT(t);
+			break;
+		case VEValueObjective:
+			nodes |= 1u << VE_NODE_OBJECTIVE(t);
+			break;
+		}
+	}
+	return nodes;
+}
+
+
+/*
+	ValueEngine CLASS
+*/
+
+ValueEngine::ValueEngine()
+{
+	game = NULL;
+	state = NULL;
+	bus = NULL;
+	store = NULL;
+	deferred = 0;
+	fullRecompute = 0;
+	coefficients = new VECoefficients;
+	VEDefaultCoefficients(coefficients);
+	BuildGraph();
+	Reset();
+	ResetStats();
+}
+
+ValueEngine::~ValueEngine()
+{
+	Subscribe(NULL);
+	delete coefficients;
+}
+
+
+void ValueEngine::BuildGraph()
+{
+	unsigned int direct[VE_NOF_NODES];
+	int n, m, s, e, v, index, team;
+	const VEValueStruct *value;
+
+	memset(readers, 0, sizeof(readers));
+	for (n = 0; n < VE_NOF_NODES; n++)
+	{
+		value = &veValues[ValueOfNode(n)];
+		index = value->perTeam ? n - (ValueOfNode(n) == VEValueTeamFight ? VE_NODE_TEAM_FIGHT(0) : VE_NODE_OBJECTIVE(0)) : n;
+		team = value->perTeam ? index : GameClass::TeamOf(index);
+
+		for (s = 0; s < VE_NOF_STATES; s++)
+		{
+			if (value->reads & VE_STATE_BIT(s))
+				readers[s][index] |= 1u << n;
+			for (e = 0; e < GAME_NOF_SLOTS; e++)
+			{
+				if ((value->allReads & VE_STATE_BIT(s)) ||
+					((value->teamReads & VE_STATE_BIT(s)) && GameClass::TeamOf(e) == team))
+					readers[s][e] |= 1u << n;
+			}
+		}
+
+		direct[n] = 0;
+		for (v = 0; v < VE_NOF_VALUES; v++)
+		{
+			if (value->teamValues & (1u << v))
+				direct[n] |= NodesOf(v, team);
+			if (value->allValues & (1u << v))
+				direct[n] |= NodesOf(v, -1);
+		}
+		direct[n] &= ~(1u << n);
+	}
+
+	/* the inputs come first, one pass in index order closes them */
+	for (n = 0; n < VE_NOF_NODES; n++)
+	{
+		inputs[n] = 1u << n;
+		for (m = 0; m < n; m++)
+		{
+			if (direct[n] & (1u << m))
+				inputs[n] |= inputs[m];
+		}
+	}
+	for (n = 0; n < VE_NOF_NODES; n++)
+	{
+		closure[n] = 0;
+		for (m = 0; m < VE_NOF_NODES; m++)
+		{
+			if (inputs[m] & (1u << n))
+				closure[n] |= 1u << m;
+		}
+	}
+}
+
+
+void ValueEngine::Bind(const GameClass* boundGame)
+{
+	game = boundGame;
+	state = (game != NULL) ? game->GetState() : NULL;
+	Reset();
+}
+
+
+void ValueEngine::Reset()
+{
+	memset(damage, 0, sizeof(damage));
+	memset(healing, 0, sizeof(healing));
+	memset(takedowns, 0, sizeof(takedowns));
+	memset(deaths, 0, sizeof(deaths));
+	memset(abilities, 0, sizeof(abilities));
+	memset(objectives, 0, sizeof(objectives));
+	memset(values, 0, sizeof(values));
+	dirty = (1u << VE_NOF_NODES) - 1;
+	unpublished = 0;
+}
+
+
+static int FindEventType(const char* instruction)
+{
+	int t;
+
+	if (instruction == NULL)
+		return -1;
+	for (t = 0; t < VE_NOF_EVENT_TYPES; t++)
+	{
+		if (strcmp(instruction, veEventEffects[t].instruction) == 0)
+			return t;
+	}
+	return -1;
+}
+
+
+int ValueEngine::ActionDetected(const char* instruction, void* value, double timeStamp)
+{
+	VEEvent event;
+	int type = FindEventType(instruction);
+
+	if (type < 0)
+		return DU_RETURN_NOT_FOUND;
+	if (value == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	event = *(const VEEvent*)value;
+	event.type = type;
+	event.time = timeStamp;
+	return HandleEvent(&event);
+}
+
+
+int ValueEngine::SomethingHappened(const char* instruction, void* value, double timeStamp)
+{
+	if (instruction != NULL && strcmp(instruction, "gameStart") == 0)
+	{
+		Reset();
+		return DU_RETURN_OK;
+	}
+	if (instruction != NULL && strcmp(instruction, "gameEnd") == 0)
+	{
+		Tick(timeStamp);
+		return DU_RETURN_OK;
+	}
+	return ActionDetected(instruction, value, timeStamp);
+}
+
+
+/* the opcodes the engine handles */
+static const int veBusOpcodes[] = { RT_BUS_GAME_START, RT_BUS_GAME_END, RT_BUS_PLAYER_UPDATE, RT_BUS_ACTION,
+                                    RT_BUS_LOAD_LEVEL, RT_BUS_UNIT_ACTION };
+
+int ValueEngine::Subscribe(RTBus newBus)
+{
+	int i, ret;
+
+	if (bus != NULL)
+	{
+		for (i = 0; i < (int)(sizeof(veBusOpcodes) / sizeof(veBusOpcodes[0])); i++)
+			RTBusUnsubscribe(bus, veBusOpcodes[i], OnBusMessage, this);
+		bus = NULL;
+	}
+	if (newBus == NULL)
+		return DU_RETURN_OK;
+
+	for (i = 0; i < (int)(sizeof(veBusOpcodes) / sizeof(veBusOpcodes[0])); i++)
+	{
+		ret = RTBusSubscribe(newBus, veBusOpcodes[i], OnBusMessage, this);
+		if (ret != RT_RETURN_OK)
+		{
+			while (--i >= 0)
+				RTBusUnsubscribe(newBus, veBusOpcodes[i], OnBusMessage, this);
+			return DU_RETURN_ILLEGAL_SIZE;
+		}
+	}
+	bus = newBus;
+	return DU_RETURN_OK;
+}
+
+
+void ValueEngine::OnBusMessage(const RTBusMessage* message, void* context)
+{
+	ValueEngine *engine = (ValueEngine*)context;
+	VEEvent event;
+
+	switch (message->opcode)
+	{
+	case RT_BUS_GAME_START:
+		engine->Reset();
+		break;
+	case RT_BUS_GAME_END:
+		engine->Tick(message->time);
+		break;
+	case RT_BUS_PLAYER_UPDATE:
+		engine->StateChanged(message->player.entity, message->player.states);
+		break;
+	case RT_BUS_ACTION:
+	case RT_BUS_UNIT_ACTION:
+		event.type = message->action.type;
+		event.entity = message->action.entity;
+		event.target = message->action.target;
+		event.team = message->action.team;
+		event.amount = message->action.amount;
+		event.time = message->time;
+		if (message->opcode == RT_BUS_UNIT_ACTION)
+			engine->HandleUnitEvent(&event);
+		else
+			engine->HandleEvent(&event);
+		break;
+	case RT_BUS_LOAD_LEVEL:
+		engine->SetDeferred((message->load.level >= RT_LIVE_LEVEL_DEFER_VALUES) ? VE_NODES_NON_CRITICAL : 0);
+		break;
+	}
+}
+
+
+int ValueEngine::HandleEvent(const VEEvent* event)
+{
+	const VEEventEffectStruct *effect;
+	unsigned int before = dirty;
+	int team, s, e;
+
+	if (event == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	if (event->type < 0 || event->type >= VE_NOF_EVENT_TYPES)
+		return DU_RETURN_ILLEGAL_ARGUMENT;
+	effect = &veEventEffects[event->type];
+
+	if (event->type == VEEventObjective)
+		team = event->team;
+	else if (event->entity >= 0 && event->entity < GAME_NOF_SLOTS)
+		team = GameClass::TeamOf(event->entity);
+	else
+		return DU_RETURN_ILLEGAL_INDEX;
+	if (team < 0 || team >= GAME_NOF_TEAMS)
+		return DU_RETURN_ILLEGAL_INDEX;
+	if (effect->targetStates != 0 && (event->target < 0 || event->target >= GAME_NOF_SLOTS))
+		return DU_RETURN_ILLEGAL_INDEX;
+
+	RT_STATS_BEGIN(RT_STAGE_VALUE_ENGINE);
+	if (store != NULL)
+		store->AppendEvent(event, (event->type == VEEventAbility) ? (int)event->amount : VE_ABILITY_NONE, ScoreEvent(event));
+	switch (event->type)
+	{
+	case VEEventDamage:
+		damage[event->entity] += event->amount;
+		break;
+	case VEEventHeal:
+		healing[event->entity] += event->amount;
+		break;
+	case VEEventAbility:
+		abilities[event->entity]++;
+		break;
+	case VEEventTakedown:
+		takedowns[event->entity]++;
+		break;
+	case VEEventDeath:
+		deaths[event->entity]++;
+		break;
+	case VEEventObjective:
+		objectives[team] += event->amount;
+		break;
+	}
+
+	for (s = 0; s < VE_NOF_STATES; s++)
+	{
+		if (effect->entityStates & VE_STATE_BIT(s))
+			MarkState(s, event->entity);
+		if (effect->targetStates & VE_STATE_BIT(s))
+			MarkState(s, event->target);
+		if (effect->teamStates & VE_STATE_BIT(s))
+		{
+			if (s == VEStateObjectives)
+				MarkState(s, team);
+			else
+				for (e = GameClass::TeamBegin(team); e < GameClass::TeamEnd(team); e++)
+					MarkState(s, e);
+		}
+	}
+
+	stats.nofEvents++;
+	stats.lastEventDirtied = NofBits(dirty & ~before);
+	stats.nofDirtied += stats.lastEventDirtied;
+	if (stats.lastEventDirtied > stats.maxEventDirtied)
+		stats.maxEventDirtied = stats.lastEventDirtied;
+	RT_STATS_END(RT_STAGE_VALUE_ENGINE);
+
+	/* the reference: everything, right away */
+	if (fullRecompute)
+	{
+		dirty = (1u << VE_NOF_NODES) - 1;
+		Update(dirty);
+	}
+	return DU_RETURN_OK;
+}
+
+
+int ValueEngine::HandleUnitEvent(const VEEvent* event)
+{
+	VEEvent resolved;
+
+	if (event == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	if (event->type < 0 || event->type >= VE_NOF_EVENT_TYPES)
+		return DU_RETURN_ILLEGAL_ARGUMENT;
+	if (game == NULL)
+		return DU_RETURN_NOT_FOUND;
+
+	resolved = *event;
+	if (event->type != VEEventObjective)
+	{
+		resolved.entity = game->ResolveUnit((unsigned int)event->entity);
+		if (resolved.entity == GAME_ENTITY_NONE)
+			return DU_RETURN_NOT_FOUND;
+	}
+	if ((unsigned int)event->target != GAME_UNIT_ID_NONE)
+	{
+		resolved.target = game->ResolveUnit((unsigned int)event->target);
+		if (resolved.target == GAME_ENTITY_NONE && veEventEffects[event->type].targetStates != 0)
+			return DU_RETURN_NOT_FOUND;
+	}
+	return HandleEvent(&resolved);
+}
+
+
+int ValueEngine::StateChanged(GameEntity entity, unsigned int states)
+{
+	int s;
+
+	if (entity < 0 || entity >= GAME_NOF_SLOTS)
+		return DU_RETURN_ILLEGAL_INDEX;
+	for (s = 0; s < VE_NOF_STATES; s++)
+	{
+		if (states & VE_STATE_BIT(s))
+			MarkState(s, (s == VEStateObjectives) ? GameClass::TeamOf(entity) : entity);
+	}
+	return DU_RETURN_OK;
+}
+
+
+void ValueEngine::MarkState(int s, int index)
+{
+	MarkNodes(readers[s][index]);
+}
+
+
+void ValueEngine::MarkNodes(unsigned int nodes)
+{
+	int n;
+
+	for (n = 0; nodes != 0; n++, nodes >>= 1)
+	{
+		if (nodes & 1)
+			dirty |= closure[n];
+	}
+}
+
+
+void ValueEngine::Tick(double time)
+{
+	RTBusMessage message;
+	int n;
+
+	Update(dirty & ~deferred);
+	stats.nofDeferred += NofBits(dirty & deferred);
+	if (unpublished == 0 || RTBusGetNofSubscribers(bus, RT_BUS_VALUE_UPDATE) == 0)
+	{
+		unpublished = 0;
+		return;
+	}
+
+	message.opcode = RT_BUS_VALUE_UPDATE;
+	message.time = time;
+	for (n = 0; n < VE_NOF_NODES; n++)
+	{
+		if (unpublished & (1u << n))
+		{
+			message.value.node = n;
+			message.value.value = values[n];
+			RTBusPublish(bus, &message);
+		}
+	}
+	unpublished = 0;
+}
+
+
+/* Recomputes the dirty nodes of nodes and everything they are computed from */
+void ValueEngine::Update(unsigned int nodes)
+{
+	unsigned int needed = 0;
+	int n;
+
+	for (n = 0; n < VE_NOF_NODES; n++)
+	{
+		if (nodes & (1u << n))
+			needed |= inputs[n];
+	}
+	needed &= dirty;
+	if (needed == 0)
+		return;
+
+	RT_STATS_BEGIN(RT_STAGE_VALUE_ENGINE);
+	for (n = 0; n < VE_NOF_NODES; n++)
+	{
+		if (needed & (1u << n))
+		{
+			values[n] = Compute(n, values);
+			stats.nofRecomputed++;
+		}
+	}
+	dirty &= ~needed;
+	unpublished |= needed;
+	RT_STATS_END(RT_STAGE_VALUE_ENGINE);
+}
+
+
+float ValueEngine::GetValue(int node)
+{
+	if (node < 0 || node >= VE_NOF_NODES)
+		return 0.0f;
+	stats.nofQueries++;
+	if (dirty & (1u << node))
+		Update(1u << node);
+	return values[node];
+}
+
+
+float ValueEngine::GetPlayerImpact(GameEntity entity)
+{
+	if (entity < 0 || entity >= GAME_NOF_SLOTS)
+		return 0.0f;
+	return GetValue(VE_NODE_PLAYER_IMPACT(entity));
+}
+
+
+float ValueEngine::GetTeamFightValue(int team)
+{
+	if (team < 0 || team >= GAME_NOF_TEAMS)
+		return 0.0f;
+	return GetValue(VE_NODE_TEAM_FIGHT(team));
+}
+
+
+float ValueEngine::GetObjectiveValue(int team)
+{
+	if (team < 0 || team >= GAME_NOF_TEAMS)
+		return 0.0f;
+	return GetValue(VE_NODE_OBJECTIVE(team));
+}
+
+
+const char* ValueEngine::GetValueName(int node)
+{
+	if (node < 0 || node >= VE_NOF_NODES)
+		return NULL;
+	return veValues[ValueOfNode(node)].name;
+}
+
+
+const char* ValueEngine::GetEventName(int type)
+{
+	if (type < 0 || type >= VE_NOF_EVENT_TYPES)
+		return NULL;
+	return veEventEffects[type].instruction;
+}
+
+
+int ValueEngine::HasTarget(int type)
+{
+	if (type < 0 || type >= VE_NOF_EVENT_TYPES)
+		return 0;
+	return veEventEffects[type].targetStates != 0;
+}
+
+
+void ValueEngine::SetEventStore(VEEventStore* eventStore)
+{
+	store = eventStore;
+}
+
+
+void ValueEngine::SetDeferred(unsigned int nodes)
+{
+	deferred = nodes & ((1u << VE_NOF_NODES) - 1);
+}
+
+
+void ValueEngine::SetFullRecompute(int full)
+{
+	fullRecompute = full;
+}
+
+
+int ValueEngine::Verify(float tolerance)
+{
+	float scratch[VE_NOF_NODES];
+	int n, nofMismatches = 0;
+
+	Update(dirty);
+	for (n = 0; n < VE_NOF_NODES; n++)
+	{
+		scratch[n] = Compute(n, scratch);
+		if (fabsf(scratch[n] - values[n]) > tolerance)
+		{
+			LogFormat(WarningLog, "Value Engine: %s %d is %f, recomputed %f", GetValueName(n), n, values[n], scratch[n]);
+			nofMismatches++;
+		}
+	}
+	return nofMismatches;
+}
+
+
+void ValueEngine::GetStats(VEStats* out) const
+{
+	if (out != NULL)
+		*out = stats;
+}
+
+
+void ValueEngine::ResetStats()
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+
+#define VE_SNAPSHOT_MAGIC   0x4C415653u     /* "SVAL" */
+
+/* Snapshot: the event counters, then the values and the dirty marks */
+typedef struct _VESnapshot
+{
+	unsigned int    magic;
+	unsigned int    size;           /* sizeof(VESnapshot) as written */
+	float           damage[GAME_NOF_SLOTS];
+	float           healing[GAME_NOF_SLOTS];
+	int             takedowns[GAME_NOF_SLOTS];
+	int             deaths[GAME_NOF_SLOTS];
+	int             abilities[GAME_NOF_SLOTS];
+	float           objectives[GAME_NOF_TEAMS];
+	float           values[VE_NOF_NODES];
+	unsigned int    dirty;
+	unsigned int    unpublished;
+} VESnapshot;
+
+
+size_t ValueEngine::GetSnapshotSize() const
+{
+	return sizeof(VESnapshot);
+}
+
+
+int ValueEngine::SaveSnapshot(void* buffer, size_t size, size_t* written) const
+{
+	VESnapshot *snapshot = (VESnapshot*)buffer;
+
+	if (written != NULL)
+		*written = 0;
+	if (buffer == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	if (size < sizeof(VESnapshot))
+		return DU_RETURN_ILLEGAL_SIZE;
+
+	snapshot->magic = VE_SNAPSHOT_MAGIC;
+	snapshot->size = sizeof(VESnapshot);
+	memcpy(snapshot->damage, damage, sizeof(damage));
+	memcpy(snapshot->healing, healing, sizeof(healing));
+	memcpy(snapshot->takedowns, takedowns, sizeof(takedowns));
+	memcpy(snapshot->deaths, deaths, sizeof(deaths));
+	memcpy(snapshot->abilities, abilities, sizeof(abilities));
+	memcpy(snapshot->objectives, objectives, sizeof(objectives));
+	memcpy(snapshot->values, values, sizeof(values));
+	snapshot->dirty = dirty;
+	snapshot->unpublished = unpublished;
+
+	if (written != NULL)
+		*written = sizeof(VESnapshot);
+	return DU_RETURN_OK;
+}
+
+
+int ValueEngine::RestoreSnapshot(const void* buffer, size_t size)
+{
+	const VESnapshot *snapshot = (const VESnapshot*)buffer;
+	unsigned int all = (1u << VE_NOF_NODES) - 1;
+
+	if (buffer == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	if (size < sizeof(VESnapshot) || snapshot->magic != VE_SNAPSHOT_MAGIC || snapshot->size != sizeof(VESnapshot) ||
+		(snapshot->dirty & ~all) != 0 || (snapshot->unpublished & ~all) != 0)
+		return DU_RETURN_ILLEGAL_ARGUMENT;
+
+	memcpy(damage, snapshot->damage, sizeof(damage));
+	memcpy(healing, snapshot->healing, sizeof(healing));
+	memcpy(takedowns, snapshot->takedowns, sizeof(takedowns));
+	memcpy(deaths, snapshot->deaths, sizeof(deaths));
+	memcpy(abilities, snapshot->abilities, sizeof(abilities));
+	memcpy(objectives, snapshot->objectives, sizeof(objectives));
+	memcpy(values, snapshot->values, sizeof(values));
+	dirty = snapshot->dirty;
+	unpublished = snapshot->unpublished;
+	return DU_RETURN_OK;
+}
+
+
+void ValueEngine::SetCoefficients(const VECoefficients* c)
+{
+	if (c != NULL)
+		*coefficients = *c;
+}
+
+
+const VECoefficients* ValueEngine::GetCoefficients() const
+{
+	return coefficients;
+}
+
+
+int ValueEngine::MakeAction(const VEEvent* event, VEAction* action) const
+{
+	int team, enemy;
+
+	if (event == NULL || action == NULL)
+		return DU_RETURN_ILLEGAL_NULL_POINTER;
+	if (event->type < 0 || event->type >= VE_NOF_EVENT_TYPES)
+		return DU_RETURN_ILLEGAL_ARGUMENT;
+	if (event->type == VEEventObjective)
+		team = event->team;
+	else if (event->entity >= 0 && event->entity < GAME_NOF_SLOTS)
+		team = GameClass::TeamOf(event->entity);
+	else
+		return DU_RETURN_ILLEGAL_INDEX;
+	if (team < 0 || team >= GAME_NOF_TEAMS)
+		return DU_RETURN_ILLEGAL_INDEX;
+	enemy = 1 - team;
+
+	action->type = event->type;
+	action->source = event->entity;
+	action->target = event->target;
+	action->time = event->time;
+	action->amount = event->amount;
+	action->levelLead = 0.0f;
+	action->targetHp = 1.0f;
+	action->aliveLead = 0.0f;
+	if (state != NULL)
+	{
+		action->levelLead = (float)(state->teamLevel[team] - state->teamLevel[enemy]);
+		action->aliveLead = (float)(state->teamNofAlive[team] - state->teamNofAlive[enemy]);
+		if (event->target >= 0 && event->target < GAME_NOF_SLOTS && state->maxHp[event->target] > 0.0f)
+			action->targetHp = state->hp[event->target] / state->maxHp[event->target];
+	}
+	return DU_RETURN_OK;
+}
+
+
+float ValueEngine::ScoreEvent(const VEEvent* event) const
+{
+	VEAction action;
+
+	if (MakeAction(event, &action) != DU_RETURN_OK)
+		return 0.0f;
+	return VEScoreAction(coefficients, &action);
+}
+
+
+float ValueEngine::ScoreAction(const VEAction* action) const
+{
+	if (action == NULL)
+		return 0.0f;
+	return VEScoreAction(coefficients, action);
+}
+
+
+int ValueEngine::ScoreActions(const VEActionColumns* columns, float* scores, float* totals) const
+{
+	return VEScoreActions(coefficients, columns, scores, totals);
+}
+
+
+float ValueEngine::Compute(int node, const float* from) const
+{
+	switch (ValueOfNode(node))
+	{
+	case VEValuePlayerImpact:
+		return ComputePlayerImpact(node);
+	case VEValueTeamFight:
+		return ComputeTeamFight(node - VE_NODE_TEAM_FIGHT(0), from);
+	default:
+		return ComputeObjective(node - VE_NODE_OBJECTIVE(0), from);
+	}
+}
+
+
+/* reads: hp, level, alive, actions of entity */
+float ValueEngine::ComputePlayerImpact(GameEntity e) const
+{
+	float impact, hpFraction = 1.0f;
+	int level = 1, alive = 1;
+
+	if (state != NULL)
+	{
+		if (!state->used[e])
+			return 0.0f;
+		level = state->level[e];
+		alive = state->alive[e];
+		if (state->maxHp[e] > 0.0f)
+			hpFraction = state->hp[e] / state->maxHp[e];
+	}
+
+	impact = damage[e] * VE_DAMAGE_WEIGHT + healing[e] * VE_HEALING_WEIGHT +
+		takedowns[e] * VE_TAKEDOWN_WEIGHT - deaths[e] * VE_DEATH_WEIGHT + abilities[e] * VE_ABILITY_WEIGHT;
+	impact *= 1.0f + VE_LEVEL_WEIGHT * level;
+	if (alive)
+		impact *= 0.5f + 0.5f * hpFraction;
+	else
+		impact *= VE_DEAD_WEIGHT;
+	return impact;
+}
+
+
+/* reads: positions of the team, alive of every slot, player impacts of the team */
+float ValueEngine::ComputeTeamFight(int team, const float* from) const
+{
+	float sum = 0.0f, cx = 0.0f, cy = 0.0f, spread = 0.0f, dx, dy;
+	int nofAlive[GAME_NOF_TEAMS] = { 0, 0 };
+	GameEntity e;
+	int t;
+
+	for (e = GameClass::TeamBegin(team); e < GameClass::TeamEnd(team); e++)
+	{
+		if (state == NULL || (state->used[e] && state->alive[e]))
+			sum += from[VE_NODE_PLAYER_IMPACT(e)];
+	}
+	if (state == NULL)
+		return sum;
+
+	for (t = 0; t < GAME_NOF_TEAMS; t++)
+		for (e = GameClass::TeamBegin(t); e < GameClass::TeamEnd(t); e++)
+			nofAlive[t] += state->used[e] && state->alive[e];
+
+	if (nofAlive[team] > 0)
+	{
+		for (e = GameClass::TeamBegin(team); e < GameClass::TeamEnd(team); e++)
+		{
+			if (state->used[e] && state->alive[e])
+			{
+				cx += state->posX[e];
+				cy += state->posY[e];
+			}
+		}
+		cx /= nofAlive[team];
+		cy /= nofAlive[team];
+		for (e = GameClass::TeamBegin(team); e < GameClass::TeamEnd(team); e++)
+		{
+			if (state->used[e] && state->alive[e])
+			{
+				dx = state->posX[e] - cx;
+				dy = state->posY[e] - cy;
+				spread += sqrtf(dx * dx + dy * dy);
+			}
+		}
+		spread /= nofAlive[team];
+	}
+
+	sum *= 1.0f + VE_ADVANTAGE_WEIGHT * (nofAlive[team] - nofAlive[1 - team]);
+	return sum / (1.0f + spread / VE_GROUPING_DISTANCE);
+}
+
+
+/* reads: objectives of the team, levels of every slot, team fight values of both teams */
+float ValueEngine::ComputeObjective(int team, const float* from) const
+{
+	int level[GAME_NOF_TEAMS] = { 0, 0 };
+	GameEntity e;
+	int t;
+
+	if (state != NULL)
+	{
+		for (t = 0; t < GAME_NOF_TEAMS; t++)
+			for (e = GameClass::TeamBegin(t); e < GameClass::TeamEnd(t); e++)
+				if (state->used[e] && state->level[e] > level[t])
+					level[t] = state->level[e];
+	}
+
+	return objectives[team] +
+		VE_LEVEL_LEAD_WEIGHT * (level[team] - level[1 - team]) +
+		VE_FIGHT_LEAD_WEIGHT * (from[VE_NODE_TEAM_FIGHT(team)] - from[VE_NODE_TEAM_FIGHT(1 - team)]);
+}
+
+
+
+
+/*
+	END OF ValueEngine CLASS
+*/
@@ -1 +1,264 @@
 ﻿#pragma once
+
+#include "Game.h"
+#include "RTBus.h"
+
+/*
+	Value Engine: scores what happens in a match from the context it happens in.
+
+	The values are nodes of a fixed computation graph:
+
+		player impact   one per slot    damage, healing, takedowns and deaths of the player,
+		                                weighted by its level and how much of it is alive
+		team fight      one per team    impact of the alive players of the team, the numbers
+		                                advantage and how grouped the team stands
+		objective       one per team    objectives taken, the level lead and the team fight lead
+
+	Every kind of value declares the state it reads (ValueEngine.cpp, veValues), so the
+	engine knows which values an event can change. An event updates the counters of the
+	engine and marks the values that read them dirty, together with every value computed
+	from those. Nothing is computed when the event comes in: a dirty value is recomputed
+	when it is read, or for all of them at once by Tick.
+
+	The hit points, levels, positions and life of the players are read from the GameState
+	of the GameClass the engine is bound to; the host reports changes it makes there with
+	StateChanged (events imply theirs).
+
+	Full recompute mode marks every value dirty on every event, as a reference for the
+	incremental mode; Verify compares the values against a recomputation from scratch.
+
+	Subscribe connects the engine to an RTBus: actions, player updates and the start and
+	end of the game come in as typed messages, and Tick publishes the values it recomputed
+	as RT_BUS_VALUE_UPDATE. When the live mode of the RTEngine reaches
+	RT_LIVE_LEVEL_DEFER_VALUES (RT_BUS_LOAD_LEVEL) Tick leaves the non-critical values
+	dirty until they are read.
+*/
+
+
+/* State a value can read, per slot (per team for VEStateObjectives) */
+enum veState
+{
+	VEStateHp,
+	VEStateLevel,
+	VEStateAlive,
+	VEStatePosition,
+	VEStateCooldown,
+	VEStateActions,         /* damage, healing, takedowns, deaths of the player */
+	VEStateObjectives,      /* objectives of the team */
+	VE_NOF_STATES
+};
+
+#define VE_STATE_BIT(state)         (1u << (state))
+
+
+enum veValue
+{
+	VEValuePlayerImpact,
+	VEValueTeamFight,
+	VEValueObjective,
+	VE_NOF_VALUES
+};
+
+/* Values are numbered: player impacts by slot, then team fight and objective by team */
+#define VE_NODE_PLAYER_IMPACT(entity)   (entity)
+#define VE_NODE_TEAM_FIGHT(team)        (GAME_NOF_SLOTS + (team))
+#define VE_NODE_OBJECTIVE(team)         (GAME_NOF_SLOTS + GAME_NOF_TEAMS + (team))
+#define VE_NOF_NODES                    (GAME_NOF_SLOTS + 2 * GAME_NOF_TEAMS)
+/* What live mode defers first (SetDeferred): the objective values, they move slowest */
+#define VE_NODES_NON_CRITICAL           (((1u << GAME_NOF_TEAMS) - 1) << VE_NODE_OBJECTIVE(0))
+
+
+/* Events of SetCB_Action_detected and SetCB_Something_happened */
+enum veEventType
+{
+	VEEventDamage,          /* entity dealt amount to target */
+	VEEventHeal,            /* entity healed target by amount */
+	VEEventAbility,         /* entity used ability amount */
+	VEEventTakedown,        /* entity took part in the takedown of target */
+	VEEventDeath,           /* entity died */
+	VEEventRespawn,
+	VEEventLevelUp,         /* the team of entity levelled up */
+	VEEventMove,
+	VEEventObjective,       /* team took an objective worth amount */
+	VE_NOF_EVENT_TYPES
+};
+
+
+typedef struct _VEEventStruct
+{
+	int             type;           /* veEventType */
+	GameEntity      entity;
+	GameEntity      target;         /* GAME_ENTITY_NONE if the event has none */
+	int             team;           /* VEEventObjective */
+	float           amount;
+	double          time;           /* game time in seconds */
+} VEEvent;
+
+
+typedef struct _VEStatsStruct
+{
+	unsigned long   nofEvents;
+	unsigned long   nofDirtied;         /* values marked dirty by events that were clean */
+	unsigned long   nofRecomputed;      /* values computed */
+	unsigned long   nofQueries;
+	unsigned long   lastEventDirtied;   /* values the last event made dirty */
+	unsigned long   maxEventDirtied;
+	unsigned long   nofDeferred;        /* dirty values a Tick left for later (SetDeferred) */
+} VEStats;
+
+
+/* Action scores, see VEScoring.h */
+typedef struct _VECoefficientsStruct VECoefficients;
+typedef struct _VEActionStruct VEAction;
+typedef struct _VEActionColumnsStruct VEActionColumns;
+
+/* Statistics Controller, see VEEventStore.h */
+class VEEventStore;
+
+
+/* The ValueEngineContext of RTEngine.h */
+class ValueEngine
+{
+public:
+	ValueEngine();
+	~ValueEngine();
+
+	/* Reads the player state from game, NULL to unbind. Starts over. */
+	void Bind(const GameClass* game);
+	void Reset();
+
+	/*
+		Targets of SetCB_Action_detected and SetCB_Something_happened: instruction names
+		the event ("damage", "heal", "ability", "takedown", "death", "respawn", "levelUp",
+		"move", "objective"), value is a VEEvent. DU_RETURN_NOT_FOUND for an unknown one.
+		Kept for hosts that still call by name, the bus (Subscribe) compares no strings.
+	*/
+	int ActionDetected(const char* instruction, void* value, double timeStamp);
+	int SomethingHappened(const char* instruction, void* value, double timeStamp);
+
+	int HandleEvent(const VEEvent* event);
+
+	/*
+		Every event HandleEvent accepts is appended to store with its score (ScoreEvent),
+		NULL to stop. The store is not part of the snapshots: unset it while a Timeline
+		seeks, or the records applied again are stored again.
+	*/
+	void SetEventStore(VEEventStore* store);
+
+	/*
+		An event as the replay reports it: entity and target are unit ids (GameClass::AddUnit),
+		resolved through the entity index of the bound game to the players they act for, so
+		the damage of a summon counts for its summoner. The target is GAME_UNIT_ID_NONE (-1)
+		for none. DU_RETURN_NOT_FOUND if the source, or the target of an event that needs
+		one, acts for no player. RT_BUS_UNIT_ACTION messages come here.
+	*/
+	int HandleUnitEvent(const VEEvent* event);
+
+	/*
+		Handles RT_BUS_GAME_START, RT_BUS_GAME_END, RT_BUS_PLAYER_UPDATE, RT_BUS_ACTION,
+		RT_BUS_UNIT_ACTION and RT_BUS_LOAD_LEVEL of bus, and publishes RT_BUS_VALUE_UPDATE on it. One bus at a time, NULL to leave it.
+		DU_RETURN_ILLEGAL_SIZE when an opcode of bus has no room for another handler.
+	*/
+	int Subscribe(RTBus bus);
+	static void OnBusMessage(const RTBusMessage* message, void* context);
+
+	/* The host changed the VE_STATE_BIT states of entity in the GameState */
+	int StateChanged(GameEntity entity, unsigned int states);
+
+	/* Tick boundary: recomputes every dirty value that is not deferred */
+	void Tick(double time);
+
+	/*
+		Tick leaves the VE_NODE_* bits of nodes dirty, GetValue still recomputes them when
+		they are read. 0, the default, defers nothing. Kept across Reset, not in snapshots.
+	*/
+	void SetDeferred(unsigned int nodes);
+
+	/* The value of a node (VE_NODE_*), recomputed first if it is dirty */
+	float GetValue(int node);
+	float GetPlayerImpact(GameEntity entity);
+	float GetTeamFightValue(int team);
+	float GetObjectiveValue(int team);
+
+	static const char* GetValueName(int node);
+	/* The instruction name of a veEventType, NULL for an unknown one */
+	static const char* GetEventName(int type);
+	/* 1 if an event of a veEventType changes its target, which must then be a player slot */
+	static int HasTarget(int type);
+
+	/* 1: every event recomputes every value */
+	void SetFullRecompute(int full);
+
+	/*
+		Brings every value up to date and compares it with a computation from scratch.
+		Returns the number of values that differ by more than tolerance.
+	*/
+	int Verify(float tolerance);
+
+	void GetStats(VEStats* stats) const;
+	void ResetStats();
+
+	/*
+		Snapshot of the engine: the event counters and the values with their dirty marks,
+		not the bound game, the bus, the coefficients or the stats. DU_RETURN_ILLEGAL_SIZE
+		if size is too small, DU_RETURN_ILLEGAL_ARGUMENT if buffer holds no snapshot of an engine.
+	*/
+	size_t GetSnapshotSize() const;
+	int SaveSnapshot(void* buffer, size_t size, size_t* written) const;
+	int RestoreSnapshot(const void* buffer, size_t size);
+
+	/* Coefficients of the action scores, VEDefaultCoefficients until set */
+	void SetCoefficients(const VECoefficients* coefficients);
+	const VECoefficients* GetCoefficients() const;
+
+	/* The action of event with its context taken from the bound GameState */
+	int MakeAction(const VEEvent* event, VEAction* action) const;
+
+	/* Per event path: the score of event in the current state */
+	float ScoreEvent(const VEEvent* event) const;
+	float ScoreAction(const VEAction* action) const;
+
+	/* Batch path for recorded actions, bit for bit the scores of ScoreAction. See VEScoreActions. */
+	int ScoreActions(const VEActionColumns* columns, float* scores, float* totals) const;
+
+private:
+	ValueEngine(const ValueEngine&);
+	ValueEngine& operator=(const ValueEngine&);
+
+	void BuildGraph();
+	void MarkState(int state, int index);
+	void MarkNodes(unsigned int nodes);
+	void Update(unsigned int nodes);
+	/* from holds the values the node is computed from */
+	float Compute(int node, const float* from) const;
+	float ComputePlayerImpact(GameEntity entity) const;
+	float ComputeTeamFight(int team, const float* from) const;
+	float ComputeObjective(int team, const float* from) const;
+
+	const GameClass *game;
+	const GameState *state;
+	RTBus bus;
+	VEEventStore *store;
+
+	/* counters of the events */
+	float damage[GAME_NOF_SLOTS];
+	float healing[GAME_NOF_SLOTS];
+	int takedowns[GAME_NOF_SLOTS];
+	int deaths[GAME_NOF_SLOTS];
+	int abilities[GAME_NOF_SLOTS];
+	float objectives[GAME_NOF_TEAMS];
+
+	/* graph: readers[s][i] are the nodes that read state s of slot (team) i, closure[n] is
+	   n and every node computed from it, inputs[n] n and every node it is computed from */
+	unsigned int readers[VE_NOF_STATES][GAME_NOF_SLOTS];
+	unsigned int closure[VE_NOF_NODES];
+	unsigned int inputs[VE_NOF_NODES];
+
+	float values[VE_NOF_NODES];
+	unsigned int dirty;
+	unsigned int unpublished;       /* recomputed since the last Tick */
+	unsigned int deferred;          /* left dirty by Tick */
+	VECoefficients *coefficients;
+	int fullRecompute;
+	VEStats stats;
+};
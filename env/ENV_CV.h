@@ -5,12 +5,60 @@ This program is meant to be run in the background while playing Heroes of the
 Storm (All rights reserved by Activision Blizzard and Blizzard Entertainment).
 
 
-		'UI.h'			DESCRIPTION:
+		'ENV_CV.h'			DESCRIPTION:
 	
-Storage of game event functions.
+Fixed regions of the game UI the CV Engine looks at.
 
-Ex: Death, score, ...
+The regions are given for a 1920x1080 replay and are scaled to the size of the
+analysed video. The CV Engine crops every frame to them once, and the analysis
+only reads the crops.
+
+Ex: minimap, hero portraits, scoreboard, timer
 
 -----------------------------------------------------------------------------*/
 
+#ifndef _ENV_CV_H_
+#define _ENV_CV_H_
+
+
+#define ENV_CV_REFERENCE_WIDTH      1920
+#define ENV_CV_REFERENCE_HEIGHT     1080
+
+/* the portrait regions hold the portraits of the 5 players of a team side by side */
+#define ENV_CV_PORTRAITS_PER_TEAM   5
+
+
+enum envCVRegionId
+{
+	ENV_CV_MINIMAP,
+	ENV_CV_PORTRAITS_BLUE,
+	ENV_CV_PORTRAITS_RED,
+	ENV_CV_SCOREBOARD,
+	ENV_CV_TIMER,
+	ENV_CV_NOF_REGIONS
+};
+
+
+typedef struct _ENV_CVRegionStruct
+{
+	envCVRegionId   id;
+	const char     *name;
+	int             x;              /* left top corner at the reference size */
+	int             y;
+	int             width;
+	int             height;
+} ENV_CVRegionStruct;
+
+
+static const ENV_CVRegionStruct ENV_CVRegions[ENV_CV_NOF_REGIONS] =
+{
+	{ ENV_CV_MINIMAP,           "minimap",          1504,  744, 416, 336 },
+	{ ENV_CV_PORTRAITS_BLUE,    "portraits blue",    560,    0, 320,  72 },
+	{ ENV_CV_PORTRAITS_RED,     "portraits red",    1040,    0, 320,  72 },
+	{ ENV_CV_SCOREBOARD,        "scoreboard",        880,    0, 160,  40 },
+	{ ENV_CV_TIMER,             "timer",             920,   40,  80,  24 },
+};
+
+
 
+#endif // _ENV_CV_H_
@@ -7,10 +7,340 @@ Storm (All rights reserved by Activision Blizzard and Blizzard Entertainment).
 
 		'ENV_characters.h'			DESCRIPTION:
 	
-Storage of in-game character variables. 
+Storage of in-game character variables.
+
+Every hero and ability of every supported patch has one dense id (ENV_HERO_*,
+ENV_ABILITY_*). Names map to ids with a compile-time perfect hash. Each patch has
+its own flat stat arrays indexed by those ids. A hero that is not in a patch
+keeps its id and has 'available' set to 0 in that patch.
+
+To add a patch, add its ENV_HeroStats_* and ENV_AbilityStats_* arrays here and
+list them in ENV_patches.h. To add a hero, extend ENV_HERO_LIST and
+ENV_ABILITY_LIST and give every patch array a row for it.
 
 Last Patch Updated:
 2.1.231 - Blaze Patch
 
 -----------------------------------------------------------------------------*/
 
+#ifndef _ENV_CHARACTERS_H_
+#define _ENV_CHARACTERS_H_
+
+
+#include "ENV_hash.h"
+
+
+/*	HERO(id, name)	*/
+#define ENV_HERO_LIST(HERO) \
+	HERO(RAYNOR,    "Raynor") \
+	HERO(VALLA,     "Valla") \
+	HERO(MURADIN,   "Muradin") \
+	HERO(UTHER,     "Uther") \
+	HERO(JAINA,     "Jaina") \
+	HERO(DIABLO,    "Diablo") \
+	HERO(MALFURION, "Malfurion") \
+	HERO(LIMING,    "Li-Ming") \
+	HERO(SONYA,     "Sonya") \
+	HERO(BLAZE,     "Blaze")
+
+
+/*	ABILITY(id, name, hero, slot)	*/
+#define ENV_ABILITY_LIST(ABILITY) \
+	ABILITY(PENETRATING_ROUND,   "Penetrating Round",   RAYNOR,    Q) \
+	ABILITY(INSPIRE,             "Inspire",             RAYNOR,    W) \
+	ABILITY(ADRENALINE_RUSH,     "Adrenaline Rush",     RAYNOR,    E) \
+	ABILITY(HYPERION,            "Hyperion",            RAYNOR,    R) \
+	ABILITY(HUNGERING_ARROW,     "Hungering Arrow",     VALLA,     Q) \
+	ABILITY(MULTISHOT,           "Multishot",           VALLA,     W) \
+	ABILITY(VAULT,               "Vault",               VALLA,     E) \
+	ABILITY(STRAFE,              "Strafe",              VALLA,     R) \
+	ABILITY(STORM_BOLT,          "Storm Bolt",          MURADIN,   Q) \
+	ABILITY(THUNDER_CLAP,        "Thunder Clap",        MURADIN,   W) \
+	ABILITY(DWARF_TOSS,          "Dwarf Toss",          MURADIN,   E) \
+	ABILITY(AVATAR,              "Avatar",              MURADIN,   R) \
+	ABILITY(HOLY_LIGHT,          "Holy Light",          UTHER,     Q) \
+	ABILITY(HOLY_RADIANCE,       "Holy Radiance",       UTHER,     W) \
+	ABILITY(HAMMER_OF_JUSTICE,   "Hammer of Justice",   UTHER,     E) \
+	ABILITY(DIVINE_SHIELD,       "Divine Shield",       UTHER,     R) \
+	ABILITY(FROSTBOLT,           "Frostbolt",           JAINA,     Q) \
+	ABILITY(BLIZZARD,            "Blizzard",            JAINA,     W) \
+	ABILITY(CONE_OF_COLD,        "Cone of Cold",        JAINA,     E) \
+	ABILITY(RING_OF_FROST,       "Ring of Frost",       JAINA,     R) \
+	ABILITY(SHADOW_CHARGE,       "Shadow Charge",       DIABLO,    Q) \
+	ABILITY(FIRE_STOMP,          "Fire Stomp",          DIABLO,    W) \
+	ABILITY(OVERPOWER,           "Overpower",           DIABLO,    E) \
+	ABILITY(APOCALYPSE,          "Apocalypse",          DIABLO,    R) \
+	ABILITY(REGROWTH,            "Regrowth",            MALFURION, Q) \
+	ABILITY(MOONFIRE,            "Moonfire",            MALFURION, W) \
+	ABILITY(ENTANGLING_ROOTS,    "Entangling Roots",    MALFURION, E) \
+	ABILITY(TRANQUILITY,         "Tranquility",         MALFURION, R) \
+	ABILITY(MAGIC_MISSILES,      "Magic Missiles",      LIMING,    Q) \
+	ABILITY(ARCANE_ORB,          "Arcane Orb",          LIMING,    W) \
+	ABILITY(TELEPORT,            "Teleport",            LIMING,    E) \
+	ABILITY(DISINTEGRATE,        "Disintegrate",        LIMING,    R) \
+	ABILITY(ANCIENT_SPEAR,       "Ancient Spear",       SONYA,     Q) \
+	ABILITY(SEISMIC_SLAM,        "Seismic Slam",        SONYA,     W) \
+	ABILITY(WHIRLWIND,           "Whirlwind",           SONYA,     E) \
+	ABILITY(LEAP,                "Leap",                SONYA,     R) \
+	ABILITY(FLAME_STREAM,        "Flame Stream",        BLAZE,     Q) \
+	ABILITY(OIL_SPILL,           "Oil Spill",           BLAZE,     W) \
+	ABILITY(JET_PROPULSION,      "Jet Propulsion",      BLAZE,     E) \
+	ABILITY(COMBUSTION,          "Combustion",          BLAZE,     R)
+
+
+
+enum envHeroId
+{
+#define ENV_HERO_ENUM(id, name) ENV_HERO_##id,
+	ENV_HERO_LIST(ENV_HERO_ENUM)
+#undef ENV_HERO_ENUM
+	ENV_NOF_HEROES
+};
+
+
+enum envAbilityId
+{
+#define ENV_ABILITY_ENUM(id, name, hero, slot) ENV_ABILITY_##id,
+	ENV_ABILITY_LIST(ENV_ABILITY_ENUM)
+#undef ENV_ABILITY_ENUM
+	ENV_NOF_ABILITIES
+};
+
+
+/* Key of an ability, same order as the cooldown rows of GameState */
+enum envAbilitySlot
+{
+	ENV_SLOT_Q, ENV_SLOT_W, ENV_SLOT_E, ENV_SLOT_R, ENV_SLOT_TRAIT,
+	ENV_NOF_ABILITY_SLOTS
+};
+
+
+static constexpr const char* ENV_HeroNames[ENV_NOF_HEROES] =
+{
+#define ENV_HERO_NAME(id, name) name,
+	ENV_HERO_LIST(ENV_HERO_NAME)
+#undef ENV_HERO_NAME
+};
+
+
+static constexpr const char* ENV_AbilityNames[ENV_NOF_ABILITIES] =
+{
+#define ENV_ABILITY_NAME(id, name, hero, slot) name,
+	ENV_ABILITY_LIST(ENV_ABILITY_NAME)
+#undef ENV_ABILITY_NAME
+};
+
+
+/* What an ability is, the same in every patch */
+typedef struct _ENV_AbilityInfoStruct
+{
+	envAbilityId    id;
+	envHeroId       hero;
+	envAbilitySlot  slot;
+} ENV_AbilityInfoStruct;
+
+
+static constexpr ENV_AbilityInfoStruct ENV_AbilityInfo[ENV_NOF_ABILITIES] =
+{
+#define ENV_ABILITY_INFO(id, name, hero, slot) { ENV_ABILITY_##id, ENV_HERO_##hero, ENV_SLOT_##slot },
+	ENV_ABILITY_LIST(ENV_ABILITY_INFO)
+#undef ENV_ABILITY_INFO
+};
+
+
+/* Stats of a hero at level 1 in one patch */
+typedef struct _ENV_HeroStatsStruct
+{
+	envHeroId   id;
+	int         available;          /* hero is in the patch */
+	float       maxHp;
+	float       hpRegen;            /* per second */
+	float       maxMana;            /* 0 for heroes without mana */
+	float       attackDamage;
+	float       attackSpeed;        /* attacks per second */
+} ENV_HeroStatsStruct;
+
+
+/* Stats of an ability in one patch */
+typedef struct _ENV_AbilityStatsStruct
+{
+	envAbilityId    id;
+	float           cooldown;       /* seconds */
+	float           manaCost;
+} ENV_AbilityStatsStruct;
+
+
+
+/*
+	2.1.230
+*/
+
+static constexpr ENV_HeroStatsStruct ENV_HeroStats_2_1_230[ENV_NOF_HEROES] =
+{
+	{ ENV_HERO_RAYNOR,    1, 1300.0f, 2.71f, 500.0f, 100.0f, 1.00f },
+	{ ENV_HERO_VALLA,     1, 1228.0f, 2.56f, 500.0f, 104.0f, 1.25f },
+	{ ENV_HERO_MURADIN,   1, 2375.0f, 4.95f, 500.0f, 110.0f, 1.11f },
+	{ ENV_HERO_UTHER,     1, 1754.0f, 3.65f, 500.0f,  82.0f, 0.91f },
+	{ ENV_HERO_JAINA,     1, 1154.0f, 2.40f, 500.0f,  85.0f, 1.00f },
+	{ ENV_HERO_DIABLO,    1, 2400.0f, 5.00f, 500.0f, 110.0f, 1.00f },
+	{ ENV_HERO_MALFURION, 1, 1450.0f, 3.02f, 500.0f,  70.0f, 1.00f },
+	{ ENV_HERO_LIMING,    1, 1120.0f, 2.33f, 500.0f,  60.0f, 1.00f },
+	{ ENV_HERO_SONYA,     1, 2270.0f, 4.73f,   0.0f, 105.0f, 1.00f },
+	{ ENV_HERO_BLAZE,     0,    0.0f, 0.00f,   0.0f,   0.0f, 0.00f },
+};
+
+
+static constexpr ENV_AbilityStatsStruct ENV_AbilityStats_2_1_230[ENV_NOF_ABILITIES] =
+{
+	{ ENV_ABILITY_PENETRATING_ROUND,  12.0f,  50.0f },
+	{ ENV_ABILITY_INSPIRE,            16.0f,  50.0f },
+	{ ENV_ABILITY_ADRENALINE_RUSH,    40.0f,   0.0f },
+	{ ENV_ABILITY_HYPERION,           70.0f, 100.0f },
+	{ ENV_ABILITY_HUNGERING_ARROW,    10.0f,  50.0f },
+	{ ENV_ABILITY_MULTISHOT,           8.0f,  70.0f },
+	{ ENV_ABILITY_VAULT,              12.0f,  30.0f },
+	{ ENV_ABILITY_STRAFE,             70.0f,  80.0f },
+	{ ENV_ABILITY_STORM_BOLT,         10.0f,  60.0f },
+	{ ENV_ABILITY_THUNDER_CLAP,        6.0f,  40.0f },
+	{ ENV_ABILITY_DWARF_TOSS,         12.0f,  50.0f },
+	{ ENV_ABILITY_AVATAR,             90.0f, 100.0f },
+	{ ENV_ABILITY_HOLY_LIGHT,         10.0f,  90.0f },
+	{ ENV_ABILITY_HOLY_RADIANCE,      12.0f,  80.0f },
+	{ ENV_ABILITY_HAMMER_OF_JUSTICE,  12.0f,  60.0f },
+	{ ENV_ABILITY_DIVINE_SHIELD,      60.0f,  60.0f },
+	{ ENV_ABILITY_FROSTBOLT,           4.0f,  45.0f },
+	{ ENV_ABILITY_BLIZZARD,           12.0f,  80.0f },
+	{ ENV_ABILITY_CONE_OF_COLD,       10.0f,  60.0f },
+	{ ENV_ABILITY_RING_OF_FROST,      80.0f, 100.0f },
+	{ ENV_ABILITY_SHADOW_CHARGE,      12.0f,  45.0f },
+	{ ENV_ABILITY_FIRE_STOMP,          8.0f,  60.0f },
+	{ ENV_ABILITY_OVERPOWER,          12.0f,  60.0f },
+	{ ENV_ABILITY_APOCALYPSE,        100.0f, 100.0f },
+	{ ENV_ABILITY_REGROWTH,            4.0f,  60.0f },
+	{ ENV_ABILITY_MOONFIRE,            3.0f,  30.0f },
+	{ ENV_ABILITY_ENTANGLING_ROOTS,   12.0f,  70.0f },
+	{ ENV_ABILITY_TRANQUILITY,       100.0f, 100.0f },
+	{ ENV_ABILITY_MAGIC_MISSILES,      4.0f,  20.0f },
+	{ ENV_ABILITY_ARCANE_ORB,          8.0f,  60.0f },
+	{ ENV_ABILITY_TELEPORT,           10.0f,  40.0f },
+	{ ENV_ABILITY_DISINTEGRATE,       50.0f,  80.0f },
+	{ ENV_ABILITY_ANCIENT_SPEAR,      10.0f,   0.0f },
+	{ ENV_ABILITY_SEISMIC_SLAM,        0.0f,  25.0f },
+	{ ENV_ABILITY_WHIRLWIND,           6.0f,  25.0f },
+	{ ENV_ABILITY_LEAP,              100.0f,  40.0f },
+	{ ENV_ABILITY_FLAME_STREAM,        0.0f,   0.0f },
+	{ ENV_ABILITY_OIL_SPILL,           0.0f,   0.0f },
+	{ ENV_ABILITY_JET_PROPULSION,      0.0f,   0.0f },
+	{ ENV_ABILITY_COMBUSTION,          0.0f,   0.0f },
+};
+
+
+
+/*
+	2.1.231 - Blaze Patch
+*/
+
+static constexpr ENV_HeroStatsStruct ENV_HeroStats_2_1_231[ENV_NOF_HEROES] =
+{
+	{ ENV_HERO_RAYNOR,    1, 1300.0f, 2.71f, 500.0f, 100.0f, 1.00f },
+	{ ENV_HERO_VALLA,     1, 1228.0f, 2.56f, 500.0f, 104.0f, 1.25f },
+	{ ENV_HERO_MURADIN,   1, 2375.0f, 4.95f, 500.0f, 110.0f, 1.11f },
+	{ ENV_HERO_UTHER,     1, 1754.0f, 3.65f, 500.0f,  82.0f, 0.91f },
+	{ ENV_HERO_JAINA,     1, 1154.0f, 2.40f, 500.0f,  85.0f, 1.00f },
+	{ ENV_HERO_DIABLO,    1, 2400.0f, 5.00f, 500.0f, 110.0f, 1.00f },
+	{ ENV_HERO_MALFURION, 1, 1450.0f, 3.02f, 500.0f,  70.0f, 1.00f },
+	{ ENV_HERO_LIMING,    1, 1120.0f, 2.33f, 500.0f,  60.0f, 1.00f },
+	{ ENV_HERO_SONYA,     1, 2270.0f, 4.73f,   0.0f, 105.0f, 1.00f },
+	{ ENV_HERO_BLAZE,     1, 2640.0f, 5.50f, 500.0f,  93.0f, 1.00f },
+};
+
+
+static constexpr ENV_AbilityStatsStruct ENV_AbilityStats_2_1_231[ENV_NOF_ABILITIES] =
+{
+	{ ENV_ABILITY_PENETRATING_ROUND,  12.0f,  50.0f },
+	{ ENV_ABILITY_INSPIRE,            16.0f,  50.0f },
+	{ ENV_ABILITY_ADRENALINE_RUSH,    40.0f,   0.0f },
+	{ ENV_ABILITY_HYPERION,           70.0f, 100.0f },
+	{ ENV_ABILITY_HUNGERING_ARROW,    10.0f,  50.0f },
+	{ ENV_ABILITY_MULTISHOT,           8.0f,  70.0f },
+	{ ENV_ABILITY_VAULT,              12.0f,  30.0f },
+	{ ENV_ABILITY_STRAFE,             70.0f,  80.0f },
+	{ ENV_ABILITY_STORM_BOLT,         10.0f,  60.0f },
+	{ ENV_ABILITY_THUNDER_CLAP,        6.0f,  40.0f },
+	{ ENV_ABILITY_DWARF_TOSS,         12.0f,  50.0f },
+	{ ENV_ABILITY_AVATAR,             90.0f, 100.0f },
+	{ ENV_ABILITY_HOLY_LIGHT,         10.0f,  90.0f },
+	{ ENV_ABILITY_HOLY_RADIANCE,      12.0f,  80.0f },
+	{ ENV_ABILITY_HAMMER_OF_JUSTICE,  12.0f,  60.0f },
+	{ ENV_ABILITY_DIVINE_SHIELD,      60.0f,  60.0f },
+	{ ENV_ABILITY_FROSTBOLT,           4.0f,  45.0f },
+	{ ENV_ABILITY_BLIZZARD,           12.0f,  80.0f },
+	{ ENV_ABILITY_CONE_OF_COLD,       10.0f,  60.0f },
+	{ ENV_ABILITY_RING_OF_FROST,      80.0f, 100.0f },
+	{ ENV_ABILITY_SHADOW_CHARGE,      12.0f,  45.0f },
+	{ ENV_ABILITY_FIRE_STOMP,          8.0f,  60.0f },
+	{ ENV_ABILITY_OVERPOWER,          12.0f,  60.0f },
+	{ ENV_ABILITY_APOCALYPSE,        100.0f, 100.0f },
+	{ ENV_ABILITY_REGROWTH,            4.0f,  60.0f },
+	{ ENV_ABILITY_MOONFIRE,            3.0f,  30.0f },
+	{ ENV_ABILITY_ENTANGLING_ROOTS,   12.0f,  70.0f },
+	{ ENV_ABILITY_TRANQUILITY,       100.0f, 100.0f },
+	{ ENV_ABILITY_MAGIC_MISSILES,      4.0f,  20.0f },
+	{ ENV_ABILITY_ARCANE_ORB,          8.0f,  60.0f },
+	{ ENV_ABILITY_TELEPORT,           10.0f,  40.0f },
+	{ ENV_ABILITY_DISINTEGRATE,       50.0f,  80.0f },
+	{ ENV_ABILITY_ANCIENT_SPEAR,      10.0f,   0.0f },
+	{ ENV_ABILITY_SEISMIC_SLAM,        0.0f,  25.0f },
+	{ ENV_ABILITY_WHIRLWIND,           6.0f,  25.0f },
+	{ ENV_ABILITY_LEAP,              100.0f,  40.0f },
+	{ ENV_ABILITY_FLAME_STREAM,        6.0f,  40.0f },
+	{ ENV_ABILITY_OIL_SPILL,          10.0f,  50.0f },
+	{ ENV_ABILITY_JET_PROPULSION,     12.0f,  40.0f },
+	{ ENV_ABILITY_COMBUSTION,         60.0f,  60.0f },
+};
+
+
+
+/*
+	Name lookup
+*/
+
+static constexpr ENV_PerfectHashStruct<ENV_NOF_HEROES> ENV_HeroHash = ENV_BuildPerfectHash(ENV_HeroNames);
+
+static constexpr ENV_PerfectHashStruct<ENV_NOF_ABILITIES> ENV_AbilityHash = ENV_BuildPerfectHash(ENV_AbilityNames);
+
+
+/* Id of a hero name (length characters, not terminated), ENV_ID_NONE if unknown */
+static constexpr int ENV_HeroIdN(const char* name, unsigned int length)
+{
+	return ENV_PerfectHashFind(ENV_HeroHash, ENV_HeroNames, name, length);
+}
+
+static constexpr int ENV_HeroId(const char* name)
+{
+	return ENV_HeroIdN(name, ENV_NameLength(name));
+}
+
+
+/* Id of an ability name (length characters, not terminated), ENV_ID_NONE if unknown */
+static constexpr int ENV_AbilityIdN(const char* name, unsigned int length)
+{
+	return ENV_PerfectHashFind(ENV_AbilityHash, ENV_AbilityNames, name, length);
+}
+
+static constexpr int ENV_AbilityId(const char* name)
+{
+	return ENV_AbilityIdN(name, ENV_NameLength(name));
+}
+
+
+static_assert(ENV_HeroHash.found, "no perfect hash for ENV_HeroNames");
+static_assert(ENV_AbilityHash.found, "no perfect hash for ENV_AbilityNames");
+static_assert(ENV_HeroId("Blaze") == ENV_HERO_BLAZE && ENV_HeroId("Blaz") == ENV_ID_NONE, "ENV_HeroHash");
+static_assert(ENV_AbilityId("Storm Bolt") == ENV_ABILITY_STORM_BOLT, "ENV_AbilityHash");
+static_assert(ENV_TableInIdOrder(ENV_AbilityInfo), "ENV_AbilityInfo");
+static_assert(ENV_TableInIdOrder(ENV_HeroStats_2_1_230) && ENV_TableInIdOrder(ENV_AbilityStats_2_1_230), "patch 2.1.230 table out of id order");
+static_assert(ENV_TableInIdOrder(ENV_HeroStats_2_1_231) && ENV_TableInIdOrder(ENV_AbilityStats_2_1_231), "patch 2.1.231 table out of id order");
+
+
+#endif // _ENV_CHARACTERS_H_
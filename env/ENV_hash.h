@@ -0,0 +1,232 @@
+/*------------------RT ANALYSIS API FOR HEROES OF THE STORM ------------------
+
+
+This program is meant to be run in the background while playing Heroes of the
+Storm (All rights reserved by Activision Blizzard and Blizzard Entertainment).
+
+
+		'ENV_hash.h'			DESCRIPTION:
+	
+Compile-time perfect hash from the names of the ENV tables (heroes, abilities,
+maps) to their dense ids.
+
+The table of a name list is built by the compiler with hash and displace (CHD):
+the names are spread over buckets by one hash, then bucket by bucket, the largest
+first, the compiler looks for a displacement that puts every name of the bucket
+in a free slot of its own. A bucket holds about two names, so a displacement is
+found in a few tries even for the last buckets, and the build stays linear in the
+number of names (a single seed for the whole list has to be searched for longer
+and longer as the list grows, and stops being found at a few hundred names).
+
+A lookup is one hash of the name, one displacement and one slot read, and one
+compare that rejects unknown names. Names known at compile time resolve to a
+constant id.
+
+-----------------------------------------------------------------------------*/
+
+#ifndef _ENV_HASH_H_
+#define _ENV_HASH_H_
+
+
+#define ENV_ID_NONE                 (-1)
+
+#define ENV_NAME_HASH_BASIS         2166136261u
+#define ENV_NAME_HASH_PRIME         16777619u
+
+
+/* Seeded FNV-1a of the first length characters of name */
+constexpr unsigned int ENV_NameHash(const char* name, unsigned int length, unsigned int seed)
+{
+	unsigned int hash = ENV_NAME_HASH_BASIS ^ (seed * ENV_NAME_HASH_PRIME);
+	unsigned int i = 0;
+
+	for (i = 0; i < length; i++)
+	{
+		hash ^= (unsigned char)name[i];
+		hash *= ENV_NAME_HASH_PRIME;
+	}
+	/* the slot is taken from the low bits, fold the high ones in */
+	return hash ^ (hash >> 16);
+}
+
+
+constexpr unsigned int ENV_NameLength(const char* name)
+{
+	unsigned int length = 0;
+
+	while (name[length] != '\0')
+		length++;
+	return length;
+}
+
+
+/* name (length characters, not terminated) equals the terminated tableName */
+constexpr int ENV_NameEqual(const char* tableName, const char* name, unsigned int length)
+{
+	unsigned int i = 0;
+
+	for (i = 0; i < length; i++)
+	{
+		if (tableName[i] != name[i])
+			return 0;
+	}
+	return tableName[length] == '\0';
+}
+
+
+constexpr int ENV_PowerOf2AtLeast(int n)
+{
+	int size = 1;
+
+	while (size < n)
+		size <<= 1;
+	return size;
+}
+
+
+/* Slots of a name list: a power of 2, at most half of them taken */
+constexpr int ENV_PerfectHashSize(int nofNames)
+{
+	return ENV_PowerOf2AtLeast(2 * nofNames);
+}
+
+/* Buckets of a name list: a power of 2, one or two names each on average */
+constexpr int ENV_PerfectHashBuckets(int nofNames)
+{
+	return ENV_PowerOf2AtLeast((nofNames + 1) / 2);
+}
+
+
+/* Second hash of a name for its slot, mixed from the first (murmur3 finalizer) */
+constexpr unsigned int ENV_NameHashMix(unsigned int hash)
+{
+	hash *= 0x85EBCA6Bu;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35u;
+	return hash ^ (hash >> 16);
+}
+
+
+/*
+	The bucket of a name comes from the low bits of its hash, its slot is base + d * step
+	with base the mixed hash and step the odd high bits of the hash: with an odd step the
+	displacements 0 .. SIZE - 1 put a name in every slot once.
+*/
+constexpr unsigned int ENV_PerfectHashSlot(unsigned int hash, unsigned int displacement, int size)
+{
+	return (ENV_NameHashMix(hash) + displacement * ((hash >> 16) | 1u)) & (unsigned int)(size - 1);
+}
+
+
+template <int N>
+struct ENV_PerfectHashStruct
+{
+	static constexpr int SIZE = ENV_PerfectHashSize(N);
+	static constexpr int BUCKETS = ENV_PerfectHashBuckets(N);
+
+	int found;                                  /* 0 if a bucket had no displacement */
+	unsigned short displacements[BUCKETS];
+	short slots[SIZE];                          /* id of the name in the slot, ENV_ID_NONE if none */
+};
+
+
+template <int N>
+constexpr ENV_PerfectHashStruct<N> ENV_BuildPerfectHash(const char* const (&names)[N])
+{
+	typedef ENV_PerfectHashStruct<N> Table;
+	Table table = {};
+	unsigned int hashes[N] = {};
+	int bucketOf[N] = {};
+	int members[N] = {};                        /* the names by bucket */
+	int first[Table::BUCKETS + 1] = {};         /* members of bucket b: first[b] .. first[b + 1] - 1 */
+	int count[Table::BUCKETS] = {};
+	int maxCount = 0;
+	int size = 0, b = 0, i = 0, k = 0;
+	unsigned int d = 0;
+
+	for (i = 0; i < Table::SIZE; i++)
+		table.slots[i] = ENV_ID_NONE;
+	for (i = 0; i < N; i++)
+	{
+		hashes[i] = ENV_NameHash(names[i], ENV_NameLength(names[i]), 0);
+		bucketOf[i] = (int)(hashes[i] & (Table::BUCKETS - 1));
+		count[bucketOf[i]]++;
+	}
+	for (b = 0; b < Table::BUCKETS; b++)
+	{
+		first[b + 1] = first[b] + count[b];
+		maxCount = (count[b] > maxCount) ? count[b] : maxCount;
+		count[b] = 0;
+	}
+	for (i = 0; i < N; i++)
+		members[first[bucketOf[i]] + count[bucketOf[i]]++] = i;
+
+	/* the largest buckets first, while most slots are free */
+	table.found = 1;
+	for (size = maxCount; size > 0 && table.found; size--)
+	{
+		for (b = 0; b < Table::BUCKETS && table.found; b++)
+		{
+			int placed = 0;
+
+			if (count[b] != size)
+				continue;
+			for (d = 0; d < (unsigned int)Table::SIZE && !placed; d++)
+			{
+				/* every name of the bucket in a free slot, two names of it not in the same one */
+				for (k = first[b]; k < first[b + 1]; k++)
+				{
+					unsigned int slot = ENV_PerfectHashSlot(hashes[members[k]], d, Table::SIZE);
+
+					if (table.slots[slot] != ENV_ID_NONE)
+						break;
+					table.slots[slot] = (short)members[k];
+				}
+				placed = (k == first[b + 1]);
+				if (!placed)
+				{
+					while (--k >= first[b])
+						table.slots[ENV_PerfectHashSlot(hashes[members[k]], d, Table::SIZE)] = ENV_ID_NONE;
+				}
+			}
+			if (placed)
+				table.displacements[b] = (unsigned short)(d - 1);
+			else
+				table.found = 0;
+		}
+	}
+	return table;
+}
+
+
+/* Id of name (length characters) in names, ENV_ID_NONE if it is not one of them */
+template <int N>
+constexpr int ENV_PerfectHashFind(const ENV_PerfectHashStruct<N>& table, const char* const (&names)[N],
+                                  const char* name, unsigned int length)
+{
+	typedef ENV_PerfectHashStruct<N> Table;
+	unsigned int hash = ENV_NameHash(name, length, 0);
+	unsigned int slot = ENV_PerfectHashSlot(hash, table.displacements[hash & (Table::BUCKETS - 1)], Table::SIZE);
+	int id = table.slots[slot];
+
+	return (id != ENV_ID_NONE && ENV_NameEqual(names[id], name, length)) ? id : ENV_ID_NONE;
+}
+
+
+/* Rows of a patch table carry their id, they must be in id order */
+template <class ROW, int N>
+constexpr int ENV_TableInIdOrder(const ROW (&rows)[N])
+{
+	int i = 0;
+
+	for (i = 0; i < N; i++)
+	{
+		if ((int)rows[i].id != i)
+			return 0;
+	}
+	return 1;
+}
+
+
+
+#endif // _ENV_HASH_H_
@@ -10,12 +10,103 @@ Storm (All rights reserved by Activision Blizzard and Blizzard Entertainment).
 Storage of environmental variables that define each Heroes of the Storm map
 on the present pool.
 
+Every map has a dense id (ENV_MAP_*). Names map to ids with the compile-time
+perfect hash of ENV_hash.h. Each patch has a flat array indexed by map id,
+same as the hero tables of ENV_characters.h.
+
 List of supported maps:
 
 	- Cursed Hollow
 
 -----------------------------------------------------------------------------*/
 
+#ifndef _ENV_MAPS_H_
+#define _ENV_MAPS_H_
+
+
+#include "ENV_hash.h"
+
+
+/*	MAP(id, name)	*/
+#define ENV_MAP_LIST(MAP) \
+	MAP(CURSED_HOLLOW,  "Cursed Hollow")
+
+
+
+enum envMapId
+{
+#define ENV_MAP_ENUM(id, name) ENV_MAP_##id,
+	ENV_MAP_LIST(ENV_MAP_ENUM)
+#undef ENV_MAP_ENUM
+	ENV_NOF_MAPS
+};
+
+
+static constexpr const char* ENV_MapNames[ENV_NOF_MAPS] =
+{
+#define ENV_MAP_NAME(id, name) name,
+	ENV_MAP_LIST(ENV_MAP_NAME)
+#undef ENV_MAP_NAME
+};
+
+
+/* Definition of a map in one patch */
+typedef struct _ENV_MapStruct
+{
+	envMapId    id;
+	int         available;              /* map is in the pool of the patch */
+	int         nofLanes;
+	int         nofForts;               /* per team */
+	int         nofKeeps;               /* per team */
+	float       objectiveFirstSpawn;    /* game time in seconds */
+	float       objectiveInterval;      /* seconds between two objectives */
+} ENV_MapStruct;
+
+
+
+/*
+	2.1.230
+*/
+
+static constexpr ENV_MapStruct ENV_Maps_2_1_230[ENV_NOF_MAPS] =
+{
+	{ ENV_MAP_CURSED_HOLLOW, 1, 3, 3, 3, 150.0f, 180.0f },
+};
+
+
+/*
+	2.1.231 - Blaze Patch
+*/
+
+static constexpr ENV_MapStruct ENV_Maps_2_1_231[ENV_NOF_MAPS] =
+{
+	{ ENV_MAP_CURSED_HOLLOW, 1, 3, 3, 3, 150.0f, 180.0f },
+};
+
+
+
+/*
+	Name lookup
+*/
+
+static constexpr ENV_PerfectHashStruct<ENV_NOF_MAPS> ENV_MapHash = ENV_BuildPerfectHash(ENV_MapNames);
+
+
+/* Id of a map name (length characters, not terminated), ENV_ID_NONE if unknown */
+static constexpr int ENV_MapIdN(const char* name, unsigned int length)
+{
+	return ENV_PerfectHashFind(ENV_MapHash, ENV_MapNames, name, length);
+}
+
+static constexpr int ENV_MapId(const char* name)
+{
+	return ENV_MapIdN(name, ENV_NameLength(name));
+}
+
 
+static_assert(ENV_MapHash.found, "no perfect hash for ENV_MapNames");
+static_assert(ENV_MapId("Cursed Hollow") == ENV_MAP_CURSED_HOLLOW, "ENV_MapHash");
+static_assert(ENV_TableInIdOrder(ENV_Maps_2_1_230) && ENV_TableInIdOrder(ENV_Maps_2_1_231), "map table out of id order");
 
 
+#endif // _ENV_MAPS_H_
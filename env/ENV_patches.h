@@ -0,0 +1,76 @@
+/*------------------RT ANALYSIS API FOR HEROES OF THE STORM ------------------
+
+
+This program is meant to be run in the background while playing Heroes of the
+Storm (All rights reserved by Activision Blizzard and Blizzard Entertainment).
+
+
+		'ENV_patches.h'			DESCRIPTION:
+	
+Every supported patch, built side by side.
+
+A patch is picked at run time by its version string (ENV_FindPatch). The lookups
+after that index the flat arrays of the patch by the dense ids of
+ENV_characters.h and ENV_maps.h:
+
+	const ENV_PatchStruct *patch = ENV_FindPatch("2.1.231");
+	int ability = ENV_AbilityIdN(name, length);
+
+	if (patch != NULL && ability != ENV_ID_NONE)
+		cooldown = patch->abilities[ability].cooldown;
+
+Keep the newest patch last, it is the default.
+
+-----------------------------------------------------------------------------*/
+
+#ifndef _ENV_PATCHES_H_
+#define _ENV_PATCHES_H_
+
+
+#include <string.h>
+
+#include "ENV_characters.h"
+#include "ENV_maps.h"
+
+
+typedef struct _ENV_PatchStruct
+{
+	const char                      *version;
+	const ENV_HeroStatsStruct       *heroes;        /* [ENV_NOF_HEROES] */
+	const ENV_AbilityStatsStruct    *abilities;     /* [ENV_NOF_ABILITIES] */
+	const ENV_MapStruct             *maps;          /* [ENV_NOF_MAPS] */
+} ENV_PatchStruct;
+
+
+static constexpr ENV_PatchStruct ENV_Patches[] =
+{
+	{ "2.1.230", ENV_HeroStats_2_1_230, ENV_AbilityStats_2_1_230, ENV_Maps_2_1_230 },
+	{ "2.1.231", ENV_HeroStats_2_1_231, ENV_AbilityStats_2_1_231, ENV_Maps_2_1_231 },
+};
+
+#define ENV_NOF_PATCHES ((int)(sizeof(ENV_Patches) / sizeof(ENV_Patches[0])))
+
+
+static inline const ENV_PatchStruct* ENV_LatestPatch()
+{
+	return &ENV_Patches[ENV_NOF_PATCHES - 1];
+}
+
+
+/* Patch with the given version, NULL if it is not supported */
+static inline const ENV_PatchStruct* ENV_FindPatch(const char* version)
+{
+	int i;
+
+	if (version == NULL)
+		return NULL;
+	for (i = 0; i < ENV_NOF_PATCHES; i++)
+	{
+		if (strcmp(ENV_Patches[i].version, version) == 0)
+			return &ENV_Patches[i];
+	}
+	return NULL;
+}
+
+
+#endif // _ENV_PATCHES_H_
@@ -1,5 +1,13 @@
 #include <iostream>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
 #include "Game.h"
+#include "Batch.h"
+#include "CVEngine.h"
+#include "ValueEngine.h"
+#include "VEScoring.h"
+#include "RTStats.h"
 
 
 using namespace std;
@@ -9,8 +17,243 @@ static LoggingObject glLog;
 
 
 
-int main()
+/* the lines of the hot path stats, to the stats log and the console */
+static void WriteStatsLine(const char* line, void* context)
 {
+	(void)context;
+	LogMessage(line);
+	printf("%s\n", line);
+}
+
+
+/*
+	StormValue --batch [-j workers] [--stats | --stats-json] replay.log ...
+	Analyses the replay logs in parallel and prints the throughput, with --stats also the
+	latencies of the stages of RTEngine (see RTStats.h).
+*/
+static int RunBatch(int argc, char* argv[])
+{
+	BatchClass batch;
+	BatchThroughput throughput;
+	int nofWorkers = 0;
+	int statsFormat = -1;
+	int i;
+
+	for (i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			nofWorkers = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--stats") == 0)
+			statsFormat = RT_STATS_FORMAT_TEXT;
+		else if (strcmp(argv[i], "--stats-json") == 0)
+			statsFormat = RT_STATS_FORMAT_JSON;
+		else
+			batch.AddReplay(argv[i]);
+	}
+	if (statsFormat >= 0)
+	{
+		InitLog("stats", MessageLog);
+		RTStatsReset();
+	}
+
+	if (batch.Run(nofWorkers, &throughput) != RT_RETURN_OK)
+		return 1;
+
+	for (i = 0; i < batch.GetNofReplays(); i++)
+	{
+		const BatchReplayResult *result = batch.GetResult(i);
+
+		if (result->ret != RT_RETURN_OK)
+			fprintf(stderr, "%s: error %d\n", result->path, result->ret);
+	}
+	BatchClass::PrintThroughput(stdout, &throughput);
+
+	if (statsFormat >= 0)
+	{
+		if (RTStatsWrite(statsFormat, WriteStatsLine, NULL) == RT_RETURN_NOT_IMPLEMENTED)
+			fprintf(stderr, "built without stats (RT_NO_STATS)\n");
+		CloseLogFiles();
+	}
+	return throughput.nofFailed != 0;
+}
+
+
+
+/*
+	StormValue --cv [--realtime] [--speed x] replay.y4m
+	Runs the CV Engine pipeline on a recorded replay and prints the frames/s of every stage.
+*/
+static int RunVideo(int argc, char* argv[])
+{
+	CVPipelineSettings settings;
+	CVPipelineStats stats;
+	RTInstanceSettings instanceSettings;
+	RTEngineInstance instance;
+	CVPipeline pipeline;
+	const char *path = NULL;
+	int ret;
+	int i;
+
+	memset(&settings, 0, sizeof(settings));
+	for (i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--realtime") == 0)
+			settings.realTime = 1;
+		else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc)
+			settings.replaySpeed = atof(argv[++i]);
+		else
+			path = argv[i];
+	}
+	if (path == NULL)
+	{
+		fprintf(stderr, "no video given\n");
+		return 1;
+	}
+
+	memset(&instanceSettings, 0, sizeof(instanceSettings));
+	instanceSettings.synchronous = 1;
+	ret = RTInstanceCreate("CV", &instanceSettings, &instance);
+	if (ret != RT_RETURN_OK)
+		return 1;
+
+	settings.instance = instance;
+	ret = CVPipelineOpen(path, &settings, &pipeline);
+	if (ret != RT_RETURN_OK)
+	{
+		fprintf(stderr, "%s: error %d\n", path, ret);
+		RTInstanceDestroy(instance);
+		return 1;
+	}
+	CVPipelineWait(pipeline);
+	CVPipelineGetStats(pipeline, &stats);
+	CVPipelineClose(pipeline);
+	RTInstanceDestroy(instance);
+
+	CVPipelinePrintStats(stdout, &stats);
+	return stats.nofErrors != 0;
+}
+
+
+
+/*
+	StormValue --score-bench [actions]
+	Scores random actions one by one through the Value Engine and as columns, prints the
+	actions/s of both paths and checks that they give the same bits.
+*/
+static int RunScoreBench(int argc, char* argv[])
+{
+	ValueEngineContext engine = new ValueEngine;
+	VEActionColumns columns;
+	VEAction action;
+	int *type;
+	GameEntity *source, *target;
+	double *time;
+	float *amount, *levelLead, *targetHp, *aliveLead, *single, *batch;
+	float totals[GAME_NOF_SLOTS];
+	std::chrono::steady_clock::time_point start;
+	double singleSeconds, batchSeconds;
+	int count = (argc > 2) ? atoi(argv[2]) : 4000000;
+	int nofDiffs = 0;
+	int ret, i;
+
+	if (count <= 0)
+		count = 4000000;
+	type = (int*)malloc(count * sizeof(int));
+	source = (GameEntity*)malloc(count * sizeof(GameEntity));
+	target = (GameEntity*)malloc(count * sizeof(GameEntity));
+	time = (double*)malloc(count * sizeof(double));
+	amount = (float*)malloc(count * sizeof(float));
+	levelLead = (float*)malloc(count * sizeof(float));
+	targetHp = (float*)malloc(count * sizeof(float));
+	aliveLead = (float*)malloc(count * sizeof(float));
+	single = (float*)malloc(count * sizeof(float));
+	batch = (float*)malloc(count * sizeof(float));
+	if (type == NULL || source == NULL || target == NULL || time == NULL || amount == NULL ||
+		levelLead == NULL || targetHp == NULL || aliveLead == NULL || single == NULL || batch == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	srand(1);
+	for (i = 0; i < count; i++)
+	{
+		type[i] = rand() % VE_NOF_EVENT_TYPES;
+		source[i] = rand() % GAME_NOF_SLOTS;
+		target[i] = rand() % GAME_NOF_SLOTS;
+		time[i] = i * (1800.0 / count);
+		amount[i] = (float)(rand() % 2000);
+		levelLead[i] = (float)(rand() % 9 - 4);
+		targetHp[i] = (rand() % 1001) / 1000.0f;
+		aliveLead[i] = (float)(rand() % 11 - 5);
+	}
+
+	start = std::chrono::steady_clock::now();
+	for (i = 0; i < count; i++)
+	{
+		action.type = type[i];
+		action.source = source[i];
+		action.target = target[i];
+		action.time = time[i];
+		action.amount = amount[i];
+		action.levelLead = levelLead[i];
+		action.targetHp = targetHp[i];
+		action.aliveLead = aliveLead[i];
+		single[i] = engine->ScoreAction(&action);
+	}
+	singleSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	columns.count = count;
+	columns.type = type;
+	columns.source = source;
+	columns.target = target;
+	columns.time = time;
+	columns.amount = amount;
+	columns.levelLead = levelLead;
+	columns.targetHp = targetHp;
+	columns.aliveLead = aliveLead;
+	memset(totals, 0, sizeof(totals));
+	start = std::chrono::steady_clock::now();
+	ret = engine->ScoreActions(&columns, batch, totals);
+	batchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	for (i = 0; i < count; i++)
+	{
+		if (memcmp(&single[i], &batch[i], sizeof(float)) != 0)
+			nofDiffs++;
+	}
+
+	printf("%d actions, %s kernel\n", count, VEGetScoreKernelName());
+	printf("per action: %.3f s, %.0f actions/s\n", singleSeconds, count / singleSeconds);
+	printf("batch:      %.3f s, %.0f actions/s (%.1fx)\n", batchSeconds, count / batchSeconds,
+	       singleSeconds / batchSeconds);
+	printf("%d scores differ\n", nofDiffs);
+
+	free(type);
+	free(source);
+	free(target);
+	free(time);
+	free(amount);
+	free(levelLead);
+	free(targetHp);
+	free(aliveLead);
+	free(single);
+	free(batch);
+	delete engine;
+	return (ret != DU_RETURN_OK || nofDiffs != 0);
+}
+
+
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && strcmp(argv[1], "--batch") == 0)
+		return RunBatch(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--cv") == 0)
+		return RunVideo(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--score-bench") == 0)
+		return RunScoreBench(argc, argv);
+
 	DuList test;
 	DuListCreate(&test);
 	cout << "Hello, World!";